@@ -1,6 +1,11 @@
 #ifndef CANMORE__ETHERNET_DEFS_H_
 #define CANMORE__ETHERNET_DEFS_H_
 
+#include "canmore/protocol.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -39,6 +44,79 @@ extern "C" {
 // Packets sent larger than this length may not be received properly
 #define CANMORE_ETH_UDP_MAX_LEN 512
 
+/*
+ * CANmore Message Port
+ * ====================
+ *
+ * CANmore messages (such as DDS-XRCE packets) are carried over UDP with one message per datagram, rather than being
+ * fragmented into frames. As UDP already provides the length and a checksum, the message is sent directly after a short
+ * header carrying the metadata normally stored in the CAN IDs:
+ *
+ *   +--------+--------+--------+--------+--------+--------+-----+
+ *   |  Addr  | Subtyp |     Length      |  Data 0  |  Data 1  | ... |
+ *   +--------+--------+--------+--------+--------+--------+-----+
+ *
+ * Addr: Bits 0-4 hold the client ID (0 for agent-to-client broadcast), bit 5 holds the direction (same values as the
+ * CAN direction bit), and bits 6-7 are reserved and must be 0
+ *
+ * Subtype: The message subtype (see CANMORE_MSG_SUBTYPE_*), in the lower 6 bits
+ *
+ * Length: The length of the message data, little-endian. This must match the length of the data in the datagram
+ *
+ * Unlike the control interface, a single agent socket serves all clients on the network. Clients send datagrams to the
+ * agent's message port, and the agent replies to the address which each client last sent from.
+ */
+
+#define CANMORE_ETH_MSG_PORT 2203
+
+// The length of the header at the start of every datagram on the message port
+#define CANMORE_ETH_MSG_HEADER_LEN 4
+
+// The max length of a datagram sent on the message port
+#define CANMORE_ETH_MSG_MAX_LEN (CANMORE_ETH_MSG_HEADER_LEN + CANMORE_MAX_MSG_LENGTH)
+
+/**
+ * @brief Decoded fields of the message port header
+ *
+ * This is not the wire format, use canmore_eth_msg_header_pack/canmore_eth_msg_header_unpack to convert to and from the
+ * CANMORE_ETH_MSG_HEADER_LEN bytes sent at the start of the datagram.
+ */
+struct canmore_eth_msg_header {
+    uint8_t client_id;
+    uint8_t direction;
+    uint8_t subtype;
+    uint16_t length;
+};
+
+/**
+ * @brief Packs the header into the bytes sent at the start of a message port datagram
+ *
+ * @param header The header to pack. Fields wider than their wire encoding are masked
+ * @param buf The buffer to pack into, must be at least CANMORE_ETH_MSG_HEADER_LEN bytes
+ */
+static inline void canmore_eth_msg_header_pack(const struct canmore_eth_msg_header *header, uint8_t *buf) {
+    buf[0] = (header->client_id & ((1u << CANMORE_CLIENT_ID_LENGTH) - 1)) |
+             ((header->direction & ((1u << CANMORE_DIRECTION_LENGTH) - 1)) << CANMORE_CLIENT_ID_LENGTH);
+    buf[1] = header->subtype;
+    buf[2] = header->length & 0xFF;
+    buf[3] = header->length >> 8;
+}
+
+/**
+ * @brief Unpacks the header from the bytes at the start of a message port datagram
+ *
+ * @param buf The start of the datagram, must be at least CANMORE_ETH_MSG_HEADER_LEN bytes
+ * @param header The header to unpack into
+ * @return true if the header is valid, false if reserved bits in the address byte are set
+ */
+static inline bool canmore_eth_msg_header_unpack(const uint8_t *buf, struct canmore_eth_msg_header *header) {
+    header->client_id = buf[0] & ((1u << CANMORE_CLIENT_ID_LENGTH) - 1);
+    header->direction = (buf[0] >> CANMORE_CLIENT_ID_LENGTH) & ((1u << CANMORE_DIRECTION_LENGTH) - 1);
+    header->subtype = buf[1];
+    header->length = buf[2] | ((uint16_t) buf[3] << 8);
+    return (buf[0] >> (CANMORE_CLIENT_ID_LENGTH + CANMORE_DIRECTION_LENGTH)) == 0;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,187 @@
+#ifndef CANMORE__MSG_AGGREGATION_H_
+#define CANMORE__MSG_AGGREGATION_H_
+
+#include "canmore/protocol.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file canmore/msg_aggregation.h
+ *
+ * @brief API for packing several small messages into a single CANmore message
+ *
+ * Every CANmore message is sent with an extended first frame, and if fragmented, an extended last frame. For small
+ * messages this overhead can be larger than the message itself. Aggregate messages (subtype
+ * CANMORE_MSG_SUBTYPE_AGGREGATE) carry several messages for the same client in one CANmore message, so the overhead is
+ * only paid once.
+ *
+ * The aggregate message contains one or more entries back to back, each with the following format:
+ *
+ *  Byte:  0          1          2 ...
+ *       | HEADER (little endian) | DATA (LENGTH + 1 bytes) |
+ *
+ * Header bits (as a 16-bit little endian integer):
+ *
+ *   Bit:  15        10 9                  0
+ *       | MSG SUBTYPE |    LENGTH - 1      |
+ *
+ * MSG SUBTYPE: The subtype of the contained message. This must not be CANMORE_MSG_SUBTYPE_AGGREGATE
+ * LENGTH: The length of the contained message, minus 1 (messages must not be empty)
+ *
+ * Each entry is delivered to the receiver as if it were sent as a separate message, in the order they were packed.
+ */
+
+/**
+ * @brief Size of the header before each entry in an aggregate message
+ */
+#define CANMORE_MSG_AGGREGATE_ENTRY_HEADER_SIZE 2
+
+/**
+ * @brief Maximum length of a single message packed into an aggregate message
+ */
+#define CANMORE_MSG_AGGREGATE_MAX_ENTRY_LENGTH (CANMORE_MAX_MSG_LENGTH - CANMORE_MSG_AGGREGATE_ENTRY_HEADER_SIZE)
+
+// ========================================
+// Aggregate Message Packing
+// ========================================
+
+/**
+ * @brief Struct containing the state for packing an aggregate message
+ *
+ * Do not modify this struct directly! Use the `canmore_msg_aggregate_` set of functions instead
+ */
+typedef struct canmore_msg_aggregator_state {
+    // The buffer the aggregate message is packed into
+    uint8_t *buffer;
+    // The size of buffer
+    size_t capacity;
+    // The length of the aggregate message packed so far
+    size_t len;
+    // The number of entries packed so far
+    size_t count;
+} canmore_msg_aggregator_t;
+
+/**
+ * @brief Initializes a new aggregate message packer
+ *
+ * @param state Pointer to aggregator state struct to store internal state
+ * @param buffer Buffer to pack the aggregate message into
+ * @param capacity Size of buffer in bytes (values above CANMORE_MAX_MSG_LENGTH are clamped)
+ */
+void canmore_msg_aggregate_init(canmore_msg_aggregator_t *state, uint8_t *buffer, size_t capacity);
+
+/**
+ * @brief Discards all packed entries, so the next message can be packed
+ *
+ * @param state Pointer to aggregator state data struct
+ */
+static inline void canmore_msg_aggregate_reset(canmore_msg_aggregator_t *state) {
+    state->len = 0;
+    state->count = 0;
+}
+
+/**
+ * @brief Checks if a message of the given length will fit in the aggregate message
+ *
+ * @param state Pointer to aggregator state data struct
+ * @param len The length of the message to add
+ * @return true The message can be added with canmore_msg_aggregate_add
+ */
+static inline bool canmore_msg_aggregate_fits(const canmore_msg_aggregator_t *state, size_t len) {
+    return len > 0 && len <= CANMORE_MSG_AGGREGATE_MAX_ENTRY_LENGTH &&
+           state->len + CANMORE_MSG_AGGREGATE_ENTRY_HEADER_SIZE + len <= state->capacity;
+}
+
+/**
+ * @brief Packs a message into the aggregate message
+ *
+ * @param state Pointer to aggregator state data struct
+ * @param subtype The subtype of the message (must not be CANMORE_MSG_SUBTYPE_AGGREGATE)
+ * @param data The message data
+ * @param len The length of the message
+ * @return true The message was added
+ * @return false The message was not added, as it does not fit or the subtype is invalid
+ */
+bool canmore_msg_aggregate_add(canmore_msg_aggregator_t *state, uint8_t subtype, const uint8_t *data, size_t len);
+
+/**
+ * @brief Returns the number of entries packed into the aggregate message
+ *
+ * @param state Pointer to aggregator state data struct
+ */
+static inline size_t canmore_msg_aggregate_get_count(const canmore_msg_aggregator_t *state) {
+    return state->count;
+}
+
+/**
+ * @brief Returns the length of the packed aggregate message, to be transmitted from the buffer passed to init
+ *
+ * @param state Pointer to aggregator state data struct
+ */
+static inline size_t canmore_msg_aggregate_get_len(const canmore_msg_aggregator_t *state) {
+    return state->len;
+}
+
+// ========================================
+// Aggregate Message Unpacking
+// ========================================
+
+/**
+ * @brief Struct containing the state for reading the entries from a received aggregate message
+ *
+ * Do not modify this struct directly! Use the `canmore_msg_aggregate_iter_` set of functions instead
+ */
+typedef struct canmore_msg_aggregate_iter_state {
+    // The received aggregate message
+    const uint8_t *buffer;
+    // The length of the aggregate message
+    size_t len;
+    // The position of the next entry header
+    size_t position;
+    // Set if an invalid entry was found
+    bool malformed;
+} canmore_msg_aggregate_iter_t;
+
+/**
+ * @brief Initializes a reader for a received aggregate message
+ *
+ * @param state Pointer to iterator state struct to store internal state
+ * @param buffer The aggregate message. Must remain valid while iterating
+ * @param len The length of the aggregate message
+ */
+void canmore_msg_aggregate_iter_init(canmore_msg_aggregate_iter_t *state, const uint8_t *buffer, size_t len);
+
+/**
+ * @brief Reads the next entry from the aggregate message
+ *
+ * @param state Pointer to iterator state data struct
+ * @param subtype_out Pointer to write the subtype of the entry
+ * @param data_out Pointer to write the entry data pointer (pointing into the aggregate message buffer)
+ * @param len_out Pointer to write the length of the entry
+ * @return true An entry was read
+ * @return false There are no more entries, or the message is malformed (see canmore_msg_aggregate_iter_malformed)
+ */
+bool canmore_msg_aggregate_iter_next(canmore_msg_aggregate_iter_t *state, uint8_t *subtype_out,
+                                     const uint8_t **data_out, size_t *len_out);
+
+/**
+ * @brief Checks if iteration stopped due to a malformed entry. Entries before the malformed entry are still valid
+ *
+ * @param state Pointer to iterator state data struct
+ * @return true The aggregate message contained an invalid entry
+ */
+static inline bool canmore_msg_aggregate_iter_malformed(const canmore_msg_aggregate_iter_t *state) {
+    return state->malformed;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
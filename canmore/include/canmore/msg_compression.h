@@ -0,0 +1,84 @@
+#ifndef CANMORE__MSG_COMPRESSION_H_
+#define CANMORE__MSG_COMPRESSION_H_
+
+#include "canmore/protocol.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file canmore/msg_compression.h
+ *
+ * @brief API for compressing large messages to reduce the number of frames sent on the bus
+ *
+ * Compressed messages (subtype CANMORE_MSG_SUBTYPE_COMPRESSED) contain another message compressed with an LZ4
+ * compatible block codec. The codec requires no heap allocation, with the compressor using 512 bytes of stack for its
+ * match table and the decompressor requiring no working memory beyond the output buffer.
+ *
+ * The compressed message has the following format:
+ *
+ *  Byte:  0               1          2          3 ...
+ *       | INNER SUBTYPE | LENGTH (little endian) | LZ4 BLOCK |
+ *
+ * INNER SUBTYPE: The subtype of the uncompressed message. This must not be CANMORE_MSG_SUBTYPE_COMPRESSED
+ * LENGTH: The length of the uncompressed message
+ * LZ4 BLOCK: The message data, compressed in the LZ4 block format
+ *
+ * The receiver decompresses the message and delivers it with the inner subtype, as if it were sent uncompressed.
+ * Messages should only be compressed when it reduces the number of frames required to send them, as the receiver pays
+ * the cost of decompression. See canmore_msg_compress_target_len.
+ */
+
+/**
+ * @brief Size of the header before the compressed data
+ */
+#define CANMORE_MSG_COMPRESSED_HEADER_SIZE 3
+
+/**
+ * @brief Computes the length a message must compress to for it to be sent in at least one less frame
+ *
+ * @param len The length of the uncompressed message
+ * @param use_canfd If the message will be sent over CAN FD
+ * @return size_t The maximum compressed length (including header) which saves a frame, or 0 if it cannot save a frame
+ */
+static inline size_t canmore_msg_compress_target_len(size_t len, bool use_canfd) {
+    size_t frame_len = (use_canfd ? CANMORE_MAX_FD_FRAME_SIZE : CANMORE_MAX_FRAME_SIZE);
+    size_t num_frames = (len + frame_len - 1) / frame_len;
+    return (num_frames > 1 ? (num_frames - 1) * frame_len : 0);
+}
+
+/**
+ * @brief Compresses a message
+ *
+ * @param subtype The subtype of the message to compress (must not be CANMORE_MSG_SUBTYPE_COMPRESSED)
+ * @param data The message data
+ * @param len The length of the message. Must be between 1 and CANMORE_MAX_MSG_LENGTH
+ * @param buffer_out Buffer to write the compressed message into
+ * @param capacity The size of buffer_out. Compression is abandoned if the result would be larger than this
+ * @return size_t The length of the compressed message, or 0 if it does not fit in capacity or the arguments are invalid
+ */
+size_t canmore_msg_compress(uint8_t subtype, const uint8_t *data, size_t len, uint8_t *buffer_out, size_t capacity);
+
+/**
+ * @brief Decompresses a received compressed message
+ *
+ * @param msg The compressed message
+ * @param msg_len The length of the compressed message
+ * @param subtype_out Pointer to write the subtype of the uncompressed message
+ * @param buffer_out Buffer to write the uncompressed message into
+ * @param capacity The size of buffer_out (CANMORE_MAX_MSG_LENGTH is always sufficient)
+ * @return size_t The length of the uncompressed message, or 0 if the message is malformed or does not fit in capacity
+ */
+size_t canmore_msg_decompress(const uint8_t *msg, size_t msg_len, uint8_t *subtype_out, uint8_t *buffer_out,
+                              size_t capacity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
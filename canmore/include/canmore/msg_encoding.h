@@ -30,6 +30,31 @@ extern "C" {
 // CANmore Message Encoder
 // ========================================
 
+/**
+ * @brief Maximum number of frames in a CAN FD message (sequence number rollover is not permitted in CAN FD mode)
+ */
+#define CANMORE_MSG_FD_MAX_FRAMES (CANMORE_MAX_MSG_SEQ_NUM + 1)
+
+/**
+ * @brief A single segment of a message loaded with canmore_msg_encode_load_segments
+ */
+typedef struct canmore_msg_segment {
+    // Pointer to the data in this segment
+    const uint8_t *data;
+    // Length of the data in this segment
+    size_t len;
+} canmore_msg_segment_t;
+
+/**
+ * @brief Callback to fetch message data for canmore_msg_encode_load_pull
+ *
+ * @param arg The argument passed to canmore_msg_encode_load_pull
+ * @param offset Offset into the message of the first byte to fetch
+ * @param buffer_out Buffer to write exactly len bytes of message data into
+ * @param len Number of bytes to fetch
+ */
+typedef void (*canmore_msg_encode_pull_cb_t)(void *arg, size_t offset, uint8_t *buffer_out, size_t len);
+
 /**
  * @brief Struct containing encoder state
  *
@@ -44,8 +69,25 @@ typedef struct canmore_msg_encoder_state {
     uint8_t subtype;
     // Setting this bool enables CAN FD, increasing the max transmit size for each frame
     bool use_canfd;
+    // Where the message data is read from (one of the internal CANMORE_MSG_ENCODE_SOURCE_ values)
+    uint8_t source;
     // The pointer to the buffer containing the data. This must be vaild from when load is called to when returns true
     const uint8_t *buf_ptr;
+    // The segment list for segmented messages, and the position of the next byte to send within it
+    const canmore_msg_segment_t *segments;
+    size_t segment_index;
+    size_t segment_offset;
+    // The callback and argument for pulled messages
+    canmore_msg_encode_pull_cb_t pull_cb;
+    void *pull_arg;
+    // The running crc18 of all data encoded so far, reported in the last frame
+    uint32_t crc18;
+    // Bitrates used to plan CAN FD frame sizes, or 0 to fill each frame (see canmore_msg_encode_set_fd_bitrates)
+    uint32_t fd_nominal_bitrate;
+    uint32_t fd_data_bitrate;
+    // The planned number of data bytes in each frame of the current message, valid if fd_plan_frames is non-zero
+    uint8_t fd_plan[CANMORE_MSG_FD_MAX_FRAMES];
+    uint8_t fd_plan_frames;
     // The next sequence number to be used when encoding frame IDs
     uint32_t seq_num;
     // The length of data in `buffer`
@@ -81,10 +123,43 @@ void canmore_msg_encode_init(canmore_msg_encoder_t *state, uint32_t client_id, u
  */
 void canmore_msg_encode_load(canmore_msg_encoder_t *state, uint8_t subtype, const uint8_t *buffer, size_t len);
 
+/**
+ * @brief Loads a new message made up of several separate buffers into the CANmore encoder
+ * This allows a header and payload to be sent as one message without first copying them into a single buffer.
+ * If a previous message has not been fully flushed, it will be discarded and overwritten
+ *
+ * @attention Both the segment array and the buffers it points to must remain valid from when this function is called
+ * until canmore_msg_encode_done returns true, as with canmore_msg_encode_load.
+ *
+ * @param state Pointer to encoder state data struct
+ * @param subtype The subtype for this message to encode (6-bit value which is forwarded with the message)
+ * @param segments Array of segments, which are concatenated to form the message
+ * @param num_segments Number of entries in segments
+ */
+void canmore_msg_encode_load_segments(canmore_msg_encoder_t *state, uint8_t subtype,
+                                      const canmore_msg_segment_t *segments, size_t num_segments);
+
+/**
+ * @brief Loads a new message into the CANmore encoder, where the data is fetched on demand as each frame is encoded
+ * This allows messages to be generated as they're sent, without the full message ever being stored in memory.
+ * If a previous message has not been fully flushed, it will be discarded and overwritten
+ *
+ * @note The callback is called from canmore_msg_encode_next, with the data for each frame fetched in order exactly once
+ *
+ * @param state Pointer to encoder state data struct
+ * @param subtype The subtype for this message to encode (6-bit value which is forwarded with the message)
+ * @param len Total length of the message to encode
+ * @param pull_cb Callback to fetch the data for each frame
+ * @param pull_arg Argument passed to pull_cb
+ */
+void canmore_msg_encode_load_pull(canmore_msg_encoder_t *state, uint8_t subtype, size_t len,
+                                  canmore_msg_encode_pull_cb_t pull_cb, void *pull_arg);
+
 /**
  * @brief Checks if any remaining frames exist in the encoder to be sent
  *
- * @note After this function returns true, it is safe to release the buffer pointer passed to canmore_msg_encode_load.
+ * @note After this function returns true, it is safe to release the buffer pointer passed to canmore_msg_encode_load
+ * (or the segments passed to canmore_msg_encode_load_segments).
  *
  * @param state Pointer to encoder state data struct
  * @return True if data still needs to be sent, false if no data remaining to be transmitted
@@ -111,6 +186,57 @@ bool canmore_msg_encode_done(canmore_msg_encoder_t *state);
 bool canmore_msg_encode_next(canmore_msg_encoder_t *state, uint8_t *buffer_out, uint8_t *len_out, uint32_t *id_out,
                              bool *is_extended);
 
+/**
+ * @brief Enables planning of CAN FD frame sizes to minimize message transmission time
+ *
+ * By default, each frame is filled to 64 bytes, with the last frame padded to the next valid CAN FD length. This can
+ * waste time padding the last frame, or sending large CRCs when a shorter frame would have used a smaller one. When
+ * enabled, the frame sizes for each message are chosen with canmore_msg_fd_plan_fragments when the message is loaded.
+ * This produces standard frames, so the decoder does not need to be configured.
+ *
+ * @note This only has effect if the encoder was initialized with use_canfd. It applies starting at the next message.
+ *
+ * @param state Pointer to encoder state data struct
+ * @param nominal_bitrate The arbitration phase bitrate in bits/s, or 0 to disable frame planning
+ * @param data_bitrate The data phase bitrate in bits/s (equal to nominal_bitrate if bitrate switching is not used)
+ */
+void canmore_msg_encode_set_fd_bitrates(canmore_msg_encoder_t *state, uint32_t nominal_bitrate, uint32_t data_bitrate);
+
+/**
+ * @brief Chooses the data length of each frame for a CAN FD message, minimizing the estimated time on the bus
+ *
+ * Frame times are estimated from the CAN FD frame format, with the arbitration and end of frame sent at the nominal
+ * bitrate, and the remaining fields at the data bitrate. Stuff bits are counted assuming the worst case. All frames
+ * except the last are sized to valid CAN FD lengths, so that only the last frame is padded.
+ *
+ * @note This uses around 1.2 KB of stack
+ *
+ * @param len The length of the message
+ * @param nominal_bitrate The arbitration phase bitrate in bits/s
+ * @param data_bitrate The data phase bitrate in bits/s
+ * @param frame_lens_out Array of CANMORE_MSG_FD_MAX_FRAMES entries, written with the message bytes in each frame
+ * @return size_t The number of frames in the plan
+ */
+size_t canmore_msg_fd_plan_fragments(size_t len, uint32_t nominal_bitrate, uint32_t data_bitrate,
+                                     uint8_t *frame_lens_out);
+
+/**
+ * @brief Computes the frame ID to send a whole message in a single CAN XL frame
+ *
+ * A CAN XL frame can hold a maximum size CANmore message, so no fragmentation is required. The message is sent as a
+ * single frame message, with this extended ID and the message as the frame data. This is decoded like any other
+ * message by the canmore_msg_decode_ functions, so decoders do not need to be configured for CAN XL.
+ *
+ * @param client_id The client id for the message
+ * @param direction The direction of the message
+ * @param subtype The subtype for the message
+ * @param len The length of the message (between 1 and CANMORE_MAX_MSG_LENGTH)
+ * @return uint32_t The extended frame ID
+ */
+static inline uint32_t canmore_msg_encode_xl_id(uint32_t client_id, uint32_t direction, uint8_t subtype, size_t len) {
+    return CANMORE_CALC_MSG_FIRST_ID(client_id, direction, 0, 1, len, subtype);
+}
+
 // ========================================
 // CANmore Message Decoder
 // ========================================
@@ -127,6 +253,22 @@ bool canmore_msg_encode_next(canmore_msg_encoder_t *state, uint8_t *buffer_out,
 #define CANMORE_MSG_DECODER_ERROR_MSG_TOO_SMALL 6
 #define CANMORE_MSG_DECODER_ERROR_ROLLOVER_WITH_CANFD 7
 #define CANMORE_MSG_DECODER_ERROR_INVALID_CLIENT_ID 8
+#define CANMORE_MSG_DECODER_ERROR_MSG_EXCEEDS_CAPACITY 9
+#define CANMORE_MSG_DECODER_ERROR_MALFORMED_AGGREGATE 10
+#define CANMORE_MSG_DECODER_ERROR_MALFORMED_COMPRESSED 11
+#define CANMORE_MSG_DECODER_ERROR_NO_BUFFER 12
+// Number of decoder error codes defined above (useful for sizing per-error arrays)
+#define CANMORE_MSG_DECODER_NUM_ERRORS 13
+
+/**
+ * @brief Subtype filter value which accepts all message subtypes (the default after initialization)
+ */
+#define CANMORE_MSG_SUBTYPE_FILTER_ALL UINT64_MAX
+
+/**
+ * @brief Computes the subtype filter bit for the requested message subtype
+ */
+#define CANMORE_MSG_SUBTYPE_FILTER_BIT(subtype) (1ull << ((subtype) & ((1u << CANMORE_MSG_SUBTYPE_LENGTH) - 1)))
 
 /**
  * @brief Callback for reporting a decoder error
@@ -134,31 +276,86 @@ bool canmore_msg_encode_next(canmore_msg_encoder_t *state, uint8_t *buffer_out,
 typedef void (*canmore_msg_decoder_error_handler_t)(void *arg, unsigned int error_code);
 
 /**
- * @brief Struct containing decoder state
+ * @brief Struct containing the hot (per-frame) decoder state, with the reassembly buffer stored separately
  *
- * Do not modify this struct directly! Use the `canmore_msg_decode_` set of functions instead
+ * This is packed to fit within a single cache line, so that agents tracking many clients can store the state for every
+ * client contiguously, and only attach reassembly buffers to clients which are in the middle of receiving a message.
+ * See the `canmore_msg_split_decode_` set of functions.
+ *
+ * Do not modify this struct directly! Use the `canmore_msg_split_decode_` or `canmore_msg_decode_` set of functions
+ * instead
  */
-typedef struct canmore_msg_decoder_state {
-    // Setting this bool enables CAN FD, increasing the max transmit size for each frame
-    bool use_canfd;
-    // Holds the subtype for this message received in the first packet
-    uint8_t subtype;
-    // Holds the expected length of the packet received in the first frame
-    size_t expected_len;
+typedef struct canmore_msg_split_decoder_state {
     // Current crc18 decode value
     uint32_t crc18;
-    // The next seq_num expected when receiving data
-    uint32_t next_seq_num;
+    // Holds the expected length of the packet received in the first frame
+    uint16_t expected_len;
     // The size of data contained in the decode buffer
-    size_t decode_len;
-    // Buffer containing partially decode canmore message
-    uint8_t decode_buffer[CANMORE_MAX_MSG_LENGTH];
+    uint16_t decode_len;
+    // The size of the decode buffer. Messages larger than this are rejected on the first frame
+    uint16_t decode_capacity;
+    // The next seq_num expected when receiving data
+    uint8_t next_seq_num;
+    // Holds the subtype for this message received in the first packet
+    uint8_t subtype;
+    // Setting this bool enables CAN FD, increasing the max transmit size for each frame
+    bool use_canfd;
+    // Set if the message currently being received is skipped due to the subtype filter
+    bool skip_msg;
+    // Bitmask of subtypes to reassemble (see CANMORE_MSG_SUBTYPE_FILTER_BIT). Other subtypes are skipped
+    uint64_t subtype_filter;
+    // Buffer to reassemble messages into (at least decode_capacity bytes), or NULL if no buffer is attached
+    uint8_t *decode_buffer;
     // Decoder error handler, can be NULL if no handler assigned
     canmore_msg_decoder_error_handler_t decode_error_handler;
     // Decoder error handler optional argument
     void *decode_error_arg;
+} canmore_msg_split_decoder_t;
+static_assert(sizeof(canmore_msg_split_decoder_t) <= 64, "Split decoder state does not fit in a cache line");
+
+/**
+ * @brief Struct containing decoder state
+ *
+ * Do not modify this struct directly! Use the `canmore_msg_decode_` set of functions instead
+ */
+typedef struct canmore_msg_decoder_state {
+    // Decoder state (the decode_buffer pointer is unused, as the buffer below is always used)
+    canmore_msg_split_decoder_t split;
+    // Buffer containing partially decode canmore message
+    uint8_t decode_buffer[CANMORE_MAX_MSG_LENGTH];
 } canmore_msg_decoder_t;
 
+/**
+ * @brief Declares a decoder struct type with an inline buffer of the given capacity, for decoders which only need to
+ * receive small messages. Initialize with canmore_msg_sized_decode_init, then decode with the
+ * `canmore_msg_split_decode_` set of functions on the split member:
+ * @code
+ * static CANMORE_MSG_SIZED_DECODER_TYPE(64) decoder;
+ * canmore_msg_sized_decode_init(&decoder, NULL, NULL, true);
+ * size_t len = canmore_msg_split_decode_frame(&decoder.split, can_id, is_extended, frame, frame_len);
+ * @endcode
+ *
+ * @attention Unlike canmore_msg_decoder_t, the split state holds a pointer to the inline buffer, so these structs
+ * must not be copied or moved after initialization.
+ */
+#define CANMORE_MSG_SIZED_DECODER_TYPE(capacity)                                                                       \
+    struct {                                                                                                           \
+        canmore_msg_split_decoder_t split;                                                                             \
+        uint8_t decode_buffer[capacity];                                                                               \
+    }
+
+/**
+ * @brief Initializes a decoder declared with CANMORE_MSG_SIZED_DECODER_TYPE
+ *
+ * @param decoder Pointer to the sized decoder struct
+ * @param decode_error_handler Callback for reporting a decoder error, can be NULL if no handler assigned
+ * @param decode_error_arg Argument to provide to decode error handler
+ * @param use_canfd Enables CAN FD mode, expanding the max frame size from the standard can frame size to CAN FD
+ */
+#define canmore_msg_sized_decode_init(decoder, decode_error_handler, decode_error_arg, use_canfd)                      \
+    canmore_msg_split_decode_init_with_buffer(&(decoder)->split, (decode_error_handler), (decode_error_arg),           \
+                                              (use_canfd), (decoder)->decode_buffer, sizeof((decoder)->decode_buffer))
+
 /**
  * @brief Initializes a new CANmore message decoder
  *
@@ -176,6 +373,22 @@ void canmore_msg_decode_init(canmore_msg_decoder_t *state, canmore_msg_decoder_e
  */
 void canmore_msg_decode_reset_state(canmore_msg_decoder_t *state);
 
+/**
+ * @brief Sets which message subtypes the decoder will reassemble
+ *
+ * When the first frame of a message announces a subtype not in the filter, the remaining frames of that message are
+ * still checked for sequence errors, but are not copied into the decode buffer or checksummed, and no message is
+ * returned by canmore_msg_decode_frame. This saves processing when only a subset of message traffic is of interest.
+ *
+ * @note The filter applies starting at the next message. A message which is partially received is not affected.
+ *
+ * @param state Pointer to decoder state data struct
+ * @param subtype_filter Bitmask of accepted subtypes, built with CANMORE_MSG_SUBTYPE_FILTER_BIT
+ */
+static inline void canmore_msg_decode_set_subtype_filter(canmore_msg_decoder_t *state, uint64_t subtype_filter) {
+    state->split.subtype_filter = subtype_filter;
+}
+
 /**
  * @brief Add a new frame to the decoder state
  *
@@ -203,7 +416,7 @@ size_t canmore_msg_decode_frame(canmore_msg_decoder_t *state, uint32_t can_id, b
  * @return uint8_t The subtype for the last decoded message
  */
 static inline uint8_t canmore_msg_decode_get_subtype(canmore_msg_decoder_t *state) {
-    return state->subtype;
+    return state->split.subtype;
 }
 
 /**
@@ -221,6 +434,246 @@ static inline uint8_t *canmore_msg_decode_get_buf(canmore_msg_decoder_t *state)
     return state->decode_buffer;
 }
 
+// ========================================
+// CANmore Split Message Decoder
+// ========================================
+
+/*
+ * The split decoder behaves identically to the decoder above, except that the reassembly buffer is not stored inline.
+ * A buffer must be attached before the first frame of a message is decoded, and can be detached whenever the decoder is
+ * not in the middle of receiving a message. This allows buffers to be shared between many decoders, so that memory is
+ * only needed for clients which are actively transmitting.
+ *
+ * The expected usage is:
+ *  1. Before decoding a frame, if canmore_msg_split_decode_needs_buffer returns true, attach a buffer
+ *  2. Decode the frame with canmore_msg_split_decode_frame, reading the message from the buffer if one is returned
+ *  3. If canmore_msg_split_decode_in_progress returns false, detach the buffer so it can be used by another decoder
+ *
+ * If the first frame of a message in the subtype filter is received without a buffer attached (such as when the buffer
+ * pool is exhausted), the message is skipped and CANMORE_MSG_DECODER_ERROR_NO_BUFFER is reported.
+ */
+
+/**
+ * @brief Initializes a new CANmore split message decoder. No buffer is attached after initialization
+ *
+ * @param state Pointer to split decoder state struct to store internal state
+ * @param decode_error_handler Callback for reporting a decoder error, can be NULL if no handler assigned
+ * @param decode_error_arg Argument to provide to decode error handler
+ * @param use_canfd Enables CAN FD mode, expanding the max frame size from the standard can frame size to CAN FD
+ */
+void canmore_msg_split_decode_init(canmore_msg_split_decoder_t *state,
+                                   canmore_msg_decoder_error_handler_t decode_error_handler, void *decode_error_arg,
+                                   bool use_canfd);
+
+/**
+ * @brief Initializes a new CANmore split message decoder with an external buffer attached, which may be smaller than
+ * CANMORE_MAX_MSG_LENGTH. Messages larger than the capacity are rejected on their first frame with
+ * CANMORE_MSG_DECODER_ERROR_MSG_EXCEEDS_CAPACITY. This allows RAM-constrained devices to size each decoder for the
+ * messages it actually receives.
+ *
+ * @param state Pointer to split decoder state struct to store internal state
+ * @param decode_error_handler Callback for reporting a decoder error, can be NULL if no handler assigned
+ * @param decode_error_arg Argument to provide to decode error handler
+ * @param use_canfd Enables CAN FD mode, expanding the max frame size from the standard can frame size to CAN FD
+ * @param buffer Buffer to reassemble messages into. Must remain valid for the lifetime of the decoder
+ * @param capacity The size of buffer in bytes (values above CANMORE_MAX_MSG_LENGTH are clamped)
+ */
+void canmore_msg_split_decode_init_with_buffer(canmore_msg_split_decoder_t *state,
+                                               canmore_msg_decoder_error_handler_t decode_error_handler,
+                                               void *decode_error_arg, bool use_canfd, uint8_t *buffer,
+                                               size_t capacity);
+
+/**
+ * @brief Resets the split message decoder state to receive a new sequence of message frames
+ * @param state Pointer to split decoder state data struct
+ */
+void canmore_msg_split_decode_reset_state(canmore_msg_split_decoder_t *state);
+
+/**
+ * @brief Sets which message subtypes the split decoder will reassemble. See canmore_msg_decode_set_subtype_filter
+ *
+ * @param state Pointer to split decoder state data struct
+ * @param subtype_filter Bitmask of accepted subtypes, built with CANMORE_MSG_SUBTYPE_FILTER_BIT
+ */
+static inline void canmore_msg_split_decode_set_subtype_filter(canmore_msg_split_decoder_t *state,
+                                                               uint64_t subtype_filter) {
+    state->subtype_filter = subtype_filter;
+}
+
+/**
+ * @brief Checks if a buffer must be attached before the given frame is decoded.
+ *
+ * This is true when no buffer is attached, and the frame is the first frame of a message with a subtype accepted by the
+ * subtype filter.
+ *
+ * @param state Pointer to split decoder state data struct
+ * @param can_id The CAN frame ID for the frame about to be decoded
+ * @param is_extended True if can_id is an extended frame id
+ * @return true A buffer should be attached with canmore_msg_split_decode_attach_buffer before decoding the frame
+ */
+static inline bool canmore_msg_split_decode_needs_buffer(const canmore_msg_split_decoder_t *state, uint32_t can_id,
+                                                         bool is_extended) {
+    canmore_id_t id;
+    id.identifier = can_id;
+    return !state->decode_buffer && is_extended && id.pkt_ext_start.noc == 0 &&
+           (state->subtype_filter & CANMORE_MSG_SUBTYPE_FILTER_BIT(id.pkt_ext_start.msg_subtype));
+}
+
+/**
+ * @brief Checks if the split decoder is in the middle of receiving a message
+ *
+ * @param state Pointer to split decoder state data struct
+ * @return true A message is partially received, and the attached buffer (if any) must not be detached
+ */
+static inline bool canmore_msg_split_decode_in_progress(const canmore_msg_split_decoder_t *state) {
+    return state->next_seq_num != 0;
+}
+
+/**
+ * @brief Attaches a reassembly buffer to the split decoder
+ *
+ * @param state Pointer to split decoder state data struct
+ * @param buffer Buffer of at least the decoder capacity (CANMORE_MAX_MSG_LENGTH unless set with
+ * canmore_msg_split_decode_set_capacity). Must remain valid until detached
+ */
+static inline void canmore_msg_split_decode_attach_buffer(canmore_msg_split_decoder_t *state, uint8_t *buffer) {
+    state->decode_buffer = buffer;
+}
+
+/**
+ * @brief Sets the size of the buffers which will be attached to the split decoder. See
+ * canmore_msg_split_decode_init_with_buffer
+ *
+ * @attention This must not be called while canmore_msg_split_decode_in_progress returns true
+ *
+ * @param state Pointer to split decoder state data struct
+ * @param capacity The size of attached buffers in bytes (values above CANMORE_MAX_MSG_LENGTH are clamped)
+ */
+static inline void canmore_msg_split_decode_set_capacity(canmore_msg_split_decoder_t *state, size_t capacity) {
+    state->decode_capacity = (capacity > CANMORE_MAX_MSG_LENGTH ? CANMORE_MAX_MSG_LENGTH : capacity);
+}
+
+/**
+ * @brief Detaches the reassembly buffer from the split decoder
+ *
+ * @attention This must not be called while canmore_msg_split_decode_in_progress returns true
+ *
+ * @param state Pointer to split decoder state data struct
+ * @return uint8_t* The previously attached buffer, or NULL if no buffer was attached
+ */
+static inline uint8_t *canmore_msg_split_decode_detach_buffer(canmore_msg_split_decoder_t *state) {
+    uint8_t *buffer = state->decode_buffer;
+    state->decode_buffer = NULL;
+    return buffer;
+}
+
+/**
+ * @brief Add a new frame to the split decoder state. See canmore_msg_decode_frame
+ *
+ * @param state Pointer to split decoder state data struct
+ * @param can_id The CAN frame ID for this frame
+ * @param is_extended True if can_id is an extended frame id
+ * @param frame Buffer containing frame data
+ * @param frame_len Length of the incoming CAN frame
+ * @return Length of the decoded message (read from the attached buffer), or 0 if no message finished decoding
+ */
+size_t canmore_msg_split_decode_frame(canmore_msg_split_decoder_t *state, uint32_t can_id, bool is_extended,
+                                      const uint8_t *frame, size_t frame_len);
+
+/**
+ * @brief Returns the subtype of the last decoded message. See canmore_msg_decode_get_subtype
+ *
+ * @param state Pointer to split decoder state data struct
+ * @return uint8_t The subtype for the last decoded message
+ */
+static inline uint8_t canmore_msg_split_decode_get_subtype(const canmore_msg_split_decoder_t *state) {
+    return state->subtype;
+}
+
+/**
+ * @brief Returns pointer to the last decoded message, which is stored in the attached buffer
+ *
+ * @param state Pointer to split decoder state data struct
+ * @return uint8_t* Pointer to the last decoded message
+ */
+static inline uint8_t *canmore_msg_split_decode_get_buf(canmore_msg_split_decoder_t *state) {
+    return state->decode_buffer;
+}
+
+// ========================================
+// CANmore Batched Message Decoding
+// ========================================
+
+/**
+ * @brief A single received frame to be decoded by canmore_msg_decode_frames
+ */
+typedef struct canmore_msg_frame {
+    // The CAN frame ID for this frame
+    uint32_t can_id;
+    // True if can_id is an extended frame id
+    bool is_extended;
+    // Length of the frame data (CAN XL frames can exceed 255 bytes)
+    uint16_t len;
+    // Pointer to the frame data
+    const uint8_t *data;
+} canmore_msg_frame_t;
+
+/**
+ * @brief A message completed by canmore_msg_decode_frames
+ *
+ * The buffer holding the message is detached from the decoder, so the message remains valid even if later frames in
+ * the batch start a new message on the same decoder. The caller owns the buffer, and is responsible for returning it to
+ * wherever the batch ops acquire_buffer function gets its buffers from.
+ */
+typedef struct canmore_msg_decoded {
+    // The decoder which received this message
+    canmore_msg_split_decoder_t *decoder;
+    // The subtype of the message
+    uint8_t subtype;
+    // The length of the message
+    size_t len;
+    // The buffer holding the message
+    uint8_t *buffer;
+} canmore_msg_decoded_t;
+
+/**
+ * @brief Callbacks used by canmore_msg_decode_frames to find decoders and manage reassembly buffers
+ */
+typedef struct canmore_msg_decode_batch_ops {
+    // Returns the split decoder which should decode the given frame, or NULL to drop the frame
+    canmore_msg_split_decoder_t *(*lookup)(void *arg, uint32_t can_id, bool is_extended);
+    // Returns a buffer (at least CANMORE_MAX_MSG_LENGTH) to attach to a decoder starting a message, or NULL if none are
+    // available, in which case the message is dropped with CANMORE_MSG_DECODER_ERROR_NO_BUFFER
+    uint8_t *(*acquire_buffer)(void *arg);
+    // Returns a buffer detached from a decoder which is no longer receiving a message. Can be NULL to keep buffers
+    // attached to idle decoders
+    void (*release_buffer)(void *arg, uint8_t *buffer);
+    // Argument passed to all callbacks
+    void *arg;
+} canmore_msg_decode_batch_ops_t;
+
+/**
+ * @brief Decodes a batch of frames, possibly from many different sources, in a single call
+ *
+ * This is equivalent to decoding each frame with canmore_msg_split_decode_frame in order (following the buffer
+ * attach/detach sequence described above), but the decoder state for the next frame is prefetched while the current
+ * frame is decoded. This reduces per-frame overhead when draining a full receive queue or replaying a capture.
+ *
+ * Decoding stops early once out_max messages have been completed. The remaining frames should be passed to another call
+ * after the completed messages are processed.
+ *
+ * @param frames Array of frames to decode
+ * @param num_frames Number of frames in the array
+ * @param ops Callbacks to look up decoders and manage buffers
+ * @param out Array to write completed messages into
+ * @param out_max The number of entries in the out array
+ * @param out_count Pointer to write the number of completed messages written to out
+ * @return size_t The number of frames consumed from the array
+ */
+size_t canmore_msg_decode_frames(const canmore_msg_frame_t *frames, size_t num_frames,
+                                 const canmore_msg_decode_batch_ops_t *ops, canmore_msg_decoded_t *out,
+                                 size_t out_max, size_t *out_count);
+
 /**
  * @brief Converts the given length to a the next available CANFD DLC value which can hold the length
  *
@@ -0,0 +1,306 @@
+#ifndef CANMORE__MSG_TRANSFER_H_
+#define CANMORE__MSG_TRANSFER_H_
+
+#include "canmore/protocol.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file canmore/msg_transfer.h
+ *
+ * @brief API for sending payloads larger than CANMORE_MAX_MSG_LENGTH as a large transfer
+ *
+ * A large transfer carries a payload of up to CANMORE_MSG_TRANSFER_MAX_LENGTH bytes in a series of standard CANmore
+ * messages with the CANMORE_MSG_SUBTYPE_TRANSFER subtype. The whole payload is protected by a CRC32, and the receiver
+ * controls the rate of the transfer by granting the sender a window of bytes it may send before waiting for an ACK.
+ *
+ * Each transfer message begins with an opcode and the transfer ID, followed by an opcode specific body:
+ *
+ * START (sender -> receiver): Requests a new transfer. The receiver replies with an ACK granting the first window, or
+ * ABORT if it can't accept the transfer.
+ *  Byte:  0        1             2                3 ... 6                  7 ... 10
+ *       | OPCODE | TRANSFER ID | INNER SUBTYPE | LENGTH (little endian) | CRC32 (little endian) |
+ *
+ * DATA (sender -> receiver): Carries the payload bytes starting at the given offset.
+ *  Byte:  0        1             2 ... 3                  4 ...
+ *       | OPCODE | TRANSFER ID | OFFSET (little endian) | PAYLOAD DATA |
+ *
+ * ACK (receiver -> sender): Reports the number of bytes received in order, and the window of bytes past this offset
+ * the sender may send. If OFFSET is equal to the transfer length, the transfer is complete and passed the CRC check.
+ *  Byte:  0        1             2 ... 5                  6 ... 7                  8
+ *       | OPCODE | TRANSFER ID | OFFSET (little endian) | WINDOW (little endian) | FLAGS |
+ *
+ * ABORT (receiver -> sender) / CANCEL (sender -> receiver): Ends the transfer, with a reason code from
+ * CANMORE_MSG_TRANSFER_ABORT_*. These use separate opcodes so that a peer can send and receive transfers at once.
+ *  Byte:  0        1             2
+ *       | OPCODE | TRANSFER ID | REASON |
+ *
+ * CANmore messages between a client and the agent are delivered in order, so DATA is only resent if a message was
+ * dropped due to a decode error. When the receiver sees a gap, it sends an ACK with the RESEND flag set, and the sender
+ * continues from the acknowledged offset. The sender should also resume from the last acknowledged offset (or resend
+ * START if it was never acknowledged) if no ACK arrives within a timeout, see canmore_msg_transfer_tx_timeout.
+ */
+
+/**
+ * @brief Maximum length of a large transfer payload
+ */
+#define CANMORE_MSG_TRANSFER_MAX_LENGTH 65536
+
+#define CANMORE_MSG_TRANSFER_OPCODE_START 0
+#define CANMORE_MSG_TRANSFER_OPCODE_DATA 1
+#define CANMORE_MSG_TRANSFER_OPCODE_ACK 2
+#define CANMORE_MSG_TRANSFER_OPCODE_ABORT 3
+#define CANMORE_MSG_TRANSFER_OPCODE_CANCEL 4
+
+#define CANMORE_MSG_TRANSFER_START_SIZE 11
+#define CANMORE_MSG_TRANSFER_DATA_HEADER_SIZE 4
+#define CANMORE_MSG_TRANSFER_ACK_SIZE 9
+#define CANMORE_MSG_TRANSFER_ABORT_SIZE 3
+
+/**
+ * @brief Maximum payload data carried in a single DATA message
+ */
+#define CANMORE_MSG_TRANSFER_MAX_CHUNK_SIZE (CANMORE_MAX_MSG_LENGTH - CANMORE_MSG_TRANSFER_DATA_HEADER_SIZE)
+
+/**
+ * @brief ACK flag set when the receiver detected a gap, and the sender should resend from the acknowledged offset
+ */
+#define CANMORE_MSG_TRANSFER_ACK_FLAG_RESEND (1 << 0)
+
+/**
+ * @brief Abort reason codes
+ */
+#define CANMORE_MSG_TRANSFER_ABORT_TOO_LARGE 0      // The receiver has no buffer large enough for the transfer
+#define CANMORE_MSG_TRANSFER_ABORT_INVALID_START 1  // The START message was malformed
+#define CANMORE_MSG_TRANSFER_ABORT_CRC_FAIL 2       // The reassembled payload failed the CRC check
+#define CANMORE_MSG_TRANSFER_ABORT_CANCELLED 3      // The transfer was cancelled by the application
+
+/**
+ * @brief Transfer status values
+ */
+enum canmore_msg_transfer_status {
+    CANMORE_MSG_TRANSFER_STATUS_IDLE = 0,  // No transfer has been started
+    CANMORE_MSG_TRANSFER_STATUS_ACTIVE,    // A transfer is in progress
+    CANMORE_MSG_TRANSFER_STATUS_COMPLETE,  // The last transfer completed successfully
+    CANMORE_MSG_TRANSFER_STATUS_ABORTED,   // The last transfer was aborted
+};
+
+// ========================================
+// Sender
+// ========================================
+
+/**
+ * @brief Struct containing the state for sending a large transfer
+ *
+ * Do not modify this struct directly! Use the `canmore_msg_transfer_tx_` set of functions instead
+ */
+typedef struct canmore_msg_transfer_tx_state {
+    // The payload being sent
+    const uint8_t *data;
+    // The length of the payload
+    uint32_t length;
+    // The CRC32 of the payload
+    uint32_t crc32;
+    // The next offset to send
+    uint32_t send_offset;
+    // The offset acknowledged by the receiver
+    uint32_t acked_offset;
+    // The window granted by the receiver past acked_offset
+    uint16_t window;
+    // The maximum payload bytes in each DATA message
+    uint16_t chunk_size;
+    // The subtype delivered to the receiver
+    uint8_t subtype;
+    // The ID of the current transfer
+    uint8_t transfer_id;
+    // Set if START must be sent (either not sent yet, or not acknowledged before a timeout)
+    bool send_start;
+    // Set once the receiver acknowledges START
+    bool started;
+    // The status of the transfer (one of enum canmore_msg_transfer_status)
+    uint8_t status;
+    // The abort reason if status is ABORTED
+    uint8_t abort_reason;
+} canmore_msg_transfer_tx_t;
+
+/**
+ * @brief Initializes a large transfer sender
+ *
+ * @param state Pointer to sender state struct to store internal state
+ */
+void canmore_msg_transfer_tx_init(canmore_msg_transfer_tx_t *state);
+
+/**
+ * @brief Begins sending a new transfer, replacing any transfer in progress
+ *
+ * @param state Pointer to sender state struct
+ * @param subtype The subtype to deliver the payload with
+ * @param data The payload. Must remain valid until the transfer completes or aborts
+ * @param len The length of the payload. Must be between 1 and CANMORE_MSG_TRANSFER_MAX_LENGTH
+ * @param chunk_size Maximum payload bytes per DATA message (clamped to CANMORE_MSG_TRANSFER_MAX_CHUNK_SIZE). Smaller
+ * chunks give a finer grained window, while larger chunks amortize the per-message overhead
+ * @return true The transfer was started
+ * @return false The arguments are invalid
+ */
+bool canmore_msg_transfer_tx_start(canmore_msg_transfer_tx_t *state, uint8_t subtype, const uint8_t *data, size_t len,
+                                   size_t chunk_size);
+
+/**
+ * @brief Encodes the next message to send, if the window allows it. Call repeatedly until it returns 0
+ *
+ * @param state Pointer to sender state struct
+ * @param buffer_out Buffer to write the message into. Must be at least CANMORE_MAX_MSG_LENGTH bytes
+ * @return size_t Length of the message to send with CANMORE_MSG_SUBTYPE_TRANSFER, or 0 if nothing can be sent now
+ */
+size_t canmore_msg_transfer_tx_next(canmore_msg_transfer_tx_t *state, uint8_t *buffer_out);
+
+/**
+ * @brief Processes a CANMORE_MSG_SUBTYPE_TRANSFER message received from the receiver
+ *
+ * @param state Pointer to sender state struct
+ * @param msg The received message
+ * @param len The length of the received message
+ * @return true The message updated the transfer. canmore_msg_transfer_tx_next may now have messages to send
+ * @return false The message was not for the current transfer
+ */
+bool canmore_msg_transfer_tx_handle(canmore_msg_transfer_tx_t *state, const uint8_t *msg, size_t len);
+
+/**
+ * @brief Notifies the sender that no ACK arrived within the application's timeout.
+ * Sending resumes from the last acknowledged offset (or resends START if it was never acknowledged).
+ *
+ * @param state Pointer to sender state struct
+ */
+void canmore_msg_transfer_tx_timeout(canmore_msg_transfer_tx_t *state);
+
+/**
+ * @brief Cancels the transfer in progress
+ *
+ * @param state Pointer to sender state struct
+ * @param buffer_out Buffer to write a CANCEL message into for the receiver. Must be at least
+ * CANMORE_MSG_TRANSFER_ABORT_SIZE bytes
+ * @return size_t Length of the message to send, or 0 if no transfer was in progress
+ */
+size_t canmore_msg_transfer_tx_cancel(canmore_msg_transfer_tx_t *state, uint8_t *buffer_out);
+
+/**
+ * @brief Returns the status of the transfer (one of enum canmore_msg_transfer_status)
+ *
+ * @param state Pointer to sender state struct
+ */
+static inline uint8_t canmore_msg_transfer_tx_get_status(const canmore_msg_transfer_tx_t *state) {
+    return state->status;
+}
+
+/**
+ * @brief Returns the reason the transfer was aborted (one of CANMORE_MSG_TRANSFER_ABORT_*)
+ *
+ * @param state Pointer to sender state struct
+ */
+static inline uint8_t canmore_msg_transfer_tx_get_abort_reason(const canmore_msg_transfer_tx_t *state) {
+    return state->abort_reason;
+}
+
+// ========================================
+// Receiver
+// ========================================
+
+/**
+ * @brief Struct containing the state for receiving large transfers
+ *
+ * Do not modify this struct directly! Use the `canmore_msg_transfer_rx_` set of functions instead
+ */
+typedef struct canmore_msg_transfer_rx_state {
+    // The buffer to reassemble the payload in
+    uint8_t *buffer;
+    // The size of buffer
+    uint32_t capacity;
+    // The length of the payload being received
+    uint32_t length;
+    // The CRC32 of the payload from the START message
+    uint32_t expected_crc32;
+    // The running CRC32 of the payload received so far
+    uint32_t crc32;
+    // The number of bytes received in order
+    uint32_t received;
+    // The offset sent in the last ACK
+    uint32_t acked_offset;
+    // The window granted to the sender in each ACK
+    uint16_t window;
+    // The subtype of the payload
+    uint8_t subtype;
+    // The ID of the current (or last completed) transfer
+    uint8_t transfer_id;
+    // The offset of the out of order DATA message which triggered the last RESEND ACK
+    uint32_t resend_trigger_offset;
+    // Set when an ACK with the RESEND flag has been sent for the current gap
+    bool resend_requested;
+    // The status of the transfer (one of enum canmore_msg_transfer_status)
+    uint8_t status;
+} canmore_msg_transfer_rx_t;
+
+/**
+ * @brief Initializes a large transfer receiver
+ *
+ * @param state Pointer to receiver state struct to store internal state
+ * @param buffer Preallocated buffer to reassemble transfers into. Transfers larger than this are rejected
+ * @param capacity The size of buffer
+ * @param window The number of bytes the sender may send past the last ACK. Larger windows allow higher throughput,
+ * with the sender waiting for ACKs less often. ACKs are sent each time half of the window has been received
+ */
+void canmore_msg_transfer_rx_init(canmore_msg_transfer_rx_t *state, uint8_t *buffer, size_t capacity,
+                                  uint16_t window);
+
+/**
+ * @brief Processes a CANMORE_MSG_SUBTYPE_TRANSFER message received from the sender
+ *
+ * @param state Pointer to receiver state struct
+ * @param msg The received message
+ * @param len The length of the received message
+ * @param reply_out Buffer to write a reply into, to be sent with CANMORE_MSG_SUBTYPE_TRANSFER. Must be at least
+ * CANMORE_MSG_TRANSFER_ACK_SIZE bytes
+ * @param reply_len_out Pointer to write the length of the reply, or 0 if no reply should be sent
+ * @return true The transfer completed with this message. The payload is in the buffer passed to init, see
+ * canmore_msg_transfer_rx_get_length and canmore_msg_transfer_rx_get_subtype
+ */
+bool canmore_msg_transfer_rx_handle(canmore_msg_transfer_rx_t *state, const uint8_t *msg, size_t len,
+                                    uint8_t *reply_out, size_t *reply_len_out);
+
+/**
+ * @brief Returns the status of the transfer (one of enum canmore_msg_transfer_status)
+ *
+ * @param state Pointer to receiver state struct
+ */
+static inline uint8_t canmore_msg_transfer_rx_get_status(const canmore_msg_transfer_rx_t *state) {
+    return state->status;
+}
+
+/**
+ * @brief Returns the length of the received payload
+ *
+ * @param state Pointer to receiver state struct
+ */
+static inline size_t canmore_msg_transfer_rx_get_length(const canmore_msg_transfer_rx_t *state) {
+    return state->length;
+}
+
+/**
+ * @brief Returns the subtype of the received payload
+ *
+ * @param state Pointer to receiver state struct
+ */
+static inline uint8_t canmore_msg_transfer_rx_get_subtype(const canmore_msg_transfer_rx_t *state) {
+    return state->subtype;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
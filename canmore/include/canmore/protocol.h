@@ -182,6 +182,12 @@ extern "C" {
  * Idx:    0        1        2        3        4        5        6        7
  *
  *
+ * Control Interface Notification Channel
+ * --------------------------------------
+ * Channel 11 carries register change notifications from the control interface to the agent (see Subscriptions in
+ * canmore/reg_mapped/protocol.h). This channel does not have any agent-to-client requests.
+ *
+ *
  * Remote TTY Interface
  * --------------------
  * Channel 13 is allocated on Linux Devices to act as a remote shell. Refer to the Remote TTY protocol for more
@@ -258,6 +264,7 @@ extern "C" {
 // Length of CAN frame
 #define CANMORE_MAX_FRAME_SIZE 8
 #define CANMORE_MAX_FD_FRAME_SIZE 64
+#define CANMORE_MAX_XL_FRAME_SIZE 2048
 
 // Identifier Field Lengths
 #define CANMORE_EXTRA_LENGTH 18
@@ -401,9 +408,15 @@ typedef union __attribute__((__packed__)) canmore_id {
 
 // Message Subtype Assignments
 #define CANMORE_MSG_SUBTYPE_XRCE_DDS 0
+#define CANMORE_MSG_SUBTYPE_AGGREGATE 1          // Small messages packed together, see canmore/msg_aggregation.h
+#define CANMORE_MSG_SUBTYPE_COMPRESSED 2         // Compressed messages, see canmore/msg_compression.h
+#define CANMORE_MSG_SUBTYPE_TRANSFER 3           // Payloads larger than a single message, see canmore/msg_transfer.h
+#define CANMORE_MSG_SUBTYPE_REG_MAPPED 4         // Register requests/responses, see canmore/reg_mapped/protocol.h
+#define CANMORE_MSG_SUBTYPE_REG_MAPPED_NOTIFY 5  // Register change notifications, see canmore/reg_mapped/protocol.h
 
 // Utility Channel Assignments
 #define CANMORE_CHAN_THRUSTER_CMDS 0
+#define CANMORE_CHAN_CONTROL_INTERFACE_NOTIFY 11
 #define CANMORE_CHAN_CAMERA_FEED 12
 #define CANMORE_CHAN_REMOTE_TTY 13
 #define CANMORE_CHAN_CONTROL_INTERFACE 14
@@ -20,7 +20,7 @@ enum reg_mapped_client_transfer_mode {
      */
     TRANSFER_MODE_SINGLE,
     /**
-     * @brief Perform bulk transfers during array writes
+     * @brief Perform bulk transfers during array read/writes
      */
     TRANSFER_MODE_BULK,
     /**
@@ -110,6 +110,7 @@ typedef struct reg_mapped_client_cfg {
     /**
      * @brief Maximum number of outstanding packets to have in flight before waiting for a response
      * This must not be greater than the buffer size on the server, or else packets can be lost
+     * In multiword mode, this is the number of multiword requests sent before waiting for the oldest response
      */
     unsigned int max_in_flight;
 
@@ -129,6 +130,62 @@ typedef struct reg_mapped_client_cfg {
 
 } reg_mapped_client_cfg_t;
 
+/**
+ * @brief Region addresses number the words of all pages linearly, so the word after the last word in a page is the
+ * first word of the next page
+ */
+#define REG_MAPPED_CLIENT_REGION_ADDR(page, offset) ((((uint32_t) (page)) * REG_MAPPED_PAGE_NUM_WORDS) + (offset))
+#define REG_MAPPED_CLIENT_REGION_PAGE(addr) ((uint8_t) ((addr) / REG_MAPPED_PAGE_NUM_WORDS))
+#define REG_MAPPED_CLIENT_REGION_OFFSET(addr) ((uint8_t) ((addr) % REG_MAPPED_PAGE_NUM_WORDS))
+#define REG_MAPPED_CLIENT_REGION_NUM_WORDS REG_MAPPED_CLIENT_REGION_ADDR(0x100, 0)
+
+/**
+ * @brief An access in a batch transaction (see reg_mapped_client_transact)
+ */
+typedef struct reg_mapped_client_batch_entry {
+    bool write;          // True to write the words in data, false to read words into data
+    uint8_t page;        // Page to access
+    uint8_t offset;      // Offset of the first register to access
+    unsigned int count;  // Number of sequential registers to access (at least 1, must not cross the page boundary)
+    uint32_t *data;      // Words to write, or array to read count words into
+} reg_mapped_client_batch_entry_t;
+
+/**
+ * @brief Maximum number of posted writes which can be awaiting a response
+ * The number in flight is also limited by max_in_flight in the client configuration
+ */
+#define REG_MAPPED_CLIENT_MAX_POSTED_WRITES 64
+
+/**
+ * @brief Callback for a posted write which failed
+ *
+ * @param page The page of the register which failed to be written
+ * @param offset The offset of the register which failed to be written
+ * @param result The error code for the write
+ * @param arg User argument for the posted writes
+ */
+typedef void (*reg_mapped_client_posted_error_func)(uint8_t page, uint8_t offset, int result, void *arg);
+
+/**
+ * @brief State for posted writes, holding the writes which have been sent but not yet responded to
+ * Initialize with reg_mapped_client_posted_init. This is not to be modified by the caller
+ */
+typedef struct reg_mapped_client_posted_writes {
+    struct {
+        uint8_t page;
+        uint8_t offset;
+    } pending[REG_MAPPED_CLIENT_MAX_POSTED_WRITES];  // Ring buffer of writes awaiting a response, in order sent
+    unsigned int pending_head;                       // Index of the oldest pending write
+    unsigned int pending_count;                      // Number of pending writes
+
+    int first_error;             // The first error since the last sync, or REG_MAPPED_RESULT_SUCCESSFUL
+    uint8_t first_error_page;    // The page of the first error
+    uint8_t first_error_offset;  // The offset of the first error
+
+    reg_mapped_client_posted_error_func error_cb;  // Optional callback for each failed write
+    void *error_cb_arg;                            // Argument to pass to error_cb
+} reg_mapped_client_posted_writes_t;
+
 /**
  * @brief Read a register
  *
@@ -152,6 +209,33 @@ int reg_mapped_client_read_register(const reg_mapped_client_cfg_t *cfg, uint8_t
  */
 int reg_mapped_client_write_register(const reg_mapped_client_cfg_t *cfg, uint8_t page, uint8_t offset, uint32_t data);
 
+/**
+ * @brief Subscribe to notifications when a range of registers change (see Subscriptions in reg_mapped/protocol.h)
+ *
+ * Notifications are sent on a separate channel from responses, so must be received separately from the client
+ * configuration. A subscription to the same page and offset replaces the existing subscription.
+ *
+ * @param cfg Register mapped client configuration
+ * @param page Page to watch
+ * @param offset Offset of the first register to watch
+ * @param count Number of registers to watch (up to REG_MAPPED_SUBSCRIPTION_MAX_WORDS, must not cross the page boundary)
+ * @param interval_ms Minimum interval between the server sampling the registers
+ * @param threshold Amount a register must change by since it was last notified to send a notification (0 for any)
+ * @return REG_MAPPED_RESULT_SUCCESSFUL on success, other error code on failure
+ */
+int reg_mapped_client_subscribe(const reg_mapped_client_cfg_t *cfg, uint8_t page, uint8_t offset, uint8_t count,
+                                uint16_t interval_ms, uint16_t threshold);
+
+/**
+ * @brief Remove the subscription starting at the given register
+ *
+ * @param cfg Register mapped client configuration
+ * @param page Page of the subscription
+ * @param offset Offset of the first register in the subscription
+ * @return REG_MAPPED_RESULT_SUCCESSFUL on success, other error code on failure
+ */
+int reg_mapped_client_unsubscribe(const reg_mapped_client_cfg_t *cfg, uint8_t page, uint8_t offset);
+
 /**
  * @brief Read array of words from a page
  *
@@ -167,6 +251,22 @@ int reg_mapped_client_write_register(const reg_mapped_client_cfg_t *cfg, uint8_t
 int reg_mapped_client_read_array(const reg_mapped_client_cfg_t *cfg, uint8_t page, uint8_t offset_start,
                                  uint32_t *data_array, unsigned int num_words);
 
+/**
+ * @brief Read array of words from a page, reporting where the read failed
+ *
+ * @note This function can only read to words in the same page
+ *
+ * @param cfg Register mapped client configuration
+ * @param page Page to read
+ * @param offset_start Start offset to begin reading in page
+ * @param data_array Array of words to read data into
+ * @param num_words  Number of words to read
+ * @param error_offset If not NULL, set to the offset of the first request which failed if an error occurs
+ * @return REG_MAPPED_RESULT_SUCCESSFUL on success, other error code on failure
+ */
+int reg_mapped_client_read_array_ex(const reg_mapped_client_cfg_t *cfg, uint8_t page, uint8_t offset_start,
+                                    uint32_t *data_array, unsigned int num_words, uint8_t *error_offset);
+
 /**
  * @brief Write array of words to a page
  *
@@ -182,6 +282,137 @@ int reg_mapped_client_read_array(const reg_mapped_client_cfg_t *cfg, uint8_t pag
 int reg_mapped_client_write_array(const reg_mapped_client_cfg_t *cfg, uint8_t page, uint8_t offset_start,
                                   const uint32_t *data_array, uint8_t num_words);
 
+/**
+ * @brief Write array of words to a page, reporting where the write failed
+ *
+ * @note This function can only write to words in the same page
+ * @note When several requests are in flight, requests after the failing one may have still been written
+ *
+ * @param cfg Register mapped client configuration
+ * @param page Page to write
+ * @param offset_start Start offset to begin writing in page
+ * @param data_array Array of words to write
+ * @param num_words  Number of words to write
+ * @param error_offset If not NULL, set to the offset of the first request which failed if an error occurs
+ * @return REG_MAPPED_RESULT_SUCCESSFUL on success, other error code on failure
+ */
+int reg_mapped_client_write_array_ex(const reg_mapped_client_cfg_t *cfg, uint8_t page, uint8_t offset_start,
+                                     const uint32_t *data_array, uint8_t num_words, uint8_t *error_offset);
+
+/**
+ * @brief Read a region of words which may span several pages
+ *
+ * The region is split into requests which don't cross page boundaries, which are pipelined across the entire region
+ * using the client's transfer mode.
+ *
+ * @param cfg Register mapped client configuration
+ * @param addr_start Region address of the first word to read (see REG_MAPPED_CLIENT_REGION_ADDR)
+ * @param data_array Array of words to read data into
+ * @param num_words Number of words to read
+ * @param error_addr If not NULL, set to the region address of the first request which failed if an error occurs
+ * @return REG_MAPPED_RESULT_SUCCESSFUL on success, other error code on failure
+ */
+int reg_mapped_client_read_region(const reg_mapped_client_cfg_t *cfg, uint32_t addr_start, uint32_t *data_array,
+                                  size_t num_words, uint32_t *error_addr);
+
+/**
+ * @brief Write a region of words which may span several pages
+ *
+ * The region is split into requests which don't cross page boundaries, which are pipelined across the entire region
+ * using the client's transfer mode.
+ *
+ * @note When several requests are in flight, requests after the failing one may have still been written
+ *
+ * @param cfg Register mapped client configuration
+ * @param addr_start Region address of the first word to write (see REG_MAPPED_CLIENT_REGION_ADDR)
+ * @param data_array Array of words to write
+ * @param num_words Number of words to write
+ * @param error_addr If not NULL, set to the region address of the first request which failed if an error occurs
+ * @return REG_MAPPED_RESULT_SUCCESSFUL on success, other error code on failure
+ */
+int reg_mapped_client_write_region(const reg_mapped_client_cfg_t *cfg, uint32_t addr_start, const uint32_t *data_array,
+                                   size_t num_words, uint32_t *error_addr);
+
+/**
+ * @brief Performs a list of reads and writes, which may each access any page, in as few round trips as possible
+ *
+ * In multiword mode, entries are packed into batch requests, so a batch which fits in the scratch buffer is performed
+ * in a single round trip. Larger batches are split across several batch requests, performed in order. If the server's
+ * multiword buffer is too small for the words read by a batch request, it is resent reading half as many words, for
+ * the rest of the transaction. In other transfer modes, each entry is performed as its own array transfer.
+ *
+ * Entries are performed in order, stopping at the first entry which fails. Accesses made before the failure are not
+ * undone.
+ *
+ * @param cfg Register mapped client configuration
+ * @param entries Array of entries to perform. Read entries have their data array filled
+ * @param num_entries Number of entries
+ * @param error_entry If not NULL, set to the index of the entry which failed if an error occurs
+ * @return REG_MAPPED_RESULT_SUCCESSFUL on success, other error code on failure
+ */
+int reg_mapped_client_transact(const reg_mapped_client_cfg_t *cfg, const reg_mapped_client_batch_entry_t *entries,
+                               size_t num_entries, size_t *error_entry);
+
+/**
+ * @brief Initializes the state for posted writes
+ *
+ * @param state The posted write state to initialize
+ * @param error_cb Optional callback for each posted write which fails (NULL if errors are only collected for sync)
+ * @param error_cb_arg Argument to pass to error_cb
+ */
+void reg_mapped_client_posted_init(reg_mapped_client_posted_writes_t *state,
+                                   reg_mapped_client_posted_error_func error_cb, void *error_cb_arg);
+
+/**
+ * @brief Write to a register without waiting for the response
+ *
+ * The response is matched against the write later, when polled or synced, or when another posted write needs room.
+ * This only blocks if max_in_flight writes are already awaiting a response. Responses are matched in order, so if a
+ * response is lost, the resulting REG_MAPPED_CLIENT_RESULT_RX_FAIL may be reported against a later write.
+ *
+ * @attention No other requests can be made with the client configuration while posted writes are pending, as they
+ * clear the receive buffer. Call reg_mapped_client_posted_drain or reg_mapped_client_posted_sync first.
+ *
+ * @param cfg Register mapped client configuration
+ * @param state Posted write state
+ * @param page Page to write to
+ * @param offset Register offset to write
+ * @param data Data word to write into register
+ * @return REG_MAPPED_RESULT_SUCCESSFUL if the write was sent, other error code if the write could not be sent.
+ * Errors for earlier writes are reported through the error callback and reg_mapped_client_posted_sync
+ */
+int reg_mapped_client_post_write(const reg_mapped_client_cfg_t *cfg, reg_mapped_client_posted_writes_t *state,
+                                 uint8_t page, uint8_t offset, uint32_t data);
+
+/**
+ * @brief Processes responses to posted writes which have already been received, without blocking
+ *
+ * @param cfg Register mapped client configuration
+ * @param state Posted write state
+ */
+void reg_mapped_client_posted_poll(const reg_mapped_client_cfg_t *cfg, reg_mapped_client_posted_writes_t *state);
+
+/**
+ * @brief Waits for the responses to all posted writes. Errors are kept for the next reg_mapped_client_posted_sync
+ *
+ * @param cfg Register mapped client configuration
+ * @param state Posted write state
+ */
+void reg_mapped_client_posted_drain(const reg_mapped_client_cfg_t *cfg, reg_mapped_client_posted_writes_t *state);
+
+/**
+ * @brief Waits for the responses to all posted writes, returning the first error since the last sync
+ *
+ * @param cfg Register mapped client configuration
+ * @param state Posted write state
+ * @param error_page_out Optional pointer to store the page of the first failed write
+ * @param error_offset_out Optional pointer to store the offset of the first failed write
+ * @return REG_MAPPED_RESULT_SUCCESSFUL if all posted writes since the last sync succeeded, otherwise the error code
+ * of the first failed write
+ */
+int reg_mapped_client_posted_sync(const reg_mapped_client_cfg_t *cfg, reg_mapped_client_posted_writes_t *state,
+                                  uint8_t *error_page_out, uint8_t *error_offset_out);
+
 /**
  * @brief Read a page containing a null-temrinated string
  *
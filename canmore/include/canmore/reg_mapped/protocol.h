@@ -11,7 +11,8 @@ extern "C" {
 /*
  * Register-Mapped Channel Protocol
  * ********************************
- * This defines the protocol for accessing a register-mapped interface over a CANmore utility channel.
+ * This defines the protocol for accessing a register-mapped interface over a CANmore utility channel (or CANmore
+ * messages, see Message Binding below).
  *
  * This allows for higher-level interface to be implemented through a variety of 'registers' accessed via addresses
  * to allow for easier implementation of higher-level protocols. Rather than defining a CAN request/response structure,
@@ -52,9 +53,9 @@ extern "C" {
  * bulk write, upon which the bulk write is finished and the server will respond if all register writes were
  * successfully received.
  *
- * Other than bulk writes, no state is saved by the server (although the higher level register interfaces may save
- * state). This allows the server to continue to reliably operate even if transfers fail, as well as seamlessly support
- * multiple clients* (however, bulk writes only support one client at a time).
+ * Other than bulk writes and subscriptions, no state is saved by the server (although the higher level register
+ * interfaces may save state). This allows the server to continue to reliably operate even if transfers fail, as well
+ * as seamlessly support multiple clients* (however, bulk writes only support one client at a time).
  *
  *
  * Address Structure
@@ -93,7 +94,8 @@ extern "C" {
  * This allows for a large amount of data to be queued without the overhead of waiting for a response. This can
  * increase throughput, especially when filling a number of registers representing a buffer.
  *
- * Only write requests can be made bulk requests.
+ * Both read and write requests can be made bulk requests, although a single bulk request must be either all reads or
+ * all writes.
  *
  * To ensure that bulk requests do not execute unless the previous request has been successfully received, a sequence
  * number is assigned to each request. This limits the maximum number of bulk requests before a response to 256 words.
@@ -109,6 +111,23 @@ extern "C" {
  * sequence number for the last received sequence number, and the non-bulk request will error with a bulk request
  * sequence error. Note that all non-bulk requests will fail until a bulk request with end bulk request=1 is sent.
  *
+ * Bulk reads follow the same sequencing, except that the server responds to every bulk read request with the read
+ * data and the sequence number of the request. This allows the agent to stream several read requests before waiting,
+ * with the responses arriving in the same order as the requests. If a bulk read fails, the response (and the response
+ * to every later request in the bulk read) will contain the error and the sequence number the error occurred on, and
+ * the remaining reads are not performed. The agent should still end the bulk read with bulk request end = 1.
+ *
+ *
+ * Message Binding
+ * ===============
+ * Rather than a utility channel, requests and responses can instead be carried in CANmore message frames with the
+ * CANMORE_MSG_SUBTYPE_REG_MAPPED subtype. Each request (agent to client) or response (client to agent) is the entire
+ * contents of a single message, so the message encoder/decoder handles fragmentation and the CRC-18 check.
+ *
+ * This lifts the frame size limit on multiword requests, which can then carry up to CANMORE_MAX_MSG_LENGTH bytes
+ * (255 words) even on classic CAN. Servers on this binding should size the multiword response buffer to match, and
+ * bulk requests are no longer needed (although they are still supported).
+ *
  *
  * Multiword Requests
  * ==================
@@ -116,6 +135,48 @@ extern "C" {
  * requests, and only
  *
  *
+ * Batch Requests
+ * ==============
+ * Batch requests carry a list of reads and writes, each to any page and offset, and return the results in a single
+ * response. This allows scattered registers (such as status registers from several pages) to be polled in a single
+ * round trip. Each entry in the batch accesses count sequential registers, performed one register at a time like a
+ * single request, so any page type can be accessed.
+ *
+ * The server checks the entire batch is well formed before performing any access, responding with a malformed request
+ * error if not. Entries are then performed in order, stopping at the first entry which fails. Accesses made before the
+ * failure are not undone. If successful, the response carries the data of every read entry, in order. The read data
+ * is placed in the multiword response buffer, so servers without one respond with a multiword unsupported error, and
+ * batches reading as many or more words than the largest multiword read respond with a multiword too large error (as
+ * the batch response header is a byte larger). Servers without batch support respond with a malformed request error.
+ *
+ *
+ * Subscriptions
+ * =============
+ * Rather than polling registers to notice when they change, the agent can subscribe to a range of up to
+ * REG_MAPPED_SUBSCRIPTION_MAX_WORDS registers in a page. The server then samples the registers at most once every
+ * interval, and pushes a notification when any register has changed by more than the threshold since it was last
+ * notified (a threshold of 0 notifies on any change). The difference is taken between the raw unsigned words. Every
+ * subscription is also notified at least every REG_MAPPED_SUBSCRIPTION_KEEPALIVE_MS, so the agent can tell an
+ * unchanged register from a lost subscription. A notification is sent for every new subscription as soon as it is
+ * sampled, carrying the current values.
+ *
+ * Subscription requests use the write request structure, with the batch and write flags set. The count is the number
+ * of registers to watch, starting at the page and offset, and the data word carries the interval and threshold. A
+ * subscription to the same page and offset as an existing one replaces it, and a count of 0 removes it. The registers
+ * are read when subscribing, so registers which can't be read are reported in the response. Servers without room for
+ * another subscription respond with a subscription unavailable error.
+ *
+ * Notifications are sent from server to agent on a separate channel from responses, so they can arrive at any time
+ * without being mistaken for a response: CANMORE_CHAN_CONTROL_INTERFACE_NOTIFY on utility channels, or messages with
+ * the CANMORE_MSG_SUBTYPE_REG_MAPPED_NOTIFY subtype on the message binding. Each notification carries the values of
+ * count sequential registers. Subscriptions larger than a notification frame are split across several notifications,
+ * and only the notifications containing a changed register are sent (other than keepalives). If the registers can no
+ * longer be read, a notification is sent with the error result and no data.
+ *
+ * Subscriptions are kept until removed, so agents should remove their subscriptions when finished.
+ *
+ *
+ *
  * Client to Server Request
  * ========================
  *
@@ -140,16 +201,32 @@ extern "C" {
  *   | Flags  | Count  |  Page  | Offset |           Data Word 0             |           Data Word 1             | ... |
  *   +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+-----+
  *
+ * Batch Request Structure:
+ *   +--------+--------+--------+--------+--------+--------+--------+-----+
+ *   | Byte 0 | Byte 1 | Byte 2 | Byte 3 | Byte 4 | Byte 5 | Byte 6 | ... |
+ *   +--------+--------+--------+--------+--------+--------+--------+-----+
+ *   | Flags  | Count  |   Op   | Count  |  Page  | Offset |  Data Words | | Next Entry...
+ *   +--------+--------+--------+--------+--------+--------+--------+-----+
+ *                     |             Batch Entry 0                  |
+ *
+ * Subscription Request Structure:
+ *   +--------+--------+--------+--------+--------+--------+--------+--------+
+ *   | Byte 0 | Byte 1 | Byte 2 | Byte 3 | Byte 4 | Byte 5 | Byte 6 | Byte 7 |
+ *   +--------+--------+--------+--------+--------+--------+--------+--------+
+ *   | Flags  | Count  |  Page  | Offset |  Interval (ms)  |    Threshold    |
+ *   +--------+--------+--------+--------+--------+--------+--------+--------+
+ *
  * Field Definitions:
  *
  * Flags:
  *   +-*-*-*-+-*-+-*-+-*-+-*-+-*-+
- *   | Mode  | R | M | E | B | W |
+ *   | Mode  | T | M | E | B | W |
  *   +-*-*-*-+-*-+-*-+-*-+-*-+-*-+
  *     7   5   4   3   2   1   0
  *   Mode: The Control Interface Mode implemented by this protocol (See titan canmore heartbeat extension mode
  *         description)
- *   R (RFU): Reserved for future use, set to 0
+ *   T (Batch): Set to 1 if a batch request (all other flags except mode must be 0), or a subscription request if W is
+ *              also set
  *   W (Write): Set to 1 if write request, 0 if read request
  *   B (Bulk Request): Set to 1 if a bulk request, 0 if normal request
  *   E (Bulk End): Set to 1 if the last transfer in a bulk request, 0 if not last request or not a bulk request
@@ -158,6 +235,13 @@ extern "C" {
  * Count:
  *  If multiword: the number of words to read/write.
  *  If bulk request: An increasing counter for the bulk request
+ *  If batch request: The number of entries in the batch
+ *  If subscription request: The number of registers to watch, or 0 to remove the subscription
+ *
+ * Batch Entry:
+ *  Op: REG_MAPPED_BATCH_OP_READ or REG_MAPPED_BATCH_OP_WRITE
+ *  Count: The number of sequential registers to access (at least 1, and must not cross the page boundary)
+ *  Data Words (Only if a write entry): Count words to write in little-endian format
  *
  * Reg Address: The 16-bit address for the register to access in little-endian. This is defined by the higher-level
  * protocol Data Word (Only if W=1): The 32-bit word to write in little-endian format
@@ -193,9 +277,30 @@ extern "C" {
  *   | Result |             Data Word             |
  *   +--------+--------+--------+--------+--------+
  *
+ * Bulk Read Response Structure:
+ *   +--------+--------+--------+--------+--------+--------+
+ *   | Byte 0 | Byte 1 | Byte 2 | Byte 3 | Byte 4 | Byte 5 |
+ *   +--------+--------+--------+--------+--------+--------+
+ *   | Result | Seq No |             Data Word             |
+ *   +--------+--------+--------+--------+--------+--------+
+ *
+ * Batch Response Structure
+ *   +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+-----+
+ *   | Byte 0 | Byte 1 | Byte 2 | Byte 3 | Byte 4 | Byte 5 | Byte 6 | Byte 7 | Byte 8 | Byte 9 | ... |
+ *   +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+-----+
+ *   | Result | Entry  |           Data Word 0             |           Data Word 1             | ... |
+ *   +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+-----+
+ *
+ * Notification Structure (Server to Agent, not in response to a request)
+ *   +--------+--------+--------+--------+--------+--------+--------+--------+-----+
+ *   | Byte 0 | Byte 1 | Byte 2 | Byte 3 | Byte 4 | Byte 5 | Byte 6 | Byte 7 | ... |
+ *   +--------+--------+--------+--------+--------+--------+--------+--------+-----+
+ *   | Result | Count  |  Page  | Offset |           Data Word 0             | ... |
+ *   +--------+--------+--------+--------+--------+--------+--------+--------+-----+
+ *
  * Multiword Read Resonse Structure
  *   +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+-----+
- *   | Byte 0 | Byte 1 | Byte 2 | Byte 3 | Byte 4 | Byte 5 | Byte 6 | Byte 6 | Byte 7 | Byte 8 | ... |
+ *   | Byte 0 | Byte 1 | Byte 2 | Byte 3 | Byte 4 | Byte 5 | Byte 6 | Byte 7 | Byte 8 | Byte 9 | ... |
  *   +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+-----+
  *   | Result | Seq No |           Data Word 0             |           Data Word 1             | ... |
  *   +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+-----+
@@ -209,13 +314,22 @@ extern "C" {
  *   5: Invalid Data (If attempting to write an invalid value, such an invalid command to a register which executes the
  *      command)
  *   6: Invalid Mode (The mode in the request does not match the mode for the reg mapped server)
+ *   7: Multiword Unsupported (The server has no multiword response buffer)
+ *   8: Multiword Too Large (The read does not fit in the multiword response buffer)
+ *   9: Subscription Unavailable (The server does not support subscriptions, or has no free subscriptions)
  *
  * Seq No: The last sequence number received from the agent if successful, or the sequence number the error occurred on
  * (all subsequent requests ignored)
  *
+ * Entry: The number of entries performed if successful, or the index of the entry the error occurred on
+ *
  * Data Word:
- *   If Read: The 32-bit word read from the register in little-endian if successful, or 0 if an error occurred
+ *   If Read/Bulk Read: The 32-bit word read from the register in little-endian if successful, or 0 if an error
+ *   occurred
  *   If Multiword Read: If successful, n words (determined by Count). If unsuccessful, this may or may not be present
+ *   If Batch: If successful, the words read by every read entry, in order. If an entry failed, this is still present
+ *             but its contents are undefined. Not present if the batch was rejected before any entry was performed
+ *   If Notification: If successful, Count words starting at Page and Offset. Not present if unsuccessful
  */
 
 union reg_mapped_request_flags {
@@ -225,7 +339,7 @@ union reg_mapped_request_flags {
         uint8_t bulk_req:1;
         uint8_t bulk_end:1;
         uint8_t multiword:1;
-        uint8_t reserved:1;
+        uint8_t batch:1;
         uint8_t mode:3;
     } f;
 };
@@ -254,11 +368,39 @@ struct reg_mapped_multiword_write_request {
     uint32_t data[];
 } __attribute__((packed));
 
+struct reg_mapped_batch_entry {
+    uint8_t op;
+    uint8_t count;
+    uint8_t page;
+    uint8_t offset;
+    uint32_t data[];  // Only present in write entries
+} __attribute__((packed));
+
+struct reg_mapped_batch_request {
+    union reg_mapped_request_flags flags;
+    uint8_t count;
+    uint8_t entries[];  // Sequence of count struct reg_mapped_batch_entry, each followed by its data if a write
+} __attribute__((packed));
+
+#define REG_MAPPED_BATCH_OP_READ 0
+#define REG_MAPPED_BATCH_OP_WRITE 1
+
+struct reg_mapped_subscribe_request {
+    union reg_mapped_request_flags flags;
+    uint8_t count;
+    uint8_t page;
+    uint8_t offset;
+    uint16_t interval_ms;
+    uint16_t threshold;
+} __attribute__((packed));
+
 typedef union reg_mapped_request {
     uint8_t data[1];
     struct reg_mapped_write_request write_pkt;
     struct reg_mapped_read_request read_pkt;
     struct reg_mapped_multiword_write_request multiword_write_pkt;
+    struct reg_mapped_batch_request batch_pkt;
+    struct reg_mapped_subscribe_request subscribe_pkt;
 } reg_mapped_request_t;
 
 #define REG_MAPPED_COMPUTE_MULTIWORD_REQ_LEN(word_count)                                                               \
@@ -275,12 +417,19 @@ typedef union reg_mapped_request {
 #define REG_MAPPED_RESULT_INVALID_MODE 6
 #define REG_MAPPED_RESULT_MULTIWORD_UNSUPPORTED 7
 #define REG_MAPPED_RESULT_MULTIWORD_TOO_LARGE 8
+#define REG_MAPPED_RESULT_SUBSCRIPTION_UNAVAILABLE 9
 
 struct reg_mapped_multiword_read_response {
     uint8_t result;
     uint32_t data[];
 } __attribute__((packed));
 
+struct reg_mapped_batch_response {
+    uint8_t result;
+    uint8_t entry;
+    uint32_t data[];
+} __attribute__((packed));
+
 typedef union reg_mapped_response {
     uint8_t data[1];
 
@@ -298,13 +447,42 @@ typedef union reg_mapped_response {
         uint32_t data;
     } read_pkt;
 
+    struct __attribute__((packed)) {
+        uint8_t result;
+        uint8_t seq_no;
+        uint32_t data;
+    } read_bulk_pkt;
+
     struct reg_mapped_multiword_read_response multiword_read_pkt;
+    struct reg_mapped_batch_response batch_pkt;
 } reg_mapped_response_t;
 #define REG_MAPPED_COMPUTE_MULTIWORD_RESP_LEN(word_count)                                                              \
     (sizeof(struct reg_mapped_multiword_read_response) + (sizeof(uint32_t) * (word_count)))
 #define REG_MAPPED_COMPUTE_MAX_RESP_WORD_COUNT(buffer_len)                                                             \
     ((((unsigned int) (buffer_len)) - sizeof(struct reg_mapped_multiword_read_response)) / sizeof(uint32_t))
 
+#define REG_MAPPED_COMPUTE_BATCH_RESP_LEN(word_count)                                                                  \
+    (sizeof(struct reg_mapped_batch_response) + (sizeof(uint32_t) * (word_count)))
+// Batch responses share the multiword response buffer, and give up a word of it to make room for the entry byte
+#define REG_MAPPED_COMPUTE_MAX_BATCH_RESP_WORD_COUNT(buffer_len)                                                       \
+    (REG_MAPPED_COMPUTE_MAX_RESP_WORD_COUNT(buffer_len) - 1)
+
+struct reg_mapped_notification {
+    uint8_t result;
+    uint8_t count;
+    uint8_t page;
+    uint8_t offset;
+    uint32_t data[];
+} __attribute__((packed));
+
+#define REG_MAPPED_COMPUTE_NOTIFICATION_LEN(word_count)                                                                \
+    (sizeof(struct reg_mapped_notification) + (sizeof(uint32_t) * (word_count)))
+#define REG_MAPPED_COMPUTE_MAX_NOTIFICATION_WORD_COUNT(buffer_len)                                                     \
+    ((((unsigned int) (buffer_len)) - sizeof(struct reg_mapped_notification)) / sizeof(uint32_t))
+
+#define REG_MAPPED_SUBSCRIPTION_MAX_WORDS 16
+#define REG_MAPPED_SUBSCRIPTION_KEEPALIVE_MS 1000
+
 #define REG_MAPPED_PAGE_NUM_WORDS 0x100
 #define REG_MAPPED_PAGE_SIZE (REG_MAPPED_PAGE_NUM_WORDS * 4)
 
@@ -163,9 +163,32 @@ typedef struct reg_mapped_server_page_definition {
     } type;
 } reg_mapped_server_page_def_t;
 
+/**
+ * @brief State for a subscription to a range of registers (see Subscriptions in reg_mapped/protocol.h)
+ * An array of these is preallocated for the server, and must be initialized to 0. These are not to be modified by the
+ * caller
+ */
+typedef struct reg_mapped_server_subscription {
+    uint8_t count;                                       // Registers watched, or 0 if unused
+    uint8_t page;                                        // Page of the watched registers
+    uint8_t offset;                                      // Offset of the first watched register
+    uint8_t last_result;                                 // Result of the last notification
+    bool notify_pending;                                 // Notify every register when next sampled
+    uint16_t interval_ms;                                // Minimum interval between samples
+    uint16_t threshold;                                  // Change from the notified value to notify
+    uint32_t last_sample_ms;                             // Time the registers were last sampled
+    uint32_t last_notify_ms;                             // Time every register was last notified
+    uint32_t values[REG_MAPPED_SUBSCRIPTION_MAX_WORDS];  // The last notified value of each register
+} reg_mapped_server_subscription_t;
+
 /**
  * @brief Register mapped server instance declaration.
  * Passed to the register mapped server request handler to determine how to handle the packet.
+ *
+ * @note Subscriptions added the notify_tx_func, subscriptions, num_subscriptions and notify_max_words fields, which are
+ * compiled in unless CANMORE_CONFIG_DISABLE_SUBSCRIPTIONS is set. Instances which are zero initialized or use
+ * designated initializers need no changes, as a NULL subscriptions array disables subscriptions. Instances initialized
+ * positionally must add the new fields, or set CANMORE_CONFIG_DISABLE_SUBSCRIPTIONS to keep the previous layout.
  */
 typedef struct reg_mapped_server_inst {
     // Must be populated by code calling reg_mapped_server_handle_request
@@ -184,11 +207,19 @@ typedef struct reg_mapped_server_inst {
     size_t multiword_resp_buffer_max_count;        // The maximum number of words to put in multiword_resp_buffer
 #endif
 
+#if !CANMORE_CONFIG_DISABLE_SUBSCRIPTIONS
+    reg_mapped_server_tx_func notify_tx_func;         // Function called to transmit notifications, passed arg
+    reg_mapped_server_subscription_t *subscriptions;  // Preallocated subscriptions (NULL to disable subscriptions)
+    size_t num_subscriptions;                         // Number of elements in subscriptions
+    size_t notify_max_words;                          // Max words in a notification (limited by the frame size)
+#endif
+
     // Should be initialized to 0, holds state tracking data
     // This is noot to be modified by the caller of reg_mapped_server_handle_request
     uint8_t bulk_last_seq_num;
     uint8_t bulk_error_code;
     bool in_bulk_request;
+    bool bulk_request_read;
 } reg_mapped_server_inst_t;
 
 // ========================================
@@ -311,6 +342,20 @@ typedef struct reg_mapped_server_inst {
  */
 void reg_mapped_server_handle_request(reg_mapped_server_inst_t *inst, const uint8_t *msg, size_t len);
 
+#if !CANMORE_CONFIG_DISABLE_SUBSCRIPTIONS
+/**
+ * @brief Samples subscribed registers which are due, transmitting notifications for any which changed
+ *
+ * This should be called periodically (such as from the main loop), at least as often as the shortest subscription
+ * interval expected. Registers are read from this call, so exec register callbacks for subscribed registers are called
+ * from here.
+ *
+ * @param inst The register mapped server instance
+ * @param now_ms The current time in milliseconds. This may wrap around
+ */
+void reg_mapped_server_tick(reg_mapped_server_inst_t *inst, uint32_t now_ms);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -5,7 +5,7 @@
 uint32_t crc32_update(const uint8_t *data, size_t len, uint32_t original_crc32) {
     uint32_t crc32 = original_crc32;
     while (len--) {
-        crc32 = crc32 ^ ((*data++) << 24);
+        crc32 = crc32 ^ (((uint32_t) *data++) << 24);
         for (int i = 0; i < 8; i++) {
             if (crc32 & (1L << 31))
                 crc32 = (crc32 << 1) ^ CRC32_POLYNOMIAL;
@@ -0,0 +1,77 @@
+#include "canmore/msg_aggregation.h"
+
+#include <string.h>
+
+#define AGGREGATE_LEN_LENGTH 10
+#define AGGREGATE_SUBTYPE_OFFSET AGGREGATE_LEN_LENGTH
+
+static_assert(CANMORE_MSG_AGGREGATE_MAX_ENTRY_LENGTH <= (1 << AGGREGATE_LEN_LENGTH),
+              "Aggregate entry length field too small");
+static_assert(AGGREGATE_SUBTYPE_OFFSET + CANMORE_MSG_SUBTYPE_LENGTH <= 16, "Aggregate entry header too small");
+
+// ========================================
+// Packing Functions
+// ========================================
+
+void canmore_msg_aggregate_init(canmore_msg_aggregator_t *state, uint8_t *buffer, size_t capacity) {
+    state->buffer = buffer;
+    state->capacity = (capacity > CANMORE_MAX_MSG_LENGTH ? CANMORE_MAX_MSG_LENGTH : capacity);
+    canmore_msg_aggregate_reset(state);
+}
+
+bool canmore_msg_aggregate_add(canmore_msg_aggregator_t *state, uint8_t subtype, const uint8_t *data, size_t len) {
+    if (subtype == CANMORE_MSG_SUBTYPE_AGGREGATE || subtype >= (1 << CANMORE_MSG_SUBTYPE_LENGTH)) {
+        return false;
+    }
+    if (!canmore_msg_aggregate_fits(state, len)) {
+        return false;
+    }
+
+    uint16_t header = ((len - 1) & ((1u << AGGREGATE_LEN_LENGTH) - 1)) | (subtype << AGGREGATE_SUBTYPE_OFFSET);
+    state->buffer[state->len++] = header & 0xFF;
+    state->buffer[state->len++] = header >> 8;
+    memcpy(&state->buffer[state->len], data, len);
+    state->len += len;
+    state->count++;
+
+    return true;
+}
+
+// ========================================
+// Unpacking Functions
+// ========================================
+
+void canmore_msg_aggregate_iter_init(canmore_msg_aggregate_iter_t *state, const uint8_t *buffer, size_t len) {
+    state->buffer = buffer;
+    state->len = len;
+    state->position = 0;
+    state->malformed = false;
+}
+
+bool canmore_msg_aggregate_iter_next(canmore_msg_aggregate_iter_t *state, uint8_t *subtype_out,
+                                     const uint8_t **data_out, size_t *len_out) {
+    if (state->malformed || state->position == state->len) {
+        return false;
+    }
+
+    // Make sure the full entry is present in the message
+    if (state->len - state->position < CANMORE_MSG_AGGREGATE_ENTRY_HEADER_SIZE) {
+        state->malformed = true;
+        return false;
+    }
+    uint16_t header = state->buffer[state->position] | (state->buffer[state->position + 1] << 8);
+    size_t entry_len = (header & ((1u << AGGREGATE_LEN_LENGTH) - 1)) + 1;
+    uint8_t subtype = header >> AGGREGATE_SUBTYPE_OFFSET;
+    size_t data_pos = state->position + CANMORE_MSG_AGGREGATE_ENTRY_HEADER_SIZE;
+
+    if (state->len - data_pos < entry_len || subtype == CANMORE_MSG_SUBTYPE_AGGREGATE) {
+        state->malformed = true;
+        return false;
+    }
+
+    *subtype_out = subtype;
+    *data_out = &state->buffer[data_pos];
+    *len_out = entry_len;
+    state->position = data_pos + entry_len;
+    return true;
+}
@@ -0,0 +1,250 @@
+#include "canmore/msg_compression.h"
+
+#include <string.h>
+
+// LZ4 block format constraints
+#define LZ_MIN_MATCH 4      // Shortest match which can be encoded
+#define LZ_LAST_LITERALS 5  // The last bytes in a block are always literals
+#define LZ_MATCH_LIMIT 12   // The last match must start at least this many bytes before the end of the block
+#define LZ_MAX_OFFSET 65535
+#define LZ_RUN_MASK 15  // Value of a token length field which continues into extension bytes
+
+// Number of entries in the compressor match table
+#define LZ_HASH_BITS 8
+#define LZ_HASH_SIZE (1 << LZ_HASH_BITS)
+
+static_assert(CANMORE_MAX_MSG_LENGTH < UINT16_MAX, "Match table entries too small");
+static_assert(CANMORE_MAX_MSG_LENGTH <= LZ_MAX_OFFSET, "Messages too long to address every byte");
+
+// ========================================
+// Compression
+// ========================================
+
+static inline uint32_t lz_read32(const uint8_t *data) {
+    return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t) data[3] << 24);
+}
+
+static inline size_t lz_hash(uint32_t seq) {
+    return (seq * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+static inline size_t lz_put_length(uint8_t *buffer_out, size_t len) {
+    size_t pos = 0;
+    while (len >= 255) {
+        buffer_out[pos++] = 255;
+        len -= 255;
+    }
+    buffer_out[pos++] = len;
+    return pos;
+}
+
+/**
+ * @brief Writes a single LZ4 sequence (literals followed by an optional match)
+ *
+ * @param buffer_out Output buffer
+ * @param capacity Size of output buffer
+ * @param pos_ptr Pointer to the current position in the output buffer, updated with the new position
+ * @param literals Pointer to the literals to copy
+ * @param literal_len Number of literals
+ * @param offset Match offset, unused if match_len is 0
+ * @param match_len Match length, or 0 if this is the last sequence
+ * @return true The sequence was written
+ * @return false The sequence does not fit in the output buffer
+ */
+static bool lz_emit_sequence(uint8_t *buffer_out, size_t capacity, size_t *pos_ptr, const uint8_t *literals,
+                             size_t literal_len, size_t offset, size_t match_len) {
+    size_t pos = *pos_ptr;
+
+    // Check worst case size before writing anything
+    size_t required = 1 + literal_len + (literal_len / 255) + 1;
+    if (match_len) {
+        required += 2 + (match_len / 255) + 1;
+    }
+    if (capacity - pos < required) {
+        return false;
+    }
+
+    size_t token_pos = pos++;
+    uint8_t token;
+    if (literal_len >= LZ_RUN_MASK) {
+        token = LZ_RUN_MASK << 4;
+        pos += lz_put_length(&buffer_out[pos], literal_len - LZ_RUN_MASK);
+    }
+    else {
+        token = literal_len << 4;
+    }
+    memcpy(&buffer_out[pos], literals, literal_len);
+    pos += literal_len;
+
+    if (match_len) {
+        buffer_out[pos++] = offset & 0xFF;
+        buffer_out[pos++] = offset >> 8;
+
+        size_t len_code = match_len - LZ_MIN_MATCH;
+        if (len_code >= LZ_RUN_MASK) {
+            token |= LZ_RUN_MASK;
+            pos += lz_put_length(&buffer_out[pos], len_code - LZ_RUN_MASK);
+        }
+        else {
+            token |= len_code;
+        }
+    }
+
+    buffer_out[token_pos] = token;
+    *pos_ptr = pos;
+    return true;
+}
+
+size_t canmore_msg_compress(uint8_t subtype, const uint8_t *data, size_t len, uint8_t *buffer_out, size_t capacity) {
+    if (subtype == CANMORE_MSG_SUBTYPE_COMPRESSED || subtype >= (1 << CANMORE_MSG_SUBTYPE_LENGTH)) {
+        return 0;
+    }
+    if (len == 0 || len > CANMORE_MAX_MSG_LENGTH || capacity < CANMORE_MSG_COMPRESSED_HEADER_SIZE) {
+        return 0;
+    }
+
+    buffer_out[0] = subtype;
+    buffer_out[1] = len & 0xFF;
+    buffer_out[2] = len >> 8;
+    size_t out_pos = CANMORE_MSG_COMPRESSED_HEADER_SIZE;
+
+    // Positions of previously seen 4 byte sequences, offset by 1 so that 0 marks an empty entry
+    uint16_t match_table[LZ_HASH_SIZE];
+    memset(match_table, 0, sizeof(match_table));
+
+    size_t pos = 0;
+    size_t anchor = 0;  // Start of literals not yet written
+    while (pos + LZ_MATCH_LIMIT <= len) {
+        uint32_t seq = lz_read32(&data[pos]);
+        size_t hash = lz_hash(seq);
+        size_t candidate = match_table[hash];
+        match_table[hash] = pos + 1;
+
+        if (candidate == 0 || lz_read32(&data[candidate - 1]) != seq) {
+            pos++;
+            continue;
+        }
+        size_t match_pos = candidate - 1;
+
+        // Extend the match, stopping before the trailing literals
+        size_t match_len = LZ_MIN_MATCH;
+        while (pos + match_len < len - LZ_LAST_LITERALS && data[match_pos + match_len] == data[pos + match_len]) {
+            match_len++;
+        }
+
+        if (!lz_emit_sequence(buffer_out, capacity, &out_pos, &data[anchor], pos - anchor, pos - match_pos,
+                              match_len)) {
+            return 0;
+        }
+        pos += match_len;
+        anchor = pos;
+    }
+
+    if (!lz_emit_sequence(buffer_out, capacity, &out_pos, &data[anchor], len - anchor, 0, 0)) {
+        return 0;
+    }
+    return out_pos;
+}
+
+// ========================================
+// Decompression
+// ========================================
+
+/**
+ * @brief Reads the extension bytes of a length field
+ *
+ * @param data The compressed data
+ * @param data_len Length of the compressed data
+ * @param pos_ptr Pointer to the position of the first extension byte, updated to the position after the field
+ * @param len_ptr Pointer to the length, which the extension bytes are added to
+ * @return false The field runs past the end of the data
+ */
+static bool lz_read_length(const uint8_t *data, size_t data_len, size_t *pos_ptr, size_t *len_ptr) {
+    size_t pos = *pos_ptr;
+    uint8_t next;
+    do {
+        if (pos >= data_len) {
+            return false;
+        }
+        next = data[pos++];
+        *len_ptr += next;
+    } while (next == 255);
+
+    *pos_ptr = pos;
+    return true;
+}
+
+size_t canmore_msg_decompress(const uint8_t *msg, size_t msg_len, uint8_t *subtype_out, uint8_t *buffer_out,
+                              size_t capacity) {
+    if (msg_len < CANMORE_MSG_COMPRESSED_HEADER_SIZE) {
+        return 0;
+    }
+
+    uint8_t subtype = msg[0];
+    size_t len = msg[1] | (msg[2] << 8);
+    if (subtype == CANMORE_MSG_SUBTYPE_COMPRESSED || subtype >= (1 << CANMORE_MSG_SUBTYPE_LENGTH)) {
+        return 0;
+    }
+    if (len == 0 || len > capacity) {
+        return 0;
+    }
+
+    const uint8_t *data = &msg[CANMORE_MSG_COMPRESSED_HEADER_SIZE];
+    size_t data_len = msg_len - CANMORE_MSG_COMPRESSED_HEADER_SIZE;
+    size_t pos = 0;
+    size_t out_pos = 0;
+
+    while (pos < data_len) {
+        uint8_t token = data[pos++];
+
+        // Copy literals
+        size_t literal_len = token >> 4;
+        if (literal_len == LZ_RUN_MASK && !lz_read_length(data, data_len, &pos, &literal_len)) {
+            return 0;
+        }
+        if (literal_len > data_len - pos || literal_len > len - out_pos) {
+            return 0;
+        }
+        memcpy(&buffer_out[out_pos], &data[pos], literal_len);
+        pos += literal_len;
+        out_pos += literal_len;
+
+        // The last sequence has no match
+        if (pos == data_len) {
+            break;
+        }
+
+        // Copy match
+        if (data_len - pos < 2) {
+            return 0;
+        }
+        size_t offset = data[pos] | (data[pos + 1] << 8);
+        pos += 2;
+        if (offset == 0 || offset > out_pos) {
+            return 0;
+        }
+
+        size_t match_len = token & LZ_RUN_MASK;
+        if (match_len == LZ_RUN_MASK && !lz_read_length(data, data_len, &pos, &match_len)) {
+            return 0;
+        }
+        match_len += LZ_MIN_MATCH;
+        if (match_len > len - out_pos) {
+            return 0;
+        }
+
+        // Matches may overlap the bytes being written, so this must copy forwards one byte at a time
+        const uint8_t *match = &buffer_out[out_pos - offset];
+        for (size_t i = 0; i < match_len; i++) {
+            buffer_out[out_pos + i] = match[i];
+        }
+        out_pos += match_len;
+    }
+
+    if (out_pos != len) {
+        return 0;
+    }
+
+    *subtype_out = subtype;
+    return len;
+}
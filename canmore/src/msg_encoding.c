@@ -2,6 +2,8 @@
 
 #include <string.h>
 
+static_assert(CANMORE_MAX_MSG_LENGTH <= CANMORE_MAX_XL_FRAME_SIZE, "Messages must fit in a single CAN XL frame");
+
 // ========================================
 // CRC-18 Calculations
 // ========================================
@@ -51,28 +53,120 @@ static void crc18_update(uint32_t *crc_ptr, const uint8_t *data, size_t data_len
 // Encoder Functions
 // ========================================
 
+// Sources for message data in the encoder
+#define CANMORE_MSG_ENCODE_SOURCE_BUFFER 0
+#define CANMORE_MSG_ENCODE_SOURCE_SEGMENTS 1
+#define CANMORE_MSG_ENCODE_SOURCE_PULL 2
+
 void canmore_msg_encode_init(canmore_msg_encoder_t *state, uint32_t client_id, uint32_t direction, bool use_canfd) {
     state->client_id = client_id;
     state->direction = direction;
     state->use_canfd = use_canfd;
+    state->source = CANMORE_MSG_ENCODE_SOURCE_BUFFER;
+    state->fd_nominal_bitrate = 0;
+    state->fd_data_bitrate = 0;
+    state->fd_plan_frames = 0;
     state->length = 0;
     state->position = 0;
 }
 
-bool canmore_msg_encode_done(canmore_msg_encoder_t *state) {
-    return state->length == state->position;
+void canmore_msg_encode_set_fd_bitrates(canmore_msg_encoder_t *state, uint32_t nominal_bitrate, uint32_t data_bitrate) {
+    state->fd_nominal_bitrate = nominal_bitrate;
+    state->fd_data_bitrate = (data_bitrate ? data_bitrate : nominal_bitrate);
 }
 
-void canmore_msg_encode_load(canmore_msg_encoder_t *state, uint8_t subtype, const uint8_t *buffer, size_t len) {
+/**
+ * @brief Internal function to reset the encoder for a new message, once the source has been configured
+ */
+static void encode_load_internal(canmore_msg_encoder_t *state, uint8_t subtype, size_t len) {
     if (len > CANMORE_MAX_MSG_LENGTH) {
         len = CANMORE_MAX_MSG_LENGTH;
     }
 
     state->subtype = subtype;
-    state->buf_ptr = buffer;
     state->length = len;
     state->position = 0;
     state->seq_num = 0;
+    state->crc18 = CRC18_INITIAL_VALUE;
+
+    state->fd_plan_frames = 0;
+    if (state->use_canfd && state->fd_nominal_bitrate) {
+        state->fd_plan_frames =
+            canmore_msg_fd_plan_fragments(len, state->fd_nominal_bitrate, state->fd_data_bitrate, state->fd_plan);
+    }
+}
+
+bool canmore_msg_encode_done(canmore_msg_encoder_t *state) {
+    return state->length == state->position;
+}
+
+void canmore_msg_encode_load(canmore_msg_encoder_t *state, uint8_t subtype, const uint8_t *buffer, size_t len) {
+    state->source = CANMORE_MSG_ENCODE_SOURCE_BUFFER;
+    state->buf_ptr = buffer;
+    encode_load_internal(state, subtype, len);
+}
+
+void canmore_msg_encode_load_segments(canmore_msg_encoder_t *state, uint8_t subtype,
+                                      const canmore_msg_segment_t *segments, size_t num_segments) {
+    size_t len = 0;
+    for (size_t i = 0; i < num_segments; i++) {
+        len += segments[i].len;
+    }
+
+    state->source = CANMORE_MSG_ENCODE_SOURCE_SEGMENTS;
+    state->segments = segments;
+    state->segment_index = 0;
+    state->segment_offset = 0;
+    encode_load_internal(state, subtype, len);
+}
+
+void canmore_msg_encode_load_pull(canmore_msg_encoder_t *state, uint8_t subtype, size_t len,
+                                  canmore_msg_encode_pull_cb_t pull_cb, void *pull_arg) {
+    state->source = CANMORE_MSG_ENCODE_SOURCE_PULL;
+    state->pull_cb = pull_cb;
+    state->pull_arg = pull_arg;
+    encode_load_internal(state, subtype, len);
+}
+
+/**
+ * @brief Internal function to copy the next bytes of the loaded message into the frame buffer
+ *
+ * @param state The encoder state
+ * @param buffer_out The buffer to copy into
+ * @param copy_size The number of bytes to copy. Must not exceed the remaining data in the message
+ */
+static void encode_copy_data(canmore_msg_encoder_t *state, uint8_t *buffer_out, size_t copy_size) {
+    if (state->source == CANMORE_MSG_ENCODE_SOURCE_SEGMENTS) {
+        size_t copied = 0;
+        while (copied < copy_size) {
+            const canmore_msg_segment_t *segment = &state->segments[state->segment_index];
+            size_t segment_remaining = segment->len - state->segment_offset;
+            size_t chunk = copy_size - copied;
+            if (chunk > segment_remaining) {
+                chunk = segment_remaining;
+            }
+
+            memcpy(&buffer_out[copied], &segment->data[state->segment_offset], chunk);
+            copied += chunk;
+            state->segment_offset += chunk;
+
+            // Move onto the next segment (which also skips over any empty segments)
+            if (state->segment_offset == segment->len) {
+                state->segment_index++;
+                state->segment_offset = 0;
+            }
+        }
+    }
+    else if (state->source == CANMORE_MSG_ENCODE_SOURCE_PULL) {
+        state->pull_cb(state->pull_arg, state->position, buffer_out, copy_size);
+    }
+    else {
+        memcpy(buffer_out, &state->buf_ptr[state->position], copy_size);
+    }
+
+    // Compute the crc as the data goes out, so the full message never needs to be read back
+    crc18_update(&state->crc18, buffer_out, copy_size);
+    state->position += copy_size;
 }
 
 bool canmore_msg_encode_next(canmore_msg_encoder_t *state, uint8_t *buffer_out, uint8_t *len_out, uint32_t *id_out,
@@ -86,8 +180,11 @@ bool canmore_msg_encode_next(canmore_msg_encoder_t *state, uint8_t *buffer_out,
     // Copy buffer
     size_t remaining_size = state->length - state->position;
     size_t copy_size = (max_frame_len > remaining_size ? remaining_size : max_frame_len);
-    memcpy(buffer_out, &state->buf_ptr[state->position], copy_size);
-    state->position += copy_size;
+    if (state->fd_plan_frames) {
+        // Use the planned frame size (sequence numbers never roll over in CAN FD, so they index the plan directly)
+        copy_size = state->fd_plan[state->seq_num];
+    }
+    encode_copy_data(state, buffer_out, copy_size);
 
     // Handle 0 padding for can fd
     if (state->use_canfd) {
@@ -114,10 +211,7 @@ bool canmore_msg_encode_next(canmore_msg_encoder_t *state, uint8_t *buffer_out,
     else if (state->length == state->position) {
         *is_extended = true;
 
-        uint32_t crc = CRC18_INITIAL_VALUE;
-        crc18_update(&crc, state->buf_ptr, state->length);
-        crc &= CRC18_MASK;
-
+        uint32_t crc = state->crc18 & CRC18_MASK;
         *id_out = CANMORE_CALC_MSG_EXT_ID(state->client_id, state->direction, state->seq_num, crc);
     }
     else {
@@ -136,43 +230,249 @@ bool canmore_msg_encode_next(canmore_msg_encoder_t *state, uint8_t *buffer_out,
     return true;
 }
 
+// ========================================
+// CAN FD Fragmentation Planner
+// ========================================
+
+// Frame data lengths available to frames which aren't the last in a message (which can't be padded)
+static const uint8_t fd_unpadded_lens[] = { 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64 };
+#define FD_NUM_UNPADDED_LENS (sizeof(fd_unpadded_lens) / sizeof(*fd_unpadded_lens))
+
+// Maximum frames between the first and last frame of a message
+#define FD_MAX_MIDDLE_FRAMES (CANMORE_MSG_FD_MAX_FRAMES - 2)
+
+/**
+ * @brief Estimates the time to transmit a CAN FD frame with bitrate switching, assuming worst case bit stuffing
+ *
+ * @param frame_len The length of the frame (must be a valid CAN FD length)
+ * @param is_extended True if the frame has an extended ID
+ * @param nominal_bitrate The arbitration phase bitrate
+ * @param data_bitrate The data phase bitrate
+ * @return uint32_t The frame time in nanoseconds
+ */
+static uint32_t fd_frame_time_ns(size_t frame_len, bool is_extended, uint32_t nominal_bitrate, uint32_t data_bitrate) {
+    // SOF, ID, (SRR, IDE, ID Ext), RRS, IDE/FDF, res, BRS, then a stuff bit every 4 bits in the worst case
+    uint32_t arb_bits = (is_extended ? 36 : 17);
+    arb_bits += (arb_bits - 1) / 4;
+
+    // ESI, DLC, and data, still subject to dynamic stuffing
+    uint32_t data_bits = 1 + 4 + 8 * frame_len;
+    data_bits += data_bits / 4;
+
+    // Stuff count and CRC with their fixed stuff bits, then the CRC delimiter where the bitrate switches back
+    uint32_t crc_len = (frame_len > 16 ? 21 : 17);
+    data_bits += 4 + crc_len + (4 + crc_len + 3) / 4 + 1;
+
+    // ACK slot, ACK delimiter, EOF, and interframe space
+    arb_bits += 1 + 1 + 7 + 3;
+
+    return (uint32_t) ((arb_bits * 1000000000ull) / nominal_bitrate + (data_bits * 1000000000ull) / data_bitrate);
+}
+
+/**
+ * @brief Fills the plan using the default strategy of filling each frame
+ */
+static size_t fd_plan_fill_frames(size_t len, uint8_t *frame_lens_out) {
+    size_t num_frames = 0;
+    while (len > 0) {
+        size_t frame_len = (len > CANMORE_MAX_FD_FRAME_SIZE ? CANMORE_MAX_FD_FRAME_SIZE : len);
+        frame_lens_out[num_frames++] = frame_len;
+        len -= frame_len;
+    }
+    return num_frames;
+}
+
+/**
+ * @brief Computes the time to transmit a message with the given plan
+ */
+static uint64_t fd_plan_time_ns(const uint8_t *frame_lens, size_t num_frames, uint32_t nominal_bitrate,
+                                uint32_t data_bitrate) {
+    uint64_t time = 0;
+    for (size_t i = 0; i < num_frames; i++) {
+        bool is_extended = (i == 0 || i == num_frames - 1);
+        size_t frame_len = canmore_fd_dlc2len(canmore_fd_len2dlc(frame_lens[i]));
+        time += fd_frame_time_ns(frame_len, is_extended, nominal_bitrate, data_bitrate);
+    }
+    return time;
+}
+
+size_t canmore_msg_fd_plan_fragments(size_t len, uint32_t nominal_bitrate, uint32_t data_bitrate,
+                                     uint8_t *frame_lens_out) {
+    if (len > CANMORE_MAX_MSG_LENGTH) {
+        len = CANMORE_MAX_MSG_LENGTH;
+    }
+
+    // Start with the default plan, only replacing it if a faster one is found
+    size_t best_frames = fd_plan_fill_frames(len, frame_lens_out);
+    if (len == 0 || !nominal_bitrate || !data_bitrate) {
+        return best_frames;
+    }
+    uint64_t best_time = fd_plan_time_ns(frame_lens_out, best_frames, nominal_bitrate, data_bitrate);
+
+    // Every frame other than the first and last uses a standard ID, so only the total data in the middle frames affects
+    // the rest of the message. Compute the fastest way to send each possible number of middle bytes with unpadded
+    // standard frames, keeping only a sliding window of costs, and the choice for each length to rebuild the plan.
+    uint32_t first_cost[FD_NUM_UNPADDED_LENS];
+    uint32_t middle_cost[FD_NUM_UNPADDED_LENS];
+    for (size_t i = 0; i < FD_NUM_UNPADDED_LENS; i++) {
+        first_cost[i] = fd_frame_time_ns(fd_unpadded_lens[i], true, nominal_bitrate, data_bitrate);
+        middle_cost[i] = fd_frame_time_ns(fd_unpadded_lens[i], false, nominal_bitrate, data_bitrate);
+    }
+    uint32_t last_cost[CANMORE_MAX_FD_FRAME_SIZE + 1];
+    for (size_t i = 1; i <= CANMORE_MAX_FD_FRAME_SIZE; i++) {
+        last_cost[i] = fd_frame_time_ns(canmore_fd_dlc2len(canmore_fd_len2dlc(i)), true, nominal_bitrate, data_bitrate);
+    }
+
+#define FD_WINDOW_SIZE (CANMORE_MAX_FD_FRAME_SIZE + 1)
+    uint32_t middle_time[FD_WINDOW_SIZE];
+    uint8_t middle_count[FD_WINDOW_SIZE];
+    uint8_t middle_choice[(CANMORE_MAX_MSG_LENGTH + 1) / 2 + 1];  // Packed 4-bit indices into fd_unpadded_lens
+
+    size_t best_first = 0, best_middle = 0, best_last = 0;
+    for (size_t middle = 0; middle + 2 <= len; middle++) {
+        uint32_t *time = &middle_time[middle % FD_WINDOW_SIZE];
+        uint8_t *count = &middle_count[middle % FD_WINDOW_SIZE];
+
+        if (middle == 0) {
+            *time = 0;
+            *count = 0;
+        }
+        else {
+            *time = UINT32_MAX;
+            uint8_t choice = 0;
+            for (size_t i = 0; i < FD_NUM_UNPADDED_LENS && fd_unpadded_lens[i] <= middle; i++) {
+                size_t prev = (middle - fd_unpadded_lens[i]) % FD_WINDOW_SIZE;
+                if (middle_time[prev] == UINT32_MAX || middle_count[prev] >= FD_MAX_MIDDLE_FRAMES) {
+                    continue;
+                }
+                uint32_t candidate = middle_time[prev] + middle_cost[i];
+                if (candidate < *time) {
+                    *time = candidate;
+                    *count = middle_count[prev] + 1;
+                    choice = i;
+                }
+            }
+            if (middle % 2) {
+                middle_choice[middle / 2] = (middle_choice[middle / 2] & 0x0F) | (choice << 4);
+            }
+            else {
+                middle_choice[middle / 2] = choice;
+            }
+        }
+
+        if (*time == UINT32_MAX) {
+            continue;
+        }
+
+        // Try every first frame length which leaves a valid last frame
+        for (size_t i = 0; i < FD_NUM_UNPADDED_LENS; i++) {
+            size_t first = fd_unpadded_lens[i];
+            if (first + middle >= len) {
+                break;
+            }
+            size_t last = len - first - middle;
+            if (last > CANMORE_MAX_FD_FRAME_SIZE) {
+                continue;
+            }
+
+            uint64_t total = (uint64_t) first_cost[i] + *time + last_cost[last];
+            if (total < best_time) {
+                best_time = total;
+                best_first = first;
+                best_middle = middle;
+                best_last = last;
+            }
+        }
+    }
+#undef FD_WINDOW_SIZE
+
+    // Keep the default plan if nothing was faster
+    if (best_first == 0) {
+        return best_frames;
+    }
+
+    // Rebuild the plan from the choices for the middle frames
+    size_t num_frames = 0;
+    frame_lens_out[num_frames++] = best_first;
+    while (best_middle > 0) {
+        uint8_t choice = middle_choice[best_middle / 2];
+        choice = (best_middle % 2 ? choice >> 4 : choice & 0x0F);
+        frame_lens_out[num_frames++] = fd_unpadded_lens[choice];
+        best_middle -= fd_unpadded_lens[choice];
+    }
+    frame_lens_out[num_frames++] = best_last;
+    return num_frames;
+}
+
 // ========================================
 // Decoder Functions
 // ========================================
 
-void canmore_msg_decode_reset_state(canmore_msg_decoder_t *state) {
+void canmore_msg_split_decode_reset_state(canmore_msg_split_decoder_t *state) {
     state->crc18 = CRC18_INITIAL_VALUE;
     state->decode_len = 0;
     state->next_seq_num = 0;
+    state->skip_msg = false;
     // Don't reset subtype or data, as these need to be read after this is called
     // No need to reset subtype or expected length, as the decode will always fail until a 0 sequence number is received
     // That code will always write these values from the extended id
 }
 
+void canmore_msg_decode_reset_state(canmore_msg_decoder_t *state) {
+    canmore_msg_split_decode_reset_state(&state->split);
+}
+
 /**
  * @brief Internal function to report decoding error and resets the decoder state
  *
  * @param state The decoder state to reset
  */
-static void decoder_error_and_reset_state(canmore_msg_decoder_t *state, unsigned int error_code) {
+static void decoder_error_and_reset_state(canmore_msg_split_decoder_t *state, unsigned int error_code) {
     if (state->decode_error_handler) {
         state->decode_error_handler(state->decode_error_arg, error_code);
     }
 
-    canmore_msg_decode_reset_state(state);
+    canmore_msg_split_decode_reset_state(state);
 }
 
-void canmore_msg_decode_init(canmore_msg_decoder_t *state, canmore_msg_decoder_error_handler_t decode_error_handler,
-                             void *decode_error_arg, bool use_canfd) {
+void canmore_msg_split_decode_init(canmore_msg_split_decoder_t *state,
+                                   canmore_msg_decoder_error_handler_t decode_error_handler, void *decode_error_arg,
+                                   bool use_canfd) {
     state->decode_error_arg = decode_error_arg;
     state->decode_error_handler = decode_error_handler;
     state->use_canfd = use_canfd;
+    state->subtype_filter = CANMORE_MSG_SUBTYPE_FILTER_ALL;
+    state->decode_buffer = NULL;
+    state->decode_capacity = CANMORE_MAX_MSG_LENGTH;
 
-    canmore_msg_decode_reset_state(state);
+    canmore_msg_split_decode_reset_state(state);
 }
 
-size_t canmore_msg_decode_frame(canmore_msg_decoder_t *state, uint32_t can_id, bool is_extended, const uint8_t *frame,
-                                size_t frame_len) {
+void canmore_msg_split_decode_init_with_buffer(canmore_msg_split_decoder_t *state,
+                                               canmore_msg_decoder_error_handler_t decode_error_handler,
+                                               void *decode_error_arg, bool use_canfd, uint8_t *buffer,
+                                               size_t capacity) {
+    canmore_msg_split_decode_init(state, decode_error_handler, decode_error_arg, use_canfd);
+    canmore_msg_split_decode_set_capacity(state, capacity);
+    state->decode_buffer = buffer;
+}
+
+void canmore_msg_decode_init(canmore_msg_decoder_t *state, canmore_msg_decoder_error_handler_t decode_error_handler,
+                             void *decode_error_arg, bool use_canfd) {
+    canmore_msg_split_decode_init(&state->split, decode_error_handler, decode_error_arg, use_canfd);
+}
+
+/**
+ * @brief Internal function to decode a frame, shared between the decoder and split decoder
+ *
+ * The buffer is passed separately rather than through the split state, so that canmore_msg_decoder_t does not need to
+ * hold a pointer to itself (which would break if the struct is copied)
+ *
+ * @param state The decoder state
+ * @param decode_buffer The buffer to reassemble into, or NULL to drop any messages starting in this frame (NO_BUFFER)
+ */
+static size_t decode_frame_internal(canmore_msg_split_decoder_t *state, uint8_t *decode_buffer, uint32_t can_id,
+                                    bool is_extended, const uint8_t *frame, size_t frame_len) {
     canmore_id_t id;
     id.identifier = can_id;
 
@@ -202,6 +502,18 @@ size_t canmore_msg_decode_frame(canmore_msg_decoder_t *state, uint32_t can_id, b
 
         state->subtype = id.pkt_ext_start.msg_subtype;
         state->expected_len = id.pkt_ext_start.msg_len;
+        state->skip_msg = !(state->subtype_filter & CANMORE_MSG_SUBTYPE_FILTER_BIT(state->subtype));
+
+        // Reject messages which can't be stored now, rather than after they've been received
+        // The rest of the message is skipped, so its remaining frames don't raise sequence errors
+        if (!state->skip_msg && (!decode_buffer || state->expected_len > state->decode_capacity)) {
+            if (state->decode_error_handler) {
+                state->decode_error_handler(state->decode_error_arg,
+                                            (decode_buffer ? CANMORE_MSG_DECODER_ERROR_MSG_EXCEEDS_CAPACITY :
+                                                             CANMORE_MSG_DECODER_ERROR_NO_BUFFER));
+            }
+            state->skip_msg = true;
+        }
         is_last = !!id.pkt_ext_start.msg_single;
         is_single = is_last;
     }
@@ -238,13 +550,16 @@ size_t canmore_msg_decode_frame(canmore_msg_decoder_t *state, uint32_t can_id, b
         copy_len = state->expected_len - state->decode_len;
     }
 
-    // Compute the checksum (only needed if not single frame packet, since those can't be fragmented)
-    if (!is_single) {
-        crc18_update(&state->crc18, frame, copy_len);
-    }
+    // Only track the length of skipped messages, no need to compute the checksum or store the data
+    if (!state->skip_msg) {
+        // Compute the checksum (only needed if not single frame packet, since those can't be fragmented)
+        if (!is_single) {
+            crc18_update(&state->crc18, frame, copy_len);
+        }
 
-    // Append packet to end of decode buffer
-    memcpy(&state->decode_buffer[state->decode_len], frame, copy_len);
+        // Append packet to end of decode buffer
+        memcpy(&decode_buffer[state->decode_len], frame, copy_len);
+    }
     state->decode_len += copy_len;
 
     // Finish Processing
@@ -255,6 +570,12 @@ size_t canmore_msg_decode_frame(canmore_msg_decoder_t *state, uint32_t can_id, b
             return 0;
         }
 
+        // Skipped messages are silently dropped once fully received
+        if (state->skip_msg) {
+            canmore_msg_split_decode_reset_state(state);
+            return 0;
+        }
+
         // If we're the last packet (and not a single packet transmission), verify the complete message checksum
         if (!is_single) {
             uint32_t crc_calc = state->crc18 & CRC18_MASK;
@@ -267,7 +588,7 @@ size_t canmore_msg_decode_frame(canmore_msg_decoder_t *state, uint32_t can_id, b
 
         // Reset state for new message
         size_t decoded_len = state->decode_len;
-        canmore_msg_decode_reset_state(state);
+        canmore_msg_split_decode_reset_state(state);
         return decoded_len;
     }
     else {
@@ -297,6 +618,82 @@ size_t canmore_msg_decode_frame(canmore_msg_decoder_t *state, uint32_t can_id, b
     }
 }
 
+size_t canmore_msg_decode_frame(canmore_msg_decoder_t *state, uint32_t can_id, bool is_extended, const uint8_t *frame,
+                                size_t frame_len) {
+    return decode_frame_internal(&state->split, state->decode_buffer, can_id, is_extended, frame, frame_len);
+}
+
+size_t canmore_msg_split_decode_frame(canmore_msg_split_decoder_t *state, uint32_t can_id, bool is_extended,
+                                      const uint8_t *frame, size_t frame_len) {
+    return decode_frame_internal(state, state->decode_buffer, can_id, is_extended, frame, frame_len);
+}
+
+// ========================================
+// Batched Decoder Functions
+// ========================================
+
+#if defined(__GNUC__)
+#define CANMORE_PREFETCH_WRITE(addr) __builtin_prefetch((addr), 1)
+#define CANMORE_PREFETCH_READ(addr) __builtin_prefetch((addr), 0)
+#else
+#define CANMORE_PREFETCH_WRITE(addr) ((void) (addr))
+#define CANMORE_PREFETCH_READ(addr) ((void) (addr))
+#endif
+
+size_t canmore_msg_decode_frames(const canmore_msg_frame_t *frames, size_t num_frames,
+                                 const canmore_msg_decode_batch_ops_t *ops, canmore_msg_decoded_t *out,
+                                 size_t out_max, size_t *out_count) {
+    size_t consumed = 0;
+    size_t decoded = 0;
+
+    // Look up the first decoder ahead of the loop, after that the next decoder is always looked up one frame ahead
+    canmore_msg_split_decoder_t *next_decoder = NULL;
+    if (num_frames > 0) {
+        next_decoder = ops->lookup(ops->arg, frames[0].can_id, frames[0].is_extended);
+    }
+
+    while (consumed < num_frames && decoded < out_max) {
+        const canmore_msg_frame_t *frame = &frames[consumed];
+        canmore_msg_split_decoder_t *decoder = next_decoder;
+
+        // Start pulling in the state for the next frame while this frame is decoded
+        if (consumed + 1 < num_frames) {
+            const canmore_msg_frame_t *next_frame = &frames[consumed + 1];
+            CANMORE_PREFETCH_READ(next_frame->data);
+            next_decoder = ops->lookup(ops->arg, next_frame->can_id, next_frame->is_extended);
+            if (next_decoder) {
+                CANMORE_PREFETCH_WRITE(next_decoder);
+            }
+        }
+        consumed++;
+
+        if (!decoder) {
+            continue;
+        }
+
+        if (canmore_msg_split_decode_needs_buffer(decoder, frame->can_id, frame->is_extended)) {
+            canmore_msg_split_decode_attach_buffer(decoder, ops->acquire_buffer(ops->arg));
+        }
+
+        size_t len = canmore_msg_split_decode_frame(decoder, frame->can_id, frame->is_extended, frame->data,
+                                                    frame->len);
+        if (len > 0) {
+            // Hand the buffer off with the message, the decoder will get a new one if another message starts
+            canmore_msg_decoded_t *msg = &out[decoded++];
+            msg->decoder = decoder;
+            msg->subtype = canmore_msg_split_decode_get_subtype(decoder);
+            msg->len = len;
+            msg->buffer = canmore_msg_split_decode_detach_buffer(decoder);
+        }
+        else if (ops->release_buffer && !canmore_msg_split_decode_in_progress(decoder) && decoder->decode_buffer) {
+            ops->release_buffer(ops->arg, canmore_msg_split_decode_detach_buffer(decoder));
+        }
+    }
+
+    *out_count = decoded;
+    return consumed;
+}
+
 // ========================================
 // CAN FD DLC conversion
 // ========================================
@@ -0,0 +1,335 @@
+#include "canmore/msg_transfer.h"
+#include "canmore/crc32.h"
+
+#include <string.h>
+
+static_assert(CANMORE_MSG_TRANSFER_MAX_LENGTH - 1 <= UINT16_MAX, "DATA offset field too small");
+static_assert(CANMORE_MSG_TRANSFER_START_SIZE <= CANMORE_MAX_MSG_LENGTH, "START message too large");
+
+// ========================================
+// Message Encoding
+// ========================================
+
+static inline void put_u16(uint8_t *buffer, uint16_t value) {
+    buffer[0] = value & 0xFF;
+    buffer[1] = value >> 8;
+}
+
+static inline void put_u32(uint8_t *buffer, uint32_t value) {
+    buffer[0] = value & 0xFF;
+    buffer[1] = (value >> 8) & 0xFF;
+    buffer[2] = (value >> 16) & 0xFF;
+    buffer[3] = value >> 24;
+}
+
+static inline uint16_t get_u16(const uint8_t *buffer) {
+    return buffer[0] | (buffer[1] << 8);
+}
+
+static inline uint32_t get_u32(const uint8_t *buffer) {
+    return buffer[0] | (buffer[1] << 8) | (buffer[2] << 16) | ((uint32_t) buffer[3] << 24);
+}
+
+static size_t encode_ack(uint8_t *buffer_out, uint8_t transfer_id, uint32_t offset, uint16_t window, uint8_t flags) {
+    buffer_out[0] = CANMORE_MSG_TRANSFER_OPCODE_ACK;
+    buffer_out[1] = transfer_id;
+    put_u32(&buffer_out[2], offset);
+    put_u16(&buffer_out[6], window);
+    buffer_out[8] = flags;
+    return CANMORE_MSG_TRANSFER_ACK_SIZE;
+}
+
+static size_t encode_abort(uint8_t *buffer_out, uint8_t opcode, uint8_t transfer_id, uint8_t reason) {
+    buffer_out[0] = opcode;
+    buffer_out[1] = transfer_id;
+    buffer_out[2] = reason;
+    return CANMORE_MSG_TRANSFER_ABORT_SIZE;
+}
+
+static inline bool valid_subtype(uint8_t subtype) {
+    return subtype != CANMORE_MSG_SUBTYPE_TRANSFER && subtype < (1 << CANMORE_MSG_SUBTYPE_LENGTH);
+}
+
+// ========================================
+// Sender
+// ========================================
+
+void canmore_msg_transfer_tx_init(canmore_msg_transfer_tx_t *state) {
+    memset(state, 0, sizeof(*state));
+    state->status = CANMORE_MSG_TRANSFER_STATUS_IDLE;
+}
+
+bool canmore_msg_transfer_tx_start(canmore_msg_transfer_tx_t *state, uint8_t subtype, const uint8_t *data, size_t len,
+                                   size_t chunk_size) {
+    if (!valid_subtype(subtype) || len == 0 || len > CANMORE_MSG_TRANSFER_MAX_LENGTH || chunk_size == 0) {
+        return false;
+    }
+
+    state->data = data;
+    state->length = len;
+    state->crc32 = crc32_compute(data, len);
+    state->send_offset = 0;
+    state->acked_offset = 0;
+    state->window = 0;
+    state->chunk_size =
+        (chunk_size > CANMORE_MSG_TRANSFER_MAX_CHUNK_SIZE ? CANMORE_MSG_TRANSFER_MAX_CHUNK_SIZE : chunk_size);
+    state->subtype = subtype;
+    state->transfer_id++;  // Distinguishes stale messages from the previous transfer
+    state->send_start = true;
+    state->started = false;
+    state->status = CANMORE_MSG_TRANSFER_STATUS_ACTIVE;
+    state->abort_reason = 0;
+    return true;
+}
+
+size_t canmore_msg_transfer_tx_next(canmore_msg_transfer_tx_t *state, uint8_t *buffer_out) {
+    if (state->status != CANMORE_MSG_TRANSFER_STATUS_ACTIVE) {
+        return 0;
+    }
+
+    if (state->send_start) {
+        state->send_start = false;
+        buffer_out[0] = CANMORE_MSG_TRANSFER_OPCODE_START;
+        buffer_out[1] = state->transfer_id;
+        buffer_out[2] = state->subtype;
+        put_u32(&buffer_out[3], state->length);
+        put_u32(&buffer_out[7], state->crc32);
+        return CANMORE_MSG_TRANSFER_START_SIZE;
+    }
+
+    // Data can't be sent until the receiver grants a window
+    if (!state->started || state->send_offset >= state->length) {
+        return 0;
+    }
+
+    size_t remaining = state->length - state->send_offset;
+    size_t chunk_len = (remaining > state->chunk_size ? state->chunk_size : remaining);
+    uint32_t window_end = state->acked_offset + state->window;
+    if (state->send_offset + chunk_len > window_end) {
+        // Wait for the next ACK, unless the window is too small to ever fit a full chunk
+        if (state->window >= chunk_len || state->send_offset >= window_end) {
+            return 0;
+        }
+        chunk_len = window_end - state->send_offset;
+    }
+
+    buffer_out[0] = CANMORE_MSG_TRANSFER_OPCODE_DATA;
+    buffer_out[1] = state->transfer_id;
+    put_u16(&buffer_out[2], state->send_offset);
+    memcpy(&buffer_out[CANMORE_MSG_TRANSFER_DATA_HEADER_SIZE], &state->data[state->send_offset], chunk_len);
+    state->send_offset += chunk_len;
+
+    return CANMORE_MSG_TRANSFER_DATA_HEADER_SIZE + chunk_len;
+}
+
+bool canmore_msg_transfer_tx_handle(canmore_msg_transfer_tx_t *state, const uint8_t *msg, size_t len) {
+    if (len < 2 || msg[1] != state->transfer_id || state->status != CANMORE_MSG_TRANSFER_STATUS_ACTIVE) {
+        return false;
+    }
+
+    if (msg[0] == CANMORE_MSG_TRANSFER_OPCODE_ACK && len >= CANMORE_MSG_TRANSFER_ACK_SIZE) {
+        uint32_t offset = get_u32(&msg[2]);
+        uint16_t window = get_u16(&msg[6]);
+        uint8_t flags = msg[8];
+        if (offset > state->length) {
+            return false;
+        }
+
+        state->started = true;
+        state->send_start = false;
+        state->window = window;
+
+        if (flags & CANMORE_MSG_TRANSFER_ACK_FLAG_RESEND) {
+            // Receiver wants the data continued from this offset
+            state->acked_offset = offset;
+            state->send_offset = offset;
+        }
+        else if (offset >= state->acked_offset) {
+            state->acked_offset = offset;
+            if (state->send_offset < offset) {
+                state->send_offset = offset;
+            }
+        }
+
+        if (state->acked_offset == state->length) {
+            state->status = CANMORE_MSG_TRANSFER_STATUS_COMPLETE;
+        }
+        return true;
+    }
+    else if (msg[0] == CANMORE_MSG_TRANSFER_OPCODE_ABORT && len >= CANMORE_MSG_TRANSFER_ABORT_SIZE) {
+        state->status = CANMORE_MSG_TRANSFER_STATUS_ABORTED;
+        state->abort_reason = msg[2];
+        return true;
+    }
+
+    return false;
+}
+
+void canmore_msg_transfer_tx_timeout(canmore_msg_transfer_tx_t *state) {
+    if (state->status != CANMORE_MSG_TRANSFER_STATUS_ACTIVE) {
+        return;
+    }
+
+    if (!state->started) {
+        state->send_start = true;
+    }
+    else {
+        state->send_offset = state->acked_offset;
+    }
+}
+
+size_t canmore_msg_transfer_tx_cancel(canmore_msg_transfer_tx_t *state, uint8_t *buffer_out) {
+    if (state->status != CANMORE_MSG_TRANSFER_STATUS_ACTIVE) {
+        return 0;
+    }
+
+    state->status = CANMORE_MSG_TRANSFER_STATUS_ABORTED;
+    state->abort_reason = CANMORE_MSG_TRANSFER_ABORT_CANCELLED;
+    return encode_abort(buffer_out, CANMORE_MSG_TRANSFER_OPCODE_CANCEL, state->transfer_id,
+                        CANMORE_MSG_TRANSFER_ABORT_CANCELLED);
+}
+
+// ========================================
+// Receiver
+// ========================================
+
+void canmore_msg_transfer_rx_init(canmore_msg_transfer_rx_t *state, uint8_t *buffer, size_t capacity,
+                                  uint16_t window) {
+    memset(state, 0, sizeof(*state));
+    state->buffer = buffer;
+    state->capacity = (capacity > CANMORE_MSG_TRANSFER_MAX_LENGTH ? CANMORE_MSG_TRANSFER_MAX_LENGTH : capacity);
+    state->window = (window > 0 ? window : 1);
+    state->status = CANMORE_MSG_TRANSFER_STATUS_IDLE;
+}
+
+static bool rx_handle_start(canmore_msg_transfer_rx_t *state, const uint8_t *msg, size_t len, uint8_t *reply_out,
+                            size_t *reply_len_out) {
+    uint8_t transfer_id = msg[1];
+    if (len < CANMORE_MSG_TRANSFER_START_SIZE) {
+        state->transfer_id = transfer_id;
+        state->status = CANMORE_MSG_TRANSFER_STATUS_ABORTED;
+        *reply_len_out = encode_abort(reply_out, CANMORE_MSG_TRANSFER_OPCODE_ABORT, transfer_id,
+                                      CANMORE_MSG_TRANSFER_ABORT_INVALID_START);
+        return false;
+    }
+
+    uint8_t subtype = msg[2];
+    uint32_t length = get_u32(&msg[3]);
+    uint8_t reason;
+    bool accept = false;
+    if (!valid_subtype(subtype) || length == 0 || length > CANMORE_MSG_TRANSFER_MAX_LENGTH) {
+        reason = CANMORE_MSG_TRANSFER_ABORT_INVALID_START;
+    }
+    else if (length > state->capacity) {
+        reason = CANMORE_MSG_TRANSFER_ABORT_TOO_LARGE;
+    }
+    else {
+        accept = true;
+    }
+
+    state->transfer_id = transfer_id;
+    if (!accept) {
+        state->status = CANMORE_MSG_TRANSFER_STATUS_ABORTED;
+        *reply_len_out = encode_abort(reply_out, CANMORE_MSG_TRANSFER_OPCODE_ABORT, transfer_id, reason);
+        return false;
+    }
+
+    // A repeated START (from a lost ACK) also lands here, restarting the transfer from the beginning
+    state->subtype = subtype;
+    state->length = length;
+    state->expected_crc32 = get_u32(&msg[7]);
+    state->crc32 = CRC32_INITIAL_VALUE;
+    state->received = 0;
+    state->acked_offset = 0;
+    state->resend_requested = false;
+    state->status = CANMORE_MSG_TRANSFER_STATUS_ACTIVE;
+
+    *reply_len_out = encode_ack(reply_out, transfer_id, 0, state->window, 0);
+    return false;
+}
+
+static bool rx_handle_data(canmore_msg_transfer_rx_t *state, const uint8_t *msg, size_t len, uint8_t *reply_out,
+                           size_t *reply_len_out) {
+    if (len < CANMORE_MSG_TRANSFER_DATA_HEADER_SIZE || msg[1] != state->transfer_id) {
+        return false;
+    }
+
+    if (state->status == CANMORE_MSG_TRANSFER_STATUS_COMPLETE) {
+        // The sender must have missed the final ACK, resend it
+        *reply_len_out = encode_ack(reply_out, state->transfer_id, state->length, state->window, 0);
+        return false;
+    }
+    else if (state->status != CANMORE_MSG_TRANSFER_STATUS_ACTIVE) {
+        return false;
+    }
+
+    uint32_t offset = get_u16(&msg[2]);
+    const uint8_t *data = &msg[CANMORE_MSG_TRANSFER_DATA_HEADER_SIZE];
+    size_t data_len = len - CANMORE_MSG_TRANSFER_DATA_HEADER_SIZE;
+
+    if (offset != state->received) {
+        // Data was lost (or the sender rewound after a timeout). Ask for it to continue from what we have, but only
+        // once per burst of out of order chunks. An offset at or before the one which triggered the last request means
+        // the sender rewound again, so that request must have been lost
+        if (!state->resend_requested || offset <= state->resend_trigger_offset) {
+            state->resend_requested = true;
+            state->resend_trigger_offset = offset;
+            state->acked_offset = state->received;
+            *reply_len_out = encode_ack(reply_out, state->transfer_id, state->received, state->window,
+                                        CANMORE_MSG_TRANSFER_ACK_FLAG_RESEND);
+        }
+        return false;
+    }
+    if (data_len == 0 || data_len > state->length - state->received) {
+        return false;
+    }
+
+    memcpy(&state->buffer[state->received], data, data_len);
+    state->crc32 = crc32_update(data, data_len, state->crc32);
+    state->received += data_len;
+    state->resend_requested = false;
+
+    if (state->received == state->length) {
+        if (state->crc32 != state->expected_crc32) {
+            state->status = CANMORE_MSG_TRANSFER_STATUS_ABORTED;
+            *reply_len_out = encode_abort(reply_out, CANMORE_MSG_TRANSFER_OPCODE_ABORT, state->transfer_id,
+                                          CANMORE_MSG_TRANSFER_ABORT_CRC_FAIL);
+            return false;
+        }
+
+        state->status = CANMORE_MSG_TRANSFER_STATUS_COMPLETE;
+        state->acked_offset = state->received;
+        *reply_len_out = encode_ack(reply_out, state->transfer_id, state->received, state->window, 0);
+        return true;
+    }
+
+    // Extend the window once half of it has been used, so the sender isn't left waiting
+    size_t ack_threshold = (state->window > 1 ? state->window / 2 : 1);
+    if (state->received - state->acked_offset >= ack_threshold) {
+        state->acked_offset = state->received;
+        *reply_len_out = encode_ack(reply_out, state->transfer_id, state->received, state->window, 0);
+    }
+    return false;
+}
+
+bool canmore_msg_transfer_rx_handle(canmore_msg_transfer_rx_t *state, const uint8_t *msg, size_t len,
+                                    uint8_t *reply_out, size_t *reply_len_out) {
+    *reply_len_out = 0;
+    if (len < 2) {
+        return false;
+    }
+
+    if (msg[0] == CANMORE_MSG_TRANSFER_OPCODE_START) {
+        return rx_handle_start(state, msg, len, reply_out, reply_len_out);
+    }
+    else if (msg[0] == CANMORE_MSG_TRANSFER_OPCODE_DATA) {
+        return rx_handle_data(state, msg, len, reply_out, reply_len_out);
+    }
+    else if (msg[0] == CANMORE_MSG_TRANSFER_OPCODE_CANCEL) {
+        if (msg[1] == state->transfer_id && state->status == CANMORE_MSG_TRANSFER_STATUS_ACTIVE) {
+            state->status = CANMORE_MSG_TRANSFER_STATUS_ABORTED;
+        }
+    }
+
+    return false;
+}
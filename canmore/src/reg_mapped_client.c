@@ -56,12 +56,74 @@ int reg_mapped_client_write_register(const reg_mapped_client_cfg_t *cfg, uint8_t
     return resp.write_pkt.result;
 }
 
-int reg_mapped_client_write_array(const reg_mapped_client_cfg_t *cfg, uint8_t page, uint8_t offset_start,
-                                  const uint32_t *data_array, uint8_t num_words) {
-    // Make sure we don't cross the page boundary
-    if (((unsigned int) offset_start) + num_words > REG_MAPPED_PAGE_NUM_WORDS) {
+int reg_mapped_client_subscribe(const reg_mapped_client_cfg_t *cfg, uint8_t page, uint8_t offset, uint8_t count,
+                                uint16_t interval_ms, uint16_t threshold) {
+    if (count > REG_MAPPED_SUBSCRIPTION_MAX_WORDS || ((unsigned int) offset) + count > REG_MAPPED_PAGE_NUM_WORDS) {
+        return REG_MAPPED_CLIENT_RESULT_INVALID_ARG;
+    }
+
+    reg_mapped_request_t req = { .subscribe_pkt = {
+                                     .flags = { .f = { .write = true,
+                                                       .batch = true,
+                                                       .mode = cfg->control_interface_mode } },
+                                     .count = count,
+                                     .page = page,
+                                     .offset = offset,
+                                     .interval_ms = interval_ms,
+                                     .threshold = threshold } };
+
+    if (!cfg->clear_rx_func(cfg->arg)) {
+        return REG_MAPPED_CLIENT_RESULT_RX_CLEAR_FAIL;
+    }
+
+    if (!cfg->tx_func(req.data, sizeof(req.subscribe_pkt), cfg->arg)) {
+        return REG_MAPPED_CLIENT_RESULT_TX_FAIL;
+    }
+
+    reg_mapped_response_t resp;
+    if (!cfg->rx_func(resp.data, sizeof(resp.write_pkt), cfg->timeout_ms, cfg->arg)) {
+        return REG_MAPPED_CLIENT_RESULT_RX_FAIL;
+    }
+
+    return resp.write_pkt.result;
+}
+
+int reg_mapped_client_unsubscribe(const reg_mapped_client_cfg_t *cfg, uint8_t page, uint8_t offset) {
+    return reg_mapped_client_subscribe(cfg, page, offset, 0, 0, 0);
+}
+
+// Stores the address of a failed request if the caller requested it
+#define REG_MAPPED_CLIENT_SET_ERROR_ADDR(error_addr, addr)                                                             \
+    do {                                                                                                               \
+        if (error_addr) {                                                                                              \
+            *(error_addr) = (addr);                                                                                    \
+        }                                                                                                              \
+    } while (0)
+
+// Bulk request sequence numbers are carried in the 8-bit count field, limiting the number of requests in a bulk request
+#define REG_MAPPED_CLIENT_MAX_BULK_REQUESTS 0x100
+
+// Returns the number of words to carry in a multiword request starting at addr. Requests can't cross a page boundary
+static unsigned int reg_mapped_client_multiword_count(uint32_t addr, uint32_t addr_end, size_t max_req_count) {
+    uint32_t limit = addr_end;
+    uint32_t page_end = addr - REG_MAPPED_CLIENT_REGION_OFFSET(addr) + REG_MAPPED_PAGE_NUM_WORDS;
+    if (page_end < limit) {
+        limit = page_end;
+    }
+    if (addr + max_req_count < limit) {
+        limit = addr + max_req_count;
+    }
+    return limit - addr;
+}
+
+int reg_mapped_client_write_region(const reg_mapped_client_cfg_t *cfg, uint32_t addr_start, const uint32_t *data_array,
+                                   size_t num_words, uint32_t *error_addr) {
+    // Make sure we don't run past the last page
+    if (addr_start > REG_MAPPED_CLIENT_REGION_NUM_WORDS ||
+        num_words > REG_MAPPED_CLIENT_REGION_NUM_WORDS - addr_start) {
         return REG_MAPPED_CLIENT_RESULT_INVALID_ARG;
     }
+    uint32_t addr_end = addr_start + num_words;
 
     if (!cfg->clear_rx_func(cfg->arg)) {
         return REG_MAPPED_CLIENT_RESULT_RX_CLEAR_FAIL;
@@ -85,37 +147,49 @@ int reg_mapped_client_write_array(const reg_mapped_client_cfg_t *cfg, uint8_t pa
         req->multiword_write_pkt.flags.f.write = true;
         req->multiword_write_pkt.flags.f.multiword = true;
         req->multiword_write_pkt.flags.f.mode = cfg->control_interface_mode;
-        req->multiword_write_pkt.page = page;
-
-        uint8_t offset = offset_start;
-        uint8_t remaining_words = num_words;
-        while (remaining_words > 0) {
-            uint8_t count = (remaining_words > max_req_count ? max_req_count : remaining_words);
 
-            // Construct request
-            req->multiword_write_pkt.count = count;
-            req->multiword_write_pkt.offset = offset;
-            memcpy(req->multiword_write_pkt.data, &data_array[offset], count * sizeof(*data_array));
-
-            // Send this packet
-            if (!cfg->tx_func(req->data, REG_MAPPED_COMPUTE_MULTIWORD_REQ_LEN(count), cfg->arg)) {
-                return REG_MAPPED_CLIENT_RESULT_TX_FAIL;
+        // Every request carries up to max_req_count words, stopping at page boundaries
+        // Keep up to max_in_flight requests outstanding (across pages), with the server responding to each in order
+        unsigned int max_in_flight = (cfg->max_in_flight > 0 ? cfg->max_in_flight : 1);
+        unsigned int num_in_flight = 0;
+        uint32_t send_addr = addr_start;
+        uint32_t recv_addr = addr_start;
+        while (recv_addr < addr_end) {
+            while (send_addr < addr_end && num_in_flight < max_in_flight) {
+                unsigned int count = reg_mapped_client_multiword_count(send_addr, addr_end, max_req_count);
+
+                // Construct request
+                req->multiword_write_pkt.count = count;
+                req->multiword_write_pkt.page = REG_MAPPED_CLIENT_REGION_PAGE(send_addr);
+                req->multiword_write_pkt.offset = REG_MAPPED_CLIENT_REGION_OFFSET(send_addr);
+                memcpy(req->multiword_write_pkt.data, &data_array[send_addr - addr_start],
+                       count * sizeof(*data_array));
+
+                // Send this packet
+                if (!cfg->tx_func(req->data, REG_MAPPED_COMPUTE_MULTIWORD_REQ_LEN(count), cfg->arg)) {
+                    REG_MAPPED_CLIENT_SET_ERROR_ADDR(error_addr, send_addr);
+                    return REG_MAPPED_CLIENT_RESULT_TX_FAIL;
+                }
+                send_addr += count;
+                num_in_flight++;
             }
 
-            // Get the response
+            // Get the response for the oldest request in flight
+            // Requests after a failed one may have already been performed, but the first failure is reported
             reg_mapped_response_t resp;
             if (!cfg->rx_func(resp.data, sizeof(resp.write_pkt), cfg->timeout_ms, cfg->arg)) {
+                REG_MAPPED_CLIENT_SET_ERROR_ADDR(error_addr, recv_addr);
                 return REG_MAPPED_CLIENT_RESULT_RX_FAIL;
             }
 
             // Check for errors in the response
             if (resp.write_pkt.result != REG_MAPPED_RESULT_SUCCESSFUL) {
+                REG_MAPPED_CLIENT_SET_ERROR_ADDR(error_addr, recv_addr);
                 return resp.write_pkt.result;
             }
 
-            // Note this packet and keep transferring
-            offset += count;
-            remaining_words -= count;
+            recv_addr += reg_mapped_client_multiword_count(recv_addr, addr_end, max_req_count);
+            num_in_flight--;
         }
     }
     else
@@ -126,40 +200,45 @@ int reg_mapped_client_write_array(const reg_mapped_client_cfg_t *cfg, uint8_t pa
                                                            .bulk_req = true,
                                                            .mode = cfg->control_interface_mode } },
                                          .count = 0,
-                                         .page = page,
-                                         .offset = offset_start,
                                      } };
 
-        // Loop until no words left to read
-        while (num_words--) {
-            if (!num_words || req.write_pkt.count + 1u >= cfg->max_in_flight) {
+        // Loop until no words left to write, with each bulk request free to cross page boundaries
+        for (uint32_t addr = addr_start; addr < addr_end; addr++) {
+            if (addr + 1 == addr_end || req.write_pkt.count + 1u >= cfg->max_in_flight ||
+                req.write_pkt.count + 1u >= REG_MAPPED_CLIENT_MAX_BULK_REQUESTS) {
                 // If we don't have any more data to send, or we've hit the max number of packets in flight,
                 // end the bulk transfer and wait for a response
                 req.write_pkt.flags.f.bulk_end = true;
             }
 
-            req.write_pkt.data = *data_array++;
+            req.write_pkt.page = REG_MAPPED_CLIENT_REGION_PAGE(addr);
+            req.write_pkt.offset = REG_MAPPED_CLIENT_REGION_OFFSET(addr);
+            req.write_pkt.data = data_array[addr - addr_start];
 
             if (!cfg->tx_func(req.data, sizeof(req.write_pkt), cfg->arg)) {
+                REG_MAPPED_CLIENT_SET_ERROR_ADDR(error_addr, addr);
                 return REG_MAPPED_CLIENT_RESULT_TX_FAIL;
             }
 
             req.write_pkt.count++;
-            req.write_pkt.offset++;
 
             if (req.write_pkt.flags.f.bulk_end) {
                 // If this is a bulk end packet, get the response back
+                uint32_t bulk_addr_start = addr + 1 - req.write_pkt.count;
                 reg_mapped_response_t resp;
                 if (!cfg->rx_func(resp.data, sizeof(resp.write_bulk_pkt), cfg->timeout_ms, cfg->arg)) {
+                    REG_MAPPED_CLIENT_SET_ERROR_ADDR(error_addr, bulk_addr_start);
                     return REG_MAPPED_CLIENT_RESULT_RX_FAIL;
                 }
 
                 // Check for errors in the response
                 if (resp.write_bulk_pkt.result != REG_MAPPED_RESULT_SUCCESSFUL) {
+                    REG_MAPPED_CLIENT_SET_ERROR_ADDR(error_addr, bulk_addr_start + resp.write_bulk_pkt.seq_no);
                     return resp.write_bulk_pkt.result;
                 }
 
                 if ((resp.write_bulk_pkt.seq_no + 1) != req.write_pkt.count) {
+                    REG_MAPPED_CLIENT_SET_ERROR_ADDR(error_addr, bulk_addr_start + resp.write_bulk_pkt.seq_no + 1);
                     return REG_MAPPED_CLIENT_RESULT_INVALID_BULK_COUNT;
                 }
 
@@ -172,10 +251,12 @@ int reg_mapped_client_write_array(const reg_mapped_client_cfg_t *cfg, uint8_t pa
     else {
         // TRANSFER_MODE_SINGLE
 
-        uint8_t offset = offset_start;
-        for (int i = 0; i < num_words; i++) {
-            int ret = reg_mapped_client_write_register(cfg, page, offset++, *data_array++);
+        for (uint32_t addr = addr_start; addr < addr_end; addr++) {
+            int ret = reg_mapped_client_write_register(cfg, REG_MAPPED_CLIENT_REGION_PAGE(addr),
+                                                       REG_MAPPED_CLIENT_REGION_OFFSET(addr),
+                                                       data_array[addr - addr_start]);
             if (ret != REG_MAPPED_RESULT_SUCCESSFUL) {
+                REG_MAPPED_CLIENT_SET_ERROR_ADDR(error_addr, addr);
                 return ret;
             }
         }
@@ -184,13 +265,35 @@ int reg_mapped_client_write_array(const reg_mapped_client_cfg_t *cfg, uint8_t pa
     return REG_MAPPED_RESULT_SUCCESSFUL;
 }
 
-int reg_mapped_client_read_array(const reg_mapped_client_cfg_t *cfg, uint8_t page, uint8_t offset_start,
-                                 uint32_t *data_array, unsigned int num_words) {
+int reg_mapped_client_write_array_ex(const reg_mapped_client_cfg_t *cfg, uint8_t page, uint8_t offset_start,
+                                     const uint32_t *data_array, uint8_t num_words, uint8_t *error_offset) {
     // Make sure we don't cross the page boundary
     if (((unsigned int) offset_start) + num_words > REG_MAPPED_PAGE_NUM_WORDS) {
         return REG_MAPPED_CLIENT_RESULT_INVALID_ARG;
     }
 
+    uint32_t error_addr = REG_MAPPED_CLIENT_REGION_ADDR(page, offset_start);
+    int ret = reg_mapped_client_write_region(cfg, error_addr, data_array, num_words, &error_addr);
+    if (ret != REG_MAPPED_RESULT_SUCCESSFUL && error_offset) {
+        *error_offset = REG_MAPPED_CLIENT_REGION_OFFSET(error_addr);
+    }
+    return ret;
+}
+
+int reg_mapped_client_write_array(const reg_mapped_client_cfg_t *cfg, uint8_t page, uint8_t offset_start,
+                                  const uint32_t *data_array, uint8_t num_words) {
+    return reg_mapped_client_write_array_ex(cfg, page, offset_start, data_array, num_words, NULL);
+}
+
+int reg_mapped_client_read_region(const reg_mapped_client_cfg_t *cfg, uint32_t addr_start, uint32_t *data_array,
+                                  size_t num_words, uint32_t *error_addr) {
+    // Make sure we don't run past the last page
+    if (addr_start > REG_MAPPED_CLIENT_REGION_NUM_WORDS ||
+        num_words > REG_MAPPED_CLIENT_REGION_NUM_WORDS - addr_start) {
+        return REG_MAPPED_CLIENT_RESULT_INVALID_ARG;
+    }
+    uint32_t addr_end = addr_start + num_words;
+
 #if !CANMORE_CONFIG_DISABLE_MULTIWORD
     if (cfg->transfer_mode == TRANSFER_MODE_MULTIWORD) {
         reg_mapped_request_t req;
@@ -205,67 +308,468 @@ int reg_mapped_client_read_array(const reg_mapped_client_cfg_t *cfg, uint8_t pag
             return REG_MAPPED_CLIENT_RESULT_MULTIWORD_ALLOC_TOO_SMALL;
         }
 
+        if (!cfg->clear_rx_func(cfg->arg)) {
+            return REG_MAPPED_CLIENT_RESULT_RX_CLEAR_FAIL;
+        }
+
         // This part of the request remains constant
         req.read_pkt.flags.data = 0;
         req.read_pkt.flags.f.multiword = true;
         req.read_pkt.flags.f.mode = cfg->control_interface_mode;
-        req.read_pkt.page = page;
 
-        uint8_t offset = offset_start;
-        uint8_t remaining_words = num_words;
-        while (remaining_words > 0) {
-            uint8_t count = (remaining_words > max_req_count ? max_req_count : remaining_words);
-
-            // Construct request
-            req.read_pkt.count = count;
-            req.read_pkt.offset = offset;
-
-            // Send this packet
-            if (!cfg->tx_func(req.data, sizeof(req.read_pkt), cfg->arg)) {
-                return REG_MAPPED_CLIENT_RESULT_TX_FAIL;
+        // Every request carries up to max_req_count words, stopping at page boundaries
+        // Keep up to max_in_flight requests outstanding (across pages), with the server responding to each in order
+        unsigned int max_in_flight = (cfg->max_in_flight > 0 ? cfg->max_in_flight : 1);
+        unsigned int num_in_flight = 0;
+        uint32_t send_addr = addr_start;
+        uint32_t recv_addr = addr_start;
+        while (recv_addr < addr_end) {
+            while (send_addr < addr_end && num_in_flight < max_in_flight) {
+                unsigned int count = reg_mapped_client_multiword_count(send_addr, addr_end, max_req_count);
+
+                // Construct request
+                req.read_pkt.count = count;
+                req.read_pkt.page = REG_MAPPED_CLIENT_REGION_PAGE(send_addr);
+                req.read_pkt.offset = REG_MAPPED_CLIENT_REGION_OFFSET(send_addr);
+
+                // Send this packet
+                if (!cfg->tx_func(req.data, sizeof(req.read_pkt), cfg->arg)) {
+                    REG_MAPPED_CLIENT_SET_ERROR_ADDR(error_addr, send_addr);
+                    return REG_MAPPED_CLIENT_RESULT_TX_FAIL;
+                }
+                send_addr += count;
+                num_in_flight++;
             }
 
-            // Get the response
+            // Get the response for the oldest request in flight
+            unsigned int count = reg_mapped_client_multiword_count(recv_addr, addr_end, max_req_count);
             size_t resp_len = REG_MAPPED_COMPUTE_MULTIWORD_RESP_LEN(count);
             if (!cfg->rx_func(resp->data, resp_len, cfg->timeout_ms, cfg->arg)) {
+                REG_MAPPED_CLIENT_SET_ERROR_ADDR(error_addr, recv_addr);
                 return REG_MAPPED_CLIENT_RESULT_RX_FAIL;
             }
 
             // Check for errors in the response
             if (resp->multiword_read_pkt.result != REG_MAPPED_RESULT_SUCCESSFUL) {
+                REG_MAPPED_CLIENT_SET_ERROR_ADDR(error_addr, recv_addr);
                 return resp->multiword_read_pkt.result;
             }
 
             // Copy the data into the output buffer
-            memcpy(&data_array[offset], resp->multiword_read_pkt.data, count * sizeof(*data_array));
+            memcpy(&data_array[recv_addr - addr_start], resp->multiword_read_pkt.data, count * sizeof(*data_array));
+            recv_addr += count;
+            num_in_flight--;
+        }
+    }
+    else
+#endif
+        if (cfg->transfer_mode == TRANSFER_MODE_BULK) {
+        reg_mapped_request_t req = { .read_pkt = {
+                                         .flags = { .f = { .write = false,
+                                                           .bulk_req = true,
+                                                           .mode = cfg->control_interface_mode } },
+                                         .count = 0,
+                                     } };
+
+        if (!cfg->clear_rx_func(cfg->arg)) {
+            return REG_MAPPED_CLIENT_RESULT_RX_CLEAR_FAIL;
+        }
+
+        // The read is split into bulk requests of REG_MAPPED_CLIENT_MAX_BULK_REQUESTS words, which are free to cross
+        // page boundaries. The next bulk request is started without waiting for the previous one to finish
+        // Keep up to max_in_flight requests outstanding, with the server responding to each request in order
+        unsigned int max_in_flight = (cfg->max_in_flight > 0 ? cfg->max_in_flight : 1);
+        size_t num_sent = 0;
+        size_t num_received = 0;
+        while (num_received < num_words) {
+            while (num_sent < num_words && num_sent - num_received < max_in_flight) {
+                uint32_t addr = addr_start + num_sent;
+                req.read_pkt.count = num_sent % REG_MAPPED_CLIENT_MAX_BULK_REQUESTS;
+                req.read_pkt.page = REG_MAPPED_CLIENT_REGION_PAGE(addr);
+                req.read_pkt.offset = REG_MAPPED_CLIENT_REGION_OFFSET(addr);
+                req.read_pkt.flags.f.bulk_end =
+                    (num_sent + 1 == num_words || req.read_pkt.count + 1u == REG_MAPPED_CLIENT_MAX_BULK_REQUESTS);
+
+                if (!cfg->tx_func(req.data, sizeof(req.read_pkt), cfg->arg)) {
+                    REG_MAPPED_CLIENT_SET_ERROR_ADDR(error_addr, addr);
+                    return REG_MAPPED_CLIENT_RESULT_TX_FAIL;
+                }
+                num_sent++;
+            }
+
+            int ret;
+            reg_mapped_response_t resp;
+            if (!cfg->rx_func(resp.data, sizeof(resp.read_bulk_pkt), cfg->timeout_ms, cfg->arg)) {
+                ret = REG_MAPPED_CLIENT_RESULT_RX_FAIL;
+            }
+            else if (resp.read_bulk_pkt.result != REG_MAPPED_RESULT_SUCCESSFUL) {
+                ret = resp.read_bulk_pkt.result;
+            }
+            else if (resp.read_bulk_pkt.seq_no != num_received % REG_MAPPED_CLIENT_MAX_BULK_REQUESTS) {
+                ret = REG_MAPPED_CLIENT_RESULT_INVALID_BULK_COUNT;
+            }
+            else {
+                data_array[num_received++] = resp.read_bulk_pkt.data;
+                continue;
+            }
 
-            // Note this packet and keep transferring
-            offset += count;
-            remaining_words -= count;
+            REG_MAPPED_CLIENT_SET_ERROR_ADDR(error_addr, addr_start + num_received);
+
+            // If the request ending the current bulk read hasn't been sent yet, send it now so the server leaves bulk
+            // mode. Its response (along with any others still in flight) will be cleared by the next request
+            if (num_sent < num_words && num_sent % REG_MAPPED_CLIENT_MAX_BULK_REQUESTS != 0) {
+                uint32_t addr = addr_start + num_sent;
+                req.read_pkt.count = num_sent % REG_MAPPED_CLIENT_MAX_BULK_REQUESTS;
+                req.read_pkt.page = REG_MAPPED_CLIENT_REGION_PAGE(addr);
+                req.read_pkt.offset = REG_MAPPED_CLIENT_REGION_OFFSET(addr);
+                req.read_pkt.flags.f.bulk_end = true;
+                cfg->tx_func(req.data, sizeof(req.read_pkt), cfg->arg);
+            }
+            return ret;
         }
     }
     else {
-#endif
-        // TRANSFER_MODE_BULK does not support optimized reads
-        // Fallback to single transfers
-        uint8_t offset = offset_start;
-        for (unsigned int i = 0; i < num_words; i++) {
-            int ret = reg_mapped_client_read_register(cfg, page, offset++, data_array++);
+        // TRANSFER_MODE_SINGLE
+        for (uint32_t addr = addr_start; addr < addr_end; addr++) {
+            int ret = reg_mapped_client_read_register(cfg, REG_MAPPED_CLIENT_REGION_PAGE(addr),
+                                                      REG_MAPPED_CLIENT_REGION_OFFSET(addr),
+                                                      &data_array[addr - addr_start]);
             if (ret != REG_MAPPED_RESULT_SUCCESSFUL) {
+                REG_MAPPED_CLIENT_SET_ERROR_ADDR(error_addr, addr);
                 return ret;
             }
         }
+    }
+
+    return REG_MAPPED_RESULT_SUCCESSFUL;
+}
+
+int reg_mapped_client_read_array_ex(const reg_mapped_client_cfg_t *cfg, uint8_t page, uint8_t offset_start,
+                                    uint32_t *data_array, unsigned int num_words, uint8_t *error_offset) {
+    // Make sure we don't cross the page boundary
+    if (((unsigned int) offset_start) + num_words > REG_MAPPED_PAGE_NUM_WORDS) {
+        return REG_MAPPED_CLIENT_RESULT_INVALID_ARG;
+    }
+
+    uint32_t error_addr = REG_MAPPED_CLIENT_REGION_ADDR(page, offset_start);
+    int ret = reg_mapped_client_read_region(cfg, error_addr, data_array, num_words, &error_addr);
+    if (ret != REG_MAPPED_RESULT_SUCCESSFUL && error_offset) {
+        *error_offset = REG_MAPPED_CLIENT_REGION_OFFSET(error_addr);
+    }
+    return ret;
+}
+
+int reg_mapped_client_read_array(const reg_mapped_client_cfg_t *cfg, uint8_t page, uint8_t offset_start,
+                                 uint32_t *data_array, unsigned int num_words) {
+    return reg_mapped_client_read_array_ex(cfg, page, offset_start, data_array, num_words, NULL);
+}
+
 #if !CANMORE_CONFIG_DISABLE_MULTIWORD
+
+// Returns the number of words from an entry (starting at word) which fit in the batch being built, or 0 if none fit
+// req_len is the length of the batch request so far, and resp_words is the number of words read by the batch so far
+static unsigned int reg_mapped_client_batch_count(const reg_mapped_client_batch_entry_t *entry, unsigned int word,
+                                                  size_t req_len, size_t max_req_len, unsigned int resp_words,
+                                                  unsigned int max_resp_words) {
+    // The count is carried in an 8-bit field
+    unsigned int count = entry->count - word;
+    if (count > UINT8_MAX) {
+        count = UINT8_MAX;
+    }
+
+    if (req_len + sizeof(struct reg_mapped_batch_entry) > max_req_len) {
+        return 0;
+    }
+
+    // Writes carry their data in the request, while reads carry their data in the response
+    unsigned int space;
+    if (entry->write) {
+        space = (max_req_len - req_len - sizeof(struct reg_mapped_batch_entry)) / sizeof(uint32_t);
+    }
+    else {
+        space = max_resp_words - resp_words;
     }
+
+    return (count < space ? count : space);
+}
+
 #endif
 
+int reg_mapped_client_transact(const reg_mapped_client_cfg_t *cfg, const reg_mapped_client_batch_entry_t *entries,
+                               size_t num_entries, size_t *error_entry) {
+    // Make sure no entry crosses a page boundary before anything is sent
+    for (size_t i = 0; i < num_entries; i++) {
+        if (entries[i].count == 0 ||
+            ((unsigned int) entries[i].offset) + entries[i].count > REG_MAPPED_PAGE_NUM_WORDS) {
+            REG_MAPPED_CLIENT_SET_ERROR_ADDR(error_entry, i);
+            return REG_MAPPED_CLIENT_RESULT_INVALID_ARG;
+        }
+    }
+
+#if !CANMORE_CONFIG_DISABLE_MULTIWORD
+    if (cfg->transfer_mode == TRANSFER_MODE_MULTIWORD) {
+        uint8_t *buf = (uint8_t *) cfg->multiword_scratch_buffer;
+        struct reg_mapped_batch_request *req = (struct reg_mapped_batch_request *) buf;
+        struct reg_mapped_batch_response *resp = (struct reg_mapped_batch_response *) buf;
+
+        // Make sure the request is capable of carrying at least 1 word, and the response capable of returning it
+        size_t max_req_len = cfg->multiword_scratch_len;
+        if (max_req_len < sizeof(*req) + sizeof(struct reg_mapped_batch_entry) + sizeof(uint32_t)) {
+            return REG_MAPPED_CLIENT_RESULT_MULTIWORD_ALLOC_TOO_SMALL;
+        }
+        unsigned int max_resp_words = REG_MAPPED_COMPUTE_MAX_BATCH_RESP_WORD_COUNT(max_req_len);
+
+        if (!cfg->clear_rx_func(cfg->arg)) {
+            return REG_MAPPED_CLIENT_RESULT_RX_CLEAR_FAIL;
+        }
+
+        size_t entry = 0;
+        unsigned int word = 0;
+        while (entry < num_entries) {
+            size_t batch_entry = entry;
+            unsigned int batch_word = word;
+
+            // Pack as many entries into the batch as fit in the request and the response
+            // An entry is only split if the batch is full, so each batch entry maps to the next entry in order
+            req->flags.data = 0;
+            req->flags.f.batch = true;
+            req->flags.f.mode = cfg->control_interface_mode;
+            req->count = 0;
+            size_t req_len = sizeof(*req);
+            unsigned int resp_words = 0;
+            while (entry < num_entries && req->count < UINT8_MAX) {
+                const reg_mapped_client_batch_entry_t *src = &entries[entry];
+                unsigned int count =
+                    reg_mapped_client_batch_count(src, word, req_len, max_req_len, resp_words, max_resp_words);
+                if (count == 0) {
+                    break;
+                }
+
+                struct reg_mapped_batch_entry *req_entry = (struct reg_mapped_batch_entry *) &buf[req_len];
+                req_entry->op = (src->write ? REG_MAPPED_BATCH_OP_WRITE : REG_MAPPED_BATCH_OP_READ);
+                req_entry->count = count;
+                req_entry->page = src->page;
+                req_entry->offset = src->offset + word;
+                req_len += sizeof(*req_entry);
+
+                if (src->write) {
+                    memcpy(req_entry->data, &src->data[word], count * sizeof(*src->data));
+                    req_len += count * sizeof(*src->data);
+                }
+                else {
+                    resp_words += count;
+                }
+
+                req->count++;
+                word += count;
+                if (word == src->count) {
+                    entry++;
+                    word = 0;
+                }
+            }
+            unsigned int batch_count = req->count;
+
+            if (!cfg->tx_func(buf, req_len, cfg->arg)) {
+                REG_MAPPED_CLIENT_SET_ERROR_ADDR(error_entry, batch_entry);
+                return REG_MAPPED_CLIENT_RESULT_TX_FAIL;
+            }
+
+            if (!cfg->rx_func(buf, REG_MAPPED_COMPUTE_BATCH_RESP_LEN(resp_words), cfg->timeout_ms, cfg->arg)) {
+                REG_MAPPED_CLIENT_SET_ERROR_ADDR(error_entry, batch_entry);
+                return REG_MAPPED_CLIENT_RESULT_RX_FAIL;
+            }
+
+            if (resp->result == REG_MAPPED_RESULT_MULTIWORD_TOO_LARGE && resp_words > 1) {
+                // The server's response buffer is smaller than ours. The whole batch is rejected before any entry is
+                // performed, so resend the same entries reading fewer words at a time
+                max_resp_words = resp_words / 2;
+                entry = batch_entry;
+                word = batch_word;
+                continue;
+            }
+
+            if (resp->result != REG_MAPPED_RESULT_SUCCESSFUL) {
+                REG_MAPPED_CLIENT_SET_ERROR_ADDR(error_entry,
+                                                 batch_entry + (resp->entry < batch_count ? resp->entry : 0));
+                return resp->result;
+            }
+
+            // Copy the read data out to each read entry
+            size_t resp_offset = 0;
+            for (unsigned int i = 0; i < batch_count; i++) {
+                const reg_mapped_client_batch_entry_t *src = &entries[batch_entry + i];
+                unsigned int start = (i == 0 ? batch_word : 0);
+                unsigned int end = (batch_entry + i == entry ? word : src->count);
+
+                if (!src->write) {
+                    memcpy(&src->data[start], &((uint8_t *) resp->data)[resp_offset], (end - start) * sizeof(uint32_t));
+                    resp_offset += (end - start) * sizeof(uint32_t);
+                }
+            }
+        }
+    }
+    else
+#endif
+    {
+        // Without multiword support, each entry is performed as its own transfer
+        for (size_t i = 0; i < num_entries; i++) {
+            const reg_mapped_client_batch_entry_t *src = &entries[i];
+            int ret;
+            if (src->write) {
+                ret = reg_mapped_client_write_region(cfg, REG_MAPPED_CLIENT_REGION_ADDR(src->page, src->offset),
+                                                     src->data, src->count, NULL);
+            }
+            else {
+                ret = reg_mapped_client_read_region(cfg, REG_MAPPED_CLIENT_REGION_ADDR(src->page, src->offset),
+                                                    src->data, src->count, NULL);
+            }
+
+            if (ret != REG_MAPPED_RESULT_SUCCESSFUL) {
+                REG_MAPPED_CLIENT_SET_ERROR_ADDR(error_entry, i);
+                return ret;
+            }
+        }
+    }
+
     return REG_MAPPED_RESULT_SUCCESSFUL;
 }
 
+static void reg_mapped_client_posted_record_error(reg_mapped_client_posted_writes_t *state, uint8_t page,
+                                                  uint8_t offset, int result) {
+    if (state->first_error == REG_MAPPED_RESULT_SUCCESSFUL) {
+        state->first_error = result;
+        state->first_error_page = page;
+        state->first_error_offset = offset;
+    }
+
+    if (state->error_cb) {
+        state->error_cb(page, offset, result, state->error_cb_arg);
+    }
+}
+
+static bool reg_mapped_client_posted_handle_response(const reg_mapped_client_cfg_t *cfg,
+                                                     reg_mapped_client_posted_writes_t *state,
+                                                     unsigned int timeout_ms) {
+    unsigned int idx = state->pending_head;
+    uint8_t page = state->pending[idx].page;
+    uint8_t offset = state->pending[idx].offset;
+
+    reg_mapped_response_t resp;
+    if (!cfg->rx_func(resp.data, sizeof(resp.write_pkt), timeout_ms, cfg->arg)) {
+        if (timeout_ms == 0) {
+            // Nothing received yet, not an error when polling
+            return false;
+        }
+
+        // The response was lost, and any responses still in flight can't be matched reliably anymore
+        // Report the oldest write as failed and clear out the rest
+        reg_mapped_client_posted_record_error(state, page, offset, REG_MAPPED_CLIENT_RESULT_RX_FAIL);
+        state->pending_count = 0;
+        return false;
+    }
+
+    // Responses arrive in the order the writes were sent, so this response belongs to the oldest write
+    state->pending_head = (idx + 1) % REG_MAPPED_CLIENT_MAX_POSTED_WRITES;
+    state->pending_count--;
+
+    if (resp.write_pkt.result != REG_MAPPED_RESULT_SUCCESSFUL) {
+        reg_mapped_client_posted_record_error(state, page, offset, resp.write_pkt.result);
+    }
+    return true;
+}
+
+void reg_mapped_client_posted_init(reg_mapped_client_posted_writes_t *state,
+                                   reg_mapped_client_posted_error_func error_cb, void *error_cb_arg) {
+    state->pending_head = 0;
+    state->pending_count = 0;
+    state->first_error = REG_MAPPED_RESULT_SUCCESSFUL;
+    state->first_error_page = 0;
+    state->first_error_offset = 0;
+    state->error_cb = error_cb;
+    state->error_cb_arg = error_cb_arg;
+}
+
+int reg_mapped_client_post_write(const reg_mapped_client_cfg_t *cfg, reg_mapped_client_posted_writes_t *state,
+                                 uint8_t page, uint8_t offset, uint32_t data) {
+    reg_mapped_request_t req = { .write_pkt = {
+                                     .flags = { .f = { .write = true, .mode = cfg->control_interface_mode } },
+                                     .count = 0,
+                                     .page = page,
+                                     .offset = offset,
+                                     .data = data } };
+
+    if (state->pending_count == 0) {
+        // Nothing in flight, so anything in the receive buffer is stale
+        if (!cfg->clear_rx_func(cfg->arg)) {
+            return REG_MAPPED_CLIENT_RESULT_RX_CLEAR_FAIL;
+        }
+    }
+    else {
+        reg_mapped_client_posted_poll(cfg, state);
+    }
+
+    // Wait for room if the server's receive buffer could be full
+    unsigned int max_pending = (cfg->max_in_flight > 0 ? cfg->max_in_flight : 1);
+    if (max_pending > REG_MAPPED_CLIENT_MAX_POSTED_WRITES) {
+        max_pending = REG_MAPPED_CLIENT_MAX_POSTED_WRITES;
+    }
+    while (state->pending_count >= max_pending) {
+        if (!reg_mapped_client_posted_handle_response(cfg, state, cfg->timeout_ms)) {
+            // The lost response has been reported and the pending writes cleared
+            // Discard any responses which arrive late so they aren't matched against this write
+            if (!cfg->clear_rx_func(cfg->arg)) {
+                return REG_MAPPED_CLIENT_RESULT_RX_CLEAR_FAIL;
+            }
+        }
+    }
+
+    if (!cfg->tx_func(req.data, sizeof(req.write_pkt), cfg->arg)) {
+        return REG_MAPPED_CLIENT_RESULT_TX_FAIL;
+    }
+
+    unsigned int idx = (state->pending_head + state->pending_count) % REG_MAPPED_CLIENT_MAX_POSTED_WRITES;
+    state->pending[idx].page = page;
+    state->pending[idx].offset = offset;
+    state->pending_count++;
+
+    return REG_MAPPED_RESULT_SUCCESSFUL;
+}
+
+void reg_mapped_client_posted_poll(const reg_mapped_client_cfg_t *cfg, reg_mapped_client_posted_writes_t *state) {
+    while (state->pending_count > 0 && reg_mapped_client_posted_handle_response(cfg, state, 0)) {
+    }
+}
+
+void reg_mapped_client_posted_drain(const reg_mapped_client_cfg_t *cfg, reg_mapped_client_posted_writes_t *state) {
+    while (state->pending_count > 0 && reg_mapped_client_posted_handle_response(cfg, state, cfg->timeout_ms)) {
+    }
+}
+
+int reg_mapped_client_posted_sync(const reg_mapped_client_cfg_t *cfg, reg_mapped_client_posted_writes_t *state,
+                                  uint8_t *error_page_out, uint8_t *error_offset_out) {
+    reg_mapped_client_posted_drain(cfg, state);
+
+    int result = state->first_error;
+    if (result != REG_MAPPED_RESULT_SUCCESSFUL) {
+        if (error_page_out) {
+            *error_page_out = state->first_error_page;
+        }
+        if (error_offset_out) {
+            *error_offset_out = state->first_error_offset;
+        }
+    }
+
+    state->first_error = REG_MAPPED_RESULT_SUCCESSFUL;
+    return result;
+}
+
+// Limits the number of words read at once when reading string pages, as the words are buffered on the stack
+#define REG_MAPPED_CLIENT_STRING_MAX_CHUNK_WORDS 64
+
 int reg_mapped_client_read_string_page(const reg_mapped_client_cfg_t *cfg, uint8_t page_num, char *str_out,
                                        size_t max_len) {
-    // We unfortunately have to do a slow word-by-word read since the length is determined by the location of the null
-    // termination
+    // The length is determined by the location of the null termination, so the string is read in chunks as large as
+    // a single transfer can carry, stopping at the first chunk containing the terminator
 
     // To avoid unnecessary reading of words at max_len, we assume str_out can hold at least one character
     // So this has to be checked here
@@ -276,21 +780,63 @@ int reg_mapped_client_read_string_page(const reg_mapped_client_cfg_t *cfg, uint8
         return 0;
     }
 
+    // Size the read-ahead to what the transfer mode can carry before waiting on a response
+    unsigned int chunk_words = 1;
+#if !CANMORE_CONFIG_DISABLE_MULTIWORD
+    if (cfg->transfer_mode == TRANSFER_MODE_MULTIWORD &&
+        cfg->multiword_scratch_len >= sizeof(struct reg_mapped_multiword_read_response)) {
+        chunk_words = REG_MAPPED_COMPUTE_MAX_RESP_WORD_COUNT(cfg->multiword_scratch_len);
+    }
+    else
+#endif
+        if (cfg->transfer_mode == TRANSFER_MODE_BULK) {
+        chunk_words = cfg->max_in_flight;
+    }
+    if (chunk_words > REG_MAPPED_CLIENT_STRING_MAX_CHUNK_WORDS) {
+        chunk_words = REG_MAPPED_CLIENT_STRING_MAX_CHUNK_WORDS;
+    }
+    if (chunk_words < 1) {
+        chunk_words = 1;
+    }
+
     // Limit to read up to an entire page
+    size_t str_offset = 0;
     unsigned int word_num = 0;
-    for (word_num = 0; word_num < REG_MAPPED_PAGE_NUM_WORDS; word_num++) {
+    while (word_num < REG_MAPPED_PAGE_NUM_WORDS) {
         union {
-            uint32_t word;
-            uint8_t bytes[4];
+            uint32_t words[REG_MAPPED_CLIENT_STRING_MAX_CHUNK_WORDS];
+            uint8_t bytes[REG_MAPPED_CLIENT_STRING_MAX_CHUNK_WORDS * 4];
         } read_data;
 
-        int result = reg_mapped_client_read_register(cfg, page_num, word_num, &read_data.word);
+        // Don't read past the end of the page, or past what str_out can hold
+        unsigned int count = chunk_words;
+        if (count > REG_MAPPED_PAGE_NUM_WORDS - word_num) {
+            count = REG_MAPPED_PAGE_NUM_WORDS - word_num;
+        }
+        unsigned int words_needed = ((max_len - 1) - str_offset + 3) / 4;
+        if (count > words_needed) {
+            count = words_needed;
+        }
+
+        int result;
+        if (count == 1) {
+            result = reg_mapped_client_read_register(cfg, page_num, word_num, &read_data.words[0]);
+        }
+        else {
+            result = reg_mapped_client_read_array(cfg, page_num, word_num, read_data.words, count);
+        }
+
         if (result != REG_MAPPED_RESULT_SUCCESSFUL) {
+            // The read-ahead may run past the end of a short page (or the page may not support multiword reads)
+            // Retry with smaller chunks, only failing once a single word can't be read
+            if (count > 1) {
+                chunk_words = count / 2;
+                continue;
+            }
             return (result < 0 ? result : -result);
         }
 
-        for (unsigned int i = 0; i < sizeof(read_data.bytes); i++) {
-            size_t str_offset = word_num * 4 + i;
+        for (unsigned int i = 0; i < count * 4; i++) {
             str_out[str_offset] = read_data.bytes[i];
 
             if (read_data.bytes[i] == 0) {
@@ -305,9 +851,11 @@ int reg_mapped_client_read_string_page(const reg_mapped_client_cfg_t *cfg, uint8
                 return str_offset;
             }
         }
+
+        word_num += count;
     }
 
     // Already checked length, we should be good to just write the terminator
-    str_out[word_num * 4] = 0;
-    return word_num * 4;
+    str_out[str_offset] = 0;
+    return str_offset;
 }
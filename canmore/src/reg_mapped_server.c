@@ -302,7 +302,247 @@ static uint8_t reg_mapped_server_handle_multiword_read(reg_mapped_server_inst_t
     }
 }
 
+static uint8_t reg_mapped_server_check_batch(reg_mapped_server_inst_t *inst, const uint8_t *msg, size_t len,
+                                             unsigned int *read_words_out) {
+    const struct reg_mapped_batch_request *req = (const struct reg_mapped_batch_request *) msg;
+    size_t pos = sizeof(*req);
+    unsigned int read_words = 0;
+
+    // Walk every entry to make sure the whole batch is well formed before any register is touched
+    for (unsigned int i = 0; i < req->count; i++) {
+        if (len < pos + sizeof(struct reg_mapped_batch_entry)) {
+            return REG_MAPPED_RESULT_MALFORMED_REQUEST;
+        }
+
+        const struct reg_mapped_batch_entry *entry = (const struct reg_mapped_batch_entry *) &msg[pos];
+        if (entry->count == 0 ||
+            ((unsigned int) entry->offset) + ((unsigned int) entry->count) > REG_MAPPED_PAGE_NUM_WORDS) {
+            return REG_MAPPED_RESULT_MALFORMED_REQUEST;
+        }
+
+        pos += sizeof(*entry);
+        if (entry->op == REG_MAPPED_BATCH_OP_WRITE) {
+            pos += sizeof(entry->data[0]) * entry->count;
+        }
+        else if (entry->op == REG_MAPPED_BATCH_OP_READ) {
+            read_words += entry->count;
+        }
+        else {
+            return REG_MAPPED_RESULT_MALFORMED_REQUEST;
+        }
+    }
+
+    if (len != pos) {
+        return REG_MAPPED_RESULT_MALFORMED_REQUEST;
+    }
+
+    // The read data is returned in the multiword response buffer, which loses a word to the larger response header
+    if (read_words + 1 > inst->multiword_resp_buffer_max_count) {
+        return REG_MAPPED_RESULT_MULTIWORD_TOO_LARGE;
+    }
+
+    *read_words_out = read_words;
+    return REG_MAPPED_RESULT_SUCCESSFUL;
+}
+
+static uint8_t reg_mapped_server_perform_batch(reg_mapped_server_inst_t *inst, const uint8_t *msg,
+                                               uint8_t *entry_out) {
+    const struct reg_mapped_batch_request *req = (const struct reg_mapped_batch_request *) msg;
+    uint8_t *data_out = (uint8_t *) inst->multiword_resp_buffer->batch_pkt.data;
+    size_t pos = sizeof(*req);
+    unsigned int read_words = 0;
+
+    for (unsigned int i = 0; i < req->count; i++) {
+        const struct reg_mapped_batch_entry *entry = (const struct reg_mapped_batch_entry *) &msg[pos];
+        pos += sizeof(*entry);
+
+        // Every word goes through the single request handlers, so batches can access any page type
+        for (unsigned int word = 0; word < entry->count; word++) {
+            uint8_t result_code;
+
+            if (entry->op == REG_MAPPED_BATCH_OP_WRITE) {
+                struct reg_mapped_write_request write_req = { .page = entry->page, .offset = entry->offset + word };
+                memcpy(&write_req.data, &msg[pos], sizeof(write_req.data));
+                pos += sizeof(write_req.data);
+
+                result_code = reg_mapped_server_handle_single_write(inst, &write_req);
+            }
+            else {
+                // NOTE: The response buffer is not aligned for words, so data must be copied in
+                struct reg_mapped_read_request read_req = { .page = entry->page, .offset = entry->offset + word };
+                uint32_t read_data = 0;
+
+                result_code = reg_mapped_server_handle_single_read(inst, &read_req, &read_data);
+                memcpy(&data_out[read_words * sizeof(read_data)], &read_data, sizeof(read_data));
+                read_words++;
+            }
+
+            if (result_code != REG_MAPPED_RESULT_SUCCESSFUL) {
+                // Stop at the first failing entry, any accesses made before it are left in place
+                *entry_out = i;
+                return result_code;
+            }
+        }
+    }
+
+    *entry_out = req->count;
+    return REG_MAPPED_RESULT_SUCCESSFUL;
+}
+
+#endif
+
+static void reg_mapped_server_handle_batch(reg_mapped_server_inst_t *inst, const uint8_t *msg, size_t len) {
+    union reg_mapped_request_flags flags = { .data = msg[0] };
+    reg_mapped_response_t response = { 0 };
+    uint8_t *response_ptr = response.data;
+    size_t response_size = sizeof(response.batch_pkt);
+    uint8_t result_code;
+    uint8_t entry = 0;
+
+    if (len < sizeof(struct reg_mapped_batch_request) || flags.f.bulk_req || flags.f.bulk_end || flags.f.multiword) {
+        // Batch requests can't be combined with any other request type
+        result_code = REG_MAPPED_RESULT_MALFORMED_REQUEST;
+    }
+    else if (inst->in_bulk_request) {
+        result_code = REG_MAPPED_RESULT_BULK_REQUEST_SEQ_ERROR;
+        inst->in_bulk_request = false;  // If we get a non-bulk request in bulk mode, exit now
+    }
+    else if (flags.f.mode != inst->control_interface_mode) {
+        result_code = REG_MAPPED_RESULT_INVALID_MODE;
+    }
+    else {
+#if CANMORE_CONFIG_DISABLE_MULTIWORD
+        result_code = REG_MAPPED_RESULT_MULTIWORD_UNSUPPORTED;
+#else
+        unsigned int read_words = 0;
+        if (!inst->multiword_resp_buffer) {
+            // The read data is returned in the multiword response buffer, so batches need it as well
+            result_code = REG_MAPPED_RESULT_MULTIWORD_UNSUPPORTED;
+        }
+        else {
+            result_code = reg_mapped_server_check_batch(inst, msg, len, &read_words);
+        }
+
+        if (result_code == REG_MAPPED_RESULT_SUCCESSFUL) {
+            result_code = reg_mapped_server_perform_batch(inst, msg, &entry);
+
+            // Send the preallocated response buffer, with the read data already filled out
+            // This is sent at full length even if an entry failed, so clients which receive fixed length frames still
+            // receive the failing entry
+            inst->multiword_resp_buffer->batch_pkt.result = result_code;
+            inst->multiword_resp_buffer->batch_pkt.entry = entry;
+            response_ptr = inst->multiword_resp_buffer->data;
+            response_size = REG_MAPPED_COMPUTE_BATCH_RESP_LEN(read_words);
+        }
+#endif
+    }
+
+    if (response_ptr == response.data) {
+        response.batch_pkt.result = result_code;
+        response.batch_pkt.entry = entry;
+    }
+
+#if CANMORE_CONFIG_DISABLE_REG_MAPPED_ARG
+    inst->tx_func(response_ptr, response_size);
+#else
+    inst->tx_func(response_ptr, response_size, inst->arg);
+#endif
+}
+
+#if !CANMORE_CONFIG_DISABLE_SUBSCRIPTIONS
+
+static uint8_t reg_mapped_server_subscribe(reg_mapped_server_inst_t *inst,
+                                           const struct reg_mapped_subscribe_request *req) {
+    if (req->count > REG_MAPPED_SUBSCRIPTION_MAX_WORDS ||
+        ((unsigned int) req->offset) + ((unsigned int) req->count) > REG_MAPPED_PAGE_NUM_WORDS) {
+        return REG_MAPPED_RESULT_MALFORMED_REQUEST;
+    }
+
+    if (!inst->subscriptions || !inst->notify_tx_func) {
+        return REG_MAPPED_RESULT_SUBSCRIPTION_UNAVAILABLE;
+    }
+
+    // Find the subscription to replace at this address, otherwise use the first free subscription
+    reg_mapped_server_subscription_t *sub = NULL;
+    for (size_t i = 0; i < inst->num_subscriptions; i++) {
+        reg_mapped_server_subscription_t *entry = &inst->subscriptions[i];
+        if (entry->count != 0 && entry->page == req->page && entry->offset == req->offset) {
+            sub = entry;
+            break;
+        }
+        else if (entry->count == 0 && !sub) {
+            sub = entry;
+        }
+    }
+
+    if (req->count == 0) {
+        // Remove the subscription (if there is one)
+        if (sub && sub->count != 0) {
+            sub->count = 0;
+        }
+        return REG_MAPPED_RESULT_SUCCESSFUL;
+    }
+
+    if (!sub) {
+        return REG_MAPPED_RESULT_SUBSCRIPTION_UNAVAILABLE;
+    }
+
+    // Read the registers now, so the agent finds out about registers which can't be read
+    uint32_t values[REG_MAPPED_SUBSCRIPTION_MAX_WORDS];
+    for (unsigned int word = 0; word < req->count; word++) {
+        struct reg_mapped_read_request read_req = { .page = req->page, .offset = req->offset + word };
+        uint8_t result_code = reg_mapped_server_handle_single_read(inst, &read_req, &values[word]);
+        if (result_code != REG_MAPPED_RESULT_SUCCESSFUL) {
+            return result_code;
+        }
+    }
+
+    sub->count = req->count;
+    sub->page = req->page;
+    sub->offset = req->offset;
+    sub->last_result = REG_MAPPED_RESULT_SUCCESSFUL;
+    sub->notify_pending = true;
+    sub->interval_ms = req->interval_ms;
+    sub->threshold = req->threshold;
+    memcpy(sub->values, values, req->count * sizeof(values[0]));
+
+    return REG_MAPPED_RESULT_SUCCESSFUL;
+}
+
+#endif
+
+static void reg_mapped_server_handle_subscribe(reg_mapped_server_inst_t *inst, const uint8_t *msg, size_t len) {
+    const struct reg_mapped_subscribe_request *req = (const struct reg_mapped_subscribe_request *) msg;
+    reg_mapped_response_t response = { 0 };
+    uint8_t result_code;
+
+    if (len != sizeof(*req) || req->flags.f.bulk_req || req->flags.f.bulk_end || req->flags.f.multiword) {
+        // Subscription requests can't be combined with any other request type
+        result_code = REG_MAPPED_RESULT_MALFORMED_REQUEST;
+    }
+    else if (inst->in_bulk_request) {
+        result_code = REG_MAPPED_RESULT_BULK_REQUEST_SEQ_ERROR;
+        inst->in_bulk_request = false;  // If we get a non-bulk request in bulk mode, exit now
+    }
+    else if (req->flags.f.mode != inst->control_interface_mode) {
+        result_code = REG_MAPPED_RESULT_INVALID_MODE;
+    }
+    else {
+#if CANMORE_CONFIG_DISABLE_SUBSCRIPTIONS
+        result_code = REG_MAPPED_RESULT_SUBSCRIPTION_UNAVAILABLE;
+#else
+        result_code = reg_mapped_server_subscribe(inst, req);
+#endif
+    }
+
+    response.write_pkt.result = result_code;
+
+#if CANMORE_CONFIG_DISABLE_REG_MAPPED_ARG
+    inst->tx_func(response.data, sizeof(response.write_pkt));
+#else
+    inst->tx_func(response.data, sizeof(response.write_pkt), inst->arg);
 #endif
+}
 
 void reg_mapped_server_handle_request(reg_mapped_server_inst_t *inst, const uint8_t *msg, size_t len) {
     if (len < 1) {
@@ -313,6 +553,17 @@ void reg_mapped_server_handle_request(reg_mapped_server_inst_t *inst, const uint
 
     // Decode flags
     union reg_mapped_request_flags flags = { .data = msg[0] };
+    if (flags.f.batch) {
+        // Batch and subscription requests have their own format and response, handle them separately
+        if (flags.f.write) {
+            reg_mapped_server_handle_subscribe(inst, msg, len);
+        }
+        else {
+            reg_mapped_server_handle_batch(inst, msg, len);
+        }
+        return;
+    }
+
     bool request_type_write = (flags.f.write ? true : false);
     bool request_type_bulk = (flags.f.bulk_req ? true : false);
     bool request_type_bulk_end = (flags.f.bulk_end ? true : false);
@@ -366,12 +617,6 @@ void reg_mapped_server_handle_request(reg_mapped_server_inst_t *inst, const uint
         goto finish_request;
     }
 
-    if (request_type_bulk && !request_type_write) {
-        // Bulk requests are only supported on write requests
-        result_code = REG_MAPPED_RESULT_MALFORMED_REQUEST;
-        goto finish_request;
-    }
-
     if (request_type_bulk_end && !request_type_bulk) {
         // Bulk end can only be sent if its a bulk request
         result_code = REG_MAPPED_RESULT_MALFORMED_REQUEST;
@@ -422,6 +667,7 @@ void reg_mapped_server_handle_request(reg_mapped_server_inst_t *inst, const uint
                 }
 
                 inst->in_bulk_request = true;
+                inst->bulk_request_read = !request_type_write;
                 inst->bulk_error_code = 0;
                 inst->bulk_last_seq_num = 0;
             }
@@ -431,7 +677,9 @@ void reg_mapped_server_handle_request(reg_mapped_server_inst_t *inst, const uint
                 if (inst->bulk_error_code == 0) {
                     inst->bulk_last_seq_num++;
 
-                    if (req->write_pkt.count != inst->bulk_last_seq_num) {
+                    // Read and write requests cannot be mixed in the same bulk request
+                    if (req->read_pkt.count != inst->bulk_last_seq_num ||
+                        inst->bulk_request_read == request_type_write) {
                         result_code = REG_MAPPED_RESULT_BULK_REQUEST_SEQ_ERROR;
                         goto finish_request;
                     }
@@ -451,7 +699,30 @@ void reg_mapped_server_handle_request(reg_mapped_server_inst_t *inst, const uint
     }
 
 finish_request:
-    if (request_type_bulk) {
+    if (request_type_bulk && !request_type_write) {
+        // Bulk reads respond to every request, reporting the first error in the bulk request if one occurred
+        if (inst->in_bulk_request && inst->bulk_error_code == 0) {
+            inst->bulk_error_code = result_code;
+        }
+        uint8_t bulk_result = (inst->in_bulk_request ? inst->bulk_error_code : result_code);
+
+        response.read_bulk_pkt.result = bulk_result;
+        response.read_bulk_pkt.seq_no = (inst->in_bulk_request ? inst->bulk_last_seq_num : 0);
+        response.read_bulk_pkt.data = (bulk_result == REG_MAPPED_RESULT_SUCCESSFUL ? read_data : 0);
+        response_size = sizeof(response.read_bulk_pkt);
+
+#if CANMORE_CONFIG_DISABLE_REG_MAPPED_ARG
+        inst->tx_func(response.data, response_size);
+#else
+        inst->tx_func(response.data, response_size, inst->arg);
+#endif
+
+        // Exit bulk request mode if this is the last transfer in the request
+        if (request_type_bulk_end) {
+            inst->in_bulk_request = false;
+        }
+    }
+    else if (request_type_bulk) {
         // Handle last transfer in request
         if (request_type_bulk_end) {
             if (inst->bulk_error_code != 0) {
@@ -515,3 +786,95 @@ finish_request:
 #endif
     }
 }
+
+#if !CANMORE_CONFIG_DISABLE_SUBSCRIPTIONS
+
+static void reg_mapped_server_send_notification(reg_mapped_server_inst_t *inst, uint8_t *msg, size_t len) {
+#if CANMORE_CONFIG_DISABLE_REG_MAPPED_ARG
+    inst->notify_tx_func(msg, len);
+#else
+    inst->notify_tx_func(msg, len, inst->arg);
+#endif
+}
+
+void reg_mapped_server_tick(reg_mapped_server_inst_t *inst, uint32_t now_ms) {
+    if (!inst->subscriptions || !inst->notify_tx_func) {
+        return;
+    }
+
+    uint8_t buffer[REG_MAPPED_COMPUTE_NOTIFICATION_LEN(REG_MAPPED_SUBSCRIPTION_MAX_WORDS)];
+    struct reg_mapped_notification *notification = (struct reg_mapped_notification *) buffer;
+
+    unsigned int max_words = inst->notify_max_words;
+    if (max_words < 1) {
+        max_words = 1;
+    }
+    else if (max_words > REG_MAPPED_SUBSCRIPTION_MAX_WORDS) {
+        max_words = REG_MAPPED_SUBSCRIPTION_MAX_WORDS;
+    }
+
+    for (size_t i = 0; i < inst->num_subscriptions; i++) {
+        reg_mapped_server_subscription_t *sub = &inst->subscriptions[i];
+        if (sub->count == 0 || (!sub->notify_pending && now_ms - sub->last_sample_ms < sub->interval_ms)) {
+            continue;
+        }
+        sub->last_sample_ms = now_ms;
+
+        // Sample every register in the subscription
+        uint32_t values[REG_MAPPED_SUBSCRIPTION_MAX_WORDS];
+        uint8_t result_code = REG_MAPPED_RESULT_SUCCESSFUL;
+        for (unsigned int word = 0; word < sub->count && result_code == REG_MAPPED_RESULT_SUCCESSFUL; word++) {
+            struct reg_mapped_read_request read_req = { .page = sub->page, .offset = sub->offset + word };
+            result_code = reg_mapped_server_handle_single_read(inst, &read_req, &values[word]);
+        }
+
+        // Every register is sent for new subscriptions, keepalives, and when the result changes
+        bool notify_all = (sub->notify_pending || result_code != sub->last_result ||
+                           now_ms - sub->last_notify_ms >= REG_MAPPED_SUBSCRIPTION_KEEPALIVE_MS);
+        sub->last_result = result_code;
+
+        notification->result = result_code;
+        notification->page = sub->page;
+
+        if (result_code != REG_MAPPED_RESULT_SUCCESSFUL) {
+            // The registers can't be read, so only the error is sent
+            if (notify_all) {
+                notification->count = sub->count;
+                notification->offset = sub->offset;
+                reg_mapped_server_send_notification(inst, buffer, sizeof(*notification));
+            }
+        }
+        else {
+            // Split the registers into notifications which fit in a frame, only sending the ones which changed
+            for (unsigned int start = 0; start < sub->count; start += max_words) {
+                unsigned int count = sub->count - start;
+                if (count > max_words) {
+                    count = max_words;
+                }
+
+                bool changed = notify_all;
+                for (unsigned int word = start; word < start + count && !changed; word++) {
+                    uint32_t diff = (values[word] > sub->values[word] ? values[word] - sub->values[word]
+                                                                      : sub->values[word] - values[word]);
+                    changed = (diff > sub->threshold);
+                }
+                if (!changed) {
+                    continue;
+                }
+
+                notification->count = count;
+                notification->offset = sub->offset + start;
+                memcpy(notification->data, &values[start], count * sizeof(values[0]));
+                memcpy(&sub->values[start], &values[start], count * sizeof(values[0]));
+                reg_mapped_server_send_notification(inst, buffer, REG_MAPPED_COMPUTE_NOTIFICATION_LEN(count));
+            }
+        }
+
+        if (notify_all) {
+            sub->notify_pending = false;
+            sub->last_notify_ms = now_ms;
+        }
+    }
+}
+
+#endif
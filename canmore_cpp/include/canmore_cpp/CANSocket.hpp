@@ -10,6 +10,7 @@ namespace Canmore {
 /**
  * @brief A socket wrapper for binding to CAN bus interfaces on Linux.
  * This class automatically detects if the given interface supports CAN FD and switches to FD mode (unless overidden).
+ * Interfaces supporting CAN XL (when built against kernel headers with CAN XL support) additionally enable XL frames.
  *
  * This handles all the heavy lifting of creating an interface, and exposes this socket as a PollFDHandler (see
  * PollFD.hpp for more information on what is required to process incoming packet events)
@@ -58,6 +59,18 @@ protected:
      */
     bool transmitFrameNoexcept(canid_t can_id, const uint8_t *data, size_t len) noexcept;
 
+    /**
+     * @brief Transmits a CAN XL frame. Only valid if usingCanXl() is true
+     *
+     * CAN XL frames only have an 11-bit priority ID. For extended IDs, the priority is set to the upper 11 bits of the
+     * ID (so arbitration matches the equivalent CAN FD frame), and the full ID (with CAN_EFF_FLAG) is carried in the
+     * acceptance field. Received XL frames are converted back in the same way before being passed to handleFrame.
+     *
+     * @param can_id The ID for this CAN frame. May be a standard or extended (with CAN_EFF_FLAG) ID
+     * @param data The data to transmit for this frame (up to CANMORE_MAX_XL_FRAME_SIZE bytes)
+     */
+    void transmitXlFrame(canid_t can_id, const std::span<const uint8_t> &data);
+
     /**
      * @brief Clears the socket of all pending packets
      */
@@ -80,6 +93,27 @@ protected:
      */
     virtual void handleFrame(canid_t can_id, const std::span<const uint8_t> &data) = 0;
 
+    /**
+     * @brief A frame received by the socket, passed to handleFrames
+     */
+    struct ReceivedFrame {
+        canid_t can_id;
+        std::span<const uint8_t> data;
+    };
+
+    /**
+     * @brief Handle Frames method which can be overridden by children to process received frames in batches.
+     *
+     * All frames available on the socket (up to rxBatchSize) are read at once and passed to this function. By default,
+     * this calls handleFrame for each frame in order.
+     *
+     * @param frames The received frames, in the order they were received. Only valid for the duration of the call
+     */
+    virtual void handleFrames(std::span<const ReceivedFrame> frames);
+
+    // Maximum number of frames read from the socket at once
+    static constexpr size_t rxBatchSize = 32;
+
     /*
      * Overrides for PollFD - Implemented by this class
      */
@@ -97,9 +131,19 @@ protected:
      */
     bool usingCanFd() { return useCanFd; }
 
+    /**
+     * @brief Reports if the socket supports CAN XL frames (detected during initialization).
+     * CAN XL sockets also support CAN FD frames, so usingCanFd is also true when this is set.
+     *
+     * @return true The socket can transmit and receive CAN XL frames with transmitXlFrame
+     * @return false CAN XL is not supported on this interface
+     */
+    bool usingCanXl() { return useCanXl; }
+
 private:
     int socketFd;
     bool useCanFd;
+    bool useCanXl;
     std::shared_ptr<PollFDDescriptor> socketPollDescriptor;
 };
 
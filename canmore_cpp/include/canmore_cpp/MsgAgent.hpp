@@ -1,14 +1,41 @@
 #pragma once
 
 #include "canmore_cpp/CANSocket.hpp"
+#include "canmore_cpp/MsgBufferPool.hpp"
+#include "canmore_cpp/MsgStats.hpp"
+#include "canmore_cpp/PollFD.hpp"
 
+#include "canmore/ethernet_defs.h"
 #include "canmore/msg_encoding.h"
 
+#include <array>
+#include <functional>
 #include <list>
+#include <memory>
+#include <netinet/in.h>
+#include <string>
 #include <vector>
 
 namespace Canmore {
 
+/**
+ * @brief Callback for messages received from a subscribed client ID and subtype
+ *
+ * @param clientId The client that sent the message
+ * @param subtype The subtype for the message
+ * @param data Contents of the message. Only valid for the duration of the callback
+ */
+typedef std::function<void(uint8_t clientId, uint8_t subtype, std::span<const uint8_t> data)> AgentMsgCB;
+
+/**
+ * @brief Callback for messages received from a subscribed client ID and subtype, taking ownership of the message
+ *
+ * @param clientId The client that sent the message
+ * @param subtype The subtype for the message
+ * @param msg Reference counted buffer holding the message. This may be kept after the callback returns
+ */
+typedef std::function<void(uint8_t clientId, uint8_t subtype, MsgBuffer msg)> AgentOwnedMsgCB;
+
 /**
  * @brief Abstract handler class to be passed to the MsgAgent for responding to events
  */
@@ -38,18 +65,17 @@ public:
 };
 
 /**
- * @brief CANmore Message Agent class to handle communication with all CANmore clients on the network using messages.
+ * @brief Base class for CANmore Message Agents, independent of the transport the messages are carried over.
+ *
+ * This holds the subscription table, statistics, and message dispatch shared by all transports. Applications which
+ * only need to send and receive messages should use this class, so that the transport (CAN bus with MsgAgent, or UDP
+ * with MsgEthernetAgent) can be switched without code changes.
+ *
+ * The agent is a PollFD, and must be added to a PollGroup to receive messages.
  */
-class MsgAgent : public CANSocket {
+class MsgAgentBase : public virtual PollFD {
 public:
-    /**
-     * @brief Construct a new Message Agent object
-     *
-     * @param ifIndex The network interface index to bind to. Must be a CAN Bus interface
-     * @param handler The handler class all callbacks will be sent to
-     * @param clientIdSelect Array of client ids to listen to. By default listens to all client ids
-     */
-    MsgAgent(int ifIndex, AgentMsgHandler &handler, std::span<const uint8_t> clientIdSelect = {});
+    virtual ~MsgAgentBase() = default;
 
     /**
      * @brief Transmits a new canmore message
@@ -58,7 +84,78 @@ public:
      * @param subtype The subtype for the message (see CANmore Specification)
      * @param data The message data to transmit
      */
-    void transmitMessage(uint8_t clientId, uint8_t subtype, std::span<const uint8_t> data);
+    virtual void transmitMessage(uint8_t clientId, uint8_t subtype, std::span<const uint8_t> data) = 0;
+
+    /**
+     * @brief Routes all messages with the given client ID and subtype to the provided callback rather than the handler
+     *
+     * Subscribing with client ID 0 creates a wildcard subscription for the subtype, which receives messages from every
+     * client that doesn't have a subscription of its own for the subtype. Per-client subscriptions are left untouched.
+     * Subscriptions may be changed from within a callback, including the subscription which called it.
+     *
+     * @param clientId The client ID to subscribe to, or 0 to subscribe to this subtype on all clients
+     * @param subtype The message subtype to subscribe to
+     * @param callback The callback to call on every message received with this client ID and subtype
+     */
+    void subscribe(uint8_t clientId, uint8_t subtype, AgentMsgCB callback);
+
+    /**
+     * @brief Like subscribe, but passes ownership of each message to the callback.
+     *
+     * Messages are reassembled directly into buffers from the agent's buffer pool, and the buffer is handed to the
+     * callback without copying (on transports which reassemble messages). The message can then be queued or passed to
+     * another thread, and the buffer is returned to the pool once all references to it are released.
+     *
+     * @param clientId The client ID to subscribe to, or 0 for a wildcard subscription (see subscribe)
+     * @param subtype The message subtype to subscribe to
+     * @param callback The callback to call on every message received with this client ID and subtype
+     */
+    void subscribeOwned(uint8_t clientId, uint8_t subtype, AgentOwnedMsgCB callback);
+
+    /**
+     * @brief Removes a subscription created by subscribe. Messages will be sent to the handler again, if it is enabled
+     *
+     * @param clientId The client ID to unsubscribe from, or 0 to remove the wildcard subscription for this subtype
+     * @param subtype The message subtype to unsubscribe from
+     */
+    void unsubscribe(uint8_t clientId, uint8_t subtype);
+
+    /**
+     * @brief Controls if messages without a subscription are sent to the AgentMsgHandler::handleMessage callback.
+     *
+     * When disabled, messages with a client ID/subtype that has no subscription are skipped by the decoder as soon as
+     * the first frame is received, avoiding the cost of reassembling messages no one will read. Decode errors are
+     * still reported to the handler. Enabled by default.
+     *
+     * @param enabled True to send unsubscribed messages to the handler, false to drop them
+     */
+    void setDefaultHandlerEnabled(bool enabled);
+
+    /**
+     * @brief Returns a snapshot of the message statistics for the requested client.
+     *
+     * Safe to call from any thread, even while the agent is processing frames. Decode errors for frames sent with the
+     * reserved client ID 0, and conflicting agent frames addressed to client 0, are reported under client ID 0.
+     *
+     * @param clientId The client ID to get statistics for
+     * @return MsgStatsSnapshot The current counters for that client
+     */
+    MsgStatsSnapshot getStats(uint8_t clientId) const;
+
+    /**
+     * @brief Returns a snapshot of the message statistics summed across all clients. Safe to call from any thread
+     */
+    MsgStatsSnapshot getTotalStats() const;
+
+    /**
+     * @brief Zeros the message statistics for all clients. Safe to call from any thread
+     */
+    void resetStats();
+
+    /**
+     * @brief Returns the pool which messages are reassembled into. This can be used to reserve buffers ahead of time
+     */
+    std::shared_ptr<MsgBufferPool> getBufferPool() { return bufferPool; }
 
     /**
      * @brief Looks up a decode error code to a human readable string
@@ -68,11 +165,128 @@ public:
      */
     static void lookupDecodeError(unsigned int errorCode, std::string &strOut);
 
+protected:
+    MsgAgentBase(AgentMsgHandler &handler);
+
+    // Number of client IDs/subtypes addressable by the protocol (size of each dimension of the subscription table)
+    static constexpr size_t numClientIds = 1 << CANMORE_CLIENT_ID_LENGTH;
+    static constexpr size_t numSubtypes = 1 << CANMORE_MSG_SUBTYPE_LENGTH;
+
+    /**
+     * @brief Sends a received message to the subscribed callback, or the handler if there isn't one (and it's enabled)
+     * Aggregate and compressed messages are unpacked and their contents dispatched, unless their subtype is subscribed
+     *
+     * @param clientId The client that sent the message
+     * @param subtype The subtype for the message
+     * @param data Contents of the message
+     */
+    void dispatchMessage(uint8_t clientId, uint8_t subtype, std::span<const uint8_t> data);
+
+    /**
+     * @brief Dispatches a message which was reassembled into a buffer from bufferPool.
+     * If the subscriber takes ownership of messages, the buffer is handed to it without copying.
+     *
+     * @param clientId The client that sent the message
+     * @param subtype The subtype for the message
+     * @param buffer Buffer acquired from bufferPool holding the message
+     * @param len The length of the message
+     * @return true Ownership of the buffer was passed to the subscriber, and the caller must no longer use it
+     * @return false The caller still owns the buffer
+     */
+    bool dispatchPooledMessage(uint8_t clientId, uint8_t subtype, uint8_t *buffer, size_t len);
+
+    /**
+     * @brief Computes the subtype filter for the requested client from the subscription table.
+     * Transports which reassemble messages should apply this to their decoders to skip unwanted messages.
+     *
+     * @param clientId The client ID to compute the filter for
+     * @return uint64_t Subtype filter, for use with canmore_msg_decode_set_subtype_filter
+     */
+    uint64_t computeSubtypeFilter(uint8_t clientId);
+
+    /**
+     * @brief Called whenever the result of computeSubtypeFilter may have changed for the given client
+     *
+     * @param clientId The client ID which had its filter change (never 0)
+     */
+    virtual void subtypeFilterChanged(uint8_t clientId) { (void) clientId; }
+
+    AgentMsgHandler &handler;                  // Handler for this class
+    std::array<MsgStats, numClientIds> stats;  // Statistics for each client (index is client id)
+    std::shared_ptr<MsgBufferPool> bufferPool;  // Pool for reassembly buffers and owned messages
+
+private:
+    // Entry in the subscription table. At most one of the callbacks is set
+    struct Subscription {
+        AgentMsgCB callback;
+        AgentOwnedMsgCB ownedCallback;
+
+        explicit operator bool() const { return callback || ownedCallback; }
+    };
+
+    // Computes the index into the subscription table for the given client and subtype
+    static size_t subscriptionIdx(uint8_t clientId, uint8_t subtype) { return (clientId * numSubtypes) + subtype; }
+
+    // Sets the callback for the given client ID (or the wildcard if 0) and subtype, updating the decoder filters
+    void setSubscription(uint8_t clientId, uint8_t subtype, const Subscription &subscription);
+
+    // Returns the subscription for the given client and subtype, falling back to the wildcard subscription
+    const Subscription &lookupSubscription(uint8_t clientId, uint8_t subtype) const;
+
+    // Returns true if the message is an aggregate or compressed message which should be unpacked before dispatching
+    bool shouldUnpack(uint8_t clientId, uint8_t subtype) const;
+
+    // Implements dispatchMessage. inCompressed is set for messages unpacked from a compressed message, which can't
+    // contain another compressed message
+    void dispatchInner(uint8_t clientId, uint8_t subtype, std::span<const uint8_t> data, bool inCompressed);
+
+    // Dispatches each entry in an aggregate message, reporting a decode error if it is malformed
+    void dispatchAggregate(uint8_t clientId, std::span<const uint8_t> data, bool inCompressed);
+
+    // Decompresses a compressed message into a pool buffer and dispatches it, reporting a decode error if it is
+    // malformed or nested inside another compressed message
+    void dispatchCompressed(uint8_t clientId, std::span<const uint8_t> data, bool inCompressed);
+
+    bool defaultHandlerEnabled = true;      // If unsubscribed messages should be sent to handler
+    std::vector<Subscription> subscriptions;  // Flat table of callbacks (index is computed by subscriptionIdx, and
+                                              // client ID 0 holds the wildcard subscriptions)
+};
+
+/**
+ * @brief CANmore Message Agent class to handle communication with all CANmore clients on the network using messages.
+ */
+class MsgAgent : public CANSocket, public MsgAgentBase {
+public:
+    /**
+     * @brief Construct a new Message Agent object
+     *
+     * @param ifIndex The network interface index to bind to. Must be a CAN Bus interface
+     * @param handler The handler class all callbacks will be sent to
+     * @param clientIdSelect Array of client ids to listen to. By default listens to all client ids
+     */
+    MsgAgent(int ifIndex, AgentMsgHandler &handler, std::span<const uint8_t> clientIdSelect = {});
+
+    void transmitMessage(uint8_t clientId, uint8_t subtype, std::span<const uint8_t> data) override;
+
+    /**
+     * @brief Enables compressing messages before transmitting them, when it reduces the number of frames required.
+     * The receiver must support CANMORE_MSG_SUBTYPE_COMPRESSED messages.
+     *
+     * @param enabled If messages should be compressed
+     */
+    void setCompressionEnabled(bool enabled) { compressionEnabled = enabled; }
+
 protected:
     /*
      * Overrides for CANSocket
      */
     void handleFrame(canid_t can_id, const std::span<const uint8_t> &data) override;
+    void handleFrames(std::span<const ReceivedFrame> frames) override;
+
+    /*
+     * Overrides for MsgAgentBase
+     */
+    void subtypeFilterChanged(uint8_t clientId) override;
 
 private:
     typedef std::pair<MsgAgent *, uint8_t> DecodeErrorCbArg;  // Format: {Agent Instance, Client ID}
@@ -80,13 +294,93 @@ private:
     // Static function to call appropriate decode error handler for the specific decoder
     static void decoderErrorCallback(void *arg, unsigned int errorCode) {
         auto argData = (DecodeErrorCbArg *) arg;
+        argData->first->stats[argData->second].countDecodeError(errorCode);
         argData->first->handler.handleDecodeError(argData->second, errorCode);
     }
 
-    AgentMsgHandler &handler;                      // Handler for this class
+    // Hot decoder state for a single client, aligned so that each client's state occupies exactly one cache line
+    struct alignas(64) DecoderSlot {
+        canmore_msg_split_decoder_t state;
+    };
+
+    // Maximum number of messages completed per call to canmore_msg_decode_frames
+    static constexpr size_t decodeBatchMaxMsgs = 8;
+
+    // Decodes a batch of frames which have already been checked to come from a valid client
+    void decodeBatch(std::span<const canmore_msg_frame_t> batch);
+
+    // Callbacks for canmore_msg_decode_frames
+    static canmore_msg_split_decoder_t *batchLookupCallback(void *arg, uint32_t can_id, bool is_extended);
+    static uint8_t *batchAcquireBufferCallback(void *arg);
+    static void batchReleaseBufferCallback(void *arg, uint8_t *buffer);
+
     std::vector<canmore_msg_encoder_t> encoders;   // Array of encoders for connected clients (index is client id)
     std::list<DecodeErrorCbArg> decoderErrorArgs;  // Holds args for decode error callbacks (refs must stay constant)
-    std::vector<canmore_msg_decoder_t> decoders;   // Array of decoders for connected clients (index is client id - 1)
+    std::vector<DecoderSlot> decoders;             // Array of decoders for all clients (index is client id - 1)
+    bool compressionEnabled = false;               // If messages are compressed when it saves frames
+};
+
+/**
+ * @brief CANmore Message Agent which communicates with Ethernet-attached clients over UDP.
+ *
+ * A single socket bound to the message port serves all clients. Each message is sent in a single datagram (see
+ * ethernet_defs.h). The address of each client is learned from the datagrams it sends, or can be set explicitly with
+ * setClientAddress, which is required before messages can be sent to a client that hasn't transmitted yet.
+ */
+class MsgEthernetAgent : public PollFDHandler, public MsgAgentBase {
+public:
+    /**
+     * @brief Construct a new Ethernet Message Agent object
+     *
+     * @param handler The handler class all callbacks will be sent to
+     * @param port The UDP port to bind to
+     * @param bindAddr The local address to bind to. By default binds to all interfaces
+     */
+    MsgEthernetAgent(AgentMsgHandler &handler, uint16_t port = CANMORE_ETH_MSG_PORT,
+                     struct in_addr bindAddr = { INADDR_ANY });
+    ~MsgEthernetAgent();
+
+    // Disabling copying (since we have a file discriptor)
+    MsgEthernetAgent(MsgEthernetAgent const &) = delete;
+    MsgEthernetAgent &operator=(MsgEthernetAgent const &) = delete;
+
+    /**
+     * @brief Transmits a new canmore message. Broadcasts (client ID 0) are sent to every client with a known address
+     *
+     * @param clientId The destination client ID, or 0 for broadcast
+     * @param subtype The subtype for the message (see CANmore Specification)
+     * @param data The message data to transmit
+     */
+    void transmitMessage(uint8_t clientId, uint8_t subtype, std::span<const uint8_t> data) override;
+
+    /**
+     * @brief Sets the address of a client. This will be updated if a message is received from a different address
+     *
+     * @param clientId The client ID to set the address for
+     * @param ipAddr The IP address of the client
+     * @param port The UDP port of the client
+     */
+    void setClientAddress(uint8_t clientId, struct in_addr ipAddr, uint16_t port = CANMORE_ETH_MSG_PORT);
+
+    /*
+     * Overrides for PollFD
+     */
+    void populateFds(std::vector<std::weak_ptr<PollFDDescriptor>> &descriptors) override;
+
+protected:
+    void handleEvent(const pollfd &fd) override;
+
+private:
+    // Maximum number of datagrams to read per recvmmsg call
+    static constexpr size_t rxBatchSize = 16;
+
+    // Processes a single received datagram
+    void handleDatagram(const struct sockaddr_in &srcAddr, std::span<const uint8_t> datagram, bool truncated);
+
+    int socketFd;
+    std::shared_ptr<PollFDDescriptor> socketPollDescriptor;
+    std::array<struct sockaddr_in, numClientIds> clientAddrs;  // Client addresses (sin_family is 0 if unknown)
+    std::vector<uint8_t> rxBuffer;  // Receive buffers for recvmmsg (rxBatchSize buffers of CANMORE_ETH_MSG_MAX_LEN)
 };
 
 }  // namespace Canmore
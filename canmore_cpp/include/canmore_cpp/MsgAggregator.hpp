@@ -0,0 +1,97 @@
+#pragma once
+
+#include "canmore_cpp/MsgAgent.hpp"
+#include "canmore_cpp/PollFD.hpp"
+#include "canmore_cpp/span_compat.hpp"
+
+#include "canmore/msg_aggregation.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Canmore {
+
+/**
+ * @brief Packs small messages sent by an agent into aggregate messages, reducing the per-message overhead on the bus.
+ *
+ * Messages queued for a client are held until either the next message would not fit in the aggregate message, or the
+ * flush delay has elapsed since the first message was queued. They are then sent together as a single message with the
+ * CANMORE_MSG_SUBTYPE_AGGREGATE subtype, which the receiver unpacks and delivers as if each was sent separately. If
+ * only one message is pending when flushed, it is sent as a normal message.
+ *
+ * The flush timer is a timerfd, so the aggregator must be added to the same PollGroup as the agent.
+ */
+class MsgAggregator : public PollFDHandler {
+public:
+    /**
+     * @brief Creates a new aggregator sending through the given agent
+     *
+     * @param agent The agent to transmit messages with. Must outlive this object
+     * @param flushDelay The maximum time a message is held before being sent
+     * @param maxLength The maximum length of each aggregate message (smaller values reduce latency on slow busses)
+     */
+    MsgAggregator(MsgAgentBase &agent, std::chrono::microseconds flushDelay = std::chrono::milliseconds(1),
+                  size_t maxLength = CANMORE_MAX_MSG_LENGTH);
+    ~MsgAggregator();
+
+    // Disabling copying (since we have a file discriptor)
+    MsgAggregator(MsgAggregator const &) = delete;
+    MsgAggregator &operator=(MsgAggregator const &) = delete;
+
+    /**
+     * @brief Queues a message to be sent to a client in the next aggregate message.
+     * Messages too large to be aggregated are sent immediately, after any messages already queued for that client.
+     *
+     * @param clientId The destination client ID, or 0 for broadcast
+     * @param subtype The subtype for the message (must not be CANMORE_MSG_SUBTYPE_AGGREGATE)
+     * @param data The message data to transmit. This is copied, and does not need to remain valid
+     */
+    void queueMessage(uint8_t clientId, uint8_t subtype, std::span<const uint8_t> data);
+
+    /**
+     * @brief Immediately sends any messages queued for the given client
+     *
+     * @param clientId The client ID to flush
+     */
+    void flush(uint8_t clientId);
+
+    /**
+     * @brief Immediately sends all queued messages
+     */
+    void flushAll();
+
+    /**
+     * @brief Sets the maximum time a message is held before being sent. Applies to messages queued after this call
+     */
+    void setFlushDelay(std::chrono::microseconds flushDelay) { this->flushDelay = flushDelay; }
+
+    void populateFds(std::vector<std::weak_ptr<PollFDDescriptor>> &descriptors) override;
+
+protected:
+    void handleEvent(const pollfd &fd) override;
+
+private:
+    // Messages waiting to be sent to a single client
+    struct PendingMessage {
+        std::vector<uint8_t> buffer;
+        canmore_msg_aggregator_t state;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    // Arms the timer for the earliest flush deadline, or disarms it if nothing is pending
+    void updateTimer();
+
+    static constexpr size_t numClientIds = 1 << CANMORE_CLIENT_ID_LENGTH;
+
+    MsgAgentBase &agent;
+    std::chrono::microseconds flushDelay;
+    std::array<PendingMessage, numClientIds> pending;  // Pending messages for each client (index is client id)
+
+    int timerFd;
+    std::shared_ptr<PollFDDescriptor> timerPollDescriptor;
+};
+
+};  // namespace Canmore
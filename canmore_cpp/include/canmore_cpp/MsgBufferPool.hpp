@@ -0,0 +1,139 @@
+#pragma once
+
+#include "canmore_cpp/span_compat.hpp"
+
+#include "canmore/protocol.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Canmore {
+
+/**
+ * @brief Read-only, reference counted message buffer handed off from a MsgBufferPool.
+ *
+ * Copies of this object share the same underlying buffer, which is returned to its pool when the last copy is
+ * destroyed. This allows messages to be queued or passed between threads without copying the message data.
+ */
+class MsgBuffer {
+    friend class MsgBufferPool;
+
+public:
+    MsgBuffer() = default;
+
+    /**
+     * @brief Returns the message data held by this buffer
+     */
+    std::span<const uint8_t> data() const { return std::span<const uint8_t> { buffer.get(), len }; }
+
+    /**
+     * @brief Returns the length of the message held by this buffer
+     */
+    size_t size() const { return len; }
+
+    /**
+     * @brief Returns true if this object holds a buffer
+     */
+    explicit operator bool() const { return !!buffer; }
+
+private:
+    MsgBuffer(std::shared_ptr<const uint8_t> buffer, size_t len): buffer(std::move(buffer)), len(len) {}
+
+    std::shared_ptr<const uint8_t> buffer;
+    size_t len = 0;
+};
+
+/**
+ * @brief Thread-safe pool of fixed size message buffers.
+ *
+ * Decoders reassemble messages into buffers acquired from the pool. Once a message is complete, ownership of its
+ * buffer can be transferred to the consumer as a MsgBuffer, and the decoder acquires a fresh buffer for the next
+ * message. Buffers are returned to the pool when the last MsgBuffer referencing them is destroyed, which may happen on
+ * any thread. The pool grows on demand up to a fixed number of buffers, so that a consumer which holds on to messages
+ * (or a flood of traffic) can't exhaust memory, and is kept alive until every buffer has been returned.
+ */
+class MsgBufferPool : public std::enable_shared_from_this<MsgBufferPool> {
+public:
+    // Default limit on the number of buffers a pool will allocate
+    static constexpr size_t defaultMaxBuffers = 256;
+
+    /**
+     * @brief Creates a new buffer pool
+     *
+     * @param bufferSize The size of each buffer in the pool
+     * @param maxBuffers The max number of buffers the pool will allocate
+     * @return std::shared_ptr<MsgBufferPool> The new pool
+     */
+    static std::shared_ptr<MsgBufferPool> create(size_t bufferSize = CANMORE_MAX_MSG_LENGTH,
+                                                 size_t maxBuffers = defaultMaxBuffers) {
+        return std::shared_ptr<MsgBufferPool>(new MsgBufferPool(bufferSize, maxBuffers));
+    }
+
+    // Disable copying, buffers hold a reference to the pool
+    MsgBufferPool(MsgBufferPool const &) = delete;
+    MsgBufferPool &operator=(MsgBufferPool const &) = delete;
+
+    /**
+     * @brief Allocates buffers ahead of time, so that acquire does not need to allocate memory
+     *
+     * @param count The number of free buffers to ensure are in the pool, limited by maxBuffers
+     */
+    void reserve(size_t count);
+
+    /**
+     * @brief Acquires a buffer from the pool, allocating a new one if none are free and fewer than maxBuffers have been
+     * allocated. The buffer must either be returned with release or handed off with share.
+     *
+     * @return uint8_t* Pointer to a buffer of bufferSize bytes, or nullptr if the pool is exhausted
+     */
+    uint8_t *acquire();
+
+    /**
+     * @brief Returns a buffer from acquire back to the pool
+     *
+     * @param buffer The buffer to return
+     */
+    void release(uint8_t *buffer);
+
+    /**
+     * @brief Transfers ownership of a buffer from acquire into a reference counted MsgBuffer.
+     * The buffer is returned to the pool once all references to the MsgBuffer are destroyed.
+     *
+     * @param buffer The buffer to share
+     * @param len The length of valid data in the buffer
+     * @return MsgBuffer Read-only handle to the buffer
+     */
+    MsgBuffer share(uint8_t *buffer, size_t len);
+
+    /**
+     * @brief Copies data into a buffer from the pool, returning it as a MsgBuffer
+     *
+     * @param data The data to copy. Must not be larger than bufferSize
+     * @return MsgBuffer Read-only handle to the copied data, or an empty MsgBuffer if the pool is exhausted
+     */
+    MsgBuffer copy(std::span<const uint8_t> data);
+
+    /**
+     * @brief Returns the total number of buffers allocated by the pool
+     */
+    size_t allocatedCount();
+
+    /**
+     * @brief Returns the number of buffers in the pool which are not in use
+     */
+    size_t freeCount();
+
+    const size_t bufferSize;
+    const size_t maxBuffers;
+
+private:
+    MsgBufferPool(size_t bufferSize, size_t maxBuffers): bufferSize(bufferSize), maxBuffers(maxBuffers) {}
+
+    std::mutex lock;                                   // Protects all members below, as buffers may be freed anywhere
+    std::vector<std::unique_ptr<uint8_t[]>> storage;   // Owns all allocated buffers
+    std::vector<uint8_t *> freeBuffers;                // Buffers not currently in use
+};
+
+};  // namespace Canmore
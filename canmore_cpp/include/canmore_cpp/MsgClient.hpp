@@ -1,18 +1,186 @@
 #pragma once
 
 #include "canmore_cpp/CANSocket.hpp"
+#include "canmore_cpp/MsgBufferPool.hpp"
+#include "canmore_cpp/MsgStats.hpp"
+#include "canmore_cpp/PollFD.hpp"
 #include "canmore_cpp/span_compat.hpp"
 
+#include "canmore/ethernet_defs.h"
 #include "canmore/msg_encoding.h"
 
+#include <functional>
+#include <netinet/in.h>
+#include <vector>
+
 namespace Canmore {
 
+/**
+ * @brief Callback for messages received with a subscribed subtype
+ *
+ * @param subtype The subtype for the message
+ * @param data Contents of the message. Only valid for the duration of the callback
+ */
+typedef std::function<void(uint8_t subtype, std::span<const uint8_t> data)> ClientMsgCB;
+
+/**
+ * @brief Callback for messages received with a subscribed subtype, taking ownership of the message
+ *
+ * @param subtype The subtype for the message
+ * @param msg Reference counted buffer holding the message. This may be kept after the callback returns
+ */
+typedef std::function<void(uint8_t subtype, MsgBuffer msg)> ClientOwnedMsgCB;
+
 class ClientMsgHandler {
 public:
     virtual void handleMessage(uint8_t subtype, std::span<const uint8_t> data) = 0;
     virtual void handleDecodeError(unsigned int errorCode) = 0;
 };
 
+/**
+ * @brief Base class for CANmore Message Clients, independent of the transport the messages are carried over.
+ *
+ * This holds the subscription table, statistics, and message dispatch shared by all transports. Applications which
+ * only need to send and receive messages should use this class, so that the transport (CAN bus with MsgClient, or UDP
+ * with MsgEthernetClient) can be switched without code changes.
+ *
+ * The client is a PollFD, and must be added to a PollGroup to receive messages.
+ */
+class MsgClientBase : public virtual PollFD {
+public:
+    virtual ~MsgClientBase() = default;
+
+    /**
+     * @brief Transmits a new canmore message
+     *
+     * @param subtype The subtype for the message (see CANmore Specification)
+     * @param data The message data to transmit
+     */
+    virtual void transmitMessage(uint8_t subtype, std::span<const uint8_t> data) = 0;
+
+    /**
+     * @brief Routes all messages with the given subtype to the provided callback rather than the handler
+     *
+     * @param subtype The message subtype to subscribe to
+     * @param callback The callback to call on every message received with this subtype
+     */
+    void subscribe(uint8_t subtype, ClientMsgCB callback);
+
+    /**
+     * @brief Like subscribe, but passes ownership of each message to the callback.
+     *
+     * Messages are reassembled directly into buffers from the client's buffer pool, and the buffer is handed to the
+     * callback without copying (on transports which reassemble messages). The message can then be queued or passed to
+     * another thread, and the buffer is returned to the pool once all references to it are released.
+     *
+     * @param subtype The message subtype to subscribe to
+     * @param callback The callback to call on every message received with this subtype
+     */
+    void subscribeOwned(uint8_t subtype, ClientOwnedMsgCB callback);
+
+    /**
+     * @brief Removes a subscription created by subscribe. Messages will be sent to the handler again, if it is enabled
+     *
+     * @param subtype The message subtype to unsubscribe from
+     */
+    void unsubscribe(uint8_t subtype);
+
+    /**
+     * @brief Controls if messages without a subscription are sent to the ClientMsgHandler::handleMessage callback.
+     *
+     * When disabled, messages with a subtype that has no subscription are skipped by the decoder as soon as the first
+     * frame is received. Decode errors are still reported to the handler. Enabled by default.
+     *
+     * @param enabled True to send unsubscribed messages to the handler, false to drop them
+     */
+    void setDefaultHandlerEnabled(bool enabled);
+
+    /**
+     * @brief Returns a snapshot of the message statistics for this client. Safe to call from any thread
+     */
+    MsgStatsSnapshot getStats() const { return stats.snapshot(); }
+
+    /**
+     * @brief Zeros the message statistics for this client. Safe to call from any thread
+     */
+    void resetStats() { stats.reset(); }
+
+    /**
+     * @brief Returns the pool which messages are reassembled into. This can be used to reserve buffers ahead of time
+     */
+    std::shared_ptr<MsgBufferPool> getBufferPool() { return bufferPool; }
+
+    const uint8_t clientId;
+
+protected:
+    MsgClientBase(uint8_t clientId, ClientMsgHandler &handler);
+
+    /**
+     * @brief Sends a received message to the subscribed callback, or the handler if there isn't one (and it's enabled)
+     * Aggregate and compressed messages are unpacked and their contents dispatched, unless their subtype is subscribed
+     *
+     * @param subtype The subtype for the message
+     * @param data Contents of the message
+     */
+    void dispatchMessage(uint8_t subtype, std::span<const uint8_t> data);
+
+    /**
+     * @brief Dispatches a message which was reassembled into a buffer from bufferPool.
+     * If the subscriber takes ownership of messages, the buffer is handed to it without copying.
+     *
+     * @param subtype The subtype for the message
+     * @param buffer Buffer acquired from bufferPool holding the message
+     * @param len The length of the message
+     * @return true Ownership of the buffer was passed to the subscriber, and the caller must no longer use it
+     * @return false The caller still owns the buffer
+     */
+    bool dispatchPooledMessage(uint8_t subtype, uint8_t *buffer, size_t len);
+
+    /**
+     * @brief Called whenever the subtype filter changes. Transports which reassemble messages should apply this filter
+     * to their decoder to skip unwanted messages.
+     *
+     * @param filter The new subtype filter, for use with canmore_msg_decode_set_subtype_filter
+     */
+    virtual void subtypeFilterChanged(uint64_t filter) { (void) filter; }
+
+    ClientMsgHandler &handler;
+    MsgStats stats;
+    std::shared_ptr<MsgBufferPool> bufferPool;  // Pool for reassembly buffers and owned messages
+
+private:
+    // Entry in the subscription table. At most one of the callbacks is set
+    struct Subscription {
+        ClientMsgCB callback;
+        ClientOwnedMsgCB ownedCallback;
+
+        explicit operator bool() const { return callback || ownedCallback; }
+    };
+
+    // Sets the callback for the given subtype, updating the decoder filter
+    void setSubscription(uint8_t subtype, const Subscription &subscription);
+
+    // Recomputes the subtype filter from the subscription table
+    void updateSubtypeFilter();
+
+    // Returns true if the message is an aggregate or compressed message which should be unpacked before dispatching
+    bool shouldUnpack(uint8_t subtype) const;
+
+    // Implements dispatchMessage. inCompressed is set for messages unpacked from a compressed message, which can't
+    // contain another compressed message
+    void dispatchInner(uint8_t subtype, std::span<const uint8_t> data, bool inCompressed);
+
+    // Dispatches each entry in an aggregate message, reporting a decode error if it is malformed
+    void dispatchAggregate(std::span<const uint8_t> data, bool inCompressed);
+
+    // Decompresses a compressed message into a pool buffer and dispatches it, reporting a decode error if it is
+    // malformed or nested inside another compressed message
+    void dispatchCompressed(std::span<const uint8_t> data, bool inCompressed);
+
+    bool defaultHandlerEnabled = true;
+    std::vector<Subscription> subscriptions;  // Table of callbacks (index is subtype)
+};
+
 /**
  * @brief Class to act as a CANmore Client for Message frames.
  *
@@ -20,7 +188,7 @@ public:
  * a simple function to transmit new messages, and users can inherit the MsgHandler class to receive messages
  * or report decode errors.
  */
-class MsgClient : public CANSocket {
+class MsgClient : public CANSocket, public MsgClientBase {
 public:
     /**
      * @brief Creates a new CANmore Message Client
@@ -31,15 +199,15 @@ public:
      */
     MsgClient(int ifIndex, uint8_t clientId, ClientMsgHandler &handler);
 
+    void transmitMessage(uint8_t subtype, std::span<const uint8_t> data) override;
+
     /**
-     * @brief Transmits a new canmore message
+     * @brief Enables compressing messages before transmitting them, when it reduces the number of frames required.
+     * The receiver must support CANMORE_MSG_SUBTYPE_COMPRESSED messages.
      *
-     * @param subtype The subtype for the message (see CANmore Specification)
-     * @param data The message data to transmit
+     * @param enabled If messages should be compressed
      */
-    void transmitMessage(uint8_t subtype, std::span<const uint8_t> data);
-
-    const uint8_t clientId;
+    void setCompressionEnabled(bool enabled) { compressionEnabled = enabled; }
 
 protected:
     /*
@@ -47,15 +215,67 @@ protected:
      */
     void handleFrame(canid_t can_id, const std::span<const uint8_t> &data) override;
 
+    /*
+     * Overrides for MsgClientBase
+     */
+    void subtypeFilterChanged(uint64_t filter) override;
+
 private:
     static void decoderErrorCallback(void *arg, unsigned int errorCode) {
         auto client = (MsgClient *) arg;
+        client->stats.countDecodeError(errorCode);
         client->handler.handleDecodeError(errorCode);
     }
 
-    ClientMsgHandler &handler;
     canmore_msg_encoder_t encoder;
-    canmore_msg_decoder_t decoder;
+    canmore_msg_split_decoder_t decoder;  // Reassembles into buffers from bufferPool
+    bool compressionEnabled = false;      // If messages are compressed when it saves frames
+};
+
+/**
+ * @brief CANmore Message Client which communicates with the agent over UDP, for Ethernet-attached clients.
+ *
+ * Each message is sent in a single datagram to the agent's message port (see ethernet_defs.h). The socket is connected
+ * to the agent, so only datagrams from the agent are received.
+ */
+class MsgEthernetClient : public PollFDHandler, public MsgClientBase {
+public:
+    /**
+     * @brief Creates a new Ethernet CANmore Message Client
+     *
+     * @param agentAddr The IP address of the agent
+     * @param clientId The client ID for this client
+     * @param handler Class to handle incoming messages or report errors
+     * @param port The UDP port the agent is listening on
+     */
+    MsgEthernetClient(struct in_addr agentAddr, uint8_t clientId, ClientMsgHandler &handler,
+                      uint16_t port = CANMORE_ETH_MSG_PORT);
+    ~MsgEthernetClient();
+
+    // Disabling copying (since we have a file discriptor)
+    MsgEthernetClient(MsgEthernetClient const &) = delete;
+    MsgEthernetClient &operator=(MsgEthernetClient const &) = delete;
+
+    void transmitMessage(uint8_t subtype, std::span<const uint8_t> data) override;
+
+    /*
+     * Overrides for PollFD
+     */
+    void populateFds(std::vector<std::weak_ptr<PollFDDescriptor>> &descriptors) override;
+
+protected:
+    void handleEvent(const pollfd &fd) override;
+
+private:
+    // Maximum number of datagrams to read per recvmmsg call
+    static constexpr size_t rxBatchSize = 8;
+
+    // Processes a single received datagram
+    void handleDatagram(std::span<const uint8_t> datagram, bool truncated);
+
+    int socketFd;
+    std::shared_ptr<PollFDDescriptor> socketPollDescriptor;
+    std::vector<uint8_t> rxBuffer;  // Receive buffers for recvmmsg (rxBatchSize buffers of CANMORE_ETH_MSG_MAX_LEN)
 };
 
 };  // namespace Canmore
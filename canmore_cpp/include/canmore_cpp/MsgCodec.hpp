@@ -0,0 +1,571 @@
+#pragma once
+
+#include "canmore_cpp/span_compat.hpp"
+
+#include "canmore/msg_encoding.h"
+#include "canmore/protocol.h"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <linux/can.h>
+
+/**
+ * @file canmore_cpp/MsgCodec.hpp
+ *
+ * @brief Compile-time specialized CANmore message encoder/decoder
+ *
+ * These templates implement the same wire format as the C encoder/decoder in canmore/msg_encoding.h, but with the frame
+ * mode (classic CAN or CAN FD) and direction fixed at compile time. This removes the per-frame branches on those
+ * settings, and packs/unpacks IDs with constexpr shifts and masks rather than relying on the bitfield layout of
+ * canmore_id_t.
+ */
+
+namespace Canmore::Codec {
+
+/**
+ * @brief The CAN frame format used to carry message frames
+ */
+enum class Mode { Classic, FD };
+
+/**
+ * @brief The direction of a message, matching the CANMORE_DIRECTION_ values
+ */
+enum class Direction : uint32_t {
+    ClientToAgent = CANMORE_DIRECTION_CLIENT_TO_AGENT,
+    AgentToClient = CANMORE_DIRECTION_AGENT_TO_CLIENT
+};
+
+/**
+ * @brief Returns the direction of messages sent in the opposite direction
+ */
+constexpr Direction opposite(Direction dir) {
+    return (dir == Direction::ClientToAgent ? Direction::AgentToClient : Direction::ClientToAgent);
+}
+
+// ========================================
+// ID Packing/Unpacking
+// ========================================
+
+namespace Id {
+
+/**
+ * @brief Returns a mask of the given number of bits
+ */
+constexpr uint32_t bitMask(unsigned int length) {
+    return (length >= 32 ? UINT32_MAX : (1u << length) - 1u);
+}
+
+/**
+ * @brief Packs a value into a field of the given offset/length
+ */
+template <unsigned int Offset, unsigned int Length> constexpr uint32_t pack(uint32_t value) {
+    return (value & bitMask(Length)) << Offset;
+}
+
+/**
+ * @brief Extracts a field of the given offset/length from an ID
+ */
+template <unsigned int Offset, unsigned int Length> constexpr uint32_t unpack(uint32_t id) {
+    return (id >> Offset) & bitMask(Length);
+}
+
+/**
+ * @brief Computes a standard frame ID
+ */
+constexpr uint32_t std(uint32_t clientId, uint32_t type, Direction dir, uint32_t noc) {
+    return pack<CANMORE_STD_CLIENT_ID_OFFSET, CANMORE_CLIENT_ID_LENGTH>(clientId) |
+           pack<CANMORE_STD_TYPE_OFFSET, CANMORE_TYPE_LENGTH>(type) |
+           pack<CANMORE_STD_DIRECTION_OFFSET, CANMORE_DIRECTION_LENGTH>(static_cast<uint32_t>(dir)) |
+           pack<CANMORE_STD_NOC_OFFSET, CANMORE_NOC_LENGTH>(noc);
+}
+
+/**
+ * @brief Computes an extended frame ID
+ */
+constexpr uint32_t ext(uint32_t clientId, uint32_t type, Direction dir, uint32_t noc, uint32_t extra) {
+    return pack<CANMORE_EXT_CLIENT_ID_OFFSET, CANMORE_CLIENT_ID_LENGTH>(clientId) |
+           pack<CANMORE_EXT_TYPE_OFFSET, CANMORE_TYPE_LENGTH>(type) |
+           pack<CANMORE_EXT_DIRECTION_OFFSET, CANMORE_DIRECTION_LENGTH>(static_cast<uint32_t>(dir)) |
+           pack<CANMORE_EXT_NOC_OFFSET, CANMORE_NOC_LENGTH>(noc) |
+           pack<CANMORE_EXT_EXTRA_OFFSET, CANMORE_EXTRA_LENGTH>(extra);
+}
+
+/**
+ * @brief Computes the extra field for the first frame of a message
+ */
+constexpr uint32_t msgFirstExtra(bool single, uint32_t len, uint32_t subtype) {
+    return pack<CANMORE_EXT_MSG_LEN_OFFSET, CANMORE_MSG_LEN_LENGTH>(len) |
+           pack<CANMORE_EXT_MSG_SUBTYPE_OFFSET, CANMORE_MSG_SUBTYPE_LENGTH>(subtype) |
+           pack<CANMORE_EXT_MSG_SINGLE_OFFSET, CANMORE_MSG_SINGLE_LENGTH>(single ? 1 : 0);
+}
+
+/**
+ * @brief Message and utility frame IDs for a fixed direction
+ */
+template <Direction Dir> struct For {
+    static constexpr uint32_t msg(uint32_t clientId, uint32_t seqNum) {
+        return std(clientId, CANMORE_TYPE_MSG, Dir, seqNum);
+    }
+
+    static constexpr uint32_t msgExt(uint32_t clientId, uint32_t seqNum, uint32_t extra) {
+        return ext(clientId, CANMORE_TYPE_MSG, Dir, seqNum, extra);
+    }
+
+    static constexpr uint32_t msgFirst(uint32_t clientId, bool single, uint32_t len, uint32_t subtype) {
+        return ext(clientId, CANMORE_TYPE_MSG, Dir, 0, msgFirstExtra(single, len, subtype));
+    }
+
+    static constexpr uint32_t util(uint32_t clientId, uint32_t channel) {
+        return std(clientId, CANMORE_TYPE_UTIL, Dir, channel);
+    }
+};
+
+/*
+ * Field accessors, the ID passed must not contain any CAN flags
+ */
+constexpr uint32_t clientId(uint32_t id, bool isExtended) {
+    return (isExtended ? unpack<CANMORE_EXT_CLIENT_ID_OFFSET, CANMORE_CLIENT_ID_LENGTH>(id) :
+                         unpack<CANMORE_STD_CLIENT_ID_OFFSET, CANMORE_CLIENT_ID_LENGTH>(id));
+}
+
+constexpr uint32_t type(uint32_t id, bool isExtended) {
+    return (isExtended ? unpack<CANMORE_EXT_TYPE_OFFSET, CANMORE_TYPE_LENGTH>(id) :
+                         unpack<CANMORE_STD_TYPE_OFFSET, CANMORE_TYPE_LENGTH>(id));
+}
+
+constexpr Direction direction(uint32_t id, bool isExtended) {
+    return static_cast<Direction>(isExtended ? unpack<CANMORE_EXT_DIRECTION_OFFSET, CANMORE_DIRECTION_LENGTH>(id) :
+                                               unpack<CANMORE_STD_DIRECTION_OFFSET, CANMORE_DIRECTION_LENGTH>(id));
+}
+
+constexpr uint32_t noc(uint32_t id, bool isExtended) {
+    return (isExtended ? unpack<CANMORE_EXT_NOC_OFFSET, CANMORE_NOC_LENGTH>(id) :
+                         unpack<CANMORE_STD_NOC_OFFSET, CANMORE_NOC_LENGTH>(id));
+}
+
+constexpr uint32_t extra(uint32_t id) {
+    return unpack<CANMORE_EXT_EXTRA_OFFSET, CANMORE_EXTRA_LENGTH>(id);
+}
+
+constexpr uint32_t msgLen(uint32_t id) {
+    return unpack<CANMORE_EXT_MSG_LEN_OFFSET, CANMORE_MSG_LEN_LENGTH>(id);
+}
+
+constexpr uint32_t msgSubtype(uint32_t id) {
+    return unpack<CANMORE_EXT_MSG_SUBTYPE_OFFSET, CANMORE_MSG_SUBTYPE_LENGTH>(id);
+}
+
+constexpr bool msgSingle(uint32_t id) {
+    return !!unpack<CANMORE_EXT_MSG_SINGLE_OFFSET, CANMORE_MSG_SINGLE_LENGTH>(id);
+}
+
+// Make sure the helpers agree with the protocol macros
+static_assert(For<Direction::AgentToClient>::msg(21, 9) == CANMORE_CALC_MSG_ID_A2C(21, 9));
+static_assert(For<Direction::ClientToAgent>::msgExt(3, 15, 0x2BEEF) == CANMORE_CALC_MSG_EXT_ID_C2A(3, 15, 0x2BEEF));
+static_assert(For<Direction::ClientToAgent>::msgFirst(31, true, 1024, 63) ==
+              CANMORE_CALC_MSG_FIRST_ID_C2A(31, 0, true, 1024, 63));
+static_assert(For<Direction::AgentToClient>::util(7, 13) == CANMORE_CALC_UTIL_ID_A2C(7, 13));
+static_assert(msgLen(CANMORE_CALC_MSG_FIRST_ID_A2C(1, 0, false, 700, 5)) == 700);
+static_assert(msgSubtype(CANMORE_CALC_MSG_FIRST_ID_A2C(1, 0, false, 700, 5)) == 5);
+static_assert(clientId(CANMORE_CALC_MSG_EXT_ID_A2C(17, 4, 0), true) == 17);
+static_assert(noc(CANMORE_CALC_MSG_ID_C2A(17, 4), false) == 4);
+
+};  // namespace Id
+
+// ========================================
+// CAN Filter Generation
+// ========================================
+
+/**
+ * @brief Computes the socket filters to receive message frames (standard and extended) sent in the given direction
+ *
+ * @tparam Dir The direction of the frames to receive
+ * @param clientId The client ID to receive frames for
+ * @param matchClientId If false, frames from all clients are received
+ * @param matchDirection If false, frames in both directions are received (Dir is still used for the filter ID)
+ * @return std::array<can_filter, 2> The filters for standard and extended frames
+ */
+template <Direction Dir>
+constexpr std::array<can_filter, 2> msgRxFilters(uint32_t clientId, bool matchClientId = true,
+                                                 bool matchDirection = true) {
+    return { can_filter { .can_id = Id::For<Dir>::msg(clientId, 0),
+                          .can_mask = (CAN_EFF_FLAG | CAN_RTR_FLAG |
+                                       Id::std(matchClientId ? Id::bitMask(32) : 0, Id::bitMask(32),
+                                               matchDirection ? Direction::AgentToClient : Direction::ClientToAgent,
+                                               0)) },
+             can_filter { .can_id = Id::For<Dir>::msgExt(clientId, 0, 0) | CAN_EFF_FLAG,
+                          .can_mask = (CAN_EFF_FLAG | CAN_RTR_FLAG |
+                                       Id::ext(matchClientId ? Id::bitMask(32) : 0, Id::bitMask(32),
+                                               matchDirection ? Direction::AgentToClient : Direction::ClientToAgent, 0,
+                                               0)) } };
+}
+
+static_assert(msgRxFilters<Direction::AgentToClient>(5)[0].can_mask ==
+              (CAN_EFF_FLAG | CAN_RTR_FLAG | CANMORE_CALC_FILTER_MASK(1, 1, 1, 0)));
+static_assert(msgRxFilters<Direction::ClientToAgent>(0, false, false)[1].can_mask ==
+              (CAN_EFF_FLAG | CAN_RTR_FLAG | CANMORE_CALC_EXT_FILTER_MASK(0, 1, 0, 0, 0)));
+
+// ========================================
+// Mode Traits
+// ========================================
+
+/**
+ * @brief Per-mode frame size constants
+ */
+template <Mode M> struct ModeTraits;
+
+template <> struct ModeTraits<Mode::Classic> {
+    static constexpr size_t maxFrameSize = CANMORE_MAX_FRAME_SIZE;
+
+    // All lengths up to 8 are valid DLC values
+    static constexpr size_t paddedLen(size_t len) { return len; }
+};
+
+template <> struct ModeTraits<Mode::FD> {
+    static constexpr size_t maxFrameSize = CANMORE_MAX_FD_FRAME_SIZE;
+
+    // Rounds up to the next valid CAN FD frame length
+    static constexpr size_t paddedLen(size_t len) {
+        constexpr uint8_t padTable[] = { 0,  1,  2,  3,  4,  5,  6,  7,  8,  12, 12, 12, 12, 16, 16, 16, 16,
+                                         20, 20, 20, 20, 24, 24, 24, 24, 32, 32, 32, 32, 32, 32, 32, 32 };
+        return (len <= 32 ? padTable[len] : (len <= 48 ? 48 : 64));
+    }
+};
+
+// ========================================
+// CRC-18
+// ========================================
+
+namespace detail {
+
+constexpr uint32_t crc18Poly = 0x23979;
+constexpr uint32_t crc18InitialValue = 0x3FFFF;
+constexpr uint32_t crc18Mask = 0x3FFFF;
+
+constexpr std::array<uint32_t, 256> makeCrc18Table() {
+    std::array<uint32_t, 256> table {};
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i << 10;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = ((crc << 1) ^ ((crc & 0x20000) ? crc18Poly : 0)) & crc18Mask;
+        }
+        table[i] = crc;
+    }
+    return table;
+}
+
+inline constexpr std::array<uint32_t, 256> crc18Table = makeCrc18Table();
+
+// Spot check against the table in msg_encoding.c
+static_assert(crc18Table[1] == 0x23979 && crc18Table[2] == 0x24b8b && crc18Table[255] == 0x2cf7e);
+
+inline uint32_t crc18Update(uint32_t crc, const uint8_t *data, size_t len) {
+    while (len--) {
+        crc = (crc << 8) ^ crc18Table[((crc >> 10) ^ (*data++)) & 0xff];
+    }
+    return crc;
+}
+
+};  // namespace detail
+
+// ========================================
+// Encoder
+// ========================================
+
+/**
+ * @brief CANmore message encoder, equivalent to canmore_msg_encoder_t with the mode and direction fixed at compile time
+ *
+ * @tparam M The frame mode to encode for
+ * @tparam Dir The direction to encode frame IDs with
+ */
+template <Mode M, Direction Dir> class Encoder {
+public:
+    using Traits = ModeTraits<M>;
+    using Ids = Id::For<Dir>;
+
+    /**
+     * @brief Maximum frame size which can be written by next
+     */
+    static constexpr size_t maxFrameSize = Traits::maxFrameSize;
+
+    /**
+     * @brief Creates a new encoder
+     *
+     * @param clientId The client id to be used when encoding frame IDs
+     */
+    explicit Encoder(uint8_t clientId): clientId(clientId) {}
+
+    /**
+     * @brief Loads a new message into the encoder, discarding any message which has not been fully sent
+     *
+     * @attention Like canmore_msg_encode_load, data must remain valid until done returns true
+     *
+     * @param subtype The subtype for this message
+     * @param data The message data
+     */
+    void load(uint8_t subtype, std::span<const uint8_t> data) {
+        this->subtype = subtype;
+        buf = data.data();
+        length = (data.size() > CANMORE_MAX_MSG_LENGTH ? CANMORE_MAX_MSG_LENGTH : data.size());
+        position = 0;
+        seqNum = 0;
+        crc = detail::crc18InitialValue;
+    }
+
+    /**
+     * @brief Returns true if there are no remaining frames to send
+     */
+    bool done() const { return position == length; }
+
+    /**
+     * @brief Encodes the next frame, with the same semantics as canmore_msg_encode_next
+     *
+     * @param bufferOut Buffer of at least maxFrameSize bytes to write the frame data into
+     * @param lenOut Set to the frame length (including any CAN FD padding)
+     * @param idOut Set to the frame ID
+     * @param isExtended Set to true if idOut is an extended ID
+     * @return true if a frame was encoded, false if there are no remaining frames
+     */
+    bool next(uint8_t *bufferOut, uint8_t &lenOut, uint32_t &idOut, bool &isExtended) {
+        if (position == length) {
+            return false;
+        }
+
+        size_t remaining = length - position;
+        size_t copySize = (remaining > maxFrameSize ? maxFrameSize : remaining);
+        std::memcpy(bufferOut, &buf[position], copySize);
+        crc = detail::crc18Update(crc, &buf[position], copySize);
+        position += copySize;
+
+        size_t frameSize = Traits::paddedLen(copySize);
+        if constexpr (M == Mode::FD) {
+            std::memset(&bufferOut[copySize], 0, frameSize - copySize);
+        }
+        lenOut = frameSize;
+
+        bool last = (position == length);
+        if (seqNum == 0) {
+            isExtended = true;
+            idOut = Ids::msgFirst(clientId, last, length, subtype);
+        }
+        else {
+            isExtended = last;
+            idOut = (last ? Ids::msgExt(clientId, seqNum, crc & detail::crc18Mask) : Ids::msg(clientId, seqNum));
+        }
+
+        if constexpr (M == Mode::FD) {
+            // A maximum size message fits in the available sequence numbers, so no rollover can occur
+            seqNum++;
+        }
+        else {
+            // Roll over from 15 back to 1, as 0 is reserved for the first frame
+            seqNum = (seqNum % CANMORE_MAX_MSG_SEQ_NUM) + 1;
+        }
+
+        return true;
+    }
+
+private:
+    const uint8_t clientId;
+    uint8_t subtype = 0;
+    uint8_t seqNum = 0;
+    uint32_t crc = detail::crc18InitialValue;
+    const uint8_t *buf = nullptr;
+    size_t length = 0;
+    size_t position = 0;
+};
+
+static_assert(CANMORE_MAX_MSG_LENGTH <= CANMORE_MAX_FD_FRAME_SIZE * (CANMORE_MAX_MSG_SEQ_NUM + 1),
+              "CAN FD messages must not require sequence number rollover");
+
+// ========================================
+// Decoder
+// ========================================
+
+/**
+ * @brief CANmore message decoder, equivalent to canmore_msg_decoder_t with the mode and direction fixed at compile time
+ *
+ * @tparam M The frame mode to decode
+ * @tparam Dir The direction of frames received by this decoder
+ */
+template <Mode M, Direction Dir> class Decoder {
+public:
+    using Traits = ModeTraits<M>;
+
+    /**
+     * @brief Creates a new decoder
+     *
+     * @param errorHandler Callback for decode errors, or nullptr if errors should be ignored
+     * @param errorArg Argument passed to the error handler
+     */
+    Decoder(canmore_msg_decoder_error_handler_t errorHandler = nullptr, void *errorArg = nullptr):
+        errorHandler(errorHandler), errorArg(errorArg) {}
+
+    /**
+     * @brief Returns the socket filters to receive frames decoded by this decoder
+     *
+     * @param clientId The client ID to receive frames for
+     */
+    static constexpr std::array<can_filter, 2> rxFilters(uint32_t clientId) { return msgRxFilters<Dir>(clientId); }
+
+    /**
+     * @brief Sets the subtype filter, as in canmore_msg_split_decode_set_subtype_filter
+     */
+    void setSubtypeFilter(uint64_t filter) { subtypeFilter = filter; }
+
+    /**
+     * @brief Resets the decoder, discarding any partially received message
+     */
+    void reset() {
+        crc = detail::crc18InitialValue;
+        decodeLen = 0;
+        nextSeqNum = 0;
+        skipMsg = false;
+    }
+
+    /**
+     * @brief Decodes a frame, with the same semantics as canmore_msg_decode_frame
+     *
+     * @param canId The frame ID, without any CAN flags
+     * @param isExtended True if the frame has an extended ID
+     * @param frame The frame data
+     * @return size_t The length of the completed message, or 0 if no message was completed by this frame
+     */
+    size_t decodeFrame(uint32_t canId, bool isExtended, std::span<const uint8_t> frame) {
+        uint32_t seqNum = Id::noc(canId, isExtended);
+        bool isLast;
+        bool isSingle;
+        uint32_t crcExpected = UINT32_MAX;
+
+        if (seqNum == 0) {
+            if (nextSeqNum != 0) {
+                // Not expecting a new message, but we can just start fresh
+                errorAndReset(CANMORE_MSG_DECODER_ERROR_BAD_SEQ_NUM);
+            }
+
+            if (!isExtended) {
+                errorAndReset(CANMORE_MSG_DECODER_ERROR_SEQ_ZERO_NOT_EXTENDED);
+                return 0;
+            }
+
+            uint32_t msgLen = Id::msgLen(canId);
+            if (msgLen > CANMORE_MAX_MSG_LENGTH || msgLen == 0) {
+                errorAndReset(CANMORE_MSG_DECODER_ERROR_MSG_TOO_LARGE);
+                return 0;
+            }
+
+            subtype = Id::msgSubtype(canId);
+            expectedLen = msgLen;
+            skipMsg = !(subtypeFilter & CANMORE_MSG_SUBTYPE_FILTER_BIT(subtype));
+            isLast = Id::msgSingle(canId);
+            isSingle = isLast;
+        }
+        else {
+            isLast = isExtended;
+            isSingle = false;
+            if (isExtended) {
+                crcExpected = Id::extra(canId);
+            }
+
+            if (seqNum != nextSeqNum) {
+                errorAndReset(CANMORE_MSG_DECODER_ERROR_BAD_SEQ_NUM);
+                return 0;
+            }
+        }
+
+        if (frame.size() == 0) {
+            errorAndReset(CANMORE_MSG_DECODER_ERROR_ZERO_LENGTH_PACKET);
+            return 0;
+        }
+
+        // Trim padding from the last CAN FD frame, classic CAN frames are never padded
+        size_t copyLen = frame.size();
+        if (copyLen + decodeLen > expectedLen) {
+            if (M == Mode::Classic || !isLast) {
+                errorAndReset(CANMORE_MSG_DECODER_ERROR_UNEXPECTED_DATA);
+                return 0;
+            }
+            copyLen = expectedLen - decodeLen;
+        }
+
+        if (!skipMsg) {
+            if (!isSingle) {
+                crc = detail::crc18Update(crc, frame.data(), copyLen);
+            }
+            std::memcpy(&buffer[decodeLen], frame.data(), copyLen);
+        }
+        decodeLen += copyLen;
+
+        if (isLast) {
+            if (decodeLen < expectedLen) {
+                errorAndReset(CANMORE_MSG_DECODER_ERROR_MSG_TOO_SMALL);
+                return 0;
+            }
+
+            if (skipMsg) {
+                reset();
+                return 0;
+            }
+
+            if (!isSingle && (crc & detail::crc18Mask) != crcExpected) {
+                errorAndReset(CANMORE_MSG_DECODER_ERROR_CRC_FAIL);
+                return 0;
+            }
+
+            size_t decodedLen = decodeLen;
+            reset();
+            return decodedLen;
+        }
+
+        if (decodeLen >= expectedLen) {
+            errorAndReset(CANMORE_MSG_DECODER_ERROR_MSG_TOO_LARGE);
+            return 0;
+        }
+
+        if constexpr (M == Mode::FD) {
+            // Rollover is not permitted in CAN FD mode, since it should fit the full message
+            if (nextSeqNum >= CANMORE_MAX_MSG_SEQ_NUM) {
+                errorAndReset(CANMORE_MSG_DECODER_ERROR_ROLLOVER_WITH_CANFD);
+                return 0;
+            }
+            nextSeqNum++;
+        }
+        else {
+            nextSeqNum = (nextSeqNum % CANMORE_MAX_MSG_SEQ_NUM) + 1;
+        }
+
+        return 0;
+    }
+
+    /**
+     * @brief Returns the subtype of the last decoded message
+     */
+    uint8_t getSubtype() const { return subtype; }
+
+    /**
+     * @brief Returns the buffer holding the last decoded message
+     */
+    const uint8_t *getBuf() const { return buffer.data(); }
+
+private:
+    void errorAndReset(unsigned int errorCode) {
+        if (errorHandler) {
+            errorHandler(errorArg, errorCode);
+        }
+        reset();
+    }
+
+    canmore_msg_decoder_error_handler_t errorHandler;
+    void *errorArg;
+    uint64_t subtypeFilter = CANMORE_MSG_SUBTYPE_FILTER_ALL;
+    uint32_t crc = detail::crc18InitialValue;
+    uint16_t expectedLen = 0;
+    uint16_t decodeLen = 0;
+    uint8_t nextSeqNum = 0;
+    uint8_t subtype = 0;
+    bool skipMsg = false;
+    std::array<uint8_t, CANMORE_MAX_MSG_LENGTH> buffer;
+};
+
+};  // namespace Canmore::Codec
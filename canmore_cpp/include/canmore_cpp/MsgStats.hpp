@@ -0,0 +1,146 @@
+#pragma once
+
+#include "canmore/msg_encoding.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace Canmore {
+
+/**
+ * @brief Number of buckets in the message reassembly time histogram.
+ *
+ * Bucket 0 holds messages reassembled in under 2 us, bucket n holds messages which took [2^n, 2^(n+1)) us, and the
+ * last bucket holds everything longer than that.
+ */
+#define CANMORE_MSG_STATS_NUM_HIST_BUCKETS 20
+
+/**
+ * @brief Point in time copy of the counters in a MsgStats block
+ */
+struct MsgStatsSnapshot {
+    // Receive counters
+    uint64_t framesRx = 0;       // Message frames received
+    uint64_t frameBytesRx = 0;   // Data bytes in all message frames received
+    uint64_t messagesRx = 0;     // Messages successfully reassembled
+    uint64_t msgBytesRx = 0;     // Data bytes in all messages successfully reassembled
+    uint64_t conflictingAgent = 0;  // Frames seen from another agent on the bus
+
+    // Decode errors, indexed by CANMORE_MSG_DECODER_ERROR_* code
+    std::array<uint64_t, CANMORE_MSG_DECODER_NUM_ERRORS> decodeErrors = {};
+
+    // Transmit counters
+    uint64_t framesTx = 0;      // Message frames transmitted
+    uint64_t frameBytesTx = 0;  // Data bytes in all message frames transmitted (including CAN FD padding)
+    uint64_t messagesTx = 0;    // Messages transmitted
+    uint64_t msgBytesTx = 0;    // Data bytes in all messages transmitted
+
+    // Histogram of time between the first and last frame of received messages (see CANMORE_MSG_STATS_NUM_HIST_BUCKETS)
+    std::array<uint64_t, CANMORE_MSG_STATS_NUM_HIST_BUCKETS> reassemblyTimeHist = {};
+
+    /**
+     * @brief Returns the sum of all decode errors in this snapshot
+     */
+    uint64_t totalDecodeErrors() const;
+
+    /**
+     * @brief Adds all of the counters of another snapshot into this snapshot
+     */
+    MsgStatsSnapshot &operator+=(const MsgStatsSnapshot &other);
+};
+
+/**
+ * @brief Block of lock-free message statistics counters.
+ *
+ * All counters are relaxed atomics, so the receive and transmit paths never block, and a monitoring thread can call
+ * snapshot() at any time. Note that as the counters are not read together atomically, a snapshot taken while traffic is
+ * flowing may have counters which are off by the few events which were in progress while it was taken.
+ */
+class MsgStats {
+public:
+    MsgStats() { reset(); }
+
+    // Disable copying, as all data is atomics. Use snapshot() instead
+    MsgStats(MsgStats const &) = delete;
+    MsgStats &operator=(MsgStats const &) = delete;
+
+    /**
+     * @brief Copies all counters into a snapshot. Safe to call from any thread
+     */
+    MsgStatsSnapshot snapshot() const;
+
+    /**
+     * @brief Zeros all counters. Safe to call from any thread
+     */
+    void reset();
+
+    /*
+     * Counter update functions, called by the message agent/client
+     */
+
+    // Reports a received frame. firstFrame should be set if the frame is the first frame in the message
+    void countFrameRx(size_t len, bool firstFrame) {
+        increment(framesRx);
+        increment(frameBytesRx, len);
+        if (firstFrame) {
+            msgStartTime = std::chrono::steady_clock::now();
+        }
+    }
+
+    // Reports a successfully reassembled message, recording its reassembly time
+    void countMessageRx(size_t len) {
+        increment(messagesRx);
+        increment(msgBytesRx, len);
+
+        auto elapsed = std::chrono::steady_clock::now() - msgStartTime;
+        increment(reassemblyTimeHist[histogramBucket(
+            std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count())]);
+    }
+
+    void countDecodeError(unsigned int errorCode) {
+        if (errorCode < decodeErrors.size()) {
+            increment(decodeErrors[errorCode]);
+        }
+    }
+
+    void countConflictingAgent() { increment(conflictingAgent); }
+
+    void countFrameTx(size_t len) {
+        increment(framesTx);
+        increment(frameBytesTx, len);
+    }
+
+    void countMessageTx(size_t len) {
+        increment(messagesTx);
+        increment(msgBytesTx, len);
+    }
+
+private:
+    typedef std::atomic<uint64_t> Counter;
+
+    static void increment(Counter &counter, uint64_t amount = 1) {
+        counter.fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    // Computes the histogram bucket for the reassembly time in microseconds
+    static size_t histogramBucket(int64_t elapsedUs);
+
+    Counter framesRx;
+    Counter frameBytesRx;
+    Counter messagesRx;
+    Counter msgBytesRx;
+    Counter conflictingAgent;
+    std::array<Counter, CANMORE_MSG_DECODER_NUM_ERRORS> decodeErrors;
+    Counter framesTx;
+    Counter frameBytesTx;
+    Counter messagesTx;
+    Counter msgBytesTx;
+    std::array<Counter, CANMORE_MSG_STATS_NUM_HIST_BUCKETS> reassemblyTimeHist;
+
+    // Time the first frame of the current message was received. Only accessed from the receive path
+    std::chrono::steady_clock::time_point msgStartTime;
+};
+
+};  // namespace Canmore
@@ -0,0 +1,151 @@
+#pragma once
+
+#include "canmore_cpp/MsgAgent.hpp"
+#include "canmore_cpp/MsgClient.hpp"
+#include "canmore_cpp/PollFD.hpp"
+#include "canmore_cpp/span_compat.hpp"
+
+#include "canmore/msg_transfer.h"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace Canmore {
+
+/**
+ * @brief Sends and receives payloads larger than CANMORE_MAX_MSG_LENGTH with a single peer, using large transfers
+ * (see canmore/msg_transfer.h).
+ *
+ * The transfer subscribes to CANMORE_MSG_SUBTYPE_TRANSFER on the agent or client it is created with, so that subtype
+ * must not be subscribed elsewhere. Transfers are driven by the replies from the peer, with a timerfd used to recover
+ * from lost replies, so this must be added to the same PollGroup as the agent or client.
+ */
+class MsgTransfer : public PollFDHandler {
+public:
+    /**
+     * @brief Callback for a completed incoming transfer
+     *
+     * @param subtype The subtype the payload was sent with
+     * @param data The payload. Only valid for the duration of the callback
+     */
+    typedef std::function<void(uint8_t subtype, std::span<const uint8_t> data)> ReceiveCB;
+
+    /**
+     * @brief Callback for when an outgoing transfer finishes
+     *
+     * @param success True if the peer received the whole payload, false if it was aborted or timed out
+     */
+    typedef std::function<void(bool success)> CompleteCB;
+
+    /**
+     * @brief Creates a transfer endpoint on the agent for the given client
+     *
+     * @param agent The agent to communicate through. Must outlive this object
+     * @param clientId The client to transfer with
+     * @param maxRxLength The largest incoming payload to accept. The receive buffer is allocated up front
+     * @param window The number of bytes the peer may send before waiting for an ACK
+     */
+    MsgTransfer(MsgAgentBase &agent, uint8_t clientId, size_t maxRxLength = CANMORE_MSG_TRANSFER_MAX_LENGTH,
+                uint16_t window = defaultWindow);
+
+    /**
+     * @brief Creates a transfer endpoint on the client for the agent
+     *
+     * @param client The client to communicate through. Must outlive this object
+     * @param maxRxLength The largest incoming payload to accept. The receive buffer is allocated up front
+     * @param window The number of bytes the peer may send before waiting for an ACK
+     */
+    MsgTransfer(MsgClientBase &client, size_t maxRxLength = CANMORE_MSG_TRANSFER_MAX_LENGTH,
+                uint16_t window = defaultWindow);
+    ~MsgTransfer();
+
+    // Disabling copying (since we have a file discriptor and subscription)
+    MsgTransfer(MsgTransfer const &) = delete;
+    MsgTransfer &operator=(MsgTransfer const &) = delete;
+
+    /**
+     * @brief Sets the callback for completed incoming transfers
+     */
+    void setReceiveCallback(ReceiveCB callback) { receiveCallback = callback; }
+
+    /**
+     * @brief Starts sending a payload to the peer, cancelling any transfer in progress
+     *
+     * @param subtype The subtype to deliver the payload with (must not be CANMORE_MSG_SUBTYPE_TRANSFER)
+     * @param data The payload, up to CANMORE_MSG_TRANSFER_MAX_LENGTH bytes. This is copied, and does not need to
+     * remain valid
+     * @param onComplete Optional callback for when the transfer finishes
+     */
+    void send(uint8_t subtype, std::span<const uint8_t> data, CompleteCB onComplete = nullptr);
+
+    /**
+     * @brief Cancels the outgoing transfer in progress. The completion callback is not called
+     */
+    void cancel();
+
+    /**
+     * @brief Returns true if an outgoing transfer is in progress
+     */
+    bool busy() const { return canmore_msg_transfer_tx_get_status(&txState) == CANMORE_MSG_TRANSFER_STATUS_ACTIVE; }
+
+    /**
+     * @brief Sets how long to wait for a reply before resending, and how many times to resend before giving up
+     */
+    void setTimeout(std::chrono::milliseconds timeout, unsigned int maxRetries) {
+        this->timeout = timeout;
+        this->maxRetries = maxRetries;
+    }
+
+    /**
+     * @brief Sets the maximum payload carried in each message of an outgoing transfer. Applies to the next send
+     */
+    void setChunkSize(size_t chunkSize) { this->chunkSize = chunkSize; }
+
+    void populateFds(std::vector<std::weak_ptr<PollFDDescriptor>> &descriptors) override;
+
+    // Default window, large enough for several full chunks to be in flight
+    static constexpr uint16_t defaultWindow = 4 * CANMORE_MSG_TRANSFER_MAX_CHUNK_SIZE;
+
+protected:
+    void handleEvent(const pollfd &fd) override;
+
+private:
+    MsgTransfer(std::function<void(std::span<const uint8_t>)> transmit, size_t maxRxLength, uint16_t window);
+
+    // Processes a CANMORE_MSG_SUBTYPE_TRANSFER message from the peer
+    void handleTransferMessage(std::span<const uint8_t> data);
+
+    // Transmits every message the window allows, then rearms the timeout
+    void pumpTx();
+
+    // Ends the outgoing transfer if it has finished, calling the completion callback
+    void checkTxDone();
+
+    // Arms the timeout timer, or disarms it if no outgoing transfer is in progress
+    void updateTimer();
+
+    std::function<void(std::span<const uint8_t>)> transmit;  // Sends a message with the transfer subtype to the peer
+    std::function<void()> unsubscribe;                        // Removes the subscription on the agent/client
+
+    canmore_msg_transfer_tx_t txState;
+    std::vector<uint8_t> txData;
+    CompleteCB completeCallback;
+    std::vector<uint8_t> txMsgBuf;
+
+    canmore_msg_transfer_rx_t rxState;
+    std::vector<uint8_t> rxBuffer;
+    ReceiveCB receiveCallback;
+
+    size_t chunkSize = CANMORE_MSG_TRANSFER_MAX_CHUNK_SIZE;
+    std::chrono::milliseconds timeout = std::chrono::milliseconds(250);
+    unsigned int maxRetries = 4;
+    unsigned int retries = 0;
+
+    int timerFd;
+    std::shared_ptr<PollFDDescriptor> timerPollDescriptor;
+};
+
+};  // namespace Canmore
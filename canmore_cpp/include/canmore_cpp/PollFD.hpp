@@ -80,8 +80,11 @@ public:
  *
  * Whenever a fd has an event, handleEvent is called. This class, by default, is also a PollFD as it must be able to
  * provide the fds it owns to the PollGroup.
+ *
+ * PollFD is inherited virtually, so that interface classes which are PollFDs (such as MsgAgentBase) can be combined
+ * with a PollFDHandler implementation without creating two PollFD bases.
  */
-class PollFDHandler : public PollFD {
+class PollFDHandler : public virtual PollFD {
     friend class PollGroup;
 
 protected:
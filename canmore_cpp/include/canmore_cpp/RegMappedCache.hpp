@@ -0,0 +1,153 @@
+#pragma once
+
+#include "canmore_cpp/RegMappedClient.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace Canmore {
+
+/**
+ * @brief Caches register values read from and written to a register mapped client for a single mode.
+ *
+ * Each page is given a policy controlling how its registers are cached. Reads of cached registers are served without
+ * a round trip, and writes to cacheable pages are held in a dirty range for that page. Writes to adjacent offsets are
+ * combined into the dirty range, which is sent as a single array write (using multiword or bulk transfers if the client
+ * supports them) when flushed. Writes of the value already cached are skipped.
+ *
+ * Pending writes are flushed before any other access goes to the client, so the device sees accesses in the order they
+ * were made. They are also flushed once the flush delay has passed since the first pending write, checked whenever the
+ * cache is accessed or flushIfDue is called.
+ */
+class RegMappedCache {
+public:
+    /**
+     * @brief How the registers in a page are cached
+     */
+    enum class Policy {
+        Volatile,   // Never cached. Reads and writes go straight to the client (the default for all pages)
+        Immutable,  // Read once and cached until invalidated (such as version or ID registers)
+        Cacheable   // Cached until the page's TTL expires, with writes combined into dirty ranges
+    };
+
+    /**
+     * @brief Creates a new cache over the given client
+     *
+     * @param client The client to access registers through
+     * @param mode The control interface mode to access the registers with
+     * @param flushDelay The maximum time a write is held before being flushed
+     */
+    RegMappedCache(std::shared_ptr<RegMappedClient> client, uint8_t mode,
+                   std::chrono::milliseconds flushDelay = std::chrono::milliseconds(50));
+
+    /**
+     * @brief Flushes pending writes. Errors are ignored, so flush should be called first if they must be reported
+     */
+    ~RegMappedCache();
+
+    // Disabling copying (since pending writes would be flushed twice)
+    RegMappedCache(RegMappedCache const &) = delete;
+    RegMappedCache &operator=(RegMappedCache const &) = delete;
+
+    /**
+     * @brief Sets the caching policy for a page, invalidating any values cached for it
+     *
+     * @param page The page to configure
+     * @param policy The policy for registers in the page
+     * @param ttl How long values in a Policy::Cacheable page remain valid after being read or written
+     */
+    void setPagePolicy(uint8_t page, Policy policy, std::chrono::milliseconds ttl = std::chrono::milliseconds(1000));
+
+    /**
+     * @brief Reads a register, returning the cached value if one is valid
+     */
+    uint32_t readRegister(uint8_t page, uint8_t offset);
+
+    /**
+     * @brief Reads an array of words from a page, only reading the range of words not validly cached from the client
+     */
+    void readArray(uint8_t page, uint8_t offsetStart, std::vector<uint32_t> &dst, unsigned int numWords);
+
+    /**
+     * @brief Writes a register. Writes to Policy::Cacheable pages are held until flushed, other writes are sent
+     * immediately (after flushing any pending writes)
+     */
+    void writeRegister(uint8_t page, uint8_t offset, uint32_t data);
+
+    /**
+     * @brief Writes an array of words to a page, in the same way as writeRegister
+     */
+    void writeArray(uint8_t page, uint8_t offsetStart, const std::vector<uint32_t> &data);
+
+    /**
+     * @brief Sends all pending writes to the client, in the order the pages were first written
+     */
+    void flush();
+
+    /**
+     * @brief Flushes pending writes if the flush delay has elapsed since the first pending write
+     */
+    void flushIfDue();
+
+    /**
+     * @brief Sets the maximum time a write is held before being flushed
+     */
+    void setFlushDelay(std::chrono::milliseconds flushDelay) { this->flushDelay = flushDelay; }
+
+    /**
+     * @brief Discards the values cached for a page. Pending writes are kept
+     */
+    void invalidate(uint8_t page);
+
+    /**
+     * @brief Discards all cached values. Pending writes are kept
+     */
+    void invalidateAll();
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct CachedRegister {
+        uint32_t value = 0;
+        bool valid = false;
+        Clock::time_point expiry;
+    };
+
+    struct PageState {
+        Policy policy = Policy::Volatile;
+        std::chrono::milliseconds ttl = std::chrono::milliseconds(0);
+        std::array<CachedRegister, REG_MAPPED_PAGE_NUM_WORDS> regs;
+
+        // Offsets [dirtyStart, dirtyEnd) hold writes which have not been sent to the client
+        unsigned int dirtyStart = 0;
+        unsigned int dirtyEnd = 0;
+        bool isDirty() const { return dirtyEnd > dirtyStart; }
+    };
+
+    // Returns the page state, creating a volatile page if it has not been configured
+    PageState &getPage(uint8_t page);
+
+    // Returns true if the register holds a value that can be returned without reading from the client
+    bool isFresh(const PageState &state, uint8_t offset, Clock::time_point now) const;
+
+    // Stores a value read from or written to the client
+    void storeValue(PageState &state, uint8_t offset, uint32_t value, Clock::time_point now);
+
+    // Sends the dirty range for the page to the client
+    void flushPage(uint8_t page, PageState &state);
+
+    std::shared_ptr<RegMappedClient> client;
+    const uint8_t mode;
+    std::chrono::milliseconds flushDelay;
+
+    std::unordered_map<uint8_t, PageState> pages;
+    std::list<uint8_t> dirtyPages;  // Pages with pending writes, in the order they were first written
+    Clock::time_point flushDeadline;
+};
+
+};  // namespace Canmore
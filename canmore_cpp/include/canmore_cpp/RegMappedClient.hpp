@@ -2,6 +2,7 @@
 
 #include "CANSocket.hpp"
 #include "Canmore.hpp"
+#include "MsgAgent.hpp"
 #include "SocketSingleton.hpp"
 #include "canmore_cpp/span_compat.hpp"
 
@@ -9,8 +10,14 @@
 #include "canmore/reg_mapped/client.h"
 
 #include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -19,6 +26,7 @@
 #define REG_MAPPED_TIMEOUT_MS 1000
 #define REG_MAPPED_MAX_IN_FLIGHT_PACKETS_CAN 32  // Matches config stored in CAN bus (32 frame long FIFO)
 #define REG_MAPPED_MAX_IN_FLIGHT_PACKETS_ETH 8
+#define REG_MAPPED_MAX_IN_FLIGHT_PACKETS_MSG 4  // Each message may be up to a kilobyte, so keep few buffered on the client
 
 namespace Canmore {
 
@@ -36,6 +44,30 @@ public:
                      ", length: " + std::to_string(length) + "): " + lookupError(errorCode)),
         errorCode(errorCode) {}
 
+    RegMappedClientError(int errorCode, uint8_t mode, uint8_t page, uint8_t offset, uint8_t length,
+                         uint8_t errorOffset, bool isWrite):
+        CanmoreError(std::string("Register Mapped Access Error (Array ") + (isWrite ? "Write" : "Read") + " - mode: " +
+                     lookupMode(mode) + ", page: " + std::to_string(page) + ", offset: " + std::to_string(offset) +
+                     ", length: " + std::to_string(length) + ", failed at offset: " + std::to_string(errorOffset) +
+                     "): " + lookupError(errorCode)),
+        errorCode(errorCode) {}
+
+    RegMappedClientError(int errorCode, uint8_t mode, uint8_t page, uint8_t offset, size_t length, uint8_t errorPage,
+                         uint8_t errorOffset, bool isWrite):
+        CanmoreError(std::string("Register Mapped Access Error (Region ") + (isWrite ? "Write" : "Read") + " - mode: " +
+                     lookupMode(mode) + ", page: " + std::to_string(page) + ", offset: " + std::to_string(offset) +
+                     ", length: " + std::to_string(length) + ", failed at page: " + std::to_string(errorPage) +
+                     ", offset: " + std::to_string(errorOffset) + "): " + lookupError(errorCode)),
+        errorCode(errorCode) {}
+
+    RegMappedClientError(int errorCode, uint8_t mode, size_t entry, size_t numEntries, uint8_t page, uint8_t offset,
+                         bool isWrite):
+        CanmoreError(std::string("Register Mapped Access Error (Batch ") + (isWrite ? "Write" : "Read") + " - mode: " +
+                     lookupMode(mode) + ", entry: " + std::to_string(entry) + " of " + std::to_string(numEntries) +
+                     ", page: " + std::to_string(page) + ", offset: " + std::to_string(offset) +
+                     "): " + lookupError(errorCode)),
+        errorCode(errorCode) {}
+
     RegMappedClientError(int errorCode, uint8_t mode, uint8_t page):
         CanmoreError("Register Mapped Access Error (String Access - mode: " + lookupMode(mode) +
                      ", page: " + std::to_string(page) + "): " + lookupError(errorCode)),
@@ -64,6 +96,7 @@ private:
         REG_MAPPED_ERR_DEF(REG_MAPPED_RESULT_INVALID_MODE)
         REG_MAPPED_ERR_DEF(REG_MAPPED_RESULT_MULTIWORD_UNSUPPORTED)
         REG_MAPPED_ERR_DEF(REG_MAPPED_RESULT_MULTIWORD_TOO_LARGE)
+        REG_MAPPED_ERR_DEF(REG_MAPPED_RESULT_SUBSCRIPTION_UNAVAILABLE)
 
         REG_MAPPED_ERR_DEF(REG_MAPPED_CLIENT_RESULT_TX_FAIL)
         REG_MAPPED_ERR_DEF(REG_MAPPED_CLIENT_RESULT_RX_FAIL)
@@ -90,8 +123,42 @@ private:
     }
 };
 
+/**
+ * @brief Base class for register mapped clients.
+ *
+ * Clients are safe to use from multiple threads. Each access is performed as a transaction on the client, with
+ * transactions run one at a time in the order they were requested. Array reads and writes are split into transactions
+ * of at most the transaction chunk size, so short accesses from other threads are interleaved between the chunks of a
+ * long transfer rather than waiting for the entire transfer.
+ */
 class RegMappedClient {
 public:
+    /**
+     * @brief Callback for a posted write which failed
+     *
+     * @param page The page of the register which failed to be written
+     * @param offset The offset of the register which failed to be written
+     * @param errorCode The error code for the write
+     */
+    typedef std::function<void(uint8_t page, uint8_t offset, int errorCode)> PostedErrorCB;
+
+    /**
+     * @brief A read or write of sequential registers in a batch transaction (see transact)
+     */
+    struct BatchEntry {
+        bool isWrite;
+        uint8_t page;
+        uint8_t offset;
+        std::vector<uint32_t> data;  // The words to write, or the words read once the transaction completes
+
+        static BatchEntry read(uint8_t page, uint8_t offset, unsigned int count = 1) {
+            return BatchEntry { false, page, offset, std::vector<uint32_t>(count) };
+        }
+        static BatchEntry write(uint8_t page, uint8_t offset, std::vector<uint32_t> data) {
+            return BatchEntry { true, page, offset, std::move(data) };
+        }
+    };
+
     virtual ~RegMappedClient() = 0;
 
     uint32_t readRegister(uint8_t mode, uint8_t page, uint8_t offset);
@@ -101,8 +168,117 @@ public:
     void writeStringPage(uint8_t mode, uint8_t page, const std::string &data);
     std::string readStringPage(uint8_t mode, uint8_t page);
 
+    /**
+     * @brief Reads a region of words which may span several pages, using the addresses from
+     * REG_MAPPED_CLIENT_REGION_ADDR. Requests are pipelined across page boundaries
+     */
+    void readRegion(uint8_t mode, uint32_t addrStart, std::vector<uint32_t> &dst, size_t numWords);
+
+    /**
+     * @brief Writes a region of words which may span several pages, in the same way as readRegion
+     */
+    void writeRegion(uint8_t mode, uint32_t addrStart, const std::vector<uint32_t> &data);
+
+    /**
+     * @brief Performs a list of reads and writes, each to any page, as a single transaction. On transports supporting
+     * multiword requests, the batch is sent in as few round trips as fit in a request. Entries are performed in order,
+     * stopping at the first failure, which is thrown as RegMappedClientError.
+     * Unlike array transfers, the batch isn't split into chunks, so keep batches short.
+     */
+    void transact(uint8_t mode, std::vector<BatchEntry> &batch);
+
+    /**
+     * @brief Writes a register without waiting for the response. Only blocks if the maximum number of writes are
+     * already in flight.
+     * Failed writes are reported to the posted error callback and by the next call to sync. Any other access waits for
+     * the responses to all posted writes first.
+     */
+    void postWriteRegister(uint8_t mode, uint8_t page, uint8_t offset, uint32_t data);
+
+    /**
+     * @brief Waits for the responses to all posted writes, throwing RegMappedClientError for the first write which
+     * failed since the last sync
+     */
+    void sync();
+
+    /**
+     * @brief Subscribes to changes of up to REG_MAPPED_SUBSCRIPTION_MAX_WORDS sequential registers, replacing any
+     * subscription starting at the same register. The server then pushes notifications for the registers, which are
+     * received with a RegMappedNotificationListener, instead of the registers being polled.
+     *
+     * @param intervalMs The minimum interval between the server sampling the registers
+     * @param threshold The change in value required to send a notification (0 to notify any change)
+     */
+    void subscribe(uint8_t mode, uint8_t page, uint8_t offset, uint8_t count, uint16_t intervalMs,
+                   uint16_t threshold = 0);
+
+    /**
+     * @brief Removes the subscription starting at the given register
+     */
+    void unsubscribe(uint8_t mode, uint8_t page, uint8_t offset);
+
+    /**
+     * @brief Sets the callback for each posted write which fails. Errors are still reported by sync
+     * The callback is called from whichever thread is accessing the client when the response is received. This waits
+     * for any access in progress, so it must not be called from the callback itself
+     */
+    void setPostedErrorCallback(PostedErrorCB callback);
+
+    /**
+     * @brief Sets the maximum number of words transferred by a single transaction during array reads and writes.
+     * Smaller values let other threads access the client sooner during long transfers, at the cost of throughput.
+     * Transfers already in progress keep the chunk size they started with. Each transport defaults to enough words to
+     * fill every request it keeps in flight, so this only needs lowering to let other threads in sooner.
+     */
+    void setTransactionChunkWords(unsigned int words) { transactionChunkWords = (words > 0 ? words : 1); }
+
 protected:
+    RegMappedClient();
     reg_mapped_client_cfg_t clientCfg;
+
+    /**
+     * @brief Sets the transaction chunk size to fill every request the transport keeps in flight.
+     * Called by each transport once clientCfg is configured.
+     */
+    void setDefaultTransactionChunkWords();
+
+private:
+    /**
+     * @brief Holds exclusive access to the client for the lifetime of the object.
+     * Threads are granted access in the order they requested it (a ticket lock), so a thread looping over transactions
+     * can't starve other threads waiting for the client.
+     */
+    class Transaction {
+    public:
+        Transaction(RegMappedClient &client);
+        ~Transaction();
+
+        Transaction(Transaction const &) = delete;
+        Transaction &operator=(Transaction const &) = delete;
+
+    private:
+        RegMappedClient &client;
+    };
+
+    std::mutex transactionLock;               // Protects the ticket counters
+    std::condition_variable transactionCond;  // Signalled when the ticket being served changes
+    uint64_t transactionNextTicket = 0;       // The ticket to give the next thread requesting access
+    uint64_t transactionServing = 0;          // The ticket which currently has access
+    std::atomic<unsigned int> transactionChunkWords = 64;  // Read outside of transactions, between chunks
+
+    // Waits for the responses to all posted writes so that another request can be made
+    void drainPostedWrites() { reg_mapped_client_posted_drain(&clientCfg, &postedWrites); }
+
+    static void postedErrorCB(uint8_t page, uint8_t offset, int result, void *arg) {
+        auto inst = (RegMappedClient *) arg;
+        if (inst->postedErrorCallback) {
+            inst->postedErrorCallback(page, offset, result);
+        }
+    }
+
+    reg_mapped_client_posted_writes_t postedWrites;
+    PostedErrorCB postedErrorCallback;
+    uint8_t postedMode = 0;  // The mode of the most recent posted write, for reporting errors
 };
 
 class RegisterPage {
@@ -172,17 +348,11 @@ private:
     // static std::unordered_map<CANSocketKey,std::weak_ptr<RegMappedCANClient>,CANSocketKeyHasher> clients;
     RegMappedCANClient(int ifIndex, uint8_t clientId, uint8_t channel);
 
-    // This will hold the received id and data from the frame during the CANSocket frame callback
-    std::shared_ptr<std::pair<canid_t, std::vector<uint8_t>>> frameMailbox;
+    // This will hold the received ids and data from the frames during the CANSocket frame callback
+    // Several frames can be received in a single event loop when responses to pipelined bulk reads arrive together
+    std::deque<std::pair<canid_t, std::vector<uint8_t>>> frameMailbox;
     void handleFrame(canid_t can_id, const std::span<const uint8_t> &data) {
-        if (frameMailbox) {
-            // If this has data, then we somehow got handleFrame twice before the mailbox was flushed
-            // This shouldn't be possible as the poll is only ran for one event loop
-            throw std::logic_error("Packet mailbox already has a frame in it");
-        }
-        frameMailbox = std::make_shared<std::pair<canid_t, std::vector<uint8_t>>>();
-        frameMailbox->first = can_id;
-        frameMailbox->second.assign(data.begin(), data.end());
+        frameMailbox.emplace_back(can_id, std::vector<uint8_t>(data.begin(), data.end()));
     }
 
     // Function Callbacks
@@ -196,6 +366,7 @@ private:
     static bool clearRxCB(void *arg) {
         auto inst = (RegMappedCANClient *) arg;
         inst->clearRxBuffer();
+        inst->frameMailbox.clear();
         return true;
     }
 
@@ -210,6 +381,86 @@ public:
     RegMappedCANClient &operator=(RegMappedCANClient const &) = delete;
 };
 
+// ========================================
+// CANmore Messages
+// ========================================
+
+struct MsgAgentKey {
+    MsgAgentBase *agent;
+    uint8_t clientId;
+
+    MsgAgentKey(MsgAgentBase &agent, uint8_t clientId): agent(&agent), clientId(clientId) {}
+
+    bool operator==(const MsgAgentKey &other) const { return (agent == other.agent && clientId == other.clientId); }
+};
+
+struct MsgAgentKeyHasher {
+    std::size_t operator()(const MsgAgentKey &k) const {
+        using std::hash;
+
+        return hash<MsgAgentBase *>()(k.agent) ^ (((std::size_t) k.clientId) << 1);
+    }
+};
+
+/**
+ * @brief Register mapped client carried over CANmore messages on an existing agent (see Message Binding in
+ * canmore/reg_mapped/protocol.h).
+ *
+ * Requests are sent as multiword requests of up to CANMORE_MAX_MSG_LENGTH bytes, so an entire page can be read or
+ * written in a couple of requests even on classic CAN.
+ *
+ * @attention The client polls the agent itself while waiting for responses, so the agent must not be polled from
+ * another thread while the client is in use. Messages of other subtypes received while waiting are still sent to the
+ * agent's handler/subscriptions.
+ */
+class RegMappedMsgClient :
+    public RegMappedClient,
+    public SocketSingleton<RegMappedMsgClient, MsgAgentKey, MsgAgentKeyHasher> {
+public:
+    friend class SocketSingleton<RegMappedMsgClient, MsgAgentKey, MsgAgentKeyHasher>;
+    // The client subscribes to CANMORE_MSG_SUBTYPE_REG_MAPPED on the agent, so there can only be one per client per
+    // agent. The agent must outlive the client
+
+    ~RegMappedMsgClient();
+
+    // Configured clientId
+    const uint8_t clientId;
+
+private:
+    RegMappedMsgClient(MsgAgentBase &agent, uint8_t clientId);
+
+    MsgAgentBase &agent;
+    PollGroup pollGroup;
+
+    // Responses received from the client, in the order they arrived
+    std::deque<std::vector<uint8_t>> msgMailbox;
+    std::vector<uint8_t> multiwordScratch;
+
+    // Function Callbacks
+    bool clientTx(const uint8_t *buf, size_t len);
+    bool clientRx(uint8_t *buf, size_t len, unsigned int timeoutMs);
+    bool clearRx(void);
+
+    static bool clientRxCB(uint8_t *buf, size_t len, unsigned int timeout, void *arg) {
+        auto inst = (RegMappedMsgClient *) arg;
+        return inst->clientRx(buf, len, timeout);
+    }
+
+    static bool clearRxCB(void *arg) {
+        auto inst = (RegMappedMsgClient *) arg;
+        return inst->clearRx();
+    }
+
+    static bool clientTxCB(const uint8_t *buf, size_t len, void *arg) {
+        auto inst = (RegMappedMsgClient *) arg;
+        return inst->clientTx(buf, len);
+    }
+
+public:
+    RegMappedMsgClient(RegMappedMsgClient const &) = delete;
+    RegMappedMsgClient &operator=(RegMappedMsgClient const &) = delete;
+};
+
 // ========================================
 // Ethernet
 // ========================================
@@ -281,4 +532,108 @@ public:
     RegMappedEthernetClient &operator=(RegMappedEthernetClient const &) = delete;
 };
 
+// ========================================
+// Subscription Notifications
+// ========================================
+
+/**
+ * @brief Receives notifications for registers subscribed to with RegMappedClient::subscribe, keeping a snapshot of the
+ * latest value of each notified register.
+ *
+ * Notifications are received from the transport's event loop, while snapshots may be read from any thread.
+ */
+class RegMappedNotificationListener {
+public:
+    /**
+     * @brief Callback for each notification received
+     *
+     * @param page The page of the first register in the notification
+     * @param offset The offset of the first register in the notification
+     * @param result The result of sampling the registers. values is empty unless this is REG_MAPPED_RESULT_SUCCESSFUL
+     * @param values The values of the registers, starting at offset
+     */
+    typedef std::function<void(uint8_t page, uint8_t offset, int result, const std::vector<uint32_t> &values)>
+        NotificationCB;
+
+    /**
+     * @brief The latest notification for a single register
+     */
+    struct RegisterSnapshot {
+        uint32_t value;                                 // The last value notified
+        int result;                                     // The result of the last notification for this register
+        std::chrono::steady_clock::time_point updated;  // When the last notification was received
+    };
+
+    virtual ~RegMappedNotificationListener() = 0;
+
+    /**
+     * @brief Gets the latest notification for the given register.
+     * As the server notifies every subscribed register at least every REG_MAPPED_SUBSCRIPTION_KEEPALIVE_MS, a snapshot
+     * older than that means the subscription has been lost (such as by the server resetting) and should be renewed.
+     *
+     * @return true A notification has been received for this register, and was stored in snapshotOut
+     * @return false No notification has been received for this register yet
+     */
+    bool getSnapshot(uint8_t page, uint8_t offset, RegisterSnapshot &snapshotOut);
+
+    /**
+     * @brief Sets the callback for each notification received. This is called from the transport's event loop
+     */
+    void setCallback(NotificationCB callback);
+
+protected:
+    RegMappedNotificationListener() {}
+
+    /**
+     * @brief Parses the notification, updating snapshots and calling the notification callback
+     *
+     * @param data The notification received from the server
+     */
+    void handleNotification(const std::span<const uint8_t> &data);
+
+private:
+    std::mutex snapshotLock;  // Protects snapshots and callback
+    std::unordered_map<uint16_t, RegisterSnapshot> snapshots;
+    NotificationCB callback;
+
+public:
+    RegMappedNotificationListener(RegMappedNotificationListener const &) = delete;
+    RegMappedNotificationListener &operator=(RegMappedNotificationListener const &) = delete;
+};
+
+/**
+ * @brief Receives notifications from a register mapped server on the CAN bus. This must be added to a PollGroup for
+ * notifications to be received
+ */
+class RegMappedCANNotificationListener : public CANSocket, public RegMappedNotificationListener {
+public:
+    RegMappedCANNotificationListener(int ifIndex, uint8_t clientId,
+                                     uint8_t notifyChannel = CANMORE_CHAN_CONTROL_INTERFACE_NOTIFY);
+
+    // Configured clientId and channel
+    const uint8_t clientId;
+    const uint8_t notifyChannel;
+
+protected:
+    void handleFrame(canid_t can_id, const std::span<const uint8_t> &data) override;
+};
+
+/**
+ * @brief Receives notifications from a register mapped server carried over CANmore messages. Notifications are
+ * received whenever the agent is polled, including by a RegMappedMsgClient on the same agent waiting for a response
+ */
+class RegMappedMsgNotificationListener : public RegMappedNotificationListener {
+public:
+    // The listener subscribes to CANMORE_MSG_SUBTYPE_REG_MAPPED_NOTIFY on the agent, so there can only be one per
+    // client per agent. The agent must outlive the listener
+    RegMappedMsgNotificationListener(MsgAgentBase &agent, uint8_t clientId);
+    ~RegMappedMsgNotificationListener();
+
+    // Configured clientId
+    const uint8_t clientId;
+
+private:
+    MsgAgentBase &agent;
+};
+
 }  // namespace Canmore
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "CANSocket.hpp"
+#include "MsgClient.hpp"
 #include "canmore_cpp/span_compat.hpp"
 
 #include "canmore/protocol.h"
@@ -12,6 +13,8 @@
 #include <memory>
 #include <vector>
 
+#define REG_MAPPED_SERVER_NUM_SUBSCRIPTIONS 16  // Subscriptions available to clients of a C++ server
+
 namespace Canmore {
 
 // ========================================
@@ -157,8 +160,10 @@ public:
      *
      * @param interfaceMode The interface mode this server implements (see canmore/protocol.h for more info)
      * @param multiword_buffer_len The length in bytes of the multiword response buffer (0 to disable multiword)
+     * @param notify_buffer_len The maximum length in bytes of a notification sent by transmitNotification (0 to disable
+     * subscriptions)
      */
-    RegMappedServer(uint8_t interfaceMode, size_t multiword_buffer_len);
+    RegMappedServer(uint8_t interfaceMode, size_t multiword_buffer_len, size_t notify_buffer_len = 0);
     ~RegMappedServer();
 
     /**
@@ -201,6 +206,19 @@ public:
      */
     void processPacket(const std::span<const uint8_t> &data);
 
+    /**
+     * @brief Samples subscribed registers which are due, sending notifications for any which changed. Must be called
+     * periodically from the same thread as processPacket for subscriptions to be serviced.
+     */
+    void tick();
+
+    /**
+     * @brief Same as tick(), sampling at the given time rather than the steady clock
+     *
+     * @param nowMs The current time in milliseconds. This may wrap around
+     */
+    void tick(uint32_t nowMs);
+
 protected:
     /**
      * @brief Transmit Callback to send the requested data packet over can bus (on the requested channel)
@@ -209,12 +227,24 @@ protected:
      */
     virtual void transmit(const std::span<uint8_t> &data) = 0;
 
+    /**
+     * @brief Transmit Callback to send a subscription notification. Only called if notify_buffer_len was provided
+     *
+     * @param data Data to put in the notification
+     */
+    virtual void transmitNotification(const std::span<uint8_t> &data) { (void) data; }
+
 private:
     /**
      * @brief Static binding for the underlying reg_mapped_server
      */
     static void transmit_cb_wrapper(uint8_t *msg, size_t len, void *arg);
 
+    /**
+     * @brief Static binding for notifications from the underlying reg_mapped_server
+     */
+    static void notify_cb_wrapper(uint8_t *msg, size_t len, void *arg);
+
     /**
      * @brief Gets reference to the requested page. If pages is not large enough, this will add unimplemented entries
      * until pages is large enough to hold the reg_mapped_page.
@@ -233,6 +263,11 @@ private:
      */
     std::vector<reg_mapped_server_page_def_t> pages;
 
+    /**
+     * @brief The backing array for the reg_mapped_server subscriptions
+     */
+    std::vector<reg_mapped_server_subscription_t> subscriptions;
+
     /**
      * @brief The underlying reg_mapped_server instance object
      */
@@ -245,9 +280,11 @@ private:
 
 class RegMappedCANServer : public CANSocket, public Canmore::RegMappedServer {
 public:
-    RegMappedCANServer(int ifIndex, uint8_t clientId, uint8_t channel, uint8_t interfaceMode):
-        CANSocket(ifIndex), RegMappedServer(interfaceMode, usingCanFd() ? CANFD_MAX_DLEN : 0), clientId(clientId),
-        channel(channel) {
+    RegMappedCANServer(int ifIndex, uint8_t clientId, uint8_t channel, uint8_t interfaceMode,
+                       uint8_t notifyChannel = CANMORE_CHAN_CONTROL_INTERFACE_NOTIFY):
+        CANSocket(ifIndex),
+        RegMappedServer(interfaceMode, usingCanFd() ? CANFD_MAX_DLEN : 0, getMaxFrameSize()), clientId(clientId),
+        channel(channel), notifyChannel(notifyChannel) {
         // Configure agent to receive agent to client communication on the control interface channel
         struct can_filter rfilter[] = { { .can_id = CANMORE_CALC_UTIL_ID_A2C(clientId, channel),
                                           .can_mask = (CAN_EFF_FLAG | CAN_RTR_FLAG | CAN_SFF_MASK) } };
@@ -257,6 +294,7 @@ public:
 
     const uint8_t clientId;
     const uint8_t channel;
+    const uint8_t notifyChannel;
 
 protected:
     void handleFrame(canid_t can_id, const std::span<const uint8_t> &data) override {
@@ -269,6 +307,53 @@ protected:
     void transmit(const std::span<uint8_t> &data) override {
         transmitFrame(CANMORE_CALC_UTIL_ID_C2A(clientId, channel), data);
     }
+    void transmitNotification(const std::span<uint8_t> &data) override {
+        transmitFrame(CANMORE_CALC_UTIL_ID_C2A(clientId, notifyChannel), data);
+    }
+};
+
+// ========================================
+// Register Mapped Server CANmore Message Implementation
+// ========================================
+
+/**
+ * @brief Register mapped server carried over CANmore messages (see Message Binding in canmore/reg_mapped/protocol.h)
+ *
+ * This subscribes to CANMORE_MSG_SUBTYPE_REG_MAPPED on the given client, so the client must be polled for requests to
+ * be processed.
+ */
+class RegMappedMsgServer : public Canmore::RegMappedServer {
+public:
+    /**
+     * @brief Creates a new server, subscribing to register mapped messages on the given client
+     *
+     * @param client The message client to receive requests on. Must outlive the server
+     * @param interfaceMode The interface mode this server implements (see canmore/protocol.h for more info)
+     */
+    RegMappedMsgServer(MsgClientBase &client, uint8_t interfaceMode):
+        RegMappedServer(interfaceMode, CANMORE_MAX_MSG_LENGTH, CANMORE_MAX_MSG_LENGTH), client(client) {
+        client.subscribe(CANMORE_MSG_SUBTYPE_REG_MAPPED, [this](uint8_t subtype, std::span<const uint8_t> data) {
+            (void) subtype;
+            processPacket(data);
+        });
+    }
+
+    ~RegMappedMsgServer() { client.unsubscribe(CANMORE_MSG_SUBTYPE_REG_MAPPED); }
+
+    // Disable copying, as the client subscription holds a reference to this object
+    RegMappedMsgServer(RegMappedMsgServer const &) = delete;
+    RegMappedMsgServer &operator=(RegMappedMsgServer const &) = delete;
+
+protected:
+    void transmit(const std::span<uint8_t> &data) override {
+        client.transmitMessage(CANMORE_MSG_SUBTYPE_REG_MAPPED, data);
+    }
+    void transmitNotification(const std::span<uint8_t> &data) override {
+        client.transmitMessage(CANMORE_MSG_SUBTYPE_REG_MAPPED_NOTIFY, data);
+    }
+
+private:
+    MsgClientBase &client;
 };
 
 }  // namespace Canmore
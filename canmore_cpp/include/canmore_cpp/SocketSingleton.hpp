@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 
 namespace Canmore {
@@ -9,6 +10,9 @@ template <typename T, typename ConstructorKey, typename ConstructorKeyHash> clas
 public:
     template <typename... ConstructorArgs> static std::shared_ptr<T> create(ConstructorArgs &&..._args) {
         static std::unordered_map<ConstructorKey, std::weak_ptr<T>, ConstructorKeyHash> instances;
+        static std::mutex instancesLock;  // Instances may be created from several threads
+
+        std::lock_guard<std::mutex> guard(instancesLock);
 
         // Search for instance
         auto key = ConstructorKey(std::forward<ConstructorArgs>(_args)...);
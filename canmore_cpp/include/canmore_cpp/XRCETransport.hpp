@@ -0,0 +1,228 @@
+#pragma once
+
+#include "canmore_cpp/MsgAgent.hpp"
+#include "canmore_cpp/MsgClient.hpp"
+#include "canmore_cpp/PollFD.hpp"
+#include "canmore_cpp/span_compat.hpp"
+
+#include "canmore/msg_encoding.h"
+
+#include <cstdint>
+#include <deque>
+#include <sys/types.h>
+#include <utility>
+#include <vector>
+
+namespace Canmore {
+
+/**
+ * @brief Result codes for XRCE transport operations. Named to match the agent's eprosima::uxr::TransportRc values
+ */
+enum class XRCETransportRc { ok, timeout_error, server_error };
+
+/**
+ * @brief Adapter to run a Micro XRCE-DDS client custom transport over a CANmore message client (CAN or Ethernet).
+ *
+ * CANmore messages preserve packet boundaries, so the transport should be registered in packet mode (framing disabled)
+ * with an MTU of at most CANMORE_MAX_MSG_LENGTH. Each XRCE packet is sent as a single CANmore message with the
+ * CANMORE_MSG_SUBTYPE_XRCE_DDS subtype. Received packets are copied directly from the decoder buffer into the buffer
+ * provided to read, without passing through an intermediate buffer.
+ *
+ * The static functions match the custom transport callback signatures, and are templated on the transport struct to
+ * avoid depending on the XRCE headers. The args field of the transport must point to this adapter:
+ * @code
+ * uxr_set_custom_transport_callbacks(&transport, false, XRCEClientTransport::open<uxrCustomTransport>,
+ *                                    XRCEClientTransport::close<uxrCustomTransport>,
+ *                                    XRCEClientTransport::write<uxrCustomTransport>,
+ *                                    XRCEClientTransport::read<uxrCustomTransport>);
+ * uxr_init_custom_transport(&transport, &adapter);
+ * @endcode
+ *
+ * @attention The adapter polls the client itself while reading, so the client must not be polled from another thread.
+ * Messages of other subtypes received while reading are still sent to the client's handler/subscriptions.
+ */
+class XRCEClientTransport {
+public:
+    /**
+     * @brief Creates a new XRCE transport adapter, subscribing to XRCE messages on the given client
+     *
+     * @param client The message client to send and receive XRCE packets on. Must outlive this adapter
+     */
+    XRCEClientTransport(MsgClientBase &client);
+    ~XRCEClientTransport();
+
+    // Disable copying, as the client subscription holds a reference to this object
+    XRCEClientTransport(XRCEClientTransport const &) = delete;
+    XRCEClientTransport &operator=(XRCEClientTransport const &) = delete;
+
+    /**
+     * @brief Maximum packet size which can be carried by the transport
+     */
+    static constexpr size_t mtu = CANMORE_MAX_MSG_LENGTH;
+
+    /**
+     * @brief Opens the transport, discarding any packets received before it was opened
+     */
+    bool open();
+
+    /**
+     * @brief Closes the transport
+     */
+    bool close();
+
+    /**
+     * @brief Transmits an XRCE packet
+     *
+     * @param buf The packet to transmit
+     * @param len The length of the packet
+     * @param err Set to non-zero on error
+     * @return size_t The number of bytes written, or 0 on error
+     */
+    size_t write(const uint8_t *buf, size_t len, uint8_t *err);
+
+    /**
+     * @brief Receives an XRCE packet, waiting up to the specified timeout
+     *
+     * @param buf Buffer to write the packet into
+     * @param len The size of the buffer
+     * @param timeoutMs The maximum time to wait in milliseconds
+     * @param err Set to non-zero on error (not set if no packet was received before the timeout)
+     * @return size_t The length of the received packet, or 0 on timeout or error
+     */
+    size_t read(uint8_t *buf, size_t len, int timeoutMs, uint8_t *err);
+
+    /*
+     * Custom transport callbacks. The transport args must point to the XRCEClientTransport instance
+     */
+    template <typename Transport> static bool open(Transport *transport) { return fromTransport(transport).open(); }
+
+    template <typename Transport> static bool close(Transport *transport) { return fromTransport(transport).close(); }
+
+    template <typename Transport>
+    static size_t write(Transport *transport, const uint8_t *buf, size_t len, uint8_t *err) {
+        return fromTransport(transport).write(buf, len, err);
+    }
+
+    template <typename Transport>
+    static size_t read(Transport *transport, uint8_t *buf, size_t len, int timeout, uint8_t *err) {
+        return fromTransport(transport).read(buf, len, timeout, err);
+    }
+
+private:
+    template <typename Transport> static XRCEClientTransport &fromTransport(Transport *transport) {
+        return *static_cast<XRCEClientTransport *>(transport->args);
+    }
+
+    // Subscription callback for XRCE messages
+    void handlePacket(std::span<const uint8_t> data);
+
+    MsgClientBase &client;
+    PollGroup pollGroup;
+    bool isOpen = false;
+
+    // Destination for packets received while a read is in progress (data is empty when no read is waiting)
+    std::span<uint8_t> readBuf;
+    size_t readLen = 0;
+    bool readComplete = false;
+    bool readOverflow = false;
+
+    // Packets received while no read was in progress (only used if the client is polled outside of read)
+    std::deque<std::vector<uint8_t>> pendingPackets;
+};
+
+/**
+ * @brief Adapter to run a Micro XRCE-DDS agent custom transport over a CANmore message agent (CAN or Ethernet).
+ *
+ * This supports sessions with multiple clients on the same agent. Packets are received from all clients, with the
+ * source client ID reported as the endpoint, and packets are transmitted to the client ID passed as the destination
+ * endpoint. Like XRCEClientTransport, packets are carried one per CANmore message (so the agent should use packet mode),
+ * and received packets are copied directly from the decoder buffer into the agent's buffer.
+ *
+ * These functions are intended to be bound into the custom agent callbacks, using a single uint8_t endpoint member to
+ * carry the client ID:
+ * @code
+ * endpoint.add_member<uint8_t>("client_id");
+ * recv_cb = [&](CustomEndPoint *src, uint8_t *buf, size_t len, int timeout, TransportRc &rc) -> ssize_t {
+ *     uint8_t clientId;
+ *     XRCETransportRc xrceRc;
+ *     ssize_t ret = adapter.recv(clientId, buf, len, timeout, xrceRc);
+ *     src->set_member_value<uint8_t>("client_id", clientId);
+ *     rc = static_cast<TransportRc>(xrceRc);
+ *     return ret;
+ * };
+ * @endcode
+ *
+ * @attention The adapter polls the agent itself while receiving, so the agent must not be polled from another thread.
+ */
+class XRCEAgentTransport {
+public:
+    /**
+     * @brief Creates a new XRCE transport adapter, subscribing to XRCE messages from all clients on the given agent
+     *
+     * @param agent The message agent to send and receive XRCE packets on. Must outlive this adapter
+     */
+    XRCEAgentTransport(MsgAgentBase &agent);
+    ~XRCEAgentTransport();
+
+    // Disable copying, as the agent subscription holds a reference to this object
+    XRCEAgentTransport(XRCEAgentTransport const &) = delete;
+    XRCEAgentTransport &operator=(XRCEAgentTransport const &) = delete;
+
+    /**
+     * @brief Maximum packet size which can be carried by the transport
+     */
+    static constexpr size_t mtu = CANMORE_MAX_MSG_LENGTH;
+
+    /**
+     * @brief Initializes the transport, discarding any packets received before it was initialized
+     */
+    bool init();
+
+    /**
+     * @brief Deinitializes the transport
+     */
+    bool fini();
+
+    /**
+     * @brief Receives an XRCE packet from any client, waiting up to the specified timeout
+     *
+     * @param clientIdOut Set to the client ID which sent the packet
+     * @param buf Buffer to write the packet into
+     * @param len The size of the buffer
+     * @param timeoutMs The maximum time to wait in milliseconds
+     * @param rc Set to the result of the operation
+     * @return ssize_t The length of the received packet, or -1 on timeout or error
+     */
+    ssize_t recv(uint8_t &clientIdOut, uint8_t *buf, size_t len, int timeoutMs, XRCETransportRc &rc);
+
+    /**
+     * @brief Transmits an XRCE packet to a client
+     *
+     * @param clientId The client ID to send the packet to
+     * @param buf The packet to transmit
+     * @param len The length of the packet
+     * @param rc Set to the result of the operation
+     * @return ssize_t The number of bytes transmitted, or -1 on error
+     */
+    ssize_t send(uint8_t clientId, const uint8_t *buf, size_t len, XRCETransportRc &rc);
+
+private:
+    // Subscription callback for XRCE messages
+    void handlePacket(uint8_t clientId, std::span<const uint8_t> data);
+
+    MsgAgentBase &agent;
+    PollGroup pollGroup;
+    bool isInit = false;
+
+    // Destination for packets received while a recv is in progress (data is empty when no recv is waiting)
+    std::span<uint8_t> readBuf;
+    size_t readLen = 0;
+    uint8_t readClientId = 0;
+    bool readComplete = false;
+    bool readOverflow = false;
+
+    // Packets received while no recv was in progress. Format: {Client ID, Packet}
+    std::deque<std::pair<uint8_t, std::vector<uint8_t>>> pendingPackets;
+};
+
+};  // namespace Canmore
@@ -2,6 +2,7 @@
 
 #include "canmore/msg_encoding.h"
 
+#include <array>
 #include <linux/can.h>
 #include <linux/can/raw.h>
 #include <net/if.h>
@@ -14,6 +15,18 @@ using namespace Canmore;
 
 static_assert(CANMORE_MAX_FD_FRAME_SIZE == CANFD_MAX_DLEN, "CANmore and Linux definitions do not match");
 static_assert(CANMORE_MAX_FRAME_SIZE == CAN_MAX_DLEN, "CANmore and Linux definitions do not match");
+#ifdef CANXL_MTU
+static_assert(CANMORE_MAX_XL_FRAME_SIZE == CANXL_MAX_DLEN, "CANmore and Linux definitions do not match");
+#endif
+
+// Buffer large enough to read any frame type enabled on the socket
+union CANFrameBuffer {
+    struct can_frame frame;
+    struct canfd_frame fdframe;
+#ifdef CANXL_MTU
+    struct canxl_frame xlframe;
+#endif
+};
 
 // The maximum number of milliseconds to block for when trying to transmit to the socket
 // If this elapses before the socket sucessfully writes the data, then that means that the CAN bus has probably broken,
@@ -23,7 +36,8 @@ static_assert(CANMORE_MAX_FRAME_SIZE == CAN_MAX_DLEN, "CANmore and Linux definit
 // rate limit the caller to stay within the max speed of the bus.
 #define MAX_BLOCKING_TIME_MS 50
 
-CANSocket::CANSocket(int ifIndex, bool forceNoCanFd): ifIndex(ifIndex), socketFd(-1), useCanFd(false) {
+CANSocket::CANSocket(int ifIndex, bool forceNoCanFd):
+    ifIndex(ifIndex), socketFd(-1), useCanFd(false), useCanXl(false) {
     // Open socket
     if ((socketFd = socket(PF_CAN, SOCK_RAW | SOCK_CLOEXEC, CAN_RAW)) < 0) {
         throw std::system_error(errno, std::generic_category(), "CAN socket");
@@ -73,6 +87,21 @@ CANSocket::CANSocket(int ifIndex, bool forceNoCanFd): ifIndex(ifIndex), socketFd
                                         "CAN setsockopt(SOL_CAN_RAW, CAN_RAW_FD_FRAMES)");
             }
         }
+
+#ifdef CANXL_MTU
+        // CAN XL interfaces also carry CAN FD frames, so this is enabled in addition to CAN FD
+        if (ifr.ifr_mtu > 0 && ((size_t) ifr.ifr_mtu) >= CANXL_MIN_MTU) {
+            useCanXl = true;
+
+            int enableCanXl = 1;
+            if (setsockopt(socketFd, SOL_CAN_RAW, CAN_RAW_XL_FRAMES, &enableCanXl, sizeof(enableCanXl))) {
+                close(socketFd);
+                socketFd = -1;
+                throw std::system_error(errno, std::generic_category(),
+                                        "CAN setsockopt(SOL_CAN_RAW, CAN_RAW_XL_FRAMES)");
+            }
+        }
+#endif
     }
 
     // Bind to requested interface
@@ -178,6 +207,39 @@ void CANSocket::transmitFrame(canid_t can_id, const std::span<const uint8_t> &da
     }
 }
 
+void CANSocket::transmitXlFrame(canid_t can_id, const std::span<const uint8_t> &data) {
+#ifdef CANXL_MTU
+    if (!useCanXl) {
+        throw std::logic_error("Attempting to transmit CAN XL frame on interface without CAN XL support");
+    }
+    if (data.size() < CANXL_MIN_DLEN || data.size() > CANXL_MAX_DLEN) {
+        throw std::logic_error("Invalid CAN XL frame length: " + std::to_string(data.size()));
+    }
+
+    struct canxl_frame frame = {};
+    if (can_id & CAN_EFF_FLAG) {
+        frame.prio = (can_id & CAN_EFF_MASK) >> (CAN_EFF_ID_BITS - CAN_SFF_ID_BITS);
+        frame.af = can_id & (CAN_EFF_FLAG | CAN_EFF_MASK);
+    }
+    else {
+        frame.prio = can_id & CAN_SFF_MASK;
+    }
+    frame.flags = CANXL_XLF;
+    frame.len = data.size();
+    std::copy_n(data.data(), data.size(), frame.data);
+
+    // XL frames are written with only the used portion of the data field
+    ssize_t frameSize = CANXL_HDR_SIZE + data.size();
+    if (write(socketFd, &frame, frameSize) != frameSize) {
+        throw std::system_error(errno, std::generic_category(), "CANXL write");
+    }
+#else
+    (void) can_id;
+    (void) data;
+    throw std::logic_error("CAN XL is not supported by the kernel headers this was built with");
+#endif
+}
+
 void CANSocket::clearRxBuffer() {
     struct pollfd fd = { .fd = socketFd, .events = POLLIN, .revents = 0 };
 
@@ -190,45 +252,76 @@ void CANSocket::clearRxBuffer() {
             break;
         }
 
-        if (!useCanFd) {
-            struct can_frame frame;
-            if (read(socketFd, &frame, sizeof(frame)) != sizeof(frame)) {
-                throw std::system_error(errno, std::generic_category(), "CAN Flush Read");
-            }
-        }
-        else {
-            struct canfd_frame frame;
-            if (read(socketFd, &frame, sizeof(frame)) != sizeof(frame)) {
-                throw std::system_error(errno, std::generic_category(), "CANFD Flush Read");
-            }
+        // Frames may be any of the enabled types, which all fit in the buffer
+        union CANFrameBuffer frame;
+        if (read(socketFd, &frame, sizeof(frame)) <= 0) {
+            throw std::system_error(errno, std::generic_category(), "CAN Flush Read");
         }
     }
 }
 
+void CANSocket::handleFrames(std::span<const ReceivedFrame> frames) {
+    for (auto &frame : frames) {
+        handleFrame(frame.can_id, frame.data);
+    }
+}
+
 void CANSocket::handleEvent(const pollfd &fd) {
     if (fd.revents & POLLIN) {
-        union {
-            struct can_frame frame;
-            struct canfd_frame fdframe;
-        } canu;
-
-        int readSize = read(socketFd, &canu, sizeof(canu));
-
-        if (readSize < 0) {
-            throw std::system_error(errno, std::generic_category(), "CAN read");
+        // Read all of the frames available (up to the batch size) in a single syscall
+        std::array<union CANFrameBuffer, rxBatchSize> frameBufs;
+        std::array<struct iovec, rxBatchSize> iovs;
+        std::array<struct mmsghdr, rxBatchSize> msgs = {};
+        for (size_t i = 0; i < rxBatchSize; i++) {
+            iovs[i].iov_base = &frameBufs[i];
+            iovs[i].iov_len = sizeof(frameBufs[i]);
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
         }
-        else if (useCanFd && readSize == sizeof(canu.fdframe)) {
-            handleFrame(canu.fdframe.can_id, std::span<const uint8_t>(canu.fdframe.data, canu.fdframe.len));
-        }
-        else if (readSize == sizeof(canu.frame)) {
-            // Needs to be can_dlc (deprected) because NVIDIA
-            handleFrame(canu.frame.can_id, std::span<const uint8_t>(canu.frame.data, canu.frame.can_dlc));
+
+        int count = recvmmsg(socketFd, msgs.data(), msgs.size(), MSG_DONTWAIT, NULL);
+        if (count < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                throw std::system_error(errno, std::generic_category(), "CAN read");
+            }
         }
-        else if (readSize == 0) {
+        else if (count == 0) {
             throw std::runtime_error("CAN socket reporting end of file");
         }
         else {
-            throw std::runtime_error("Unexpected CAN read size: " + std::to_string(readSize));
+            std::array<ReceivedFrame, rxBatchSize> frames;
+            for (int i = 0; i < count; i++) {
+                auto &canu = frameBufs[i];
+                size_t readSize = msgs[i].msg_len;
+#ifdef CANXL_MTU
+                // XL frames are identified by the XLF flag, which overlaps the length field of CAN/CAN FD frames
+                if (useCanXl && readSize >= CANXL_HDR_SIZE && (canu.xlframe.flags & CANXL_XLF)) {
+                    if (readSize != CANXL_HDR_SIZE + canu.xlframe.len) {
+                        throw std::runtime_error("Unexpected CAN XL read size: " + std::to_string(readSize));
+                    }
+
+                    // Restore the extended ID carried in the acceptance field (see transmitXlFrame)
+                    canid_t canId = canu.xlframe.prio & CANXL_PRIO_MASK;
+                    if (canu.xlframe.af & CAN_EFF_FLAG) {
+                        canId = canu.xlframe.af & (CAN_EFF_FLAG | CAN_EFF_MASK);
+                    }
+                    frames[i] = { canId, std::span<const uint8_t>(canu.xlframe.data, canu.xlframe.len) };
+                    continue;
+                }
+#endif
+                if (useCanFd && readSize == sizeof(canu.fdframe)) {
+                    frames[i] = { canu.fdframe.can_id, std::span<const uint8_t>(canu.fdframe.data, canu.fdframe.len) };
+                }
+                else if (readSize == sizeof(canu.frame)) {
+                    // Needs to be can_dlc (deprected) because NVIDIA
+                    frames[i] = { canu.frame.can_id, std::span<const uint8_t>(canu.frame.data, canu.frame.can_dlc) };
+                }
+                else {
+                    throw std::runtime_error("Unexpected CAN read size: " + std::to_string(readSize));
+                }
+            }
+
+            handleFrames(std::span<const ReceivedFrame> { frames.data(), (size_t) count });
         }
     }
     if (fd.revents & (POLLERR | POLLHUP)) {
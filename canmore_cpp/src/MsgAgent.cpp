@@ -1,21 +1,246 @@
 #include "canmore_cpp/MsgAgent.hpp"
+#include "canmore_cpp/MsgCodec.hpp"
+
+#include "canmore/msg_aggregation.h"
+#include "canmore/msg_compression.h"
+
+#include <array>
 
 using namespace Canmore;
 
+// ========================================
+// Transport Independent Base
+// ========================================
+
+MsgAgentBase::MsgAgentBase(AgentMsgHandler &handler):
+    handler(handler), bufferPool(MsgBufferPool::create()), subscriptions(numClientIds * numSubtypes) {}
+
+void MsgAgentBase::subscribe(uint8_t clientId, uint8_t subtype, AgentMsgCB callback) {
+    if (!callback) {
+        throw std::logic_error("Attempting to subscribe to canmore messages with an empty callback");
+    }
+    setSubscription(clientId, subtype, Subscription { .callback = callback, .ownedCallback = nullptr });
+}
+
+void MsgAgentBase::subscribeOwned(uint8_t clientId, uint8_t subtype, AgentOwnedMsgCB callback) {
+    if (!callback) {
+        throw std::logic_error("Attempting to subscribe to canmore messages with an empty callback");
+    }
+    setSubscription(clientId, subtype, Subscription { .callback = nullptr, .ownedCallback = callback });
+}
+
+void MsgAgentBase::unsubscribe(uint8_t clientId, uint8_t subtype) {
+    setSubscription(clientId, subtype, Subscription {});
+}
+
+void MsgAgentBase::setDefaultHandlerEnabled(bool enabled) {
+    defaultHandlerEnabled = enabled;
+
+    // Refresh the filters on all clients
+    for (size_t id = 1; id < numClientIds; id++) {
+        subtypeFilterChanged(id);
+    }
+}
+
+void MsgAgentBase::setSubscription(uint8_t clientId, uint8_t subtype, const Subscription &subscription) {
+    if (clientId >= numClientIds) {
+        throw std::logic_error("Attempting to subscribe to canmore messages with invalid client ID");
+    }
+    if (subtype >= numSubtypes) {
+        throw std::logic_error("Attempting to subscribe to canmore messages with invalid message subtype");
+    }
+
+    // Client ID 0 is reserved for broadcast, so its row in the table holds the wildcard subscriptions, which apply to
+    // every client without a subscription of its own
+    subscriptions[subscriptionIdx(clientId, subtype)] = subscription;
+    if (clientId == 0) {
+        for (size_t id = 1; id < numClientIds; id++) {
+            subtypeFilterChanged(id);
+        }
+    }
+    else {
+        subtypeFilterChanged(clientId);
+    }
+}
+
+const MsgAgentBase::Subscription &MsgAgentBase::lookupSubscription(uint8_t clientId, uint8_t subtype) const {
+    auto &subscription = subscriptions[subscriptionIdx(clientId, subtype)];
+    if (subscription) {
+        return subscription;
+    }
+    return subscriptions[subscriptionIdx(0, subtype)];
+}
+
+MsgStatsSnapshot MsgAgentBase::getStats(uint8_t clientId) const {
+    if (clientId >= numClientIds) {
+        throw std::logic_error("Attempting to get canmore message stats for invalid client ID");
+    }
+    return stats[clientId].snapshot();
+}
+
+MsgStatsSnapshot MsgAgentBase::getTotalStats() const {
+    MsgStatsSnapshot total;
+    for (auto &clientStats : stats) {
+        total += clientStats.snapshot();
+    }
+    return total;
+}
+
+void MsgAgentBase::resetStats() {
+    for (auto &clientStats : stats) {
+        clientStats.reset();
+    }
+}
+
+uint64_t MsgAgentBase::computeSubtypeFilter(uint8_t clientId) {
+    if (defaultHandlerEnabled) {
+        return CANMORE_MSG_SUBTYPE_FILTER_ALL;
+    }
+
+    uint64_t filter = 0;
+    for (size_t subtype = 0; subtype < numSubtypes; subtype++) {
+        if (lookupSubscription(clientId, subtype)) {
+            filter |= CANMORE_MSG_SUBTYPE_FILTER_BIT(subtype);
+        }
+    }
+
+    // Subscribed messages may also arrive inside an aggregate or compressed message
+    if (filter) {
+        filter |= CANMORE_MSG_SUBTYPE_FILTER_BIT(CANMORE_MSG_SUBTYPE_AGGREGATE);
+        filter |= CANMORE_MSG_SUBTYPE_FILTER_BIT(CANMORE_MSG_SUBTYPE_COMPRESSED);
+    }
+    return filter;
+}
+
+bool MsgAgentBase::shouldUnpack(uint8_t clientId, uint8_t subtype) const {
+    if (subtype != CANMORE_MSG_SUBTYPE_AGGREGATE && subtype != CANMORE_MSG_SUBTYPE_COMPRESSED) {
+        return false;
+    }
+    return !lookupSubscription(clientId, subtype);
+}
+
+void MsgAgentBase::dispatchAggregate(uint8_t clientId, std::span<const uint8_t> data, bool inCompressed) {
+    canmore_msg_aggregate_iter_t iter;
+    canmore_msg_aggregate_iter_init(&iter, data.data(), data.size());
+
+    uint8_t subtype;
+    const uint8_t *entryData;
+    size_t entryLen;
+    while (canmore_msg_aggregate_iter_next(&iter, &subtype, &entryData, &entryLen)) {
+        dispatchInner(clientId, subtype, std::span<const uint8_t> { entryData, entryLen }, inCompressed);
+    }
+
+    if (canmore_msg_aggregate_iter_malformed(&iter)) {
+        stats[clientId].countDecodeError(CANMORE_MSG_DECODER_ERROR_MALFORMED_AGGREGATE);
+        handler.handleDecodeError(clientId, CANMORE_MSG_DECODER_ERROR_MALFORMED_AGGREGATE);
+    }
+}
+
+void MsgAgentBase::dispatchCompressed(uint8_t clientId, std::span<const uint8_t> data, bool inCompressed) {
+    // Compression is only ever applied once, so a compressed message (possibly in an aggregate) inside another is
+    // malformed. Rejecting it bounds how far unpacking can recurse
+    if (inCompressed) {
+        stats[clientId].countDecodeError(CANMORE_MSG_DECODER_ERROR_MALFORMED_COMPRESSED);
+        handler.handleDecodeError(clientId, CANMORE_MSG_DECODER_ERROR_MALFORMED_COMPRESSED);
+        return;
+    }
+
+    uint8_t *buffer = bufferPool->acquire();
+    if (!buffer) {
+        stats[clientId].countDecodeError(CANMORE_MSG_DECODER_ERROR_NO_BUFFER);
+        handler.handleDecodeError(clientId, CANMORE_MSG_DECODER_ERROR_NO_BUFFER);
+        return;
+    }
+
+    uint8_t subtype;
+    size_t len = canmore_msg_decompress(data.data(), data.size(), &subtype, buffer, bufferPool->bufferSize);
+    if (len == 0) {
+        bufferPool->release(buffer);
+        stats[clientId].countDecodeError(CANMORE_MSG_DECODER_ERROR_MALFORMED_COMPRESSED);
+        handler.handleDecodeError(clientId, CANMORE_MSG_DECODER_ERROR_MALFORMED_COMPRESSED);
+        return;
+    }
+
+    // The buffer is returned to the pool once dispatch finishes, unless an owned subscriber keeps the message
+    MsgBuffer msg = bufferPool->share(buffer, len);
+    AgentOwnedMsgCB ownedCallback = lookupSubscription(clientId, subtype).ownedCallback;
+    if (ownedCallback) {
+        ownedCallback(clientId, subtype, std::move(msg));
+    }
+    else {
+        dispatchInner(clientId, subtype, msg.data(), true);
+    }
+}
+
+void MsgAgentBase::dispatchMessage(uint8_t clientId, uint8_t subtype, std::span<const uint8_t> data) {
+    dispatchInner(clientId, subtype, data, false);
+}
+
+void MsgAgentBase::dispatchInner(uint8_t clientId, uint8_t subtype, std::span<const uint8_t> data, bool inCompressed) {
+    if (shouldUnpack(clientId, subtype)) {
+        if (subtype == CANMORE_MSG_SUBTYPE_COMPRESSED) {
+            dispatchCompressed(clientId, data, inCompressed);
+        }
+        else {
+            dispatchAggregate(clientId, data, inCompressed);
+        }
+        return;
+    }
+
+    // The subscription is copied, as the callback may replace its own subscription while it runs
+    Subscription subscription = lookupSubscription(clientId, subtype);
+    if (subscription.callback) {
+        subscription.callback(clientId, subtype, data);
+    }
+    else if (subscription.ownedCallback) {
+        // The message isn't in a pool buffer, so it must be copied to hand off ownership
+        MsgBuffer buffer = bufferPool->copy(data);
+        if (buffer) {
+            subscription.ownedCallback(clientId, subtype, std::move(buffer));
+        }
+        else {
+            stats[clientId].countDecodeError(CANMORE_MSG_DECODER_ERROR_NO_BUFFER);
+            handler.handleDecodeError(clientId, CANMORE_MSG_DECODER_ERROR_NO_BUFFER);
+        }
+    }
+    else if (defaultHandlerEnabled) {
+        handler.handleMessage(clientId, subtype, data);
+    }
+}
+
+bool MsgAgentBase::dispatchPooledMessage(uint8_t clientId, uint8_t subtype, uint8_t *buffer, size_t len) {
+    // Copied for the same reason as in dispatchMessage
+    AgentOwnedMsgCB ownedCallback = lookupSubscription(clientId, subtype).ownedCallback;
+    if (ownedCallback) {
+        ownedCallback(clientId, subtype, bufferPool->share(buffer, len));
+        return true;
+    }
+
+    dispatchMessage(clientId, subtype, std::span<const uint8_t> { buffer, len });
+    return false;
+}
+
+// ========================================
+// CAN Agent
+// ========================================
+
 MsgAgent::MsgAgent(int ifIndex, AgentMsgHandler &handler, std::span<const uint8_t> clientIdSelect):
-    CANSocket(ifIndex), handler(handler) {
+    CANSocket(ifIndex), MsgAgentBase(handler), decoders(numClientIds - 1) {
+    // Initialize the decoders for every client up front, so that the decoder state stays at a fixed address
+    // Only the hot state is allocated here, reassembly buffers are attached on demand
+    for (size_t i = 0; i < decoders.size(); i++) {
+        auto &argEntry = decoderErrorArgs.emplace_back(this, i + 1);  // Client ID is Index + 1
+        canmore_msg_split_decode_init(&decoders[i].state, &MsgAgent::decoderErrorCallback, &argEntry, usingCanFd());
+        canmore_msg_split_decode_set_subtype_filter(&decoders[i].state, computeSubtypeFilter(i + 1));
+    }
+
     // Setup Receive Filter
     // Need to match both standard CAN frames and extended CAN message frames from all clients and agents
     // We're subscribed to agent messages as well since we should be the only agent on the network
     // If we see any packets from another agent, we can report an error
     if (clientIdSelect.empty()) {
         // If we aren't provided a selection array, listen to all client ids
-        struct can_filter rfilter[] = {
-            { .can_id = CANMORE_CALC_MSG_ID(0, 0, 0),
-              .can_mask = (CAN_EFF_FLAG | CAN_RTR_FLAG | CANMORE_CALC_FILTER_MASK(0, 1, 0, 0)) },
-            { .can_id = CAN_EFF_FLAG | CANMORE_CALC_MSG_EXT_ID(0, 0, 0, 0),
-              .can_mask = (CAN_EFF_FLAG | CAN_RTR_FLAG | CANMORE_CALC_EXT_FILTER_MASK(0, 1, 0, 0, 0)) },
-        };
+        auto rfilter = Codec::msgRxFilters<Codec::Direction::ClientToAgent>(0, false, false);
         setRxFilters(std::span<can_filter> { rfilter });
     }
     else {
@@ -23,11 +248,8 @@ MsgAgent::MsgAgent(int ifIndex, AgentMsgHandler &handler, std::span<const uint8_
         std::vector<can_filter> filterArray;
         filterArray.reserve(clientIdSelect.size() * 2);
         for (uint8_t clientId : clientIdSelect) {
-            filterArray.push_back({ .can_id = CANMORE_CALC_MSG_ID(clientId, 0, 0),
-                                    .can_mask = (CAN_EFF_FLAG | CAN_RTR_FLAG | CANMORE_CALC_FILTER_MASK(1, 1, 0, 0)) });
-            filterArray.push_back(
-                { .can_id = CAN_EFF_FLAG | CANMORE_CALC_MSG_EXT_ID(clientId, 0, 0, 0),
-                  .can_mask = (CAN_EFF_FLAG | CAN_RTR_FLAG | CANMORE_CALC_EXT_FILTER_MASK(1, 1, 0, 0, 0)) });
+            auto clientFilters = Codec::msgRxFilters<Codec::Direction::ClientToAgent>(clientId, true, false);
+            filterArray.insert(filterArray.end(), clientFilters.begin(), clientFilters.end());
         }
 
         setRxFilters(filterArray);
@@ -35,6 +257,9 @@ MsgAgent::MsgAgent(int ifIndex, AgentMsgHandler &handler, std::span<const uint8_
 }
 
 void MsgAgent::transmitMessage(uint8_t clientId, uint8_t subtype, std::span<const uint8_t> data) {
+    if (clientId >= numClientIds) {
+        throw std::logic_error("Attempting to transmit canmore message with invalid client ID");
+    }
     if (subtype >= (1 << CANMORE_MSG_SUBTYPE_LENGTH)) {
         throw std::logic_error("Attempting to transmit canmore message with invalid message subtype");
     }
@@ -42,6 +267,15 @@ void MsgAgent::transmitMessage(uint8_t clientId, uint8_t subtype, std::span<cons
         throw std::logic_error("Attempting to transmit canmore message larger than max length");
     }
 
+    // A whole message fits in a single CAN XL frame, so there's nothing to fragment (or compress)
+    if (usingCanXl()) {
+        uint32_t canId = canmore_msg_encode_xl_id(clientId, CANMORE_DIRECTION_AGENT_TO_CLIENT, subtype, data.size());
+        transmitXlFrame(canId | CAN_EFF_FLAG, data);
+        stats[clientId].countFrameTx(data.size());
+        stats[clientId].countMessageTx(data.size());
+        return;
+    }
+
     // Get reference to the decoder for this client, expanding the vector as necessary
     size_t prevEncoderSize = encoders.size();
     if (prevEncoderSize <= clientId) {
@@ -54,11 +288,27 @@ void MsgAgent::transmitMessage(uint8_t clientId, uint8_t subtype, std::span<cons
     }
     auto &encoder = encoders[clientId];
 
+    // Compress the message if it saves at least one frame
+    std::array<uint8_t, CANMORE_MAX_MSG_LENGTH> compressedBuf;
+    size_t compressedLen = 0;
+    if (compressionEnabled && subtype != CANMORE_MSG_SUBTYPE_COMPRESSED) {
+        size_t targetLen = canmore_msg_compress_target_len(data.size(), usingCanFd());
+        if (targetLen > CANMORE_MSG_COMPRESSED_HEADER_SIZE) {
+            compressedLen = canmore_msg_compress(subtype, data.data(), data.size(), compressedBuf.data(), targetLen);
+        }
+    }
+
     // Load the message to encode
-    canmore_msg_encode_load(&encoder, subtype, data.data(), data.size());
+    if (compressedLen) {
+        canmore_msg_encode_load(&encoder, CANMORE_MSG_SUBTYPE_COMPRESSED, compressedBuf.data(), compressedLen);
+    }
+    else {
+        canmore_msg_encode_load(&encoder, subtype, data.data(), data.size());
+    }
 
     // Transmit frames until done
-    std::vector<uint8_t> frameBuf(getMaxFrameSize());
+    // The encoder only produces classic or FD frames, as XL messages are sent whole above
+    std::array<uint8_t, CANMORE_MAX_FD_FRAME_SIZE> frameBuf;
     do {
         uint8_t frameSize;
         uint32_t canId;
@@ -73,57 +323,111 @@ void MsgAgent::transmitMessage(uint8_t clientId, uint8_t subtype, std::span<cons
         }
 
         transmitFrame(canId, std::span<const uint8_t> { frameBuf.data(), frameSize });
+        stats[clientId].countFrameTx(frameSize);
     } while (!canmore_msg_encode_done(&encoder));
+
+    stats[clientId].countMessageTx(data.size());
+}
+
+void MsgAgent::subtypeFilterChanged(uint8_t clientId) {
+    canmore_msg_split_decode_set_subtype_filter(&decoders[clientId - 1].state, computeSubtypeFilter(clientId));
 }
 
 void MsgAgent::handleFrame(canid_t can_id, const std::span<const uint8_t> &data) {
-    if (can_id == 0x7FF)
-        abort();
+    ReceivedFrame frame = { can_id, data };
+    handleFrames(std::span<const ReceivedFrame> { &frame, 1 });
+}
 
-    bool isExtended = !!(can_id & CAN_EFF_FLAG);
-    canmore_id_t id = { .identifier = can_id };
+void MsgAgent::handleFrames(std::span<const ReceivedFrame> frames) {
+    // Filter out any frames which can't be decoded, collecting the rest to decode as a batch
+    std::array<canmore_msg_frame_t, rxBatchSize> batch;
+    size_t batchLen = 0;
 
-    // Sanity check to make sure we don't have two agents running
-    uint8_t direction = (isExtended ? id.pkt_ext.direction : id.pkt_std.direction);
-    if (direction == CANMORE_DIRECTION_AGENT_TO_CLIENT) {
-        // We've got another agent trying to talk
-        // Raise an error
-        handler.handleConflictingAgentError();
-        return;
-    }
+    for (auto &frame : frames) {
+        canid_t can_id = frame.can_id;
+        if (can_id == 0x7FF)
+            abort();
 
-    // Frame is from a client, begin processing
-    // First determine which decoder to use
-    uint8_t clientId = (isExtended ? id.pkt_ext.client_id : id.pkt_std.client_id);
+        bool isExtended = !!(can_id & CAN_EFF_FLAG);
+        canmore_id_t id = { .identifier = can_id };
 
-    // Client ID 0 is reversed for broadcasts, don't process
-    if (clientId == 0) {
-        handler.handleDecodeError(clientId, CANMORE_MSG_DECODER_ERROR_INVALID_CLIENT_ID);
-        return;
-    }
+        // Sanity check to make sure we don't have two agents running
+        uint8_t direction = (isExtended ? id.pkt_ext.direction : id.pkt_std.direction);
+        uint8_t clientId = (isExtended ? id.pkt_ext.client_id : id.pkt_std.client_id);
+        if (direction == CANMORE_DIRECTION_AGENT_TO_CLIENT) {
+            // We've got another agent trying to talk
+            // Raise an error
+            stats[clientId].countConflictingAgent();
+            handler.handleConflictingAgentError();
+            continue;
+        }
 
-    // Get reference to the decoder for this client, expanding the vector as necessary
-    size_t prevDecoderSize = decoders.size();
-    if (prevDecoderSize < clientId) {
-        decoders.resize(clientId);
+        // Client ID 0 is reversed for broadcasts, don't process
+        if (clientId == 0) {
+            stats[0].countDecodeError(CANMORE_MSG_DECODER_ERROR_INVALID_CLIENT_ID);
+            handler.handleDecodeError(clientId, CANMORE_MSG_DECODER_ERROR_INVALID_CLIENT_ID);
+            continue;
+        }
 
-        // Initialize the new decoders we just made
-        for (size_t i = prevDecoderSize; i < decoders.size(); i++) {
-            auto &argEntry = decoderErrorArgs.emplace_back(this, i + 1);  // Client ID is Index + 1
+        // The first frame of a message is always extended with sequence number 0
+        stats[clientId].countFrameRx(frame.data.size(), isExtended && id.pkt_ext.noc == 0);
 
-            canmore_msg_decode_init(&decoders[i], &MsgAgent::decoderErrorCallback, &argEntry, usingCanFd());
+        batch[batchLen++] = { .can_id = can_id & (isExtended ? CAN_EFF_MASK : CAN_SFF_MASK),
+                              .is_extended = isExtended,
+                              .len = (uint16_t) frame.data.size(),
+                              .data = frame.data.data() };
+        if (batchLen == batch.size()) {
+            decodeBatch(std::span<const canmore_msg_frame_t> { batch.data(), batchLen });
+            batchLen = 0;
         }
     }
-    auto &decoder = decoders[clientId - 1];
 
-    // Decode the frame
-    uint32_t canIdMasked = can_id & (isExtended ? CAN_EFF_MASK : CAN_SFF_MASK);
-    size_t decodeLen = canmore_msg_decode_frame(&decoder, canIdMasked, isExtended, data.data(), data.size());
+    decodeBatch(std::span<const canmore_msg_frame_t> { batch.data(), batchLen });
+}
+
+void MsgAgent::decodeBatch(std::span<const canmore_msg_frame_t> batch) {
+    const canmore_msg_decode_batch_ops_t ops = {
+        .lookup = &MsgAgent::batchLookupCallback,
+        .acquire_buffer = &MsgAgent::batchAcquireBufferCallback,
+        // Only clients in the middle of a message hold a reassembly buffer
+        .release_buffer = &MsgAgent::batchReleaseBufferCallback,
+        .arg = this,
+    };
+
+    std::array<canmore_msg_decoded_t, decodeBatchMaxMsgs> decoded;
+    size_t consumed = 0;
+    while (consumed < batch.size()) {
+        size_t decodedCount;
+        consumed += canmore_msg_decode_frames(&batch[consumed], batch.size() - consumed, &ops, decoded.data(),
+                                              decoded.size(), &decodedCount);
 
-    // If we got a complete message, call the receive handler
-    if (decodeLen > 0) {
-        uint8_t subtype = canmore_msg_decode_get_subtype(&decoder);
-        uint8_t *msgBuf = canmore_msg_decode_get_buf(&decoder);
-        handler.handleMessage(clientId, subtype, std::span<const uint8_t> { msgBuf, decodeLen });
+        // Call the subscribed callback, or the receive handler if there isn't one, for all the completed messages
+        // The decoder has already detached each buffer, so we own them until they're handed off or released
+        for (size_t i = 0; i < decodedCount; i++) {
+            auto &msg = decoded[i];
+            uint8_t clientId = (reinterpret_cast<DecoderSlot *>(msg.decoder) - decoders.data()) + 1;
+
+            stats[clientId].countMessageRx(msg.len);
+            if (!dispatchPooledMessage(clientId, msg.subtype, msg.buffer, msg.len)) {
+                bufferPool->release(msg.buffer);
+            }
+        }
     }
 }
+
+canmore_msg_split_decoder_t *MsgAgent::batchLookupCallback(void *arg, uint32_t can_id, bool is_extended) {
+    auto agent = (MsgAgent *) arg;
+    canmore_id_t id = { .identifier = can_id };
+    uint8_t clientId = (is_extended ? id.pkt_ext.client_id : id.pkt_std.client_id);
+    return &agent->decoders[clientId - 1].state;
+}
+
+uint8_t *MsgAgent::batchAcquireBufferCallback(void *arg) {
+    auto agent = (MsgAgent *) arg;
+    return agent->bufferPool->acquire();
+}
+
+void MsgAgent::batchReleaseBufferCallback(void *arg, uint8_t *buffer) {
+    auto agent = (MsgAgent *) arg;
+    agent->bufferPool->release(buffer);
+}
@@ -0,0 +1,158 @@
+#include "canmore_cpp/MsgAggregator.hpp"
+
+#include <poll.h>
+#include <stdexcept>
+#include <sys/timerfd.h>
+#include <system_error>
+#include <unistd.h>
+
+using namespace Canmore;
+
+MsgAggregator::MsgAggregator(MsgAgentBase &agent, std::chrono::microseconds flushDelay, size_t maxLength):
+    agent(agent), flushDelay(flushDelay), timerFd(-1) {
+    if (maxLength <= CANMORE_MSG_AGGREGATE_ENTRY_HEADER_SIZE || maxLength > CANMORE_MAX_MSG_LENGTH) {
+        throw std::logic_error("Invalid canmore aggregate message max length");
+    }
+
+    for (auto &entry : pending) {
+        entry.buffer.resize(maxLength);
+        canmore_msg_aggregate_init(&entry.state, entry.buffer.data(), entry.buffer.size());
+    }
+
+    if ((timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) < 0) {
+        throw std::system_error(errno, std::generic_category(), "timerfd_create");
+    }
+
+    timerPollDescriptor = PollFDDescriptor::create(*this, timerFd, POLLIN);
+}
+
+MsgAggregator::~MsgAggregator() {
+    if (timerFd >= 0) {
+        close(timerFd);
+    }
+}
+
+void MsgAggregator::queueMessage(uint8_t clientId, uint8_t subtype, std::span<const uint8_t> data) {
+    if (clientId >= numClientIds) {
+        throw std::logic_error("Attempting to queue canmore message with invalid client ID");
+    }
+    if (subtype == CANMORE_MSG_SUBTYPE_AGGREGATE || subtype >= (1 << CANMORE_MSG_SUBTYPE_LENGTH)) {
+        throw std::logic_error("Attempting to queue canmore message with invalid message subtype");
+    }
+
+    auto &entry = pending[clientId];
+
+    // Send what we have if this message won't fit
+    if (!canmore_msg_aggregate_fits(&entry.state, data.size())) {
+        flush(clientId);
+
+        // Still too big on its own, send it directly
+        if (!canmore_msg_aggregate_fits(&entry.state, data.size())) {
+            agent.transmitMessage(clientId, subtype, data);
+            return;
+        }
+    }
+
+    bool wasEmpty = (canmore_msg_aggregate_get_count(&entry.state) == 0);
+    canmore_msg_aggregate_add(&entry.state, subtype, data.data(), data.size());
+
+    if (wasEmpty) {
+        entry.deadline = std::chrono::steady_clock::now() + flushDelay;
+        updateTimer();
+    }
+}
+
+void MsgAggregator::flush(uint8_t clientId) {
+    if (clientId >= numClientIds) {
+        throw std::logic_error("Attempting to flush canmore messages with invalid client ID");
+    }
+
+    auto &entry = pending[clientId];
+    size_t count = canmore_msg_aggregate_get_count(&entry.state);
+    if (count == 0) {
+        return;
+    }
+
+    // Reset before transmitting, so the queue is left consistent if transmit throws
+    std::span<const uint8_t> msg { entry.buffer.data(), canmore_msg_aggregate_get_len(&entry.state) };
+    canmore_msg_aggregate_reset(&entry.state);
+
+    if (count == 1) {
+        // No point in paying for the entry header with a single message, unpack it and send it normally
+        canmore_msg_aggregate_iter_t iter;
+        canmore_msg_aggregate_iter_init(&iter, msg.data(), msg.size());
+
+        uint8_t subtype;
+        const uint8_t *data;
+        size_t len;
+        canmore_msg_aggregate_iter_next(&iter, &subtype, &data, &len);
+        agent.transmitMessage(clientId, subtype, std::span<const uint8_t> { data, len });
+    }
+    else {
+        agent.transmitMessage(clientId, CANMORE_MSG_SUBTYPE_AGGREGATE, msg);
+    }
+
+    updateTimer();
+}
+
+void MsgAggregator::flushAll() {
+    for (size_t clientId = 0; clientId < numClientIds; clientId++) {
+        flush(clientId);
+    }
+}
+
+void MsgAggregator::updateTimer() {
+    bool anyPending = false;
+    std::chrono::steady_clock::time_point earliest;
+    for (auto &entry : pending) {
+        if (canmore_msg_aggregate_get_count(&entry.state) > 0 && (!anyPending || entry.deadline < earliest)) {
+            earliest = entry.deadline;
+            anyPending = true;
+        }
+    }
+
+    // A zero it_value disarms the timer
+    struct itimerspec spec = {};
+    if (anyPending) {
+        auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(earliest - std::chrono::steady_clock::now());
+        if (remaining.count() <= 0) {
+            // Already expired, fire as soon as possible
+            remaining = std::chrono::nanoseconds(1);
+        }
+        spec.it_value.tv_sec = remaining.count() / 1000000000;
+        spec.it_value.tv_nsec = remaining.count() % 1000000000;
+    }
+
+    if (timerfd_settime(timerFd, 0, &spec, NULL) < 0) {
+        throw std::system_error(errno, std::generic_category(), "timerfd_settime");
+    }
+}
+
+void MsgAggregator::populateFds(std::vector<std::weak_ptr<PollFDDescriptor>> &descriptors) {
+    descriptors.push_back(timerPollDescriptor);
+}
+
+void MsgAggregator::handleEvent(const pollfd &fd) {
+    if (!(fd.revents & POLLIN)) {
+        throw std::runtime_error("Unexpected event on aggregator timer");
+    }
+
+    uint64_t expirations;
+    if (read(timerFd, &expirations, sizeof(expirations)) < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            return;
+        }
+        throw std::system_error(errno, std::generic_category(), "read");
+    }
+
+    // Send everything which has reached its deadline
+    auto now = std::chrono::steady_clock::now();
+    for (size_t clientId = 0; clientId < numClientIds; clientId++) {
+        auto &entry = pending[clientId];
+        if (canmore_msg_aggregate_get_count(&entry.state) > 0 && entry.deadline <= now) {
+            flush(clientId);
+        }
+    }
+
+    updateTimer();
+}
@@ -0,0 +1,68 @@
+#include "canmore_cpp/MsgBufferPool.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace Canmore;
+
+void MsgBufferPool::reserve(size_t count) {
+    std::lock_guard<std::mutex> guard(lock);
+    while (freeBuffers.size() < count && storage.size() < maxBuffers) {
+        freeBuffers.push_back(storage.emplace_back(new uint8_t[bufferSize]).get());
+    }
+}
+
+uint8_t *MsgBufferPool::acquire() {
+    std::lock_guard<std::mutex> guard(lock);
+    if (freeBuffers.empty()) {
+        if (storage.size() >= maxBuffers) {
+            return nullptr;
+        }
+        return storage.emplace_back(new uint8_t[bufferSize]).get();
+    }
+
+    uint8_t *buffer = freeBuffers.back();
+    freeBuffers.pop_back();
+    return buffer;
+}
+
+void MsgBufferPool::release(uint8_t *buffer) {
+    std::lock_guard<std::mutex> guard(lock);
+    freeBuffers.push_back(buffer);
+}
+
+MsgBuffer MsgBufferPool::share(uint8_t *buffer, size_t len) {
+    if (len > bufferSize) {
+        throw std::logic_error("Attempting to share message buffer with length larger than the buffer size");
+    }
+
+    // The deleter holds a reference to the pool, so the pool stays alive until every buffer has been returned
+    auto pool = shared_from_this();
+    return MsgBuffer(std::shared_ptr<const uint8_t>(buffer, [pool](const uint8_t *ptr) {
+                         pool->release(const_cast<uint8_t *>(ptr));
+                     }),
+                     len);
+}
+
+MsgBuffer MsgBufferPool::copy(std::span<const uint8_t> data) {
+    if (data.size() > bufferSize) {
+        throw std::logic_error("Attempting to copy message larger than the buffer size into pool");
+    }
+
+    uint8_t *buffer = acquire();
+    if (!buffer) {
+        return MsgBuffer();
+    }
+    std::copy(data.begin(), data.end(), buffer);
+    return share(buffer, data.size());
+}
+
+size_t MsgBufferPool::allocatedCount() {
+    std::lock_guard<std::mutex> guard(lock);
+    return storage.size();
+}
+
+size_t MsgBufferPool::freeCount() {
+    std::lock_guard<std::mutex> guard(lock);
+    return freeBuffers.size();
+}
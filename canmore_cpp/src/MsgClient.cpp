@@ -1,24 +1,196 @@
 #include "canmore_cpp/MsgClient.hpp"
+#include "canmore_cpp/MsgCodec.hpp"
+
+#include "canmore/msg_aggregation.h"
+#include "canmore/msg_compression.h"
+
+#include <array>
 
 using namespace Canmore;
 
+// ========================================
+// Transport Independent Base
+// ========================================
+
+MsgClientBase::MsgClientBase(uint8_t clientId, ClientMsgHandler &handler):
+    clientId(clientId), handler(handler), bufferPool(MsgBufferPool::create()),
+    subscriptions(1 << CANMORE_MSG_SUBTYPE_LENGTH) {}
+
+void MsgClientBase::subscribe(uint8_t subtype, ClientMsgCB callback) {
+    if (!callback) {
+        throw std::logic_error("Attempting to subscribe to canmore messages with an empty callback");
+    }
+    setSubscription(subtype, Subscription { .callback = callback, .ownedCallback = nullptr });
+}
+
+void MsgClientBase::subscribeOwned(uint8_t subtype, ClientOwnedMsgCB callback) {
+    if (!callback) {
+        throw std::logic_error("Attempting to subscribe to canmore messages with an empty callback");
+    }
+    setSubscription(subtype, Subscription { .callback = nullptr, .ownedCallback = callback });
+}
+
+void MsgClientBase::unsubscribe(uint8_t subtype) {
+    setSubscription(subtype, Subscription {});
+}
+
+void MsgClientBase::setDefaultHandlerEnabled(bool enabled) {
+    defaultHandlerEnabled = enabled;
+    updateSubtypeFilter();
+}
+
+void MsgClientBase::setSubscription(uint8_t subtype, const Subscription &subscription) {
+    if (subtype >= subscriptions.size()) {
+        throw std::logic_error("Attempting to subscribe to canmore messages with invalid message subtype");
+    }
+    subscriptions[subtype] = subscription;
+    updateSubtypeFilter();
+}
+
+void MsgClientBase::updateSubtypeFilter() {
+    uint64_t filter = 0;
+    if (defaultHandlerEnabled) {
+        filter = CANMORE_MSG_SUBTYPE_FILTER_ALL;
+    }
+    else {
+        for (size_t subtype = 0; subtype < subscriptions.size(); subtype++) {
+            if (subscriptions[subtype]) {
+                filter |= CANMORE_MSG_SUBTYPE_FILTER_BIT(subtype);
+            }
+        }
+
+        // Subscribed messages may also arrive inside an aggregate or compressed message
+        if (filter) {
+            filter |= CANMORE_MSG_SUBTYPE_FILTER_BIT(CANMORE_MSG_SUBTYPE_AGGREGATE);
+            filter |= CANMORE_MSG_SUBTYPE_FILTER_BIT(CANMORE_MSG_SUBTYPE_COMPRESSED);
+        }
+    }
+    subtypeFilterChanged(filter);
+}
+
+bool MsgClientBase::shouldUnpack(uint8_t subtype) const {
+    if (subtype != CANMORE_MSG_SUBTYPE_AGGREGATE && subtype != CANMORE_MSG_SUBTYPE_COMPRESSED) {
+        return false;
+    }
+    return !subscriptions[subtype];
+}
+
+void MsgClientBase::dispatchAggregate(std::span<const uint8_t> data, bool inCompressed) {
+    canmore_msg_aggregate_iter_t iter;
+    canmore_msg_aggregate_iter_init(&iter, data.data(), data.size());
+
+    uint8_t subtype;
+    const uint8_t *entryData;
+    size_t entryLen;
+    while (canmore_msg_aggregate_iter_next(&iter, &subtype, &entryData, &entryLen)) {
+        dispatchInner(subtype, std::span<const uint8_t> { entryData, entryLen }, inCompressed);
+    }
+
+    if (canmore_msg_aggregate_iter_malformed(&iter)) {
+        stats.countDecodeError(CANMORE_MSG_DECODER_ERROR_MALFORMED_AGGREGATE);
+        handler.handleDecodeError(CANMORE_MSG_DECODER_ERROR_MALFORMED_AGGREGATE);
+    }
+}
+
+void MsgClientBase::dispatchCompressed(std::span<const uint8_t> data, bool inCompressed) {
+    // Compressed messages can't contain another compressed message, see MsgAgentBase::dispatchCompressed
+    if (inCompressed) {
+        stats.countDecodeError(CANMORE_MSG_DECODER_ERROR_MALFORMED_COMPRESSED);
+        handler.handleDecodeError(CANMORE_MSG_DECODER_ERROR_MALFORMED_COMPRESSED);
+        return;
+    }
+
+    uint8_t *buffer = bufferPool->acquire();
+    if (!buffer) {
+        stats.countDecodeError(CANMORE_MSG_DECODER_ERROR_NO_BUFFER);
+        handler.handleDecodeError(CANMORE_MSG_DECODER_ERROR_NO_BUFFER);
+        return;
+    }
+
+    uint8_t subtype;
+    size_t len = canmore_msg_decompress(data.data(), data.size(), &subtype, buffer, bufferPool->bufferSize);
+    if (len == 0) {
+        bufferPool->release(buffer);
+        stats.countDecodeError(CANMORE_MSG_DECODER_ERROR_MALFORMED_COMPRESSED);
+        handler.handleDecodeError(CANMORE_MSG_DECODER_ERROR_MALFORMED_COMPRESSED);
+        return;
+    }
+
+    // The buffer is returned to the pool once dispatch finishes, unless an owned subscriber keeps the message
+    MsgBuffer msg = bufferPool->share(buffer, len);
+    ClientOwnedMsgCB ownedCallback = subscriptions[subtype].ownedCallback;
+    if (ownedCallback) {
+        ownedCallback(subtype, std::move(msg));
+    }
+    else {
+        dispatchInner(subtype, msg.data(), true);
+    }
+}
+
+void MsgClientBase::dispatchMessage(uint8_t subtype, std::span<const uint8_t> data) {
+    dispatchInner(subtype, data, false);
+}
+
+void MsgClientBase::dispatchInner(uint8_t subtype, std::span<const uint8_t> data, bool inCompressed) {
+    if (shouldUnpack(subtype)) {
+        if (subtype == CANMORE_MSG_SUBTYPE_COMPRESSED) {
+            dispatchCompressed(data, inCompressed);
+        }
+        else {
+            dispatchAggregate(data, inCompressed);
+        }
+        return;
+    }
+
+    // The subscription is copied, as the callback may replace its own subscription while it runs
+    Subscription subscription = subscriptions[subtype];
+    if (subscription.callback) {
+        subscription.callback(subtype, data);
+    }
+    else if (subscription.ownedCallback) {
+        // The message isn't in a pool buffer, so it must be copied to hand off ownership
+        MsgBuffer buffer = bufferPool->copy(data);
+        if (buffer) {
+            subscription.ownedCallback(subtype, std::move(buffer));
+        }
+        else {
+            stats.countDecodeError(CANMORE_MSG_DECODER_ERROR_NO_BUFFER);
+            handler.handleDecodeError(CANMORE_MSG_DECODER_ERROR_NO_BUFFER);
+        }
+    }
+    else if (defaultHandlerEnabled) {
+        handler.handleMessage(subtype, data);
+    }
+}
+
+bool MsgClientBase::dispatchPooledMessage(uint8_t subtype, uint8_t *buffer, size_t len) {
+    // Copied for the same reason as in dispatchMessage
+    ClientOwnedMsgCB ownedCallback = subscriptions[subtype].ownedCallback;
+    if (ownedCallback) {
+        ownedCallback(subtype, bufferPool->share(buffer, len));
+        return true;
+    }
+
+    dispatchMessage(subtype, std::span<const uint8_t> { buffer, len });
+    return false;
+}
+
+// ========================================
+// CAN Client
+// ========================================
+
 MsgClient::MsgClient(int ifIndex, uint8_t clientId, ClientMsgHandler &handler):
-    CANSocket(ifIndex), clientId(clientId), handler(handler) {
+    CANSocket(ifIndex), MsgClientBase(clientId, handler) {
     // Check if the socket initialized in CAN FD mode - configure the encoder/decoder with this
     bool useFd = usingCanFd();
 
     // Initialize Encoder/Decoder
     canmore_msg_encode_init(&encoder, clientId, CANMORE_DIRECTION_CLIENT_TO_AGENT, useFd);
-    canmore_msg_decode_init(&decoder, &MsgClient::decoderErrorCallback, this, useFd);
+    canmore_msg_split_decode_init(&decoder, &MsgClient::decoderErrorCallback, this, useFd);
 
     // Setup Receive Filter
     // Need to match both standard CAN frames and extended CAN message frames for this client from the agent
-    struct can_filter rfilter[] = {
-        { .can_id = CANMORE_CALC_MSG_ID_A2C(clientId, 0),
-          .can_mask = (CAN_EFF_FLAG | CAN_RTR_FLAG | CANMORE_CALC_FILTER_MASK(1, 1, 1, 0)) },
-        { .can_id = CAN_EFF_FLAG | CANMORE_CALC_MSG_EXT_ID_A2C(clientId, 0, 0),
-          .can_mask = (CAN_EFF_FLAG | CAN_RTR_FLAG | CANMORE_CALC_EXT_FILTER_MASK(1, 1, 1, 0, 0)) },
-    };
+    auto rfilter = Codec::msgRxFilters<Codec::Direction::AgentToClient>(clientId);
     setRxFilters(std::span<can_filter> { rfilter });
 }
 
@@ -29,9 +201,35 @@ void MsgClient::transmitMessage(uint8_t subtype, std::span<const uint8_t> data)
     if (data.size() > CANMORE_MAX_MSG_LENGTH) {
         throw std::logic_error("Attempting to transmit canmore message larger than max length");
     }
-    canmore_msg_encode_load(&encoder, subtype, data.data(), data.size());
 
-    std::vector<uint8_t> frameBuf(getMaxFrameSize());
+    // A whole message fits in a single CAN XL frame, so there's nothing to fragment (or compress)
+    if (usingCanXl()) {
+        uint32_t canId = canmore_msg_encode_xl_id(clientId, CANMORE_DIRECTION_CLIENT_TO_AGENT, subtype, data.size());
+        transmitXlFrame(canId | CAN_EFF_FLAG, data);
+        stats.countFrameTx(data.size());
+        stats.countMessageTx(data.size());
+        return;
+    }
+
+    // Compress the message if it saves at least one frame
+    std::array<uint8_t, CANMORE_MAX_MSG_LENGTH> compressedBuf;
+    size_t compressedLen = 0;
+    if (compressionEnabled && subtype != CANMORE_MSG_SUBTYPE_COMPRESSED) {
+        size_t targetLen = canmore_msg_compress_target_len(data.size(), usingCanFd());
+        if (targetLen > CANMORE_MSG_COMPRESSED_HEADER_SIZE) {
+            compressedLen = canmore_msg_compress(subtype, data.data(), data.size(), compressedBuf.data(), targetLen);
+        }
+    }
+
+    if (compressedLen) {
+        canmore_msg_encode_load(&encoder, CANMORE_MSG_SUBTYPE_COMPRESSED, compressedBuf.data(), compressedLen);
+    }
+    else {
+        canmore_msg_encode_load(&encoder, subtype, data.data(), data.size());
+    }
+
+    // The encoder only produces classic or FD frames, as XL messages are sent whole above
+    std::array<uint8_t, CANMORE_MAX_FD_FRAME_SIZE> frameBuf;
     do {
         uint8_t frameSize;
         uint32_t canId;
@@ -46,20 +244,39 @@ void MsgClient::transmitMessage(uint8_t subtype, std::span<const uint8_t> data)
         }
 
         transmitFrame(canId, std::span<const uint8_t> { frameBuf.data(), frameSize });
+        stats.countFrameTx(frameSize);
     } while ((!canmore_msg_encode_done(&encoder)));
+
+    stats.countMessageTx(data.size());
+}
+
+void MsgClient::subtypeFilterChanged(uint64_t filter) {
+    canmore_msg_split_decode_set_subtype_filter(&decoder, filter);
 }
 
 void MsgClient::handleFrame(canid_t canId, const std::span<const uint8_t> &data) {
     bool isExtended = !!(canId & CAN_EFF_FLAG);
     uint32_t canIdMasked = canId & (isExtended ? CAN_EFF_MASK : CAN_SFF_MASK);
 
-    // Decode the frame
-    size_t decodeLen = canmore_msg_decode_frame(&decoder, canIdMasked, isExtended, data.data(), data.size());
+    // Decode the frame (the first frame of a message is always extended with sequence number 0)
+    canmore_id_t id = { .identifier = canIdMasked };
+    stats.countFrameRx(data.size(), isExtended && id.pkt_ext.noc == 0);
 
-    // If we got a complete message, call the receive handler
+    // The buffer stays attached between messages, unless it was handed off with the last message
+    if (canmore_msg_split_decode_needs_buffer(&decoder, canIdMasked, isExtended)) {
+        canmore_msg_split_decode_attach_buffer(&decoder, bufferPool->acquire());
+    }
+
+    size_t decodeLen = canmore_msg_split_decode_frame(&decoder, canIdMasked, isExtended, data.data(), data.size());
+
+    // If we got a complete message, call the subscribed callback, or the receive handler if there isn't one
     if (decodeLen > 0) {
-        uint8_t subtype = canmore_msg_decode_get_subtype(&decoder);
-        uint8_t *msgBuf = canmore_msg_decode_get_buf(&decoder);
-        handler.handleMessage(subtype, std::span<const uint8_t> { msgBuf, decodeLen });
+        stats.countMessageRx(decodeLen);
+
+        if (dispatchPooledMessage(canmore_msg_split_decode_get_subtype(&decoder),
+                                  canmore_msg_split_decode_get_buf(&decoder), decodeLen)) {
+            // Ownership of the buffer has been passed on, the next message will reassemble into a fresh buffer
+            canmore_msg_split_decode_detach_buffer(&decoder);
+        }
     }
 }
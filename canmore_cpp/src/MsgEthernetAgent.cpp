@@ -0,0 +1,217 @@
+#include "canmore_cpp/MsgAgent.hpp"
+
+#include <arpa/inet.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <system_error>
+#include <unistd.h>
+
+using namespace Canmore;
+
+MsgEthernetAgent::MsgEthernetAgent(AgentMsgHandler &handler, uint16_t port, struct in_addr bindAddr):
+    MsgAgentBase(handler), socketFd(-1), clientAddrs({}), rxBuffer(rxBatchSize * CANMORE_ETH_MSG_MAX_LEN) {
+    // Open socket
+    if ((socketFd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0) {
+        throw std::system_error(errno, std::generic_category(), "socket");
+    }
+
+    // Bind to the message port, this socket will receive messages from all clients
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr = bindAddr;
+    addr.sin_port = htons(port);
+
+    if (bind(socketFd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+        close(socketFd);
+        socketFd = -1;
+        throw std::system_error(errno, std::generic_category(), "bind");
+    }
+
+    socketPollDescriptor = PollFDDescriptor::create(*this, socketFd, POLLIN);
+}
+
+MsgEthernetAgent::~MsgEthernetAgent() {
+    if (socketFd >= 0) {
+        close(socketFd);
+    }
+}
+
+void MsgEthernetAgent::setClientAddress(uint8_t clientId, struct in_addr ipAddr, uint16_t port) {
+    if (clientId == 0 || clientId >= numClientIds) {
+        throw std::logic_error("Attempting to set ethernet address for invalid client ID");
+    }
+
+    auto &addr = clientAddrs[clientId];
+    addr.sin_family = AF_INET;
+    addr.sin_addr = ipAddr;
+    addr.sin_port = htons(port);
+}
+
+void MsgEthernetAgent::transmitMessage(uint8_t clientId, uint8_t subtype, std::span<const uint8_t> data) {
+    if (clientId >= numClientIds) {
+        throw std::logic_error("Attempting to transmit canmore message with invalid client ID");
+    }
+    if (subtype >= numSubtypes) {
+        throw std::logic_error("Attempting to transmit canmore message with invalid message subtype");
+    }
+    if (data.size() > CANMORE_MAX_MSG_LENGTH) {
+        throw std::logic_error("Attempting to transmit canmore message larger than max length");
+    }
+
+    struct canmore_eth_msg_header header = {};
+    header.client_id = clientId;
+    header.direction = CANMORE_DIRECTION_AGENT_TO_CLIENT;
+    header.subtype = subtype;
+    header.length = data.size();
+    uint8_t headerBuf[CANMORE_ETH_MSG_HEADER_LEN];
+    canmore_eth_msg_header_pack(&header, headerBuf);
+
+    // Send the header and data in place, without copying them into a single buffer
+    struct iovec iov[2] = {
+        { .iov_base = headerBuf, .iov_len = sizeof(headerBuf) },
+        { .iov_base = const_cast<uint8_t *>(data.data()), .iov_len = data.size() },
+    };
+    size_t datagramLen = sizeof(headerBuf) + data.size();
+
+    // Collect the destinations, with broadcasts going to every known client
+    std::vector<struct mmsghdr> msgs;
+    uint8_t firstClient = (clientId == 0 ? 1 : clientId);
+    uint8_t lastClient = (clientId == 0 ? numClientIds - 1 : clientId);
+    for (unsigned int id = firstClient; id <= lastClient; id++) {
+        if (clientAddrs[id].sin_family != AF_INET) {
+            continue;
+        }
+
+        struct mmsghdr msg = {};
+        msg.msg_hdr.msg_name = &clientAddrs[id];
+        msg.msg_hdr.msg_namelen = sizeof(clientAddrs[id]);
+        msg.msg_hdr.msg_iov = iov;
+        msg.msg_hdr.msg_iovlen = 2;
+        msgs.push_back(msg);
+    }
+
+    if (msgs.empty()) {
+        if (clientId == 0) {
+            // Nobody to broadcast to, which is not an error
+            return;
+        }
+        throw std::runtime_error("Attempting to transmit canmore message to ethernet client with unknown address");
+    }
+
+    // Send all datagrams with a single syscall
+    size_t sent = 0;
+    while (sent < msgs.size()) {
+        int rc = sendmmsg(socketFd, &msgs[sent], msgs.size() - sent, 0);
+        if (rc < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "sendmmsg");
+        }
+        sent += rc;
+    }
+
+    stats[clientId].countFrameTx(datagramLen * msgs.size());
+    stats[clientId].countMessageTx(data.size());
+}
+
+void MsgEthernetAgent::populateFds(std::vector<std::weak_ptr<PollFDDescriptor>> &descriptors) {
+    descriptors.push_back(socketPollDescriptor);
+}
+
+void MsgEthernetAgent::handleEvent(const pollfd &fd) {
+    if (!(fd.revents & POLLIN)) {
+        throw std::runtime_error("Unexpected event on ethernet message socket");
+    }
+
+    // Receive as many datagrams as are available (up to the batch size) in a single syscall
+    std::array<struct mmsghdr, rxBatchSize> msgs = {};
+    std::array<struct iovec, rxBatchSize> iovs;
+    std::array<struct sockaddr_in, rxBatchSize> srcAddrs;
+    for (size_t i = 0; i < rxBatchSize; i++) {
+        iovs[i].iov_base = &rxBuffer[i * CANMORE_ETH_MSG_MAX_LEN];
+        iovs[i].iov_len = CANMORE_ETH_MSG_MAX_LEN;
+        msgs[i].msg_hdr.msg_name = &srcAddrs[i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(srcAddrs[i]);
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int count = recvmmsg(socketFd, msgs.data(), msgs.size(), MSG_DONTWAIT, NULL);
+    if (count < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            return;
+        }
+        throw std::system_error(errno, std::generic_category(), "recvmmsg");
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (msgs[i].msg_hdr.msg_namelen != sizeof(struct sockaddr_in) || srcAddrs[i].sin_family != AF_INET) {
+            continue;
+        }
+        handleDatagram(srcAddrs[i], std::span<const uint8_t> { &rxBuffer[i * CANMORE_ETH_MSG_MAX_LEN], msgs[i].msg_len },
+                       !!(msgs[i].msg_hdr.msg_flags & MSG_TRUNC));
+    }
+}
+
+void MsgEthernetAgent::handleDatagram(const struct sockaddr_in &srcAddr, std::span<const uint8_t> datagram,
+                                      bool truncated) {
+    struct canmore_eth_msg_header header;
+    if (datagram.size() < CANMORE_ETH_MSG_HEADER_LEN) {
+        stats[0].countDecodeError(CANMORE_MSG_DECODER_ERROR_MSG_TOO_SMALL);
+        handler.handleDecodeError(0, CANMORE_MSG_DECODER_ERROR_MSG_TOO_SMALL);
+        return;
+    }
+    if (!canmore_eth_msg_header_unpack(datagram.data(), &header)) {
+        stats[0].countDecodeError(CANMORE_MSG_DECODER_ERROR_INVALID_CLIENT_ID);
+        handler.handleDecodeError(0, CANMORE_MSG_DECODER_ERROR_INVALID_CLIENT_ID);
+        return;
+    }
+    auto data = datagram.subspan(CANMORE_ETH_MSG_HEADER_LEN);
+
+    // Sanity check to make sure we don't have two agents running
+    uint8_t clientId = header.client_id;
+    if (header.direction == CANMORE_DIRECTION_AGENT_TO_CLIENT) {
+        stats[clientId].countConflictingAgent();
+        handler.handleConflictingAgentError();
+        return;
+    }
+
+    // Client ID 0 is reversed for broadcasts, don't process
+    if (clientId == 0) {
+        stats[0].countDecodeError(CANMORE_MSG_DECODER_ERROR_INVALID_CLIENT_ID);
+        handler.handleDecodeError(0, CANMORE_MSG_DECODER_ERROR_INVALID_CLIENT_ID);
+        return;
+    }
+
+    auto &clientStats = stats[clientId];
+    clientStats.countFrameRx(datagram.size(), true);
+
+    // Make sure the length in the header matches the datagram
+    unsigned int errorCode = 0;
+    bool error = true;
+    if (truncated || header.length > CANMORE_MAX_MSG_LENGTH) {
+        errorCode = CANMORE_MSG_DECODER_ERROR_MSG_TOO_LARGE;
+    }
+    else if (data.size() < header.length) {
+        errorCode = CANMORE_MSG_DECODER_ERROR_MSG_TOO_SMALL;
+    }
+    else if (data.size() > header.length) {
+        errorCode = CANMORE_MSG_DECODER_ERROR_UNEXPECTED_DATA;
+    }
+    else {
+        error = false;
+    }
+
+    if (error) {
+        clientStats.countDecodeError(errorCode);
+        handler.handleDecodeError(clientId, errorCode);
+        return;
+    }
+
+    // Remember where this client is, so we can reply to it
+    clientAddrs[clientId] = srcAddr;
+
+    clientStats.countMessageRx(data.size());
+    dispatchMessage(clientId, header.subtype & (numSubtypes - 1), data);
+}
@@ -0,0 +1,154 @@
+#include "canmore_cpp/MsgClient.hpp"
+
+#include <arpa/inet.h>
+#include <array>
+#include <poll.h>
+#include <sys/socket.h>
+#include <system_error>
+#include <unistd.h>
+
+using namespace Canmore;
+
+MsgEthernetClient::MsgEthernetClient(struct in_addr agentAddr, uint8_t clientId, ClientMsgHandler &handler,
+                                     uint16_t port):
+    MsgClientBase(clientId, handler),
+    socketFd(-1), rxBuffer(rxBatchSize * CANMORE_ETH_MSG_MAX_LEN) {
+    if (clientId == 0 || clientId >= (1 << CANMORE_CLIENT_ID_LENGTH)) {
+        throw std::logic_error("Attempting to create canmore ethernet message client with invalid client ID");
+    }
+
+    // Open socket
+    if ((socketFd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0) {
+        throw std::system_error(errno, std::generic_category(), "socket");
+    }
+
+    // Connect to the agent, so that we only receive datagrams from it
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr = agentAddr;
+    addr.sin_port = htons(port);
+
+    if (connect(socketFd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+        close(socketFd);
+        socketFd = -1;
+        throw std::system_error(errno, std::generic_category(), "connect");
+    }
+
+    socketPollDescriptor = PollFDDescriptor::create(*this, socketFd, POLLIN);
+}
+
+MsgEthernetClient::~MsgEthernetClient() {
+    if (socketFd >= 0) {
+        close(socketFd);
+    }
+}
+
+void MsgEthernetClient::transmitMessage(uint8_t subtype, std::span<const uint8_t> data) {
+    if (subtype >= (1 << CANMORE_MSG_SUBTYPE_LENGTH)) {
+        throw std::logic_error("Attempting to transmit canmore message with invalid message subtype");
+    }
+    if (data.size() > CANMORE_MAX_MSG_LENGTH) {
+        throw std::logic_error("Attempting to transmit canmore message larger than max length");
+    }
+
+    struct canmore_eth_msg_header header = {};
+    header.client_id = clientId;
+    header.direction = CANMORE_DIRECTION_CLIENT_TO_AGENT;
+    header.subtype = subtype;
+    header.length = data.size();
+    uint8_t headerBuf[CANMORE_ETH_MSG_HEADER_LEN];
+    canmore_eth_msg_header_pack(&header, headerBuf);
+
+    // Send the header and data in place, without copying them into a single buffer
+    struct iovec iov[2] = {
+        { .iov_base = headerBuf, .iov_len = sizeof(headerBuf) },
+        { .iov_base = const_cast<uint8_t *>(data.data()), .iov_len = data.size() },
+    };
+    struct msghdr msg = {};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+
+    size_t datagramLen = sizeof(headerBuf) + data.size();
+    if (sendmsg(socketFd, &msg, 0) != (ssize_t) datagramLen) {
+        throw std::system_error(errno, std::generic_category(), "sendmsg");
+    }
+
+    stats.countFrameTx(datagramLen);
+    stats.countMessageTx(data.size());
+}
+
+void MsgEthernetClient::populateFds(std::vector<std::weak_ptr<PollFDDescriptor>> &descriptors) {
+    descriptors.push_back(socketPollDescriptor);
+}
+
+void MsgEthernetClient::handleEvent(const pollfd &fd) {
+    if (!(fd.revents & POLLIN)) {
+        throw std::runtime_error("Unexpected event on ethernet message socket");
+    }
+
+    // Receive as many datagrams as are available (up to the batch size) in a single syscall
+    std::array<struct mmsghdr, rxBatchSize> msgs = {};
+    std::array<struct iovec, rxBatchSize> iovs;
+    for (size_t i = 0; i < rxBatchSize; i++) {
+        iovs[i].iov_base = &rxBuffer[i * CANMORE_ETH_MSG_MAX_LEN];
+        iovs[i].iov_len = CANMORE_ETH_MSG_MAX_LEN;
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int count = recvmmsg(socketFd, msgs.data(), msgs.size(), MSG_DONTWAIT, NULL);
+    if (count < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            return;
+        }
+        throw std::system_error(errno, std::generic_category(), "recvmmsg");
+    }
+
+    for (int i = 0; i < count; i++) {
+        handleDatagram(std::span<const uint8_t> { &rxBuffer[i * CANMORE_ETH_MSG_MAX_LEN], msgs[i].msg_len },
+                       !!(msgs[i].msg_hdr.msg_flags & MSG_TRUNC));
+    }
+}
+
+void MsgEthernetClient::handleDatagram(std::span<const uint8_t> datagram, bool truncated) {
+    stats.countFrameRx(datagram.size(), true);
+
+    struct canmore_eth_msg_header header;
+    unsigned int errorCode = 0;
+    bool error = true;
+    if (datagram.size() < CANMORE_ETH_MSG_HEADER_LEN) {
+        errorCode = CANMORE_MSG_DECODER_ERROR_MSG_TOO_SMALL;
+    }
+    else {
+        bool headerValid = canmore_eth_msg_header_unpack(datagram.data(), &header);
+        size_t dataLen = datagram.size() - CANMORE_ETH_MSG_HEADER_LEN;
+
+        // Only accept messages from the agent addressed to us (or broadcast), with a length matching the datagram
+        if (!headerValid || header.direction != CANMORE_DIRECTION_AGENT_TO_CLIENT ||
+            (header.client_id != clientId && header.client_id != 0)) {
+            errorCode = CANMORE_MSG_DECODER_ERROR_INVALID_CLIENT_ID;
+        }
+        else if (truncated || header.length > CANMORE_MAX_MSG_LENGTH) {
+            errorCode = CANMORE_MSG_DECODER_ERROR_MSG_TOO_LARGE;
+        }
+        else if (dataLen < header.length) {
+            errorCode = CANMORE_MSG_DECODER_ERROR_MSG_TOO_SMALL;
+        }
+        else if (dataLen > header.length) {
+            errorCode = CANMORE_MSG_DECODER_ERROR_UNEXPECTED_DATA;
+        }
+        else {
+            error = false;
+        }
+    }
+
+    if (error) {
+        stats.countDecodeError(errorCode);
+        handler.handleDecodeError(errorCode);
+        return;
+    }
+
+    auto data = datagram.subspan(CANMORE_ETH_MSG_HEADER_LEN);
+    stats.countMessageRx(data.size());
+    dispatchMessage(header.subtype & ((1 << CANMORE_MSG_SUBTYPE_LENGTH) - 1), data);
+}
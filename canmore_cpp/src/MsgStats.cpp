@@ -0,0 +1,78 @@
+#include "canmore_cpp/MsgStats.hpp"
+
+using namespace Canmore;
+
+uint64_t MsgStatsSnapshot::totalDecodeErrors() const {
+    uint64_t total = 0;
+    for (auto count : decodeErrors) {
+        total += count;
+    }
+    return total;
+}
+
+MsgStatsSnapshot &MsgStatsSnapshot::operator+=(const MsgStatsSnapshot &other) {
+    framesRx += other.framesRx;
+    frameBytesRx += other.frameBytesRx;
+    messagesRx += other.messagesRx;
+    msgBytesRx += other.msgBytesRx;
+    conflictingAgent += other.conflictingAgent;
+    for (size_t i = 0; i < decodeErrors.size(); i++) {
+        decodeErrors[i] += other.decodeErrors[i];
+    }
+    framesTx += other.framesTx;
+    frameBytesTx += other.frameBytesTx;
+    messagesTx += other.messagesTx;
+    msgBytesTx += other.msgBytesTx;
+    for (size_t i = 0; i < reassemblyTimeHist.size(); i++) {
+        reassemblyTimeHist[i] += other.reassemblyTimeHist[i];
+    }
+    return *this;
+}
+
+MsgStatsSnapshot MsgStats::snapshot() const {
+    MsgStatsSnapshot snap;
+    snap.framesRx = framesRx.load(std::memory_order_relaxed);
+    snap.frameBytesRx = frameBytesRx.load(std::memory_order_relaxed);
+    snap.messagesRx = messagesRx.load(std::memory_order_relaxed);
+    snap.msgBytesRx = msgBytesRx.load(std::memory_order_relaxed);
+    snap.conflictingAgent = conflictingAgent.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < decodeErrors.size(); i++) {
+        snap.decodeErrors[i] = decodeErrors[i].load(std::memory_order_relaxed);
+    }
+    snap.framesTx = framesTx.load(std::memory_order_relaxed);
+    snap.frameBytesTx = frameBytesTx.load(std::memory_order_relaxed);
+    snap.messagesTx = messagesTx.load(std::memory_order_relaxed);
+    snap.msgBytesTx = msgBytesTx.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < reassemblyTimeHist.size(); i++) {
+        snap.reassemblyTimeHist[i] = reassemblyTimeHist[i].load(std::memory_order_relaxed);
+    }
+    return snap;
+}
+
+void MsgStats::reset() {
+    framesRx.store(0, std::memory_order_relaxed);
+    frameBytesRx.store(0, std::memory_order_relaxed);
+    messagesRx.store(0, std::memory_order_relaxed);
+    msgBytesRx.store(0, std::memory_order_relaxed);
+    conflictingAgent.store(0, std::memory_order_relaxed);
+    for (auto &counter : decodeErrors) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+    framesTx.store(0, std::memory_order_relaxed);
+    frameBytesTx.store(0, std::memory_order_relaxed);
+    messagesTx.store(0, std::memory_order_relaxed);
+    msgBytesTx.store(0, std::memory_order_relaxed);
+    for (auto &counter : reassemblyTimeHist) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+}
+
+size_t MsgStats::histogramBucket(int64_t elapsedUs) {
+    // Bucket is floor(log2(elapsedUs)), with anything under 2 us in bucket 0 and clamped to the last bucket
+    size_t bucket = 0;
+    while (elapsedUs >= 2 && bucket < CANMORE_MSG_STATS_NUM_HIST_BUCKETS - 1) {
+        elapsedUs >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
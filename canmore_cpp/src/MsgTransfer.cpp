@@ -0,0 +1,199 @@
+#include "canmore_cpp/MsgTransfer.hpp"
+
+#include <poll.h>
+#include <stdexcept>
+#include <sys/timerfd.h>
+#include <system_error>
+#include <unistd.h>
+
+using namespace Canmore;
+
+MsgTransfer::MsgTransfer(std::function<void(std::span<const uint8_t>)> transmit, size_t maxRxLength,
+                         uint16_t window):
+    transmit(transmit), txMsgBuf(CANMORE_MAX_MSG_LENGTH), rxBuffer(maxRxLength), timerFd(-1) {
+    if (maxRxLength > CANMORE_MSG_TRANSFER_MAX_LENGTH) {
+        throw std::logic_error("Canmore transfer receive length larger than max transfer length");
+    }
+
+    canmore_msg_transfer_tx_init(&txState);
+    canmore_msg_transfer_rx_init(&rxState, rxBuffer.data(), rxBuffer.size(), window);
+
+    if ((timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) < 0) {
+        throw std::system_error(errno, std::generic_category(), "timerfd_create");
+    }
+
+    timerPollDescriptor = PollFDDescriptor::create(*this, timerFd, POLLIN);
+}
+
+MsgTransfer::MsgTransfer(MsgAgentBase &agent, uint8_t clientId, size_t maxRxLength, uint16_t window):
+    MsgTransfer([&agent, clientId](std::span<const uint8_t> data) {
+        agent.transmitMessage(clientId, CANMORE_MSG_SUBTYPE_TRANSFER, data);
+    }, maxRxLength, window) {
+    if (clientId == 0) {
+        throw std::logic_error("Canmore transfers cannot be sent to broadcast client ID");
+    }
+
+    agent.subscribe(clientId, CANMORE_MSG_SUBTYPE_TRANSFER,
+                    [this](uint8_t clientId, uint8_t subtype, std::span<const uint8_t> data) {
+                        (void) clientId;
+                        (void) subtype;
+                        handleTransferMessage(data);
+                    });
+    unsubscribe = [&agent, clientId]() { agent.unsubscribe(clientId, CANMORE_MSG_SUBTYPE_TRANSFER); };
+}
+
+MsgTransfer::MsgTransfer(MsgClientBase &client, size_t maxRxLength, uint16_t window):
+    MsgTransfer([&client](std::span<const uint8_t> data) {
+        client.transmitMessage(CANMORE_MSG_SUBTYPE_TRANSFER, data);
+    }, maxRxLength, window) {
+    client.subscribe(CANMORE_MSG_SUBTYPE_TRANSFER, [this](uint8_t subtype, std::span<const uint8_t> data) {
+        (void) subtype;
+        handleTransferMessage(data);
+    });
+    unsubscribe = [&client]() { client.unsubscribe(CANMORE_MSG_SUBTYPE_TRANSFER); };
+}
+
+MsgTransfer::~MsgTransfer() {
+    if (unsubscribe) {
+        unsubscribe();
+    }
+    if (timerFd >= 0) {
+        close(timerFd);
+    }
+}
+
+void MsgTransfer::send(uint8_t subtype, std::span<const uint8_t> data, CompleteCB onComplete) {
+    if (subtype == CANMORE_MSG_SUBTYPE_TRANSFER || subtype >= (1 << CANMORE_MSG_SUBTYPE_LENGTH)) {
+        throw std::logic_error("Attempting to transfer canmore payload with invalid message subtype");
+    }
+    if (data.size() == 0 || data.size() > CANMORE_MSG_TRANSFER_MAX_LENGTH) {
+        throw std::logic_error("Attempting to transfer canmore payload with invalid length");
+    }
+
+    cancel();
+
+    txData.assign(data.begin(), data.end());
+    completeCallback = onComplete;
+    retries = 0;
+    if (!canmore_msg_transfer_tx_start(&txState, subtype, txData.data(), txData.size(), chunkSize)) {
+        throw std::logic_error("Canmore transfer failed to start");
+    }
+
+    pumpTx();
+}
+
+void MsgTransfer::cancel() {
+    size_t len = canmore_msg_transfer_tx_cancel(&txState, txMsgBuf.data());
+    completeCallback = nullptr;
+    if (len) {
+        transmit(std::span<const uint8_t> { txMsgBuf.data(), len });
+    }
+    updateTimer();
+}
+
+void MsgTransfer::handleTransferMessage(std::span<const uint8_t> data) {
+    if (data.size() < 1) {
+        return;
+    }
+
+    uint8_t opcode = data[0];
+    if (opcode == CANMORE_MSG_TRANSFER_OPCODE_ACK || opcode == CANMORE_MSG_TRANSFER_OPCODE_ABORT) {
+        // Reply to our outgoing transfer
+        if (canmore_msg_transfer_tx_handle(&txState, data.data(), data.size())) {
+            retries = 0;
+            pumpTx();
+            checkTxDone();
+        }
+    }
+    else {
+        // Part of an incoming transfer
+        uint8_t reply[CANMORE_MSG_TRANSFER_ACK_SIZE];
+        size_t replyLen;
+        bool complete = canmore_msg_transfer_rx_handle(&rxState, data.data(), data.size(), reply, &replyLen);
+        if (replyLen) {
+            transmit(std::span<const uint8_t> { reply, replyLen });
+        }
+        if (complete && receiveCallback) {
+            receiveCallback(canmore_msg_transfer_rx_get_subtype(&rxState),
+                            std::span<const uint8_t> { rxBuffer.data(), canmore_msg_transfer_rx_get_length(&rxState) });
+        }
+    }
+}
+
+void MsgTransfer::pumpTx() {
+    size_t len;
+    while ((len = canmore_msg_transfer_tx_next(&txState, txMsgBuf.data()))) {
+        transmit(std::span<const uint8_t> { txMsgBuf.data(), len });
+    }
+    updateTimer();
+}
+
+void MsgTransfer::checkTxDone() {
+    uint8_t status = canmore_msg_transfer_tx_get_status(&txState);
+    if (status == CANMORE_MSG_TRANSFER_STATUS_ACTIVE || status == CANMORE_MSG_TRANSFER_STATUS_IDLE) {
+        return;
+    }
+
+    updateTimer();
+
+    // Clear the callback before calling it, in case it starts a new transfer
+    auto callback = std::move(completeCallback);
+    completeCallback = nullptr;
+    if (callback) {
+        callback(status == CANMORE_MSG_TRANSFER_STATUS_COMPLETE);
+    }
+}
+
+void MsgTransfer::updateTimer() {
+    // A zero it_value disarms the timer
+    struct itimerspec spec = {};
+    if (busy()) {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(timeout).count();
+        if (ns <= 0) {
+            ns = 1;
+        }
+        spec.it_value.tv_sec = ns / 1000000000;
+        spec.it_value.tv_nsec = ns % 1000000000;
+    }
+
+    if (timerfd_settime(timerFd, 0, &spec, NULL) < 0) {
+        throw std::system_error(errno, std::generic_category(), "timerfd_settime");
+    }
+}
+
+void MsgTransfer::populateFds(std::vector<std::weak_ptr<PollFDDescriptor>> &descriptors) {
+    descriptors.push_back(timerPollDescriptor);
+}
+
+void MsgTransfer::handleEvent(const pollfd &fd) {
+    if (!(fd.revents & POLLIN)) {
+        throw std::runtime_error("Unexpected event on transfer timer");
+    }
+
+    uint64_t expirations;
+    if (read(timerFd, &expirations, sizeof(expirations)) < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            return;
+        }
+        throw std::system_error(errno, std::generic_category(), "read");
+    }
+
+    if (!busy()) {
+        return;
+    }
+
+    if (retries >= maxRetries) {
+        // Give up, letting the peer know so it can free its buffer
+        auto callback = std::move(completeCallback);
+        completeCallback = nullptr;
+        cancel();
+        if (callback) {
+            callback(false);
+        }
+        return;
+    }
+
+    retries++;
+    canmore_msg_transfer_tx_timeout(&txState);
+    pumpTx();
+}
@@ -1,5 +1,6 @@
 #include "canmore_cpp/RegMappedClient.hpp"
 
+#include <algorithm>
 #include <chrono>
 #include <stdlib.h>
 
@@ -28,6 +29,7 @@ RegMappedCANClient::RegMappedCANClient(int ifIndex, uint8_t clientId, uint8_t ch
         clientCfg.transfer_mode = TRANSFER_MODE_BULK;
         clientCfg.multiword_scratch_buffer = nullptr;
     }
+    setDefaultTransactionChunkWords();
 }
 
 RegMappedCANClient::~RegMappedCANClient() {
@@ -41,7 +43,7 @@ void RegMappedCANClient::sendRaw(const std::span<const uint8_t> &data) {
 }
 
 bool RegMappedCANClient::clientRx(const std::span<uint8_t> &buf, unsigned int timeoutMs) {
-    if (buf.size_bytes() > CAN_MAX_DLEN) {
+    if (buf.size_bytes() > getMaxFrameSize()) {
         return false;
     }
 
@@ -54,35 +56,43 @@ bool RegMappedCANClient::clientRx(const std::span<uint8_t> &buf, unsigned int ti
     // the fd processing an event
     auto start_time = std::chrono::high_resolution_clock::now();
     int remainingMs = timeoutMs;
-    do {
+    while (frameMailbox.empty()) {
         // Process events until we fill the mailbox or we run out of time
+        // Frames left over from an earlier event are returned without waiting, and a timeout of 0 polls the socket once
         group.processEvent(remainingMs);
 
         remainingMs = timeoutMs - std::chrono::duration_cast<std::chrono::milliseconds>(
                                       std::chrono::high_resolution_clock::now() - start_time)
                                       .count();
-    } while (remainingMs > 0 && !frameMailbox);
+        if (remainingMs <= 0) {
+            break;
+        }
+    }
 
-    if (!frameMailbox) {
+    if (frameMailbox.empty()) {
         // Nothing in the mailbox, we didn't receive data in time
         return false;
     }
 
-    if (frameMailbox->first != CANMORE_CALC_UTIL_ID_C2A(clientId, channel)) {
+    // Take the oldest frame out of the mailbox
+    auto frame = std::move(frameMailbox.front());
+    frameMailbox.pop_front();
+
+    if (frame.first != CANMORE_CALC_UTIL_ID_C2A(clientId, channel)) {
         // Invalid client ID
-        frameMailbox.reset();
         return false;
     }
 
-    if (frameMailbox->second.size() < buf.size_bytes()) {
+    // A short frame is only valid if it reports an error, as error responses to multiword and batch requests may leave
+    // out the data
+    if (frame.second.size() < buf.size_bytes() &&
+        (frame.second.size() < 1 || frame.second.at(0) == REG_MAPPED_RESULT_SUCCESSFUL)) {
         // Unexpected length
-        frameMailbox.reset();
         return false;
     }
 
-    // Copy the data and free the mailbox
-    std::copy_n(frameMailbox->second.begin(), buf.size_bytes(), buf.data());
-    frameMailbox.reset();
+    // Copy the data
+    std::copy_n(frame.second.begin(), std::min(frame.second.size(), buf.size_bytes()), buf.data());
 
     return true;
 }
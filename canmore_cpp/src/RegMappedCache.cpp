@@ -0,0 +1,262 @@
+#include "canmore_cpp/RegMappedCache.hpp"
+
+#include <algorithm>
+
+using namespace Canmore;
+
+RegMappedCache::RegMappedCache(std::shared_ptr<RegMappedClient> client, uint8_t mode,
+                               std::chrono::milliseconds flushDelay):
+    client(client), mode(mode), flushDelay(flushDelay) {}
+
+RegMappedCache::~RegMappedCache() {
+    try {
+        flush();
+    } catch (std::exception &) {
+        // Can't report errors from the destructor, the pending writes are lost
+    }
+}
+
+void RegMappedCache::setPagePolicy(uint8_t page, Policy policy, std::chrono::milliseconds ttl) {
+    auto &state = getPage(page);
+    if (state.isDirty()) {
+        flushPage(page, state);
+    }
+
+    state.policy = policy;
+    state.ttl = ttl;
+    invalidate(page);
+}
+
+uint32_t RegMappedCache::readRegister(uint8_t page, uint8_t offset) {
+    flushIfDue();
+
+    auto &state = getPage(page);
+    auto now = Clock::now();
+    if (isFresh(state, offset, now)) {
+        return state.regs.at(offset).value;
+    }
+
+    // Make sure the device sees any pending writes before this read
+    flush();
+
+    uint32_t value = client->readRegister(mode, page, offset);
+    storeValue(state, offset, value, now);
+    return value;
+}
+
+void RegMappedCache::readArray(uint8_t page, uint8_t offsetStart, std::vector<uint32_t> &dst, unsigned int numWords) {
+    if (((unsigned int) offsetStart) + numWords > REG_MAPPED_PAGE_NUM_WORDS) {
+        throw RegMappedClientError(REG_MAPPED_CLIENT_RESULT_INVALID_ARG, mode, page, offsetStart, numWords, false);
+    }
+
+    flushIfDue();
+
+    auto &state = getPage(page);
+    auto now = Clock::now();
+
+    // Find the range of words which must be read from the client
+    unsigned int missStart = offsetStart + numWords;
+    unsigned int missEnd = offsetStart;
+    for (unsigned int offset = offsetStart; offset < offsetStart + numWords; offset++) {
+        if (!isFresh(state, offset, now)) {
+            missStart = std::min(missStart, offset);
+            missEnd = offset + 1;
+        }
+    }
+
+    if (missEnd > missStart) {
+        flush();
+
+        std::vector<uint32_t> readData;
+        client->readArray(mode, page, missStart, readData, missEnd - missStart);
+        if (state.policy == Policy::Volatile) {
+            // Nothing is cached, so the entire range was read
+            dst = std::move(readData);
+            return;
+        }
+
+        for (unsigned int i = 0; i < readData.size(); i++) {
+            storeValue(state, missStart + i, readData.at(i), now);
+        }
+    }
+
+    dst.resize(numWords);
+    for (unsigned int i = 0; i < numWords; i++) {
+        dst.at(i) = state.regs.at(offsetStart + i).value;
+    }
+}
+
+void RegMappedCache::writeRegister(uint8_t page, uint8_t offset, uint32_t data) {
+    flushIfDue();
+
+    auto &state = getPage(page);
+    auto now = Clock::now();
+
+    if (state.policy != Policy::Cacheable) {
+        // Only cacheable pages combine writes, everything else is written through in order
+        flush();
+        client->writeRegister(mode, page, offset, data);
+        storeValue(state, offset, data, now);
+        return;
+    }
+
+    if (isFresh(state, offset, now) && state.regs.at(offset).value == data) {
+        // The register already holds (or will hold once flushed) this value
+        return;
+    }
+
+    if (state.isDirty()) {
+        // The dirty range can be extended to this offset if it is adjacent, or if every register in the gap holds a
+        // known value (which will be rewritten unchanged)
+        unsigned int gapStart = std::min<unsigned int>(offset + 1, state.dirtyEnd);
+        unsigned int gapEnd = std::max<unsigned int>(offset, state.dirtyStart);
+        bool canExtend = true;
+        for (unsigned int i = gapStart; i < gapEnd && canExtend; i++) {
+            canExtend = isFresh(state, i, now);
+        }
+
+        if (!canExtend) {
+            flushPage(page, state);
+        }
+    }
+
+    if (state.isDirty()) {
+        state.dirtyStart = std::min<unsigned int>(state.dirtyStart, offset);
+        state.dirtyEnd = std::max<unsigned int>(state.dirtyEnd, offset + 1);
+    }
+    else {
+        if (dirtyPages.empty()) {
+            flushDeadline = now + flushDelay;
+        }
+        state.dirtyStart = offset;
+        state.dirtyEnd = offset + 1;
+        dirtyPages.push_back(page);
+    }
+    storeValue(state, offset, data, now);
+}
+
+void RegMappedCache::writeArray(uint8_t page, uint8_t offsetStart, const std::vector<uint32_t> &data) {
+    if (((unsigned int) offsetStart) + data.size() > REG_MAPPED_PAGE_NUM_WORDS) {
+        throw RegMappedClientError(REG_MAPPED_CLIENT_RESULT_INVALID_ARG, mode, page, offsetStart, data.size(), true);
+    }
+
+    auto &state = getPage(page);
+    if (state.policy == Policy::Cacheable) {
+        for (unsigned int i = 0; i < data.size(); i++) {
+            writeRegister(page, offsetStart + i, data.at(i));
+        }
+        return;
+    }
+
+    flushIfDue();
+    flush();
+
+    std::vector<uint32_t> writeData(data);
+    client->writeArray(mode, page, offsetStart, writeData);
+
+    auto now = Clock::now();
+    for (unsigned int i = 0; i < data.size(); i++) {
+        storeValue(state, offsetStart + i, data.at(i), now);
+    }
+}
+
+void RegMappedCache::flush() {
+    while (!dirtyPages.empty()) {
+        uint8_t page = dirtyPages.front();
+        flushPage(page, pages.at(page));
+    }
+}
+
+void RegMappedCache::flushIfDue() {
+    if (!dirtyPages.empty() && Clock::now() >= flushDeadline) {
+        flush();
+    }
+}
+
+void RegMappedCache::invalidate(uint8_t page) {
+    auto it = pages.find(page);
+    if (it == pages.end()) {
+        return;
+    }
+
+    // Values in the dirty range are still needed to flush the pending writes
+    auto &state = it->second;
+    for (unsigned int i = 0; i < state.regs.size(); i++) {
+        if (i < state.dirtyStart || i >= state.dirtyEnd) {
+            state.regs.at(i).valid = false;
+        }
+    }
+}
+
+void RegMappedCache::invalidateAll() {
+    for (auto &entry : pages) {
+        invalidate(entry.first);
+    }
+}
+
+RegMappedCache::PageState &RegMappedCache::getPage(uint8_t page) {
+    return pages[page];
+}
+
+bool RegMappedCache::isFresh(const PageState &state, uint8_t offset, Clock::time_point now) const {
+    if (offset >= state.dirtyStart && offset < state.dirtyEnd) {
+        // Pending writes are always returned, even if their TTL would have expired
+        return true;
+    }
+
+    auto &reg = state.regs.at(offset);
+    if (state.policy == Policy::Immutable) {
+        return reg.valid;
+    }
+    else if (state.policy == Policy::Cacheable) {
+        return reg.valid && now < reg.expiry;
+    }
+    else {
+        return false;
+    }
+}
+
+void RegMappedCache::storeValue(PageState &state, uint8_t offset, uint32_t value, Clock::time_point now) {
+    if (state.policy == Policy::Volatile) {
+        return;
+    }
+
+    auto &reg = state.regs.at(offset);
+    reg.value = value;
+    reg.valid = true;
+    reg.expiry = now + state.ttl;
+}
+
+void RegMappedCache::flushPage(uint8_t page, PageState &state) {
+    std::vector<uint32_t> data;
+    for (unsigned int i = state.dirtyStart; i < state.dirtyEnd; i++) {
+        data.push_back(state.regs.at(i).value);
+    }
+    uint8_t offsetStart = state.dirtyStart;
+
+    // Clear the dirty range before writing so a failed write isn't retried by every later access
+    state.dirtyStart = 0;
+    state.dirtyEnd = 0;
+    dirtyPages.remove(page);
+
+    try {
+        if (data.size() == 1) {
+            client->writeRegister(mode, page, offsetStart, data.at(0));
+        }
+        else {
+            client->writeArray(mode, page, offsetStart, data);
+        }
+    } catch (...) {
+        // The device state of these registers is unknown after a failed write
+        for (unsigned int i = 0; i < data.size(); i++) {
+            state.regs.at(offsetStart + i).valid = false;
+        }
+        throw;
+    }
+
+    // Successfully written, so the values are fresh from now
+    auto now = Clock::now();
+    for (unsigned int i = 0; i < data.size(); i++) {
+        storeValue(state, offsetStart + i, data.at(i), now);
+    }
+}
@@ -1,12 +1,43 @@
 #include "canmore_cpp/RegMappedClient.hpp"
 
 #include <algorithm>
+#include <utility>
 
 using namespace Canmore;
 
+RegMappedClient::RegMappedClient() {
+    reg_mapped_client_posted_init(&postedWrites, &postedErrorCB, this);
+}
+
 RegMappedClient::~RegMappedClient() {}
 
+void RegMappedClient::setDefaultTransactionChunkWords() {
+    // At least enough words to fill every request the transport keeps in flight, since transfers wait for the
+    // pipeline to drain at the end of each chunk
+    unsigned int wordsPerRequest = 1;
+    if (clientCfg.transfer_mode == TRANSFER_MODE_MULTIWORD) {
+        wordsPerRequest = REG_MAPPED_COMPUTE_MAX_REQ_WORD_COUNT(clientCfg.multiword_scratch_len);
+    }
+    setTransactionChunkWords(std::max<unsigned int>(transactionChunkWords, wordsPerRequest * clientCfg.max_in_flight));
+}
+
+RegMappedClient::Transaction::Transaction(RegMappedClient &client): client(client) {
+    std::unique_lock<std::mutex> lock(client.transactionLock);
+    uint64_t ticket = client.transactionNextTicket++;
+    client.transactionCond.wait(lock, [&client, ticket]() { return client.transactionServing == ticket; });
+}
+
+RegMappedClient::Transaction::~Transaction() {
+    {
+        std::lock_guard<std::mutex> lock(client.transactionLock);
+        client.transactionServing++;
+    }
+    client.transactionCond.notify_all();
+}
+
 uint32_t RegMappedClient::readRegister(uint8_t mode, uint8_t page, uint8_t offset) {
+    Transaction transaction(*this);
+    drainPostedWrites();
     clientCfg.control_interface_mode = mode;
 
     uint32_t data;
@@ -19,6 +50,8 @@ uint32_t RegMappedClient::readRegister(uint8_t mode, uint8_t page, uint8_t offse
 }
 
 void RegMappedClient::writeRegister(uint8_t mode, uint8_t page, uint8_t offset, uint32_t data) {
+    Transaction transaction(*this);
+    drainPostedWrites();
     clientCfg.control_interface_mode = mode;
     int ret = reg_mapped_client_write_register(&clientCfg, page, offset, data);
     if (ret != REG_MAPPED_RESULT_SUCCESSFUL) {
@@ -32,24 +65,57 @@ void RegMappedClient::readArray(uint8_t mode, uint8_t page, uint8_t offsetStart,
         numWords = 256;
     }
 
-    clientCfg.control_interface_mode = mode;
+    // Check the page boundary up front, since the chunks are checked individually
+    if (offsetStart + numWords > REG_MAPPED_PAGE_NUM_WORDS) {
+        throw RegMappedClientError(REG_MAPPED_CLIENT_RESULT_INVALID_ARG, mode, page, offsetStart, numWords, false);
+    }
 
-    auto buf = new uint32_t[numWords];
-    int ret = reg_mapped_client_read_array(&clientCfg, page, offsetStart, buf, numWords);
-    if (ret != REG_MAPPED_RESULT_SUCCESSFUL) {
-        delete buf;
-        throw RegMappedClientError(ret, mode, page, offsetStart, numWords, false);
+    std::vector<uint32_t> buf(numWords);
+
+    // Each chunk is its own transaction so other threads can access the client between chunks
+    unsigned int chunkSize = transactionChunkWords;
+    for (unsigned int chunkStart = 0; chunkStart < numWords; chunkStart += chunkSize) {
+        unsigned int chunkWords = std::min(numWords - chunkStart, chunkSize);
+
+        Transaction transaction(*this);
+        drainPostedWrites();
+        clientCfg.control_interface_mode = mode;
+
+        uint8_t errorOffset = offsetStart + chunkStart;
+        int ret = reg_mapped_client_read_array_ex(&clientCfg, page, offsetStart + chunkStart, &buf.at(chunkStart),
+                                                  chunkWords, &errorOffset);
+        if (ret != REG_MAPPED_RESULT_SUCCESSFUL) {
+            throw RegMappedClientError(ret, mode, page, offsetStart, numWords, errorOffset, false);
+        }
     }
 
-    dst.assign(buf, buf + numWords);
-    delete buf;
+    dst = std::move(buf);
 }
 
 void RegMappedClient::writeArray(uint8_t mode, uint8_t page, uint8_t offsetStart, std::vector<uint32_t> &data) {
-    clientCfg.control_interface_mode = mode;
-    int ret = reg_mapped_client_write_array(&clientCfg, page, offsetStart, data.data(), data.size());
-    if (ret != REG_MAPPED_RESULT_SUCCESSFUL) {
-        throw RegMappedClientError(ret, mode, page, offsetStart, data.size(), true);
+    // Check the page boundary up front, since the chunks are checked individually
+    if (offsetStart + data.size() > REG_MAPPED_PAGE_NUM_WORDS) {
+        throw RegMappedClientError(REG_MAPPED_CLIENT_RESULT_INVALID_ARG, mode, page, offsetStart, data.size(), true);
+    }
+
+    // Each chunk is its own transaction so other threads can access the client between chunks. The chunks are written
+    // as regions within the page, since array writes can only carry up to 255 words
+    uint32_t addrStart = REG_MAPPED_CLIENT_REGION_ADDR(page, offsetStart);
+    size_t chunkSize = transactionChunkWords;
+    for (size_t chunkStart = 0; chunkStart < data.size(); chunkStart += chunkSize) {
+        size_t chunkWords = std::min(data.size() - chunkStart, chunkSize);
+
+        Transaction transaction(*this);
+        drainPostedWrites();
+        clientCfg.control_interface_mode = mode;
+
+        uint32_t errorAddr = addrStart + chunkStart;
+        int ret = reg_mapped_client_write_region(&clientCfg, addrStart + chunkStart, &data.at(chunkStart), chunkWords,
+                                                 &errorAddr);
+        if (ret != REG_MAPPED_RESULT_SUCCESSFUL) {
+            throw RegMappedClientError(ret, mode, page, offsetStart, data.size(),
+                                       REG_MAPPED_CLIENT_REGION_OFFSET(errorAddr), true);
+        }
     }
 }
 
@@ -71,6 +137,8 @@ void RegMappedClient::writeStringPage(uint8_t mode, uint8_t page, const std::str
 }
 
 std::string RegMappedClient::readStringPage(uint8_t mode, uint8_t page) {
+    Transaction transaction(*this);
+    drainPostedWrites();
     const size_t strMaxSize = REG_MAPPED_PAGE_SIZE + 1;
     auto strArray = new char[strMaxSize];
 
@@ -86,3 +154,134 @@ std::string RegMappedClient::readStringPage(uint8_t mode, uint8_t page) {
 
     return readStr;
 }
+
+void RegMappedClient::readRegion(uint8_t mode, uint32_t addrStart, std::vector<uint32_t> &dst, size_t numWords) {
+    if (addrStart > REG_MAPPED_CLIENT_REGION_NUM_WORDS || numWords > REG_MAPPED_CLIENT_REGION_NUM_WORDS - addrStart) {
+        throw RegMappedClientError(REG_MAPPED_CLIENT_RESULT_INVALID_ARG, mode, REG_MAPPED_CLIENT_REGION_PAGE(addrStart),
+                                   REG_MAPPED_CLIENT_REGION_OFFSET(addrStart), numWords,
+                                   REG_MAPPED_CLIENT_REGION_PAGE(addrStart), REG_MAPPED_CLIENT_REGION_OFFSET(addrStart),
+                                   false);
+    }
+
+    std::vector<uint32_t> buf(numWords);
+
+    // Each chunk is its own transaction so other threads can access the client between chunks
+    size_t chunkSize = transactionChunkWords;
+    for (size_t chunkStart = 0; chunkStart < numWords; chunkStart += chunkSize) {
+        size_t chunkWords = std::min(numWords - chunkStart, chunkSize);
+
+        Transaction transaction(*this);
+        drainPostedWrites();
+        clientCfg.control_interface_mode = mode;
+
+        uint32_t errorAddr = addrStart + chunkStart;
+        int ret = reg_mapped_client_read_region(&clientCfg, addrStart + chunkStart, &buf.at(chunkStart), chunkWords,
+                                                &errorAddr);
+        if (ret != REG_MAPPED_RESULT_SUCCESSFUL) {
+            throw RegMappedClientError(ret, mode, REG_MAPPED_CLIENT_REGION_PAGE(addrStart),
+                                       REG_MAPPED_CLIENT_REGION_OFFSET(addrStart), numWords,
+                                       REG_MAPPED_CLIENT_REGION_PAGE(errorAddr),
+                                       REG_MAPPED_CLIENT_REGION_OFFSET(errorAddr), false);
+        }
+    }
+
+    dst = std::move(buf);
+}
+
+void RegMappedClient::writeRegion(uint8_t mode, uint32_t addrStart, const std::vector<uint32_t> &data) {
+    if (addrStart > REG_MAPPED_CLIENT_REGION_NUM_WORDS ||
+        data.size() > REG_MAPPED_CLIENT_REGION_NUM_WORDS - addrStart) {
+        throw RegMappedClientError(REG_MAPPED_CLIENT_RESULT_INVALID_ARG, mode, REG_MAPPED_CLIENT_REGION_PAGE(addrStart),
+                                   REG_MAPPED_CLIENT_REGION_OFFSET(addrStart), data.size(),
+                                   REG_MAPPED_CLIENT_REGION_PAGE(addrStart), REG_MAPPED_CLIENT_REGION_OFFSET(addrStart),
+                                   true);
+    }
+
+    // Each chunk is its own transaction so other threads can access the client between chunks
+    size_t chunkSize = transactionChunkWords;
+    for (size_t chunkStart = 0; chunkStart < data.size(); chunkStart += chunkSize) {
+        size_t chunkWords = std::min(data.size() - chunkStart, chunkSize);
+
+        Transaction transaction(*this);
+        drainPostedWrites();
+        clientCfg.control_interface_mode = mode;
+
+        uint32_t errorAddr = addrStart + chunkStart;
+        int ret = reg_mapped_client_write_region(&clientCfg, addrStart + chunkStart, &data.at(chunkStart), chunkWords,
+                                                 &errorAddr);
+        if (ret != REG_MAPPED_RESULT_SUCCESSFUL) {
+            throw RegMappedClientError(ret, mode, REG_MAPPED_CLIENT_REGION_PAGE(addrStart),
+                                       REG_MAPPED_CLIENT_REGION_OFFSET(addrStart), data.size(),
+                                       REG_MAPPED_CLIENT_REGION_PAGE(errorAddr),
+                                       REG_MAPPED_CLIENT_REGION_OFFSET(errorAddr), true);
+        }
+    }
+}
+
+void RegMappedClient::transact(uint8_t mode, std::vector<BatchEntry> &batch) {
+    // Point the C entries at the data in each batch entry, so reads are copied directly into them
+    std::vector<reg_mapped_client_batch_entry_t> entries;
+    entries.reserve(batch.size());
+    for (auto &entry : batch) {
+        entries.push_back(
+            { entry.isWrite, entry.page, entry.offset, (unsigned int) entry.data.size(), entry.data.data() });
+    }
+
+    Transaction transaction(*this);
+    drainPostedWrites();
+    clientCfg.control_interface_mode = mode;
+
+    size_t errorEntry = 0;
+    int ret = reg_mapped_client_transact(&clientCfg, entries.data(), entries.size(), &errorEntry);
+    if (ret != REG_MAPPED_RESULT_SUCCESSFUL) {
+        auto &entry = batch.at(errorEntry);
+        throw RegMappedClientError(ret, mode, errorEntry, batch.size(), entry.page, entry.offset, entry.isWrite);
+    }
+}
+
+void RegMappedClient::postWriteRegister(uint8_t mode, uint8_t page, uint8_t offset, uint32_t data) {
+    Transaction transaction(*this);
+    clientCfg.control_interface_mode = mode;
+    postedMode = mode;
+    int ret = reg_mapped_client_post_write(&clientCfg, &postedWrites, page, offset, data);
+    if (ret != REG_MAPPED_RESULT_SUCCESSFUL) {
+        throw RegMappedClientError(ret, mode, page, offset, true);
+    }
+}
+
+void RegMappedClient::sync() {
+    Transaction transaction(*this);
+    uint8_t page;
+    uint8_t offset;
+    int ret = reg_mapped_client_posted_sync(&clientCfg, &postedWrites, &page, &offset);
+    if (ret != REG_MAPPED_RESULT_SUCCESSFUL) {
+        throw RegMappedClientError(ret, postedMode, page, offset, true);
+    }
+}
+
+void RegMappedClient::setPostedErrorCallback(PostedErrorCB callback) {
+    // The callback is called during accesses, so it can only be replaced between them
+    Transaction transaction(*this);
+    postedErrorCallback = std::move(callback);
+}
+
+void RegMappedClient::subscribe(uint8_t mode, uint8_t page, uint8_t offset, uint8_t count, uint16_t intervalMs,
+                                uint16_t threshold) {
+    Transaction transaction(*this);
+    drainPostedWrites();
+    clientCfg.control_interface_mode = mode;
+    int ret = reg_mapped_client_subscribe(&clientCfg, page, offset, count, intervalMs, threshold);
+    if (ret != REG_MAPPED_RESULT_SUCCESSFUL) {
+        throw RegMappedClientError(ret, mode, page, offset, count, false);
+    }
+}
+
+void RegMappedClient::unsubscribe(uint8_t mode, uint8_t page, uint8_t offset) {
+    Transaction transaction(*this);
+    drainPostedWrites();
+    clientCfg.control_interface_mode = mode;
+    int ret = reg_mapped_client_unsubscribe(&clientCfg, page, offset);
+    if (ret != REG_MAPPED_RESULT_SUCCESSFUL) {
+        throw RegMappedClientError(ret, mode, page, offset, false);
+    }
+}
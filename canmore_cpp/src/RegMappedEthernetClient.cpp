@@ -46,6 +46,7 @@ RegMappedEthernetClient::RegMappedEthernetClient(struct in_addr ipAddr, uint16_t
     clientCfg.arg = this;
     clientCfg.timeout_ms = REG_MAPPED_TIMEOUT_MS;
     clientCfg.max_in_flight = REG_MAPPED_MAX_IN_FLIGHT_PACKETS_ETH;
+    setDefaultTransactionChunkWords();
 }
 
 RegMappedEthernetClient::~RegMappedEthernetClient() {
@@ -88,11 +89,18 @@ bool RegMappedEthernetClient::clientRx(uint8_t *buf, size_t len, unsigned int ti
 
     struct sockaddr_in recvaddr;
     socklen_t recvaddrlen = sizeof(recvaddr);
-    if (recvfrom(socketFd, buf, len, 0, (sockaddr *) &recvaddr, &recvaddrlen) != (ssize_t) len) {
+    ssize_t recvLen = recvfrom(socketFd, buf, len, 0, (sockaddr *) &recvaddr, &recvaddrlen);
+    if (recvLen < 0) {
         // Error reading from socket
         return false;
     }
 
+    // A short packet is only valid if it reports an error, as error responses to multiword and batch requests may
+    // leave out the data
+    if (recvLen != (ssize_t) len && (recvLen < 1 || buf[0] == REG_MAPPED_RESULT_SUCCESSFUL)) {
+        return false;
+    }
+
     if (recvaddr.sin_family != destaddr.sin_family || recvaddr.sin_addr.s_addr != destaddr.sin_addr.s_addr ||
         recvaddr.sin_port != destaddr.sin_port) {
         // Unexpected packet source
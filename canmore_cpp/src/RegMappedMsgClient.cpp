@@ -0,0 +1,99 @@
+#include "canmore_cpp/RegMappedClient.hpp"
+
+#include "canmore/protocol.h"
+#include "canmore/reg_mapped/client.h"
+
+#include <algorithm>
+#include <chrono>
+
+using namespace Canmore;
+
+RegMappedMsgClient::RegMappedMsgClient(MsgAgentBase &agent, uint8_t clientId):
+    clientId(clientId), agent(agent), multiwordScratch(CANMORE_MAX_MSG_LENGTH) {
+    pollGroup.addFd(agent);
+    agent.subscribe(clientId, CANMORE_MSG_SUBTYPE_REG_MAPPED,
+                    [this](uint8_t clientId, uint8_t subtype, std::span<const uint8_t> data) {
+                        (void) clientId;
+                        (void) subtype;
+                        msgMailbox.emplace_back(data.begin(), data.end());
+                    });
+
+    // Configure reg_mapped_client struct for linuxmappings
+    clientCfg.tx_func = &clientTxCB;
+    clientCfg.clear_rx_func = &clearRxCB;
+    clientCfg.rx_func = &clientRxCB;
+    clientCfg.transfer_mode = TRANSFER_MODE_MULTIWORD;
+    clientCfg.multiword_scratch_buffer = multiwordScratch.data();
+    clientCfg.multiword_scratch_len = multiwordScratch.size();
+    clientCfg.arg = this;
+    clientCfg.timeout_ms = REG_MAPPED_TIMEOUT_MS;
+    clientCfg.max_in_flight = REG_MAPPED_MAX_IN_FLIGHT_PACKETS_MSG;
+    // Each message carries most of a page, so a whole page is a single transaction
+    setDefaultTransactionChunkWords();
+}
+
+RegMappedMsgClient::~RegMappedMsgClient() {
+    agent.unsubscribe(clientId, CANMORE_MSG_SUBTYPE_REG_MAPPED);
+}
+
+bool RegMappedMsgClient::clientTx(const uint8_t *buf, size_t len) {
+    // The transport callbacks are called from C, so exceptions can't propagate past here
+    try {
+        agent.transmitMessage(clientId, CANMORE_MSG_SUBTYPE_REG_MAPPED, std::span<const uint8_t> { buf, len });
+    } catch (const std::exception &) {
+        return false;
+    }
+    return true;
+}
+
+bool RegMappedMsgClient::clientRx(uint8_t *buf, size_t len, unsigned int timeoutMs) {
+    // We need to keep track of the time elapsed since signals can make PollGroup exit before timeoutMs, without
+    // the fd processing an event
+    auto start_time = std::chrono::steady_clock::now();
+    int remainingMs = timeoutMs;
+    while (msgMailbox.empty()) {
+        // Process events until a response arrives or we run out of time
+        try {
+            pollGroup.processEvent(remainingMs);
+        } catch (const std::exception &) {
+            return false;
+        }
+
+        remainingMs = timeoutMs - std::chrono::duration_cast<std::chrono::milliseconds>(
+                                      std::chrono::steady_clock::now() - start_time)
+                                      .count();
+        if (remainingMs <= 0) {
+            break;
+        }
+    }
+
+    if (msgMailbox.empty()) {
+        // Nothing in the mailbox, we didn't receive data in time
+        return false;
+    }
+
+    auto msg = std::move(msgMailbox.front());
+    msgMailbox.pop_front();
+
+    // Messages keep their exact length, so a short message is only valid if it reports an error (which is all an error
+    // response to a multiword read carries)
+    if (msg.size() != len && (msg.size() < 1 || msg.size() > len || msg.at(0) == REG_MAPPED_RESULT_SUCCESSFUL)) {
+        return false;
+    }
+
+    std::copy(msg.begin(), msg.end(), buf);
+    return true;
+}
+
+bool RegMappedMsgClient::clearRx(void) {
+    // Process any frames already waiting on the agent so late responses don't reach the next request
+    try {
+        while (pollGroup.processEvent(0)) {
+        }
+    } catch (const std::exception &) {
+        return false;
+    }
+
+    msgMailbox.clear();
+    return true;
+}
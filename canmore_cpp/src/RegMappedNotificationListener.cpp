@@ -0,0 +1,108 @@
+#include "canmore_cpp/RegMappedClient.hpp"
+
+#include "canmore/protocol.h"
+#include "canmore/reg_mapped/protocol.h"
+
+#include <string.h>
+
+using namespace Canmore;
+
+// ========================================
+// Notification Listener Base Class
+// ========================================
+
+RegMappedNotificationListener::~RegMappedNotificationListener() {}
+
+bool RegMappedNotificationListener::getSnapshot(uint8_t page, uint8_t offset, RegisterSnapshot &snapshotOut) {
+    std::lock_guard<std::mutex> lock(snapshotLock);
+    auto it = snapshots.find((page << 8) | offset);
+    if (it == snapshots.end()) {
+        return false;
+    }
+
+    snapshotOut = it->second;
+    return true;
+}
+
+void RegMappedNotificationListener::setCallback(NotificationCB callback) {
+    std::lock_guard<std::mutex> lock(snapshotLock);
+    this->callback = callback;
+}
+
+void RegMappedNotificationListener::handleNotification(const std::span<const uint8_t> &data) {
+    // Drop anything too short to be a notification, rather than throwing from the event loop
+    struct reg_mapped_notification header;
+    if (data.size() < sizeof(header)) {
+        return;
+    }
+    memcpy(&header, data.data(), sizeof(header));
+
+    // Only successful notifications carry data. CAN FD frames may be padded, so extra bytes are ignored
+    std::vector<uint32_t> values;
+    if (header.result == REG_MAPPED_RESULT_SUCCESSFUL) {
+        if (data.size() < REG_MAPPED_COMPUTE_NOTIFICATION_LEN(header.count)) {
+            return;
+        }
+        values.resize(header.count);
+        memcpy(values.data(), data.data() + sizeof(header), header.count * sizeof(uint32_t));
+    }
+
+    NotificationCB notifyCallback;
+    {
+        std::lock_guard<std::mutex> lock(snapshotLock);
+        auto now = std::chrono::steady_clock::now();
+        for (unsigned int i = 0; i < header.count && header.offset + i < REG_MAPPED_PAGE_NUM_WORDS; i++) {
+            auto &snapshot = snapshots[(header.page << 8) | (header.offset + i)];
+            if (header.result == REG_MAPPED_RESULT_SUCCESSFUL) {
+                snapshot.value = values.at(i);
+            }
+            snapshot.result = header.result;
+            snapshot.updated = now;
+        }
+        notifyCallback = callback;
+    }
+
+    // Call outside of the lock so the callback can read snapshots
+    if (notifyCallback) {
+        notifyCallback(header.page, header.offset, header.result, values);
+    }
+}
+
+// ========================================
+// CAN Notification Listener
+// ========================================
+
+RegMappedCANNotificationListener::RegMappedCANNotificationListener(int ifIndex, uint8_t clientId,
+                                                                   uint8_t notifyChannel):
+    CANSocket(ifIndex), clientId(clientId), notifyChannel(notifyChannel) {
+    // Configure filter for notifications from the specific client
+    struct can_filter rfilter[] = { { .can_id = CANMORE_CALC_UTIL_ID_C2A(clientId, notifyChannel),
+                                      .can_mask = (CAN_EFF_FLAG | CAN_RTR_FLAG | CAN_SFF_MASK) } };
+    setRxFilters(std::span<can_filter> { rfilter });
+}
+
+void RegMappedCANNotificationListener::handleFrame(canid_t can_id, const std::span<const uint8_t> &data) {
+    if (can_id != CANMORE_CALC_UTIL_ID_C2A(clientId, notifyChannel)) {
+        throw std::logic_error("Received a packet with invalid CAN ID - Somehow the filters broke?");
+    }
+
+    handleNotification(data);
+}
+
+// ========================================
+// CANmore Message Notification Listener
+// ========================================
+
+RegMappedMsgNotificationListener::RegMappedMsgNotificationListener(MsgAgentBase &agent, uint8_t clientId):
+    clientId(clientId), agent(agent) {
+    agent.subscribe(clientId, CANMORE_MSG_SUBTYPE_REG_MAPPED_NOTIFY,
+                    [this](uint8_t clientId, uint8_t subtype, std::span<const uint8_t> data) {
+                        (void) clientId;
+                        (void) subtype;
+                        handleNotification(data);
+                    });
+}
+
+RegMappedMsgNotificationListener::~RegMappedMsgNotificationListener() {
+    agent.unsubscribe(clientId, CANMORE_MSG_SUBTYPE_REG_MAPPED_NOTIFY);
+}
@@ -1,5 +1,6 @@
 #include "canmore_cpp/RegMappedServer.hpp"
 
+#include <chrono>
 #include <stdlib.h>
 
 using namespace Canmore;
@@ -8,7 +9,7 @@ using namespace Canmore;
 // Register Mapped Server Class
 // ========================================
 
-RegMappedServer::RegMappedServer(uint8_t interfaceMode, size_t multiword_buffer_len) {
+RegMappedServer::RegMappedServer(uint8_t interfaceMode, size_t multiword_buffer_len, size_t notify_buffer_len) {
     // Initialize reg_mapped_server instance
     inst.tx_func = &transmit_cb_wrapper;
     inst.arg = this;
@@ -17,12 +18,29 @@ RegMappedServer::RegMappedServer(uint8_t interfaceMode, size_t multiword_buffer_
         inst.multiword_resp_buffer = (reg_mapped_response_t *) malloc(multiword_buffer_len);
         inst.multiword_resp_buffer_max_count = REG_MAPPED_COMPUTE_MAX_RESP_WORD_COUNT(multiword_buffer_len);
     }
+    else {
+        inst.multiword_resp_buffer = NULL;
+        inst.multiword_resp_buffer_max_count = 0;
+    }
+
+    // Subscriptions are only available if the transport can send notifications
+    if (notify_buffer_len >= REG_MAPPED_COMPUTE_NOTIFICATION_LEN(1)) {
+        subscriptions.resize(REG_MAPPED_SERVER_NUM_SUBSCRIPTIONS, reg_mapped_server_subscription_t {});
+        inst.notify_max_words = REG_MAPPED_COMPUTE_MAX_NOTIFICATION_WORD_COUNT(notify_buffer_len);
+    }
+    else {
+        inst.notify_max_words = 0;
+    }
+    inst.notify_tx_func = &notify_cb_wrapper;
+    inst.subscriptions = subscriptions.data();
+    inst.num_subscriptions = subscriptions.size();
     // page_array and num_pages will be set in the callback (as the vector is subject to change)
 
     // Zero out required state fields
     inst.bulk_last_seq_num = 0;
     inst.bulk_error_code = 0;
     inst.in_bulk_request = false;
+    inst.bulk_request_read = false;
 }
 
 RegMappedServer::~RegMappedServer() {
@@ -72,6 +90,24 @@ void RegMappedServer::processPacket(const std::span<const uint8_t> &data) {
     reg_mapped_server_handle_request(&inst, data.data(), data.size());
 }
 
+void RegMappedServer::tick() {
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    tick((uint32_t) std::chrono::duration_cast<std::chrono::milliseconds>(now).count());
+}
+
+void RegMappedServer::tick(uint32_t nowMs) {
+    // Fill out in case the vector was modified since we last called this function
+    inst.page_array = pages.data();
+    inst.num_pages = pages.size();
+
+    reg_mapped_server_tick(&inst, nowMs);
+}
+
+void RegMappedServer::notify_cb_wrapper(uint8_t *msg, size_t len, void *arg) {
+    auto inst = (RegMappedServer *) arg;
+    inst->transmitNotification(std::span<uint8_t>(msg, len));
+}
+
 void RegMappedServer::transmit_cb_wrapper(uint8_t *msg, size_t len, void *arg) {
     auto inst = (RegMappedServer *) arg;
     inst->transmit(std::span<uint8_t>(msg, len));
@@ -0,0 +1,250 @@
+#include "canmore_cpp/XRCETransport.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+using namespace Canmore;
+
+// Processes events in the poll group until complete is set or the timeout expires
+// A negative timeout waits indefinitely, matching poll
+static void pollUntilComplete(PollGroup &pollGroup, const bool &complete, int timeoutMs) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(std::max(timeoutMs, 0));
+
+    while (!complete) {
+        int remainingMs = -1;
+        if (timeoutMs >= 0) {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline -
+                                                                                   std::chrono::steady_clock::now());
+            if (remaining.count() < 0) {
+                break;
+            }
+            remainingMs = remaining.count();
+        }
+
+        if (!pollGroup.processEvent(remainingMs) && remainingMs == 0) {
+            break;
+        }
+    }
+}
+
+// ========================================
+// Client Transport
+// ========================================
+
+XRCEClientTransport::XRCEClientTransport(MsgClientBase &client): client(client) {
+    pollGroup.addFd(client);
+    client.subscribe(CANMORE_MSG_SUBTYPE_XRCE_DDS, [this](uint8_t subtype, std::span<const uint8_t> data) {
+        (void) subtype;
+        handlePacket(data);
+    });
+}
+
+XRCEClientTransport::~XRCEClientTransport() {
+    client.unsubscribe(CANMORE_MSG_SUBTYPE_XRCE_DDS);
+}
+
+bool XRCEClientTransport::open() {
+    pendingPackets.clear();
+    isOpen = true;
+    return true;
+}
+
+bool XRCEClientTransport::close() {
+    isOpen = false;
+    pendingPackets.clear();
+    return true;
+}
+
+size_t XRCEClientTransport::write(const uint8_t *buf, size_t len, uint8_t *err) {
+    if (!isOpen || len > mtu) {
+        *err = 1;
+        return 0;
+    }
+
+    // The transport callbacks are called from C, so exceptions can't propagate past here
+    try {
+        client.transmitMessage(CANMORE_MSG_SUBTYPE_XRCE_DDS, std::span<const uint8_t> { buf, len });
+    } catch (const std::exception &) {
+        *err = 1;
+        return 0;
+    }
+    return len;
+}
+
+size_t XRCEClientTransport::read(uint8_t *buf, size_t len, int timeoutMs, uint8_t *err) {
+    if (!isOpen) {
+        *err = 1;
+        return 0;
+    }
+
+    // Return packets which arrived while not reading first
+    if (!pendingPackets.empty()) {
+        auto packet = std::move(pendingPackets.front());
+        pendingPackets.pop_front();
+        if (packet.size() > len) {
+            *err = 1;
+            return 0;
+        }
+        std::copy(packet.begin(), packet.end(), buf);
+        return packet.size();
+    }
+
+    // Point the subscription at the caller's buffer and wait for a packet
+    readBuf = std::span<uint8_t> { buf, len };
+    readComplete = false;
+    readOverflow = false;
+
+    try {
+        pollUntilComplete(pollGroup, readComplete, timeoutMs);
+    } catch (const std::exception &) {
+        readBuf = {};
+        *err = 1;
+        return 0;
+    }
+    readBuf = {};
+
+    if (!readComplete) {
+        return 0;
+    }
+    if (readOverflow) {
+        *err = 1;
+        return 0;
+    }
+    return readLen;
+}
+
+void XRCEClientTransport::handlePacket(std::span<const uint8_t> data) {
+    if (!isOpen) {
+        return;
+    }
+
+    if (readBuf.empty() || readComplete) {
+        // No read waiting for this packet, queue it for the next read
+        pendingPackets.emplace_back(data.begin(), data.end());
+        return;
+    }
+
+    readComplete = true;
+    if (data.size() > readBuf.size()) {
+        readOverflow = true;
+        return;
+    }
+    std::memcpy(readBuf.data(), data.data(), data.size());
+    readLen = data.size();
+}
+
+// ========================================
+// Agent Transport
+// ========================================
+
+XRCEAgentTransport::XRCEAgentTransport(MsgAgentBase &agent): agent(agent) {
+    pollGroup.addFd(agent);
+    agent.subscribe(0, CANMORE_MSG_SUBTYPE_XRCE_DDS,
+                    [this](uint8_t clientId, uint8_t subtype, std::span<const uint8_t> data) {
+                        (void) subtype;
+                        handlePacket(clientId, data);
+                    });
+}
+
+XRCEAgentTransport::~XRCEAgentTransport() {
+    agent.unsubscribe(0, CANMORE_MSG_SUBTYPE_XRCE_DDS);
+}
+
+bool XRCEAgentTransport::init() {
+    pendingPackets.clear();
+    isInit = true;
+    return true;
+}
+
+bool XRCEAgentTransport::fini() {
+    isInit = false;
+    pendingPackets.clear();
+    return true;
+}
+
+ssize_t XRCEAgentTransport::recv(uint8_t &clientIdOut, uint8_t *buf, size_t len, int timeoutMs,
+                                 XRCETransportRc &rc) {
+    if (!isInit) {
+        rc = XRCETransportRc::server_error;
+        return -1;
+    }
+
+    // Return packets which arrived while not receiving first
+    if (!pendingPackets.empty()) {
+        auto packet = std::move(pendingPackets.front());
+        pendingPackets.pop_front();
+        if (packet.second.size() > len) {
+            rc = XRCETransportRc::server_error;
+            return -1;
+        }
+        clientIdOut = packet.first;
+        std::copy(packet.second.begin(), packet.second.end(), buf);
+        rc = XRCETransportRc::ok;
+        return packet.second.size();
+    }
+
+    // Point the subscription at the caller's buffer and wait for a packet
+    readBuf = std::span<uint8_t> { buf, len };
+    readComplete = false;
+    readOverflow = false;
+
+    try {
+        pollUntilComplete(pollGroup, readComplete, timeoutMs);
+    } catch (const std::exception &) {
+        readBuf = {};
+        rc = XRCETransportRc::server_error;
+        return -1;
+    }
+    readBuf = {};
+
+    if (!readComplete) {
+        rc = XRCETransportRc::timeout_error;
+        return -1;
+    }
+    if (readOverflow) {
+        rc = XRCETransportRc::server_error;
+        return -1;
+    }
+    clientIdOut = readClientId;
+    rc = XRCETransportRc::ok;
+    return readLen;
+}
+
+ssize_t XRCEAgentTransport::send(uint8_t clientId, const uint8_t *buf, size_t len, XRCETransportRc &rc) {
+    if (!isInit || len > mtu) {
+        rc = XRCETransportRc::server_error;
+        return -1;
+    }
+
+    try {
+        agent.transmitMessage(clientId, CANMORE_MSG_SUBTYPE_XRCE_DDS, std::span<const uint8_t> { buf, len });
+    } catch (const std::exception &) {
+        rc = XRCETransportRc::server_error;
+        return -1;
+    }
+    rc = XRCETransportRc::ok;
+    return len;
+}
+
+void XRCEAgentTransport::handlePacket(uint8_t clientId, std::span<const uint8_t> data) {
+    if (!isInit) {
+        return;
+    }
+
+    if (readBuf.empty() || readComplete) {
+        // No recv waiting for this packet, queue it for the next recv
+        pendingPackets.emplace_back(std::piecewise_construct, std::forward_as_tuple(clientId),
+                                    std::forward_as_tuple(data.begin(), data.end()));
+        return;
+    }
+
+    readComplete = true;
+    readClientId = clientId;
+    if (data.size() > readBuf.size()) {
+        readOverflow = true;
+        return;
+    }
+    std::memcpy(readBuf.data(), data.data(), data.size());
+    readLen = data.size();
+}
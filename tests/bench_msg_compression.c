@@ -0,0 +1,113 @@
+#include "test_util.h"
+
+#include "canmore/msg_compression.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Measures the frames saved by compressing representative payloads, against the CPU time spent compressing on the
+ * sender and decompressing on the receiver
+ *
+ * Usage: bench_msg_compression [iterations]
+ */
+
+#define BENCH_PAYLOAD_LEN 960
+
+typedef struct bench_payload {
+    const char *name;
+    uint8_t data[BENCH_PAYLOAD_LEN];
+    size_t len;
+} bench_payload_t;
+
+static uint32_t checksum;  // Consumes the results, so the work can't be optimized away
+
+// Slowly varying float32 samples, like a diagnostic array of sensor readings
+static void make_diag_array(bench_payload_t *payload) {
+    payload->name = "diagnostic float array";
+    payload->len = BENCH_PAYLOAD_LEN;
+    for (size_t i = 0; i < payload->len / sizeof(float); i++) {
+        size_t phase = i % 80;
+        float value = (float) (phase < 40 ? phase : 80 - phase) / 4.0f;
+        memcpy(&payload->data[i * sizeof(float)], &value, sizeof(float));
+    }
+}
+
+// Text key/value pairs, like a parameter dump
+static void make_param_dump(bench_payload_t *payload) {
+    payload->name = "parameter dump";
+    payload->len = 0;
+    for (int i = 0; payload->len < BENCH_PAYLOAD_LEN - 64; i++) {
+        payload->len += snprintf((char *) &payload->data[payload->len], BENCH_PAYLOAD_LEN - payload->len,
+                                 "control.pid.axis%d.gain=%d.%03d;", i % 6, i * 7 % 50, i * 131 % 1000);
+    }
+}
+
+// Random bytes, which can't be compressed
+static void make_random(bench_payload_t *payload) {
+    payload->name = "random (incompressible)";
+    payload->len = BENCH_PAYLOAD_LEN;
+    uint32_t state = 0xC0FFEE;
+    for (size_t i = 0; i < payload->len; i++) {
+        payload->data[i] = test_rand(&state);
+    }
+}
+
+static size_t frame_count(size_t len, bool use_canfd) {
+    size_t frame_len = (use_canfd ? CANMORE_MAX_FD_FRAME_SIZE : CANMORE_MAX_FRAME_SIZE);
+    return (len + frame_len - 1) / frame_len;
+}
+
+static void run(const bench_payload_t *payload, int iterations) {
+    uint8_t compressed[CANMORE_MAX_MSG_LENGTH];
+    uint8_t decompressed[CANMORE_MAX_MSG_LENGTH];
+
+    size_t compressed_len = 0;
+    uint64_t start = test_now_ns();
+    for (int i = 0; i < iterations; i++) {
+        compressed_len = canmore_msg_compress(CANMORE_MSG_SUBTYPE_XRCE_DDS, payload->data, payload->len, compressed,
+                                              sizeof(compressed));
+        checksum += compressed_len;
+    }
+    double compress_us = (double) (test_now_ns() - start) / iterations / 1000.0;
+
+    double decompress_us = 0;
+    if (compressed_len > 0) {
+        start = test_now_ns();
+        for (int i = 0; i < iterations; i++) {
+            uint8_t subtype;
+            checksum += canmore_msg_decompress(compressed, compressed_len, &subtype, decompressed,
+                                               sizeof(decompressed));
+        }
+        decompress_us = (double) (test_now_ns() - start) / iterations / 1000.0;
+        if (memcmp(decompressed, payload->data, payload->len) != 0) {
+            fprintf(stderr, "%s: round trip mismatch\n", payload->name);
+            exit(1);
+        }
+    }
+
+    // The sender only compresses when it saves a frame, so incompressible payloads are sent as is
+    size_t sent_len = (compressed_len > 0 && compressed_len < payload->len ? compressed_len : payload->len);
+    printf("%-24s %4zu -> %4zu bytes, CAN 2.0 frames %3zu -> %3zu, CAN FD frames %2zu -> %2zu, "
+           "compress %.2f us, decompress %.2f us\n",
+           payload->name, payload->len, sent_len, frame_count(payload->len, false), frame_count(sent_len, false),
+           frame_count(payload->len, true), frame_count(sent_len, true), compress_us, decompress_us);
+}
+
+int main(int argc, char **argv) {
+    int iterations = (argc > 1 ? atoi(argv[1]) : 20000);
+    if (iterations < 1) {
+        iterations = 1;
+    }
+
+    static bench_payload_t payloads[3];
+    make_diag_array(&payloads[0]);
+    make_param_dump(&payloads[1]);
+    make_random(&payloads[2]);
+    for (size_t i = 0; i < sizeof(payloads) / sizeof(*payloads); i++) {
+        run(&payloads[i], iterations);
+    }
+
+    printf("checksum: %u\n", checksum);
+    return 0;
+}
@@ -0,0 +1,126 @@
+#include "msg_traffic.h"
+#include "test_util.h"
+
+#include "canmore/msg_encoding.h"
+
+#include <stdlib.h>
+
+/*
+ * Compares the time per frame of decoding a capture of interleaved traffic from many clients one frame at a time with
+ * canmore_msg_split_decode_frame, against canmore_msg_decode_frames in batches
+ *
+ * Usage: bench_msg_decode [iterations]
+ */
+
+#define BENCH_NUM_MSGS 2000
+#define BENCH_BATCH_LEN 64
+#define BENCH_POOL_SIZE (MSG_TRAFFIC_NUM_CLIENTS + 1)
+
+static canmore_msg_split_decoder_t decoders[MSG_TRAFFIC_NUM_CLIENTS];
+static uint8_t pool_storage[BENCH_POOL_SIZE][CANMORE_MAX_MSG_LENGTH];
+static uint8_t *pool[BENCH_POOL_SIZE];
+static size_t pool_len;
+static uint32_t checksum;  // Consumes the decoded messages, so the decoding can't be optimized away
+
+static canmore_msg_split_decoder_t *lookup_cb(void *arg, uint32_t can_id, bool is_extended) {
+    (void) arg;
+    return &decoders[msg_traffic_client_id(can_id, is_extended) - 1];
+}
+
+static uint8_t *acquire_cb(void *arg) {
+    (void) arg;
+    return (pool_len > 0 ? pool[--pool_len] : NULL);
+}
+
+static void release_cb(void *arg, uint8_t *buffer) {
+    (void) arg;
+    pool[pool_len++] = buffer;
+}
+
+static void reset(bool use_canfd) {
+    for (int i = 0; i < MSG_TRAFFIC_NUM_CLIENTS; i++) {
+        canmore_msg_split_decode_init(&decoders[i], NULL, NULL, use_canfd);
+    }
+    for (pool_len = 0; pool_len < BENCH_POOL_SIZE; pool_len++) {
+        pool[pool_len] = pool_storage[pool_len];
+    }
+}
+
+static void decode_single(const msg_traffic_t *traffic) {
+    for (size_t i = 0; i < traffic->num_frames; i++) {
+        const canmore_msg_frame_t *frame = &traffic->frames[i];
+        canmore_msg_split_decoder_t *decoder = lookup_cb(NULL, frame->can_id, frame->is_extended);
+        if (canmore_msg_split_decode_needs_buffer(decoder, frame->can_id, frame->is_extended)) {
+            canmore_msg_split_decode_attach_buffer(decoder, acquire_cb(NULL));
+        }
+
+        size_t len = canmore_msg_split_decode_frame(decoder, frame->can_id, frame->is_extended, frame->data,
+                                                    frame->len);
+        if (len > 0) {
+            checksum += len + canmore_msg_split_decode_get_buf(decoder)[0];
+        }
+        if (!canmore_msg_split_decode_in_progress(decoder) && decoder->decode_buffer) {
+            release_cb(NULL, canmore_msg_split_decode_detach_buffer(decoder));
+        }
+    }
+}
+
+static void decode_batched(const msg_traffic_t *traffic) {
+    const canmore_msg_decode_batch_ops_t ops = {
+        .lookup = &lookup_cb, .acquire_buffer = &acquire_cb, .release_buffer = &release_cb, .arg = NULL
+    };
+    canmore_msg_decoded_t out[8];
+
+    for (size_t start = 0; start < traffic->num_frames; start += BENCH_BATCH_LEN) {
+        size_t len = traffic->num_frames - start;
+        if (len > BENCH_BATCH_LEN) {
+            len = BENCH_BATCH_LEN;
+        }
+
+        size_t consumed = 0;
+        while (consumed < len) {
+            size_t count;
+            consumed += canmore_msg_decode_frames(&traffic->frames[start + consumed], len - consumed, &ops, out, 8,
+                                                  &count);
+            for (size_t i = 0; i < count; i++) {
+                checksum += out[i].len + out[i].buffer[0];
+                release_cb(NULL, out[i].buffer);
+            }
+        }
+    }
+}
+
+static double run(const msg_traffic_t *traffic, bool use_canfd, int iterations, void (*decode)(const msg_traffic_t *)) {
+    reset(use_canfd);
+    decode(traffic);  // Warm up
+
+    uint64_t start = test_now_ns();
+    for (int i = 0; i < iterations; i++) {
+        decode(traffic);
+    }
+    uint64_t elapsed = test_now_ns() - start;
+    return (double) elapsed / ((double) iterations * traffic->num_frames);
+}
+
+int main(int argc, char **argv) {
+    int iterations = (argc > 1 ? atoi(argv[1]) : 200);
+    if (iterations < 1) {
+        iterations = 1;
+    }
+
+    for (int use_canfd = 0; use_canfd <= 1; use_canfd++) {
+        msg_traffic_t traffic;
+        msg_traffic_generate(&traffic, BENCH_NUM_MSGS, use_canfd, 0xBEEF);
+
+        double single_ns = run(&traffic, use_canfd, iterations, &decode_single);
+        double batched_ns = run(&traffic, use_canfd, iterations, &decode_batched);
+        printf("%s: %zu frames x %d iterations, single: %.1f ns/frame, batched: %.1f ns/frame (%.2fx)\n",
+               (use_canfd ? "CAN FD" : "CAN 2.0"), traffic.num_frames, iterations, single_ns, batched_ns,
+               single_ns / batched_ns);
+
+        msg_traffic_free(&traffic);
+    }
+
+    printf("checksum: %u\n", checksum);
+    return 0;
+}
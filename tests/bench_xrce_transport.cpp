@@ -0,0 +1,170 @@
+#include "test_util.h"
+
+#include "canmore_cpp/MsgAgent.hpp"
+#include "canmore_cpp/MsgClient.hpp"
+#include "canmore_cpp/XRCETransport.hpp"
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+/*
+ * Measures the per-message overhead of the XRCE transport adapters against using the message agent/client API directly,
+ * by timing round trips through an echoing agent over UDP on localhost. Both sides use the adapters or both use the raw
+ * API, so the difference between the two is the cost of the adapters on a round trip (two writes and two reads).
+ *
+ * Usage: bench_xrce_transport [iterations]
+ */
+
+using namespace Canmore;
+
+namespace {
+
+constexpr uint16_t benchPort = 24128;
+constexpr uint8_t benchClientId = 1;
+
+struct FakeCustomTransport {
+    void *args;
+};
+
+class NullAgentHandler : public AgentMsgHandler {
+public:
+    void handleMessage(uint8_t, uint8_t, std::span<const uint8_t>) override {}
+    void handleDecodeError(uint8_t, unsigned int) override {}
+};
+
+class NullClientHandler : public ClientMsgHandler {
+public:
+    void handleMessage(uint8_t, std::span<const uint8_t>) override {}
+    void handleDecodeError(unsigned int) override {}
+};
+
+// Echoes XRCE packets through the agent adapter until stopped
+void adapterEcho(MsgAgentBase &agent, std::atomic<bool> &stop) {
+    XRCEAgentTransport transport(agent);
+    transport.init();
+    std::vector<uint8_t> buf(XRCEAgentTransport::mtu);
+    while (!stop) {
+        uint8_t clientId;
+        XRCETransportRc rc;
+        ssize_t len = transport.recv(clientId, buf.data(), buf.size(), 10, rc);
+        if (len >= 0) {
+            transport.send(clientId, buf.data(), len, rc);
+        }
+    }
+    transport.fini();
+}
+
+// Echoes XRCE packets by subscribing to the agent directly until stopped
+void rawEcho(MsgAgentBase &agent, std::atomic<bool> &stop) {
+    agent.subscribe(0, CANMORE_MSG_SUBTYPE_XRCE_DDS, [&agent](uint8_t clientId, uint8_t subtype,
+                                                             std::span<const uint8_t> data) {
+        agent.transmitMessage(clientId, subtype, data);
+    });
+    PollGroup group;
+    group.addFd(agent);
+    while (!stop) {
+        group.processEvent(10);
+    }
+    agent.unsubscribe(0, CANMORE_MSG_SUBTYPE_XRCE_DDS);
+}
+
+double benchAdapter(MsgClientBase &client, size_t len, int iterations) {
+    XRCEClientTransport adapter(client);
+    FakeCustomTransport transport { &adapter };
+    XRCEClientTransport::open(&transport);
+
+    std::vector<uint8_t> packet(len, 0x5A);
+    std::vector<uint8_t> rxBuf(XRCEClientTransport::mtu);
+    uint8_t err = 0;
+
+    uint64_t start = test_now_ns();
+    for (int i = 0; i < iterations; i++) {
+        XRCEClientTransport::write(&transport, packet.data(), packet.size(), &err);
+        if (XRCEClientTransport::read(&transport, rxBuf.data(), rxBuf.size(), 1000, &err) != len) {
+            fprintf(stderr, "Adapter round trip failed\n");
+            exit(1);
+        }
+    }
+    uint64_t elapsed = test_now_ns() - start;
+
+    XRCEClientTransport::close(&transport);
+    return (double) elapsed / iterations / 1000.0;
+}
+
+double benchRaw(MsgClientBase &client, size_t len, int iterations) {
+    std::vector<uint8_t> packet(len, 0x5A);
+    std::vector<uint8_t> rxBuf(CANMORE_MAX_MSG_LENGTH);
+    size_t rxLen = 0;
+    bool received = false;
+    client.subscribe(CANMORE_MSG_SUBTYPE_XRCE_DDS, [&](uint8_t, std::span<const uint8_t> data) {
+        std::memcpy(rxBuf.data(), data.data(), data.size());
+        rxLen = data.size();
+        received = true;
+    });
+    PollGroup group;
+    group.addFd(client);
+
+    uint64_t start = test_now_ns();
+    for (int i = 0; i < iterations; i++) {
+        received = false;
+        client.transmitMessage(CANMORE_MSG_SUBTYPE_XRCE_DDS, packet);
+        while (!received) {
+            if (!group.processEvent(1000)) {
+                fprintf(stderr, "Raw round trip failed\n");
+                exit(1);
+            }
+        }
+        if (rxLen != len) {
+            fprintf(stderr, "Raw round trip returned the wrong length\n");
+            exit(1);
+        }
+    }
+    uint64_t elapsed = test_now_ns() - start;
+
+    client.unsubscribe(CANMORE_MSG_SUBTYPE_XRCE_DDS);
+    return (double) elapsed / iterations / 1000.0;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    int iterations = (argc > 1 ? atoi(argv[1]) : 20000);
+    if (iterations < 1) {
+        iterations = 1;
+    }
+
+    struct in_addr localhost;
+    inet_aton("127.0.0.1", &localhost);
+
+    NullAgentHandler agentHandler;
+    NullClientHandler clientHandler;
+    MsgEthernetAgent agent(agentHandler, benchPort, localhost);
+    MsgEthernetClient client(localhost, benchClientId, clientHandler, benchPort);
+    agent.setDefaultHandlerEnabled(false);
+
+    const size_t sizes[] = { 16, 128, CANMORE_MAX_MSG_LENGTH };
+    for (size_t len : sizes) {
+        std::atomic<bool> stop { false };
+        std::thread echo([&]() { rawEcho(agent, stop); });
+        benchRaw(client, len, 10);  // Warm up, and let the agent learn the client's address
+        double rawUs = benchRaw(client, len, iterations);
+        stop = true;
+        echo.join();
+
+        stop = false;
+        echo = std::thread([&]() { adapterEcho(agent, stop); });
+        benchAdapter(client, len, 10);
+        double adapterUs = benchAdapter(client, len, iterations);
+        stop = true;
+        echo.join();
+
+        printf("%4zu byte packets, %d round trips: raw API %.2f us, XRCE adapters %.2f us (%+.2f us per round trip)\n",
+               len, iterations, rawUs, adapterUs, adapterUs - rawUs);
+    }
+
+    return 0;
+}
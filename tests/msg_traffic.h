@@ -0,0 +1,162 @@
+#ifndef CANMORE_TESTS__MSG_TRAFFIC_H_
+#define CANMORE_TESTS__MSG_TRAFFIC_H_
+
+#include "test_util.h"
+
+#include "canmore/msg_encoding.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @file msg_traffic.h
+ * @brief Generates a capture of interleaved message frames from several clients, as an agent would receive them
+ */
+
+#define MSG_TRAFFIC_NUM_CLIENTS 8
+#define MSG_TRAFFIC_MAX_FRAME_LEN 64
+#define MSG_TRAFFIC_MAX_PER_CLIENT 1024
+
+typedef struct msg_traffic_expected {
+    uint8_t client_id;
+    uint8_t subtype;
+    size_t len;
+    uint8_t data[CANMORE_MAX_MSG_LENGTH];
+} msg_traffic_expected_t;
+
+typedef struct msg_traffic {
+    canmore_msg_frame_t *frames;
+    uint8_t (*frame_data)[MSG_TRAFFIC_MAX_FRAME_LEN];
+    size_t num_frames;
+
+    // Messages in the order they complete, which is the order they were queued per client
+    msg_traffic_expected_t *msgs;
+    size_t num_msgs;
+} msg_traffic_t;
+
+/**
+ * @brief Encodes num_msgs random messages, spread over MSG_TRAFFIC_NUM_CLIENTS clients (IDs 1 and up). Each round one
+ * frame is taken from every client which has one ready, so messages from different clients are interleaved frame by
+ * frame. Message lengths are biased towards short messages, with occasional messages up to the maximum length.
+ */
+static inline void msg_traffic_generate(msg_traffic_t *traffic, size_t num_msgs, bool use_canfd, uint32_t seed) {
+    canmore_msg_encoder_t encoders[MSG_TRAFFIC_NUM_CLIENTS];
+    msg_traffic_expected_t **queued = (msg_traffic_expected_t **) malloc(sizeof(*queued) * MSG_TRAFFIC_NUM_CLIENTS *
+                                                                         MSG_TRAFFIC_MAX_PER_CLIENT);
+    size_t queue_len[MSG_TRAFFIC_NUM_CLIENTS] = { 0 };
+    size_t queue_pos[MSG_TRAFFIC_NUM_CLIENTS] = { 0 };
+    size_t frame_cap = 1024;
+
+    traffic->msgs = (msg_traffic_expected_t *) calloc(num_msgs, sizeof(*traffic->msgs));
+    traffic->frames = (canmore_msg_frame_t *) malloc(frame_cap * sizeof(*traffic->frames));
+    traffic->frame_data = (uint8_t(*)[MSG_TRAFFIC_MAX_FRAME_LEN]) malloc(frame_cap * MSG_TRAFFIC_MAX_FRAME_LEN);
+    traffic->num_frames = 0;
+    traffic->num_msgs = num_msgs;
+
+    for (int i = 0; i < MSG_TRAFFIC_NUM_CLIENTS; i++) {
+        canmore_msg_encode_init(&encoders[i], i + 1, CANMORE_DIRECTION_CLIENT_TO_AGENT, use_canfd);
+    }
+
+    // Assign each message to a client up front
+    for (size_t i = 0; i < num_msgs; i++) {
+        msg_traffic_expected_t *msg = &traffic->msgs[i];
+        int client = test_rand(&seed) % MSG_TRAFFIC_NUM_CLIENTS;
+        uint32_t size_class = test_rand(&seed) % 16;
+        msg->client_id = client + 1;
+        msg->subtype = test_rand(&seed) % (1 << CANMORE_MSG_SUBTYPE_LENGTH);
+        msg->len = 1 + test_rand(&seed) % (size_class == 0 ? CANMORE_MAX_MSG_LENGTH : size_class < 4 ? 200 : 24);
+        for (size_t j = 0; j < msg->len; j++) {
+            msg->data[j] = test_rand(&seed);
+        }
+        if (queue_len[client] < MSG_TRAFFIC_MAX_PER_CLIENT) {
+            queued[client * MSG_TRAFFIC_MAX_PER_CLIENT + queue_len[client]++] = msg;
+        }
+        else {
+            // Queue is full, so drop the message from the expected list
+            msg->len = 0;
+        }
+    }
+
+    bool more = true;
+    while (more) {
+        more = false;
+        for (int client = 0; client < MSG_TRAFFIC_NUM_CLIENTS; client++) {
+            canmore_msg_encoder_t *encoder = &encoders[client];
+            if (canmore_msg_encode_done(encoder)) {
+                if (queue_pos[client] == queue_len[client]) {
+                    continue;
+                }
+                msg_traffic_expected_t *msg = queued[client * MSG_TRAFFIC_MAX_PER_CLIENT + queue_pos[client]++];
+                canmore_msg_encode_load(encoder, msg->subtype, msg->data, msg->len);
+            }
+            more = true;
+
+            if (traffic->num_frames == frame_cap) {
+                frame_cap *= 2;
+                traffic->frames =
+                    (canmore_msg_frame_t *) realloc(traffic->frames, frame_cap * sizeof(*traffic->frames));
+                traffic->frame_data = (uint8_t(*)[MSG_TRAFFIC_MAX_FRAME_LEN]) realloc(
+                    traffic->frame_data, frame_cap * MSG_TRAFFIC_MAX_FRAME_LEN);
+            }
+
+            canmore_msg_frame_t *frame = &traffic->frames[traffic->num_frames++];
+            uint8_t len;
+            bool is_extended;
+            canmore_msg_encode_next(encoder, traffic->frame_data[traffic->num_frames - 1], &len, &frame->can_id,
+                                    &is_extended);
+            frame->is_extended = is_extended;
+            frame->len = len;
+        }
+    }
+
+    free(queued);
+
+    // Frame data pointers are only fixed once the array has stopped growing
+    for (size_t i = 0; i < traffic->num_frames; i++) {
+        traffic->frames[i].data = traffic->frame_data[i];
+    }
+}
+
+static inline void msg_traffic_free(msg_traffic_t *traffic) {
+    free(traffic->frames);
+    free(traffic->frame_data);
+    free(traffic->msgs);
+}
+
+/**
+ * @brief Returns the next message expected from the given client, advancing the client's cursor (which should start at
+ * 0), or NULL if no more messages are expected from it
+ */
+static inline const msg_traffic_expected_t *msg_traffic_next_expected(const msg_traffic_t *traffic, uint8_t client_id,
+                                                                      size_t *cursor) {
+    while (*cursor < traffic->num_msgs) {
+        const msg_traffic_expected_t *msg = &traffic->msgs[(*cursor)++];
+        if (msg->client_id == client_id && msg->len > 0) {
+            return msg;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Returns the number of messages which will be decoded from the traffic
+ */
+static inline size_t msg_traffic_expected_count(const msg_traffic_t *traffic) {
+    size_t count = 0;
+    for (size_t i = 0; i < traffic->num_msgs; i++) {
+        if (traffic->msgs[i].len > 0) {
+            count++;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Returns the client ID encoded in a frame ID
+ */
+static inline uint8_t msg_traffic_client_id(uint32_t can_id, bool is_extended) {
+    canmore_id_t id = { .identifier = can_id };
+    return (is_extended ? id.pkt_ext.client_id : id.pkt_std.client_id);
+}
+
+#endif
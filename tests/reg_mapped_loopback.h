@@ -0,0 +1,144 @@
+#ifndef CANMORE_TESTS__REG_MAPPED_LOOPBACK_H_
+#define CANMORE_TESTS__REG_MAPPED_LOOPBACK_H_
+
+#include "canmore/protocol.h"
+#include "canmore/reg_mapped/client.h"
+#include "canmore/reg_mapped/server.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @file reg_mapped_loopback.h
+ * @brief Connects a register mapped client directly to a server in the same process, for the register mapped tests
+ *
+ * Requests are handled by the server as soon as the client transmits them, and the responses are queued for the client
+ * to receive in order, like a transport with a receive FIFO. Responses keep their exact length, and a short response
+ * is only accepted if it reports an error, matching the message transport.
+ *
+ * There is a single loopback per test, set up with reg_mapped_loopback_init. Its server and client configuration can be
+ * adjusted directly afterwards.
+ */
+
+#define REG_MAPPED_LOOPBACK_MAX_LEN CANMORE_MAX_MSG_LENGTH
+#define REG_MAPPED_LOOPBACK_QUEUE_LEN 64
+
+typedef struct reg_mapped_loopback {
+    reg_mapped_server_inst_t server;
+    reg_mapped_client_cfg_t client;
+
+    // Responses waiting to be received by the client
+    struct {
+        uint8_t data[REG_MAPPED_LOOPBACK_MAX_LEN];
+        size_t len;
+    } queue[REG_MAPPED_LOOPBACK_QUEUE_LEN];
+    size_t queue_head;
+    size_t queue_count;
+
+    // Number of requests the server has received
+    unsigned int requests;
+    // Number of upcoming responses to discard, to simulate losing them
+    unsigned int drop_responses;
+
+    uint8_t server_buffer[REG_MAPPED_LOOPBACK_MAX_LEN];
+    uint8_t client_scratch[REG_MAPPED_LOOPBACK_MAX_LEN];
+} reg_mapped_loopback_t;
+
+static reg_mapped_loopback_t reg_mapped_loopback __attribute__((unused));
+
+static void reg_mapped_loopback_server_tx(uint8_t *msg, size_t len, void *arg) {
+    reg_mapped_loopback_t *loopback = (reg_mapped_loopback_t *) arg;
+    if (loopback->drop_responses > 0) {
+        loopback->drop_responses--;
+        return;
+    }
+    if (loopback->queue_count == REG_MAPPED_LOOPBACK_QUEUE_LEN || len > REG_MAPPED_LOOPBACK_MAX_LEN) {
+        // Overflowed the receive FIFO
+        return;
+    }
+
+    size_t tail = (loopback->queue_head + loopback->queue_count) % REG_MAPPED_LOOPBACK_QUEUE_LEN;
+    memcpy(loopback->queue[tail].data, msg, len);
+    loopback->queue[tail].len = len;
+    loopback->queue_count++;
+}
+
+static bool reg_mapped_loopback_client_tx(const uint8_t *buf, size_t len, void *arg) {
+    reg_mapped_loopback_t *loopback = (reg_mapped_loopback_t *) arg;
+    loopback->requests++;
+    reg_mapped_server_handle_request(&loopback->server, buf, len);
+    return true;
+}
+
+static bool reg_mapped_loopback_client_rx(uint8_t *buf, size_t len, unsigned int timeout_ms, void *arg) {
+    reg_mapped_loopback_t *loopback = (reg_mapped_loopback_t *) arg;
+    (void) timeout_ms;
+
+    // Every response is queued when its request is sent, so an empty queue is a timeout
+    if (loopback->queue_count == 0) {
+        return false;
+    }
+
+    size_t msg_len = loopback->queue[loopback->queue_head].len;
+    const uint8_t *msg = loopback->queue[loopback->queue_head].data;
+    loopback->queue_head = (loopback->queue_head + 1) % REG_MAPPED_LOOPBACK_QUEUE_LEN;
+    loopback->queue_count--;
+
+    if (msg_len != len && (msg_len < 1 || msg_len > len || msg[0] == REG_MAPPED_RESULT_SUCCESSFUL)) {
+        return false;
+    }
+
+    memcpy(buf, msg, msg_len);
+    return true;
+}
+
+static bool reg_mapped_loopback_client_clear_rx(void *arg) {
+    reg_mapped_loopback_t *loopback = (reg_mapped_loopback_t *) arg;
+    loopback->queue_count = 0;
+    return true;
+}
+
+/**
+ * @brief Resets the loopback, connecting a new client to a new server serving the given pages
+ *
+ * @param pages The pages served, which must remain valid while the loopback is used
+ * @param num_pages The number of pages
+ * @param transfer_mode The client's transfer mode for array transfers
+ * @param server_buffer_len The size of the server's multiword response buffer (0 to disable multiword)
+ * @param client_scratch_len The size of the client's multiword scratch buffer
+ * @return The loopback, for the test to use the server and client configuration
+ */
+static inline reg_mapped_loopback_t *reg_mapped_loopback_init(const reg_mapped_server_page_def_t *pages,
+                                                              size_t num_pages,
+                                                              enum reg_mapped_client_transfer_mode transfer_mode,
+                                                              size_t server_buffer_len, size_t client_scratch_len) {
+    reg_mapped_loopback_t *loopback = &reg_mapped_loopback;
+    memset(loopback, 0, sizeof(*loopback));
+
+    loopback->server.tx_func = &reg_mapped_loopback_server_tx;
+    loopback->server.arg = loopback;
+    loopback->server.page_array = pages;
+    loopback->server.num_pages = num_pages;
+    loopback->server.control_interface_mode = CANMORE_CONTROL_INTERFACE_MODE_NORMAL;
+    if (server_buffer_len > 0) {
+        loopback->server.multiword_resp_buffer = (reg_mapped_response_t *) loopback->server_buffer;
+        loopback->server.multiword_resp_buffer_max_count = REG_MAPPED_COMPUTE_MAX_RESP_WORD_COUNT(server_buffer_len);
+    }
+
+    loopback->client.control_interface_mode = CANMORE_CONTROL_INTERFACE_MODE_NORMAL;
+    loopback->client.tx_func = &reg_mapped_loopback_client_tx;
+    loopback->client.clear_rx_func = &reg_mapped_loopback_client_clear_rx;
+    loopback->client.rx_func = &reg_mapped_loopback_client_rx;
+    loopback->client.arg = loopback;
+    loopback->client.transfer_mode = transfer_mode;
+    loopback->client.timeout_ms = 0;
+    loopback->client.max_in_flight = 8;
+    loopback->client.multiword_scratch_buffer = loopback->client_scratch;
+    loopback->client.multiword_scratch_len = client_scratch_len;
+
+    return loopback;
+}
+
+#endif
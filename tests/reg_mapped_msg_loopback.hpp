@@ -0,0 +1,121 @@
+#pragma once
+
+#include "canmore_cpp/MsgAgent.hpp"
+#include "canmore_cpp/MsgClient.hpp"
+#include "canmore_cpp/RegMappedClient.hpp"
+#include "canmore_cpp/RegMappedServer.hpp"
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+/*
+ * Runs a RegMappedMsgServer on a message client in a background thread, with a RegMappedMsgClient on an agent talking
+ * to it over the UDP message transport on localhost. This is the register mapped protocol carried over CANmore
+ * messages end to end, without needing a CAN interface.
+ *
+ * Pages are added to server before calling start, as the server is not safe to modify once it is serving requests.
+ * Subscriptions are sampled at the steady clock's time, unless setClock has been called.
+ */
+
+namespace Canmore {
+
+class RegMappedMsgLoopback {
+public:
+    RegMappedMsgLoopback(uint16_t port, uint8_t clientId = 1):
+        localhost(makeLocalhost()), agent(agentHandler, port, localhost),
+        msgClient(localhost, clientId, clientHandler, port),
+        server(msgClient, CANMORE_CONTROL_INTERFACE_MODE_NORMAL) {
+        // The agent learns the client's address from the first message the client sends
+        const uint8_t hello = 0;
+        msgClient.transmitMessage(CANMORE_MSG_SUBTYPE_XRCE_DDS, std::span<const uint8_t> { &hello, 1 });
+        PollGroup group;
+        group.addFd(agent);
+        if (!group.processEvent(1000)) {
+            throw std::runtime_error("Message client never reached the agent");
+        }
+
+        client = RegMappedMsgClient::create(agent, clientId);
+    }
+
+    ~RegMappedMsgLoopback() {
+        stop = true;
+        if (serverThread.joinable()) {
+            serverThread.join();
+        }
+    }
+
+    // Starts serving requests from the background thread
+    void start() {
+        serverThread = std::thread([this]() {
+            PollGroup group;
+            group.addFd(msgClient);
+            while (!stop) {
+                group.processEvent(10);
+                if (fakeClock) {
+                    server.tick(fakeNowMs);
+                }
+                else {
+                    server.tick();
+                }
+                ticks++;
+            }
+        });
+    }
+
+    // Samples subscriptions at the given time from now on, rather than the steady clock
+    void setClock(uint32_t nowMs) {
+        fakeNowMs = nowMs;
+        fakeClock = true;
+    }
+
+    // Waits for the server to sample subscriptions twice, so the last sample started after this was called
+    void waitForTicks() {
+        uint64_t target = ticks + 2;
+        while (ticks < target) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    RegMappedMsgServer &getServer() { return server; }
+    MsgEthernetAgent &getAgent() { return agent; }
+    std::shared_ptr<RegMappedClient> getClient() { return client; }
+
+private:
+    class NullAgentHandler : public AgentMsgHandler {
+    public:
+        void handleMessage(uint8_t, uint8_t, std::span<const uint8_t>) override {}
+        void handleDecodeError(uint8_t, unsigned int) override {}
+    };
+
+    class NullClientHandler : public ClientMsgHandler {
+    public:
+        void handleMessage(uint8_t, std::span<const uint8_t>) override {}
+        void handleDecodeError(unsigned int) override {}
+    };
+
+    static struct in_addr makeLocalhost() {
+        struct in_addr addr;
+        inet_aton("127.0.0.1", &addr);
+        return addr;
+    }
+
+    struct in_addr localhost;
+    NullAgentHandler agentHandler;
+    NullClientHandler clientHandler;
+    MsgEthernetAgent agent;
+    MsgEthernetClient msgClient;
+    RegMappedMsgServer server;
+    std::shared_ptr<RegMappedMsgClient> client;
+
+    std::atomic<bool> stop { false };
+    std::atomic<bool> fakeClock { false };
+    std::atomic<uint32_t> fakeNowMs { 0 };
+    std::atomic<uint64_t> ticks { 0 };
+    std::thread serverThread;
+};
+
+}  // namespace Canmore
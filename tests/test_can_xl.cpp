@@ -0,0 +1,181 @@
+#include "test_util.h"
+
+#include "canmore_cpp/MsgAgent.hpp"
+#include "canmore_cpp/MsgClient.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <linux/can.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+/*
+ * Checks CANmore messages sent as single CAN XL frames. The single frame IDs are checked against the decoder without a
+ * socket, then whole messages are sent both ways between an agent and client on a virtual CAN XL interface, which can
+ * be created with:
+ *
+ *   ip link add dev vcanxl0 type vcan && ip link set vcanxl0 mtu 2060 && ip link set up vcanxl0
+ *
+ * The interface name can be overridden with the CANMORE_TEST_XL_IF environment variable. If no CAN XL interface is
+ * available, the socket checks are skipped and the test reports as skipped.
+ */
+
+using namespace Canmore;
+
+namespace {
+
+constexpr uint8_t testClientId = 5;
+constexpr uint8_t testSubtype = CANMORE_MSG_SUBTYPE_XRCE_DDS;
+const size_t testSizes[] = { 1, 2, 8, 9, 64, 65, 500, CANMORE_MAX_MSG_LENGTH };
+
+std::vector<uint8_t> makeMessage(size_t len, uint8_t seed) {
+    std::vector<uint8_t> msg(len);
+    for (size_t i = 0; i < len; i++) {
+        msg[i] = (uint8_t) (seed * 17 + i * 3);
+    }
+    return msg;
+}
+
+// Decodes single XL frames with the C decoder, covering the frame lengths only XL can carry
+void testDecodeXlFrames() {
+    canmore_msg_decoder_t decoder;
+    for (int useCanFd = 0; useCanFd <= 1; useCanFd++) {
+        canmore_msg_decode_init(&decoder, NULL, NULL, useCanFd);
+        for (size_t len : testSizes) {
+            auto msg = makeMessage(len, len);
+            uint32_t canId = canmore_msg_encode_xl_id(testClientId, CANMORE_DIRECTION_CLIENT_TO_AGENT, testSubtype,
+                                                      len);
+            canmore_id_t id = { .identifier = canId };
+            TEST_CHECK_EQ(id.pkt_ext_start.client_id, testClientId);
+            TEST_CHECK_EQ(id.pkt_ext_start.msg_len, len);
+
+            size_t decodedLen = canmore_msg_decode_frame(&decoder, canId, true, msg.data(), msg.size());
+            TEST_CHECK_EQ(decodedLen, len);
+            TEST_CHECK_EQ(canmore_msg_decode_get_subtype(&decoder), testSubtype);
+            TEST_CHECK(decodedLen == len &&
+                       std::equal(msg.begin(), msg.end(), canmore_msg_decode_get_buf(&decoder)));
+        }
+    }
+}
+
+class CollectingAgentHandler : public AgentMsgHandler {
+public:
+    void handleMessage(uint8_t clientId, uint8_t subtype, std::span<const uint8_t> data) override {
+        TEST_CHECK_EQ(clientId, testClientId);
+        TEST_CHECK_EQ(subtype, testSubtype);
+        received.emplace_back(data.begin(), data.end());
+    }
+    void handleDecodeError(uint8_t clientId, unsigned int errorCode) override {
+        fprintf(stderr, "Agent decode error %u from client %d\n", errorCode, clientId);
+        test_failures++;
+    }
+    std::vector<std::vector<uint8_t>> received;
+};
+
+class CollectingClientHandler : public ClientMsgHandler {
+public:
+    void handleMessage(uint8_t subtype, std::span<const uint8_t> data) override {
+        TEST_CHECK_EQ(subtype, testSubtype);
+        received.emplace_back(data.begin(), data.end());
+    }
+    void handleDecodeError(unsigned int errorCode) override {
+        fprintf(stderr, "Client decode error %u\n", errorCode);
+        test_failures++;
+    }
+    std::vector<std::vector<uint8_t>> received;
+};
+
+// Waits for count messages to be received, failing if they don't arrive within a second each
+bool waitForMessages(PollGroup &group, const std::vector<std::vector<uint8_t>> &received, size_t count) {
+    while (received.size() < count) {
+        if (!group.processEvent(1000)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Sends messages of every size both ways over a CAN XL interface
+bool testVcanXl() {
+#ifndef CANXL_MTU
+    fprintf(stderr, "Built without CAN XL kernel headers, skipping CAN XL socket checks\n");
+    return false;
+#else
+    const char *ifName = getenv("CANMORE_TEST_XL_IF");
+    if (!ifName) {
+        ifName = "vcanxl0";
+    }
+    int ifIndex = if_nametoindex(ifName);
+    if (!ifIndex) {
+        fprintf(stderr, "No %s interface, skipping CAN XL socket checks\n", ifName);
+        return false;
+    }
+
+    // CANSocket enables XL by the interface MTU, so check it the same way
+    struct ifreq ifr = {};
+    strncpy(ifr.ifr_name, ifName, sizeof(ifr.ifr_name) - 1);
+    int fd = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    bool isXl = (fd >= 0 && ioctl(fd, SIOCGIFMTU, &ifr) == 0 && (size_t) ifr.ifr_mtu >= CANXL_MIN_MTU);
+    if (fd >= 0) {
+        close(fd);
+    }
+    if (!isXl) {
+        fprintf(stderr, "%s is not a CAN XL interface (set its MTU to 2060), skipping CAN XL socket checks\n", ifName);
+        return false;
+    }
+
+    CollectingAgentHandler agentHandler;
+    CollectingClientHandler clientHandler;
+    MsgAgent agent(ifIndex, agentHandler);
+    MsgClient client(ifIndex, testClientId, clientHandler);
+
+    PollGroup agentGroup;
+    PollGroup clientGroup;
+    agentGroup.addFd(agent);
+    clientGroup.addFd(client);
+
+    for (size_t len : testSizes) {
+        auto msg = makeMessage(len, 1);
+        client.transmitMessage(testSubtype, msg);
+        TEST_CHECK(waitForMessages(agentGroup, agentHandler.received, agentHandler.received.size() + 1));
+        TEST_CHECK(!agentHandler.received.empty() && agentHandler.received.back() == msg);
+
+        auto reply = makeMessage(len, 2);
+        agent.transmitMessage(testClientId, testSubtype, reply);
+        TEST_CHECK(waitForMessages(clientGroup, clientHandler.received, clientHandler.received.size() + 1));
+        TEST_CHECK(!clientHandler.received.empty() && clientHandler.received.back() == reply);
+    }
+
+    // Each message is a single frame
+    auto agentStats = agent.getStats(testClientId);
+    TEST_CHECK_EQ(agentStats.framesRx, std::size(testSizes));
+    TEST_CHECK_EQ(agentStats.framesTx, std::size(testSizes));
+    TEST_CHECK_EQ(agentStats.messagesRx, std::size(testSizes));
+
+    // Client IDs past the end of the stats are refused
+    bool threw = false;
+    try {
+        agent.transmitMessage(1 << CANMORE_CLIENT_ID_LENGTH, testSubtype, makeMessage(8, 3));
+    } catch (const std::logic_error &) {
+        threw = true;
+    }
+    TEST_CHECK(threw);
+    return true;
+#endif
+}
+
+}  // namespace
+
+int main() {
+    testDecodeXlFrames();
+    bool ranVcan = testVcanXl();
+    if (!ranVcan && !test_failures) {
+        return TEST_SKIP_RETURN_CODE;
+    }
+    return TEST_RESULT();
+}
@@ -0,0 +1,46 @@
+#include "test_util.h"
+
+#include "canmore/ethernet_defs.h"
+
+/*
+ * Checks the message port header against its documented wire format, independent of host byte order and compiler
+ * struct layout
+ */
+
+int main(void) {
+    struct canmore_eth_msg_header header = {
+        .client_id = 0x15, .direction = CANMORE_DIRECTION_AGENT_TO_CLIENT, .subtype = 0x2A, .length = 0x0102
+    };
+    uint8_t buf[CANMORE_ETH_MSG_HEADER_LEN];
+    canmore_eth_msg_header_pack(&header, buf);
+    TEST_CHECK_EQ(buf[0], 0x35);
+    TEST_CHECK_EQ(buf[1], 0x2A);
+    TEST_CHECK_EQ(buf[2], 0x02);
+    TEST_CHECK_EQ(buf[3], 0x01);
+
+    // Round trips through every client ID, direction and length
+    for (unsigned int client_id = 0; client_id < (1u << CANMORE_CLIENT_ID_LENGTH); client_id++) {
+        for (unsigned int direction = 0; direction <= 1; direction++) {
+            for (unsigned int length = 0; length <= CANMORE_MAX_MSG_LENGTH; length += 97) {
+                struct canmore_eth_msg_header in = {
+                    .client_id = client_id, .direction = direction, .subtype = client_id, .length = length
+                };
+                struct canmore_eth_msg_header out;
+                canmore_eth_msg_header_pack(&in, buf);
+                TEST_CHECK(canmore_eth_msg_header_unpack(buf, &out));
+                TEST_CHECK_EQ(out.client_id, client_id);
+                TEST_CHECK_EQ(out.direction, direction);
+                TEST_CHECK_EQ(out.subtype, client_id);
+                TEST_CHECK_EQ(out.length, length);
+            }
+        }
+    }
+
+    // Reserved bits in the address byte reject the header
+    const uint8_t reserved[] = { 0x41, 0x00, 0x00, 0x00 };
+    TEST_CHECK(!canmore_eth_msg_header_unpack(reserved, &header));
+    const uint8_t reserved_high[] = { 0x81, 0x00, 0x00, 0x00 };
+    TEST_CHECK(!canmore_eth_msg_header_unpack(reserved_high, &header));
+
+    return TEST_RESULT();
+}
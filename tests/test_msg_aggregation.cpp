@@ -0,0 +1,200 @@
+#include "test_util.h"
+
+#include "canmore_cpp/MsgAgent.hpp"
+#include "canmore_cpp/MsgAggregator.hpp"
+#include "canmore_cpp/MsgClient.hpp"
+
+#include "canmore/msg_aggregation.h"
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <utility>
+#include <vector>
+
+/*
+ * Checks the aggregate pack/unpack helpers, and that MsgAggregator delivers queued messages to the client intact and in
+ * order when flushed by size, by its timer, or explicitly. Carried over the UDP message transport on localhost, so no
+ * CAN interface is needed
+ */
+
+using namespace Canmore;
+
+namespace {
+
+constexpr uint16_t testPort = 24037;
+constexpr uint8_t testClientId = 2;
+
+typedef std::pair<uint8_t, std::vector<uint8_t>> Msg;  // Format: {Subtype, Data}
+
+Msg makeMsg(uint8_t subtype, size_t len, uint8_t seed) {
+    std::vector<uint8_t> data(len);
+    for (size_t i = 0; i < len; i++) {
+        data[i] = seed + i;
+    }
+    return { subtype, data };
+}
+
+void testPackUnpack() {
+    std::vector<uint8_t> buffer(100);
+    canmore_msg_aggregator_t aggregator;
+    canmore_msg_aggregate_init(&aggregator, buffer.data(), buffer.size());
+
+    // Pack until full
+    std::vector<Msg> packed;
+    while (true) {
+        const uint8_t subtypes[] = { CANMORE_MSG_SUBTYPE_XRCE_DDS, CANMORE_MSG_SUBTYPE_TRANSFER, 63 };
+        Msg msg = makeMsg(subtypes[packed.size() % 3], 1 + packed.size() * 5, packed.size());
+        if (!canmore_msg_aggregate_fits(&aggregator, msg.second.size())) {
+            TEST_CHECK(!canmore_msg_aggregate_add(&aggregator, msg.first, msg.second.data(), msg.second.size()));
+            break;
+        }
+        TEST_CHECK(canmore_msg_aggregate_add(&aggregator, msg.first, msg.second.data(), msg.second.size()));
+        packed.push_back(msg);
+    }
+    TEST_CHECK(packed.size() > 2);
+    TEST_CHECK_EQ(canmore_msg_aggregate_get_count(&aggregator), packed.size());
+
+    // Invalid entries are refused
+    const uint8_t byte = 0;
+    TEST_CHECK(!canmore_msg_aggregate_add(&aggregator, CANMORE_MSG_SUBTYPE_AGGREGATE, &byte, 0));
+    canmore_msg_aggregator_t empty;
+    canmore_msg_aggregate_init(&empty, buffer.data(), buffer.size());
+    TEST_CHECK(!canmore_msg_aggregate_add(&empty, CANMORE_MSG_SUBTYPE_AGGREGATE, &byte, 1));
+    TEST_CHECK(!canmore_msg_aggregate_fits(&empty, 0));
+
+    // Unpacks to the same entries
+    size_t len = canmore_msg_aggregate_get_len(&aggregator);
+    canmore_msg_aggregate_iter_t iter;
+    canmore_msg_aggregate_iter_init(&iter, buffer.data(), len);
+    uint8_t subtype;
+    const uint8_t *data;
+    size_t entryLen;
+    size_t count = 0;
+    while (canmore_msg_aggregate_iter_next(&iter, &subtype, &data, &entryLen)) {
+        TEST_CHECK(count < packed.size() && packed[count] == Msg(subtype, std::vector<uint8_t>(data, data + entryLen)));
+        count++;
+    }
+    TEST_CHECK_EQ(count, packed.size());
+    TEST_CHECK(!canmore_msg_aggregate_iter_malformed(&iter));
+
+    // A truncated aggregate returns the complete entries, then reports the malformed one
+    canmore_msg_aggregate_iter_init(&iter, buffer.data(), len - 1);
+    count = 0;
+    while (canmore_msg_aggregate_iter_next(&iter, &subtype, &data, &entryLen)) {
+        count++;
+    }
+    TEST_CHECK_EQ(count, packed.size() - 1);
+    TEST_CHECK(canmore_msg_aggregate_iter_malformed(&iter));
+}
+
+class NullAgentHandler : public AgentMsgHandler {
+public:
+    void handleMessage(uint8_t, uint8_t, std::span<const uint8_t>) override {}
+    void handleDecodeError(uint8_t, unsigned int) override {}
+};
+
+class CollectingClientHandler : public ClientMsgHandler {
+public:
+    void handleMessage(uint8_t subtype, std::span<const uint8_t> data) override {
+        received.emplace_back(subtype, std::vector<uint8_t>(data.begin(), data.end()));
+    }
+    void handleDecodeError(unsigned int errorCode) override {
+        fprintf(stderr, "Client decode error %u\n", errorCode);
+        test_failures++;
+    }
+    std::vector<Msg> received;
+};
+
+// Processes events until the client has received count messages, or nothing happens for a second
+bool waitForMessages(PollGroup &group, CollectingClientHandler &handler, size_t count) {
+    while (handler.received.size() < count) {
+        if (!group.processEvent(1000)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void testAggregator() {
+    struct in_addr localhost;
+    inet_aton("127.0.0.1", &localhost);
+
+    NullAgentHandler agentHandler;
+    CollectingClientHandler clientHandler;
+    MsgEthernetAgent agent(agentHandler, testPort, localhost);
+    MsgEthernetClient client(localhost, testClientId, clientHandler, testPort);
+
+    // The agent learns the client's address from the first datagram it sends
+    const uint8_t hello = 0;
+    client.transmitMessage(CANMORE_MSG_SUBTYPE_XRCE_DDS, std::span<const uint8_t> { &hello, 1 });
+    PollGroup agentGroup;
+    agentGroup.addFd(agent);
+    TEST_CHECK(agentGroup.processEvent(1000));
+
+    // Client IDs past the end of the agent's tables are refused
+    bool threw = false;
+    try {
+        agent.transmitMessage(1 << CANMORE_CLIENT_ID_LENGTH, CANMORE_MSG_SUBTYPE_XRCE_DDS,
+                              std::span<const uint8_t> { &hello, 1 });
+    } catch (const std::logic_error &) {
+        threw = true;
+    }
+    TEST_CHECK(threw);
+
+    MsgAggregator aggregator(agent, std::chrono::milliseconds(20), 200);
+    PollGroup group;
+    group.addFd(client);
+    group.addFd(aggregator);
+
+    // The first 9 messages (22 bytes each with their entry headers) fill the aggregate, and are sent together when the
+    // next one doesn't fit, with the rest held back
+    std::vector<Msg> sent;
+    for (uint8_t i = 0; i < 12; i++) {
+        sent.push_back(makeMsg(i % 2 ? CANMORE_MSG_SUBTYPE_XRCE_DDS : CANMORE_MSG_SUBTYPE_TRANSFER, 20, i));
+        aggregator.queueMessage(testClientId, sent.back().first, sent.back().second);
+    }
+    auto before = client.getStats();
+    TEST_CHECK(waitForMessages(group, clientHandler, 9));
+    TEST_CHECK_EQ(clientHandler.received.size(), 9);
+    TEST_CHECK_EQ(client.getStats().framesRx - before.framesRx, 1);
+
+    // The remainder is sent when the flush timer expires
+    auto start = std::chrono::steady_clock::now();
+    TEST_CHECK(waitForMessages(group, clientHandler, sent.size()));
+    TEST_CHECK(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(10));
+    TEST_CHECK(clientHandler.received == sent);
+    TEST_CHECK_EQ(client.getStats().framesRx - before.framesRx, 2);
+
+    // A single pending message is sent as a plain message, and messages too large to aggregate go straight through
+    // after anything queued before them
+    clientHandler.received.clear();
+    sent.clear();
+    sent.push_back(makeMsg(CANMORE_MSG_SUBTYPE_XRCE_DDS, 10, 50));
+    sent.push_back(makeMsg(CANMORE_MSG_SUBTYPE_XRCE_DDS, 500, 60));
+    for (auto &msg : sent) {
+        aggregator.queueMessage(testClientId, msg.first, msg.second);
+    }
+    TEST_CHECK(waitForMessages(group, clientHandler, sent.size()));
+    TEST_CHECK(clientHandler.received == sent);
+
+    // flushAll sends immediately, without waiting for the timer
+    clientHandler.received.clear();
+    sent.clear();
+    for (uint8_t i = 0; i < 3; i++) {
+        sent.push_back(makeMsg(CANMORE_MSG_SUBTYPE_XRCE_DDS, 5, 70 + i));
+        aggregator.queueMessage(testClientId, sent.back().first, sent.back().second);
+    }
+    aggregator.flushAll();
+    PollGroup clientOnly;
+    clientOnly.addFd(client);
+    TEST_CHECK(waitForMessages(clientOnly, clientHandler, sent.size()));
+    TEST_CHECK(clientHandler.received == sent);
+}
+
+}  // namespace
+
+int main() {
+    testPackUnpack();
+    testAggregator();
+    return TEST_RESULT();
+}
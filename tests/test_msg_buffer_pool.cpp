@@ -0,0 +1,52 @@
+#include "test_util.h"
+
+#include "canmore_cpp/MsgBufferPool.hpp"
+
+#include <vector>
+
+/*
+ * Checks the message buffer pool stops growing at its limit, and recovers once buffers are returned
+ */
+
+using namespace Canmore;
+
+int main() {
+    auto pool = MsgBufferPool::create(16, 4);
+
+    // Reserving past the limit only allocates up to the limit
+    pool->reserve(10);
+    TEST_CHECK_EQ(pool->allocatedCount(), 4);
+    TEST_CHECK_EQ(pool->freeCount(), 4);
+
+    std::vector<uint8_t *> buffers;
+    for (int i = 0; i < 4; i++) {
+        buffers.push_back(pool->acquire());
+        TEST_CHECK(buffers.back() != nullptr);
+    }
+
+    // Exhausted, so acquire and copy fail without allocating
+    const uint8_t data[] = { 1, 2, 3 };
+    TEST_CHECK(pool->acquire() == nullptr);
+    TEST_CHECK(!pool->copy(data));
+    TEST_CHECK_EQ(pool->allocatedCount(), 4);
+
+    // A shared buffer comes back to the pool once its last reference is dropped
+    {
+        MsgBuffer shared = pool->share(buffers.back(), 8);
+        buffers.pop_back();
+        TEST_CHECK(pool->acquire() == nullptr);
+    }
+    MsgBuffer copied = pool->copy(data);
+    TEST_CHECK(copied);
+    TEST_CHECK_EQ(copied.size(), sizeof(data));
+    TEST_CHECK_EQ(copied.data()[2], 3);
+
+    for (uint8_t *buffer : buffers) {
+        pool->release(buffer);
+    }
+    copied = MsgBuffer();
+    TEST_CHECK_EQ(pool->freeCount(), 4);
+    TEST_CHECK_EQ(pool->allocatedCount(), 4);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,152 @@
+#include "test_util.h"
+
+#include "canmore_cpp/MsgCodec.hpp"
+
+#include <algorithm>
+#include <vector>
+
+/*
+ * Checks the templated codec in MsgCodec.hpp produces exactly the same frames as the C encoder in msg_encoding.c, and
+ * that messages encoded by either are decoded by the other, with the same errors reported for corrupted frames
+ */
+
+using namespace Canmore;
+
+namespace {
+
+struct Frame {
+    uint32_t id;
+    bool isExtended;
+    std::vector<uint8_t> data;
+
+    bool operator==(const Frame &other) const {
+        return id == other.id && isExtended == other.isExtended && data == other.data;
+    }
+};
+
+constexpr uint8_t testClientId = 11;
+
+std::vector<uint8_t> makeMessage(size_t len, uint32_t seed) {
+    std::vector<uint8_t> msg(len);
+    for (auto &byte : msg) {
+        byte = test_rand(&seed);
+    }
+    return msg;
+}
+
+std::vector<Frame> encodeC(bool useCanFd, Codec::Direction dir, uint8_t subtype, const std::vector<uint8_t> &msg) {
+    canmore_msg_encoder_t encoder;
+    canmore_msg_encode_init(&encoder, testClientId, static_cast<uint32_t>(dir), useCanFd);
+    canmore_msg_encode_load(&encoder, subtype, msg.data(), msg.size());
+
+    std::vector<Frame> frames;
+    uint8_t buf[CANMORE_MAX_FD_FRAME_SIZE];
+    uint8_t len;
+    uint32_t id;
+    bool isExtended;
+    while (canmore_msg_encode_next(&encoder, buf, &len, &id, &isExtended)) {
+        frames.push_back({ id, isExtended, std::vector<uint8_t>(buf, buf + len) });
+    }
+    return frames;
+}
+
+template <Codec::Mode M, Codec::Direction Dir>
+std::vector<Frame> encodeCodec(uint8_t subtype, const std::vector<uint8_t> &msg) {
+    Codec::Encoder<M, Dir> encoder(testClientId);
+    encoder.load(subtype, msg);
+
+    std::vector<Frame> frames;
+    uint8_t buf[Codec::Encoder<M, Dir>::maxFrameSize];
+    uint8_t len;
+    uint32_t id;
+    bool isExtended;
+    while (encoder.next(buf, len, id, isExtended)) {
+        frames.push_back({ id, isExtended, std::vector<uint8_t>(buf, buf + len) });
+    }
+    return frames;
+}
+
+struct ErrorLog {
+    std::vector<unsigned int> errors;
+    static void callback(void *arg, unsigned int errorCode) { ((ErrorLog *) arg)->errors.push_back(errorCode); }
+};
+
+// Decodes the frames with the C decoder, returning the completed messages (with the subtype appended)
+std::vector<std::vector<uint8_t>> decodeC(bool useCanFd, const std::vector<Frame> &frames, ErrorLog &log) {
+    canmore_msg_decoder_t decoder;
+    canmore_msg_decode_init(&decoder, &ErrorLog::callback, &log, useCanFd);
+    std::vector<std::vector<uint8_t>> msgs;
+    for (auto &frame : frames) {
+        size_t len = canmore_msg_decode_frame(&decoder, frame.id, frame.isExtended, frame.data.data(),
+                                              frame.data.size());
+        if (len > 0) {
+            const uint8_t *buf = canmore_msg_decode_get_buf(&decoder);
+            auto &msg = msgs.emplace_back(buf, buf + len);
+            msg.push_back(canmore_msg_decode_get_subtype(&decoder));
+        }
+    }
+    return msgs;
+}
+
+template <Codec::Mode M, Codec::Direction Dir>
+std::vector<std::vector<uint8_t>> decodeCodec(const std::vector<Frame> &frames, ErrorLog &log) {
+    Codec::Decoder<M, Dir> decoder(&ErrorLog::callback, &log);
+    std::vector<std::vector<uint8_t>> msgs;
+    for (auto &frame : frames) {
+        size_t len = decoder.decodeFrame(frame.id, frame.isExtended, frame.data);
+        if (len > 0) {
+            auto &msg = msgs.emplace_back(decoder.getBuf(), decoder.getBuf() + len);
+            msg.push_back(decoder.getSubtype());
+        }
+    }
+    return msgs;
+}
+
+template <Codec::Mode M, Codec::Direction Dir> void testEquivalence() {
+    constexpr bool useCanFd = (M == Codec::Mode::FD);
+    for (size_t len = 1; len <= CANMORE_MAX_MSG_LENGTH; len++) {
+        uint8_t subtype = len % (1 << CANMORE_MSG_SUBTYPE_LENGTH);
+        auto msg = makeMessage(len, len + 1);
+        auto expected = msg;
+        expected.push_back(subtype);
+
+        // Identical frames from both encoders
+        auto cFrames = encodeC(useCanFd, Dir, subtype, msg);
+        auto codecFrames = encodeCodec<M, Dir>(subtype, msg);
+        TEST_CHECK(cFrames == codecFrames);
+
+        // Both decoders decode the message exactly
+        ErrorLog cLog, codecLog;
+        auto cMsgs = decodeC(useCanFd, codecFrames, cLog);
+        auto codecMsgs = decodeCodec<M, Dir>(cFrames, codecLog);
+        TEST_CHECK(cMsgs.size() == 1 && cMsgs[0] == expected);
+        TEST_CHECK(codecMsgs.size() == 1 && codecMsgs[0] == expected);
+        TEST_CHECK(cLog.errors.empty() && codecLog.errors.empty());
+
+        // Corrupted, dropped and repeated frames are rejected with the same errors
+        if (cFrames.size() > 2) {
+            std::vector<std::vector<Frame>> faults(3, cFrames);
+            faults[0][1].data[0] ^= 0x01;
+            faults[1].erase(faults[1].begin() + 1);
+            faults[2].insert(faults[2].begin() + 1, cFrames[1]);
+            for (auto &frames : faults) {
+                ErrorLog cFaultLog, codecFaultLog;
+                auto cFaultMsgs = decodeC(useCanFd, frames, cFaultLog);
+                auto codecFaultMsgs = decodeCodec<M, Dir>(frames, codecFaultLog);
+                TEST_CHECK(cFaultMsgs.empty() && codecFaultMsgs.empty());
+                TEST_CHECK(!cFaultLog.errors.empty());
+                TEST_CHECK(cFaultLog.errors == codecFaultLog.errors);
+            }
+        }
+    }
+}
+
+}  // namespace
+
+int main() {
+    testEquivalence<Codec::Mode::Classic, Codec::Direction::ClientToAgent>();
+    testEquivalence<Codec::Mode::Classic, Codec::Direction::AgentToClient>();
+    testEquivalence<Codec::Mode::FD, Codec::Direction::ClientToAgent>();
+    testEquivalence<Codec::Mode::FD, Codec::Direction::AgentToClient>();
+    return TEST_RESULT();
+}
@@ -0,0 +1,143 @@
+#include "test_util.h"
+
+#include "canmore_cpp/MsgAgent.hpp"
+#include "canmore_cpp/MsgClient.hpp"
+
+#include "canmore/msg_aggregation.h"
+#include "canmore/msg_compression.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <vector>
+
+/*
+ * Checks the agent unpacks compressed messages (alone and mixed with aggregates) into pool buffers, and rejects a
+ * compressed message nested inside another. Carried over the UDP message transport on localhost, so no CAN interface
+ * is needed
+ */
+
+using namespace Canmore;
+
+namespace {
+
+constexpr uint16_t testPort = 24038;
+constexpr uint8_t testClientId = 1;
+constexpr uint8_t testSubtype = CANMORE_MSG_SUBTYPE_XRCE_DDS;
+
+class CountingAgentHandler : public AgentMsgHandler {
+public:
+    void handleMessage(uint8_t clientId, uint8_t subtype, std::span<const uint8_t> data) override {
+        (void) clientId;
+        (void) subtype;
+        (void) data;
+        unexpected++;
+    }
+    void handleDecodeError(uint8_t clientId, unsigned int errorCode) override {
+        (void) clientId;
+        if (errorCode < CANMORE_MSG_DECODER_NUM_ERRORS) {
+            errors[errorCode]++;
+        }
+    }
+    int unexpected = 0;
+    int errors[CANMORE_MSG_DECODER_NUM_ERRORS] = {};
+};
+
+class NullClientHandler : public ClientMsgHandler {
+public:
+    void handleMessage(uint8_t, std::span<const uint8_t>) override {}
+    void handleDecodeError(unsigned int) override {}
+};
+
+// Compressible payload, a short phrase repeated with a counter
+std::vector<uint8_t> makePayload(size_t len) {
+    std::vector<uint8_t> payload(len);
+    for (size_t i = 0; i < len; i++) {
+        payload[i] = "register value "[i % 15] + (i / 150);
+    }
+    return payload;
+}
+
+std::vector<uint8_t> compress(uint8_t subtype, const std::vector<uint8_t> &data) {
+    std::vector<uint8_t> out(CANMORE_MAX_MSG_LENGTH);
+    size_t len = canmore_msg_compress(subtype, data.data(), data.size(), out.data(), out.size());
+    TEST_CHECK(len > 0);
+    out.resize(len);
+    return out;
+}
+
+// Sends a message from the client, and waits for the agent to process the datagram
+void sendAndProcess(MsgClientBase &client, PollGroup &agentGroup, uint8_t subtype, const std::vector<uint8_t> &data) {
+    client.transmitMessage(subtype, data);
+    TEST_CHECK(agentGroup.processEvent(1000));
+}
+
+}  // namespace
+
+int main() {
+    struct in_addr localhost;
+    inet_aton("127.0.0.1", &localhost);
+
+    CountingAgentHandler agentHandler;
+    NullClientHandler clientHandler;
+    MsgEthernetAgent agent(agentHandler, testPort, localhost);
+    MsgEthernetClient client(localhost, testClientId, clientHandler, testPort);
+    PollGroup agentGroup;
+    agentGroup.addFd(agent);
+
+    std::vector<std::vector<uint8_t>> received;
+    agent.subscribe(testClientId, testSubtype, [&](uint8_t, uint8_t, std::span<const uint8_t> data) {
+        received.emplace_back(data.begin(), data.end());
+    });
+    auto pool = agent.getBufferPool();
+    pool->reserve(4);
+    size_t allocated = pool->allocatedCount();
+
+    // A compressed message is delivered as the original message
+    auto payload = makePayload(700);
+    auto compressed = compress(testSubtype, payload);
+    TEST_CHECK(compressed.size() < payload.size());
+    sendAndProcess(client, agentGroup, CANMORE_MSG_SUBTYPE_COMPRESSED, compressed);
+    TEST_CHECK_EQ(received.size(), 1);
+    TEST_CHECK(!received.empty() && received.back() == payload);
+
+    // An aggregate inside a compressed message is unpacked, but a compressed message inside that is rejected
+    auto inner = compress(testSubtype, makePayload(100));
+    std::vector<uint8_t> aggregateBuf(CANMORE_MAX_MSG_LENGTH);
+    canmore_msg_aggregator_t aggregator;
+    canmore_msg_aggregate_init(&aggregator, aggregateBuf.data(), aggregateBuf.size());
+    const uint8_t plain[] = { 1, 2, 3 };
+    TEST_CHECK(canmore_msg_aggregate_add(&aggregator, testSubtype, plain, sizeof(plain)));
+    TEST_CHECK(canmore_msg_aggregate_add(&aggregator, CANMORE_MSG_SUBTYPE_COMPRESSED, inner.data(), inner.size()));
+    aggregateBuf.resize(canmore_msg_aggregate_get_len(&aggregator));
+    sendAndProcess(client, agentGroup, CANMORE_MSG_SUBTYPE_COMPRESSED,
+                   compress(CANMORE_MSG_SUBTYPE_AGGREGATE, aggregateBuf));
+    TEST_CHECK_EQ(received.size(), 2);
+    TEST_CHECK(received.size() == 2 && received.back() == std::vector<uint8_t>(plain, plain + sizeof(plain)));
+    TEST_CHECK_EQ(agentHandler.errors[CANMORE_MSG_DECODER_ERROR_MALFORMED_COMPRESSED], 1);
+
+    // The same compressed message in a plain aggregate is fine
+    sendAndProcess(client, agentGroup, CANMORE_MSG_SUBTYPE_AGGREGATE, aggregateBuf);
+    TEST_CHECK_EQ(received.size(), 4);
+    TEST_CHECK(received.size() == 4 && received.back() == makePayload(100));
+    TEST_CHECK_EQ(agentHandler.errors[CANMORE_MSG_DECODER_ERROR_MALFORMED_COMPRESSED], 1);
+
+    // Malformed compressed data is reported, and its buffer goes back to the pool
+    std::vector<uint8_t> garbage = { testSubtype, 0xFF, 0x00, 0xF0, 0x12 };
+    sendAndProcess(client, agentGroup, CANMORE_MSG_SUBTYPE_COMPRESSED, garbage);
+    TEST_CHECK_EQ(agentHandler.errors[CANMORE_MSG_DECODER_ERROR_MALFORMED_COMPRESSED], 2);
+    TEST_CHECK_EQ(received.size(), 4);
+
+    // Owned subscribers are handed the decompression buffer directly
+    MsgBuffer owned;
+    agent.subscribeOwned(testClientId, testSubtype, [&](uint8_t, uint8_t, MsgBuffer msg) { owned = std::move(msg); });
+    sendAndProcess(client, agentGroup, CANMORE_MSG_SUBTYPE_COMPRESSED, compressed);
+    TEST_CHECK(owned && std::equal(payload.begin(), payload.end(), owned.data().begin(), owned.data().end()));
+    TEST_CHECK_EQ(pool->freeCount(), allocated - 1);
+    owned = MsgBuffer();
+
+    // Every decompression buffer was returned, without the pool growing
+    TEST_CHECK_EQ(pool->allocatedCount(), allocated);
+    TEST_CHECK_EQ(pool->freeCount(), allocated);
+    TEST_CHECK_EQ(agentHandler.unexpected, 0);
+    return TEST_RESULT();
+}
@@ -0,0 +1,407 @@
+#include "msg_traffic.h"
+#include "test_util.h"
+
+#include "canmore/msg_encoding.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Checks canmore_msg_decode_frames reassembles interleaved traffic from many clients exactly as sent, for any batch
+ * split, that every buffer it acquires is handed back, and that messages which can't get a buffer are reported. Also
+ * checks messages loaded from segments or pulled through a callback encode to exactly the same frames as a contiguous
+ * buffer, and that decoders with a small buffer reject larger messages up front without losing the messages after them
+ */
+
+static canmore_msg_split_decoder_t decoders[MSG_TRAFFIC_NUM_CLIENTS];
+static unsigned int decode_errors[CANMORE_MSG_DECODER_NUM_ERRORS];
+static int buffers_outstanding;
+static uint8_t dropped_client;  // Client ID which lookup drops the frames of, or 0 for none
+static int buffer_limit = -1;   // Max buffers acquire hands out at once, or -1 for no limit
+
+static void decode_error_cb(void *arg, unsigned int error_code) {
+    (void) arg;
+    if (error_code < CANMORE_MSG_DECODER_NUM_ERRORS) {
+        decode_errors[error_code]++;
+    }
+}
+
+static canmore_msg_split_decoder_t *lookup_cb(void *arg, uint32_t can_id, bool is_extended) {
+    (void) arg;
+    uint8_t client_id = msg_traffic_client_id(can_id, is_extended);
+    if (client_id == 0 || client_id > MSG_TRAFFIC_NUM_CLIENTS || client_id == dropped_client) {
+        return NULL;
+    }
+    return &decoders[client_id - 1];
+}
+
+static uint8_t *acquire_cb(void *arg) {
+    (void) arg;
+    if (buffer_limit >= 0 && buffers_outstanding >= buffer_limit) {
+        return NULL;
+    }
+    buffers_outstanding++;
+    return (uint8_t *) malloc(CANMORE_MAX_MSG_LENGTH);
+}
+
+static void release_cb(void *arg, uint8_t *buffer) {
+    (void) arg;
+    buffers_outstanding--;
+    free(buffer);
+}
+
+static void reset_decoders(bool use_canfd) {
+    for (int i = 0; i < MSG_TRAFFIC_NUM_CLIENTS; i++) {
+        uint8_t *buffer = canmore_msg_split_decode_detach_buffer(&decoders[i]);
+        if (buffer) {
+            release_cb(NULL, buffer);
+        }
+        canmore_msg_split_decode_init(&decoders[i], &decode_error_cb, NULL, use_canfd);
+    }
+    memset(decode_errors, 0, sizeof(decode_errors));
+}
+
+/**
+ * @brief Decodes the traffic in batches of batch_len frames, returning the number of messages which matched.
+ * Each decoded message must match a later message from its client than the previous match (messages lost to errors are
+ * skipped), otherwise it is counted in mismatches_out
+ */
+static size_t decode_traffic(const msg_traffic_t *traffic, size_t batch_len, size_t out_max, size_t *mismatches_out) {
+    const canmore_msg_decode_batch_ops_t ops = {
+        .lookup = &lookup_cb, .acquire_buffer = &acquire_cb, .release_buffer = &release_cb, .arg = NULL
+    };
+    canmore_msg_decoded_t out[16];
+    size_t cursors[MSG_TRAFFIC_NUM_CLIENTS] = { 0 };
+    size_t matched = 0;
+    *mismatches_out = 0;
+
+    for (size_t start = 0; start < traffic->num_frames; start += batch_len) {
+        size_t len = traffic->num_frames - start;
+        if (len > batch_len) {
+            len = batch_len;
+        }
+
+        size_t consumed = 0;
+        while (consumed < len) {
+            size_t count;
+            consumed += canmore_msg_decode_frames(&traffic->frames[start + consumed], len - consumed, &ops, out,
+                                                  out_max, &count);
+            TEST_CHECK(count <= out_max);
+
+            for (size_t i = 0; i < count; i++) {
+                uint8_t client_id = (out[i].decoder - decoders) + 1;
+                const msg_traffic_expected_t *expected;
+                do {
+                    expected = msg_traffic_next_expected(traffic, client_id, &cursors[client_id - 1]);
+                } while (expected && (expected->subtype != out[i].subtype || expected->len != out[i].len ||
+                                      memcmp(expected->data, out[i].buffer, out[i].len) != 0));
+
+                if (expected) {
+                    matched++;
+                }
+                else {
+                    (*mismatches_out)++;
+                }
+                release_cb(NULL, out[i].buffer);
+            }
+        }
+    }
+
+    return matched;
+}
+
+static void test_batch_splits(bool use_canfd) {
+    msg_traffic_t traffic;
+    msg_traffic_generate(&traffic, 300, use_canfd, 0x1234 + use_canfd);
+    size_t expected = msg_traffic_expected_count(&traffic);
+
+    const size_t batch_lens[] = { 1, 2, 7, 16, 64, SIZE_MAX };
+    const size_t out_maxes[] = { 1, 3, 16 };
+    for (size_t i = 0; i < sizeof(batch_lens) / sizeof(*batch_lens); i++) {
+        for (size_t j = 0; j < sizeof(out_maxes) / sizeof(*out_maxes); j++) {
+            reset_decoders(use_canfd);
+            size_t mismatches;
+            size_t matched = decode_traffic(&traffic, batch_lens[i], out_maxes[j], &mismatches);
+            TEST_CHECK_EQ(matched, expected);
+            TEST_CHECK_EQ(mismatches, 0);
+
+            // Idle decoders release their buffers, so nothing should be left attached
+            TEST_CHECK_EQ(buffers_outstanding, 0);
+            for (int k = 0; k < CANMORE_MSG_DECODER_NUM_ERRORS; k++) {
+                TEST_CHECK_EQ(decode_errors[k], 0);
+            }
+        }
+    }
+
+    msg_traffic_free(&traffic);
+}
+
+static void test_corrupt_and_dropped(bool use_canfd) {
+    msg_traffic_t traffic;
+    msg_traffic_generate(&traffic, 100, use_canfd, 0x5678 + use_canfd);
+    size_t expected = msg_traffic_expected_count(&traffic);
+
+    // Corrupt a middle (standard ID) frame, which is covered by the CRC in the message's last frame
+    size_t corrupt_frame = SIZE_MAX;
+    for (size_t i = 0; i < traffic.num_frames && corrupt_frame == SIZE_MAX; i++) {
+        if (!traffic.frames[i].is_extended && traffic.frames[i].len > 0) {
+            corrupt_frame = i;
+        }
+    }
+    TEST_CHECK(corrupt_frame != SIZE_MAX);
+    if (corrupt_frame == SIZE_MAX) {
+        msg_traffic_free(&traffic);
+        return;
+    }
+    traffic.frame_data[corrupt_frame][0] ^= 0xFF;
+
+    // The corrupted message is lost, but every other message still decodes
+    reset_decoders(use_canfd);
+    size_t mismatches;
+    size_t matched = decode_traffic(&traffic, 16, 8, &mismatches);
+    TEST_CHECK_EQ(decode_errors[CANMORE_MSG_DECODER_ERROR_CRC_FAIL], 1);
+    TEST_CHECK_EQ(buffers_outstanding, 0);
+    TEST_CHECK_EQ(matched, expected - 1);
+    TEST_CHECK_EQ(mismatches, 0);
+    traffic.frame_data[corrupt_frame][0] ^= 0xFF;
+
+    // Frames from clients the lookup drops are skipped without disturbing other clients
+    size_t dropped_msgs = 0;
+    for (size_t i = 0; i < traffic.num_msgs; i++) {
+        if (traffic.msgs[i].client_id == 3 && traffic.msgs[i].len > 0) {
+            dropped_msgs++;
+        }
+    }
+    reset_decoders(use_canfd);
+    dropped_client = 3;
+    matched = decode_traffic(&traffic, 16, 8, &mismatches);
+    dropped_client = 0;
+    TEST_CHECK_EQ(matched, expected - dropped_msgs);
+    TEST_CHECK_EQ(mismatches, 0);
+    TEST_CHECK_EQ(buffers_outstanding, 0);
+
+    msg_traffic_free(&traffic);
+}
+
+static void test_buffer_exhausted(bool use_canfd) {
+    msg_traffic_t traffic;
+    msg_traffic_generate(&traffic, 100, use_canfd, 0x9ABC + use_canfd);
+    size_t expected = msg_traffic_expected_count(&traffic);
+
+    // With no buffers available, every message is dropped and reported rather than silently skipped
+    reset_decoders(use_canfd);
+    buffer_limit = 0;
+    size_t mismatches;
+    size_t matched = decode_traffic(&traffic, 16, 8, &mismatches);
+    TEST_CHECK_EQ(matched, 0);
+    TEST_CHECK_EQ(decode_errors[CANMORE_MSG_DECODER_ERROR_NO_BUFFER], expected);
+    TEST_CHECK_EQ(decode_errors[CANMORE_MSG_DECODER_ERROR_BAD_SEQ_NUM], 0);
+
+    // With fewer buffers than interleaved clients, every message is either decoded or reported
+    reset_decoders(use_canfd);
+    buffer_limit = 2;
+    matched = decode_traffic(&traffic, 16, 8, &mismatches);
+    TEST_CHECK(decode_errors[CANMORE_MSG_DECODER_ERROR_NO_BUFFER] > 0);
+    TEST_CHECK_EQ(matched + decode_errors[CANMORE_MSG_DECODER_ERROR_NO_BUFFER], expected);
+    TEST_CHECK_EQ(mismatches, 0);
+    TEST_CHECK_EQ(buffers_outstanding, 0);
+    buffer_limit = -1;
+
+    msg_traffic_free(&traffic);
+}
+
+// Frames captured from an encoder, for comparison between the ways of loading a message
+typedef struct encoded_frames {
+    size_t num_frames;
+    uint8_t data[CANMORE_MAX_MSG_LENGTH][CANMORE_MAX_FD_FRAME_SIZE];
+    uint8_t len[CANMORE_MAX_MSG_LENGTH];
+    uint32_t can_id[CANMORE_MAX_MSG_LENGTH];
+    bool is_extended[CANMORE_MAX_MSG_LENGTH];
+} encoded_frames_t;
+
+static void capture_frames(canmore_msg_encoder_t *encoder, encoded_frames_t *out) {
+    out->num_frames = 0;
+    while (out->num_frames < CANMORE_MAX_MSG_LENGTH) {
+        size_t i = out->num_frames;
+        if (!canmore_msg_encode_next(encoder, out->data[i], &out->len[i], &out->can_id[i], &out->is_extended[i])) {
+            break;
+        }
+        out->num_frames++;
+    }
+    TEST_CHECK(canmore_msg_encode_done(encoder));
+}
+
+// The CRC-18 is carried in the last frame's ID, so matching IDs also checks it was computed over the same bytes
+static bool frames_equal(const encoded_frames_t *a, const encoded_frames_t *b) {
+    if (a->num_frames != b->num_frames) {
+        return false;
+    }
+    for (size_t i = 0; i < a->num_frames; i++) {
+        if (a->len[i] != b->len[i] || a->can_id[i] != b->can_id[i] || a->is_extended[i] != b->is_extended[i] ||
+            memcmp(a->data[i], b->data[i], a->len[i]) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Message pulled by pull_cb, which expects the message to be fetched in order
+static struct {
+    const uint8_t *data;
+    size_t next_offset;
+    bool out_of_order;
+} pull_source;
+
+static void pull_cb(void *arg, size_t offset, uint8_t *buffer_out, size_t len) {
+    TEST_CHECK(arg == &pull_source);
+    if (offset != pull_source.next_offset) {
+        pull_source.out_of_order = true;
+    }
+    memcpy(buffer_out, &pull_source.data[offset], len);
+    pull_source.next_offset = offset + len;
+}
+
+/**
+ * @brief Splits len bytes of data into random segments (many of which end partway through a frame), with empty
+ * segments at the start, the end, and scattered in between. Returns the number of segments
+ */
+static size_t split_segments(const uint8_t *data, size_t len, canmore_msg_segment_t *segments, size_t max_segments,
+                             uint32_t *seed) {
+    size_t num_segments = 0;
+    size_t offset = 0;
+    segments[num_segments++] = (canmore_msg_segment_t) { .data = data, .len = 0 };
+    while (offset < len && num_segments < max_segments - 2) {
+        size_t segment_len = test_rand(seed) % 4 == 0 ? 0 : 1 + test_rand(seed) % 100;
+        if (segment_len > len - offset) {
+            segment_len = len - offset;
+        }
+        segments[num_segments++] = (canmore_msg_segment_t) { .data = &data[offset], .len = segment_len };
+        offset += segment_len;
+    }
+    segments[num_segments++] = (canmore_msg_segment_t) { .data = &data[offset], .len = len - offset };
+    segments[num_segments++] = (canmore_msg_segment_t) { .data = &data[len], .len = 0 };
+    return num_segments;
+}
+
+static void test_load_equivalence(bool use_canfd, uint32_t nominal_bitrate, uint32_t data_bitrate) {
+    static uint8_t msg[CANMORE_MAX_MSG_LENGTH];
+    static encoded_frames_t expected, actual;
+    uint32_t seed = 0x3300 + use_canfd + nominal_bitrate / 1000;
+    for (size_t i = 0; i < sizeof(msg); i++) {
+        msg[i] = test_rand(&seed);
+    }
+
+    canmore_msg_encoder_t encoder;
+    canmore_msg_encode_init(&encoder, 5, CANMORE_DIRECTION_CLIENT_TO_AGENT, use_canfd);
+    canmore_msg_encode_set_fd_bitrates(&encoder, nominal_bitrate, data_bitrate);
+
+    const size_t fixed_lens[] = { 1, 7, 8, 9, 63, 64, 65, 100, 512, CANMORE_MAX_MSG_LENGTH };
+    for (size_t iter = 0; iter < 200; iter++) {
+        size_t len = 1 + test_rand(&seed) % CANMORE_MAX_MSG_LENGTH;
+        if (iter < sizeof(fixed_lens) / sizeof(*fixed_lens)) {
+            len = fixed_lens[iter];
+        }
+        uint8_t subtype = iter % 16;
+
+        canmore_msg_encode_load(&encoder, subtype, msg, len);
+        capture_frames(&encoder, &expected);
+
+        canmore_msg_segment_t segments[32];
+        size_t num_segments = split_segments(msg, len, segments, 32, &seed);
+        canmore_msg_encode_load_segments(&encoder, subtype, segments, num_segments);
+        capture_frames(&encoder, &actual);
+        TEST_CHECK(frames_equal(&expected, &actual));
+
+        // A single segment holding the whole message
+        canmore_msg_segment_t whole = { .data = msg, .len = len };
+        canmore_msg_encode_load_segments(&encoder, subtype, &whole, 1);
+        capture_frames(&encoder, &actual);
+        TEST_CHECK(frames_equal(&expected, &actual));
+
+        pull_source.data = msg;
+        pull_source.next_offset = 0;
+        pull_source.out_of_order = false;
+        canmore_msg_encode_load_pull(&encoder, subtype, len, &pull_cb, &pull_source);
+        capture_frames(&encoder, &actual);
+        TEST_CHECK(frames_equal(&expected, &actual));
+        TEST_CHECK(!pull_source.out_of_order);
+        TEST_CHECK_EQ(pull_source.next_offset, len);
+    }
+}
+
+#define SIZED_CAPACITY 32
+
+static void test_sized_capacity(bool use_canfd) {
+    static CANMORE_MSG_SIZED_DECODER_TYPE(SIZED_CAPACITY) decoder;
+    canmore_msg_sized_decode_init(&decoder, &decode_error_cb, NULL, use_canfd);
+    memset(decode_errors, 0, sizeof(decode_errors));
+
+    uint8_t msg[CANMORE_MAX_MSG_LENGTH];
+    uint32_t seed = 0x3500 + use_canfd;
+    for (size_t i = 0; i < sizeof(msg); i++) {
+        msg[i] = test_rand(&seed);
+    }
+    canmore_msg_encoder_t encoder;
+    canmore_msg_encode_init(&encoder, 6, CANMORE_DIRECTION_CLIENT_TO_AGENT, use_canfd);
+
+    // Each oversized message is reported once from its first frame, and the messages which fit still decode after it
+    // (a 48 byte message is a single frame in CAN FD)
+    const size_t lens[] = { SIZED_CAPACITY + 1, 1, 48, SIZED_CAPACITY, CANMORE_MAX_MSG_LENGTH, 20, 100, 100 };
+    unsigned int expected_rejects = 0;
+    for (size_t i = 0; i < sizeof(lens) / sizeof(*lens); i++) {
+        bool fits = lens[i] <= SIZED_CAPACITY;
+        uint8_t subtype = i + 1;
+        canmore_msg_encode_load(&encoder, subtype, msg, lens[i]);
+
+        size_t frames = 0;
+        size_t decoded_len = 0;
+        uint8_t frame[CANMORE_MAX_FD_FRAME_SIZE];
+        uint8_t frame_len;
+        uint32_t can_id;
+        bool is_extended;
+        while (canmore_msg_encode_next(&encoder, frame, &frame_len, &can_id, &is_extended)) {
+            size_t ret = canmore_msg_split_decode_frame(&decoder.split, can_id, is_extended, frame, frame_len);
+            if (ret) {
+                decoded_len = ret;
+            }
+            if (frames++ == 0 && !fits) {
+                expected_rejects++;
+                TEST_CHECK_EQ(decode_errors[CANMORE_MSG_DECODER_ERROR_MSG_EXCEEDS_CAPACITY], expected_rejects);
+            }
+        }
+
+        if (fits) {
+            TEST_CHECK_EQ(decoded_len, lens[i]);
+            TEST_CHECK_EQ(canmore_msg_split_decode_get_subtype(&decoder.split), subtype);
+            TEST_CHECK(memcmp(canmore_msg_split_decode_get_buf(&decoder.split), msg, lens[i]) == 0);
+        }
+        else {
+            TEST_CHECK_EQ(decoded_len, 0);
+        }
+    }
+
+    // Nothing but the rejections was reported, so the remaining frames of each rejected message were skipped quietly
+    TEST_CHECK_EQ(decode_errors[CANMORE_MSG_DECODER_ERROR_MSG_EXCEEDS_CAPACITY], 5);
+    for (int k = 0; k < CANMORE_MSG_DECODER_NUM_ERRORS; k++) {
+        if (k != CANMORE_MSG_DECODER_ERROR_MSG_EXCEEDS_CAPACITY) {
+            TEST_CHECK_EQ(decode_errors[k], 0);
+        }
+    }
+    memset(decode_errors, 0, sizeof(decode_errors));
+}
+
+int main(void) {
+    test_batch_splits(false);
+    test_batch_splits(true);
+    test_corrupt_and_dropped(false);
+    test_corrupt_and_dropped(true);
+    test_buffer_exhausted(false);
+    test_buffer_exhausted(true);
+    test_load_equivalence(false, 0, 0);
+    test_load_equivalence(true, 0, 0);
+    test_load_equivalence(true, 1000000, 1000000);
+    test_sized_capacity(false);
+    test_sized_capacity(true);
+    reset_decoders(false);
+    return TEST_RESULT();
+}
@@ -0,0 +1,140 @@
+#include "test_util.h"
+
+#include "canmore/msg_encoding.h"
+
+#include <string.h>
+
+/*
+ * Sweeps canmore_msg_fd_plan_fragments over every message length for a range of bitrates. Each plan must fit within
+ * the CAN FD frame limit, only pad the last frame, and never take longer to send than filling every frame. Messages
+ * encoded with the plan must then decode with the standard decoder, in exactly the planned frames
+ */
+
+#define CLIENT_ID 3
+#define SUBTYPE 2
+
+static const struct {
+    uint32_t nominal;
+    uint32_t data;
+} bitrates[] = {
+    { 500000, 2000000 }, { 1000000, 5000000 }, { 1000000, 8000000 }, { 500000, 500000 }, { 125000, 4000000 },
+};
+
+static uint8_t padded_len(size_t len) {
+    return canmore_fd_dlc2len(canmore_fd_len2dlc(len));
+}
+
+// Worst case frame time, matching the estimate the planner optimizes
+static uint64_t frame_time_ns(size_t frame_len, bool is_extended, uint32_t nominal_bitrate, uint32_t data_bitrate) {
+    uint64_t arb_bits = (is_extended ? 36 : 17);
+    arb_bits += (arb_bits - 1) / 4;
+    uint64_t data_bits = 1 + 4 + 8 * frame_len;
+    data_bits += data_bits / 4;
+    uint64_t crc_len = (frame_len > 16 ? 21 : 17);
+    data_bits += 4 + crc_len + (4 + crc_len + 3) / 4 + 1;
+    arb_bits += 1 + 1 + 7 + 3;
+    return (arb_bits * 1000000000ull) / nominal_bitrate + (data_bits * 1000000000ull) / data_bitrate;
+}
+
+static uint64_t plan_time_ns(const uint8_t *frame_lens, size_t num_frames, uint32_t nominal_bitrate,
+                             uint32_t data_bitrate) {
+    uint64_t time = 0;
+    for (size_t i = 0; i < num_frames; i++) {
+        bool is_extended = (i == 0 || i == num_frames - 1);
+        time += frame_time_ns(padded_len(frame_lens[i]), is_extended, nominal_bitrate, data_bitrate);
+    }
+    return time;
+}
+
+static uint64_t greedy_time_ns(size_t len, uint32_t nominal_bitrate, uint32_t data_bitrate) {
+    uint8_t frame_lens[CANMORE_MSG_FD_MAX_FRAMES];
+    size_t num_frames = 0;
+    for (; len > 0; len -= frame_lens[num_frames++]) {
+        frame_lens[num_frames] = (len > CANMORE_MAX_FD_FRAME_SIZE ? CANMORE_MAX_FD_FRAME_SIZE : len);
+    }
+    return plan_time_ns(frame_lens, num_frames, nominal_bitrate, data_bitrate);
+}
+
+// Returns the number of plans which were faster than filling every frame
+static unsigned int test_plans(uint32_t nominal_bitrate, uint32_t data_bitrate) {
+    unsigned int faster_plans = 0;
+    for (size_t len = 1; len <= CANMORE_MAX_MSG_LENGTH; len++) {
+        uint8_t frame_lens[CANMORE_MSG_FD_MAX_FRAMES];
+        size_t num_frames = canmore_msg_fd_plan_fragments(len, nominal_bitrate, data_bitrate, frame_lens);
+        TEST_CHECK(num_frames > 0 && num_frames <= CANMORE_MSG_FD_MAX_FRAMES);
+
+        size_t total = 0;
+        for (size_t i = 0; i < num_frames; i++) {
+            TEST_CHECK(frame_lens[i] > 0 && frame_lens[i] <= CANMORE_MAX_FD_FRAME_SIZE);
+            if (i + 1 < num_frames) {
+                TEST_CHECK_EQ(padded_len(frame_lens[i]), frame_lens[i]);
+            }
+            total += frame_lens[i];
+        }
+        TEST_CHECK_EQ(total, len);
+
+        uint64_t time = plan_time_ns(frame_lens, num_frames, nominal_bitrate, data_bitrate);
+        uint64_t greedy_time = greedy_time_ns(len, nominal_bitrate, data_bitrate);
+        TEST_CHECK(time <= greedy_time);
+        if (time < greedy_time) {
+            faster_plans++;
+        }
+    }
+    return faster_plans;
+}
+
+static void test_round_trip(uint32_t nominal_bitrate, uint32_t data_bitrate) {
+    static uint8_t msg[CANMORE_MAX_MSG_LENGTH];
+    uint32_t seed = 0x3600 + nominal_bitrate / 1000 + data_bitrate / 1000;
+    for (size_t i = 0; i < sizeof(msg); i++) {
+        msg[i] = test_rand(&seed);
+    }
+
+    canmore_msg_encoder_t encoder;
+    canmore_msg_encode_init(&encoder, CLIENT_ID, CANMORE_DIRECTION_CLIENT_TO_AGENT, true);
+    canmore_msg_encode_set_fd_bitrates(&encoder, nominal_bitrate, data_bitrate);
+    canmore_msg_decoder_t decoder;
+    canmore_msg_decode_init(&decoder, NULL, NULL, true);
+
+    for (size_t len = 1; len <= CANMORE_MAX_MSG_LENGTH; len++) {
+        uint8_t frame_lens[CANMORE_MSG_FD_MAX_FRAMES];
+        size_t num_frames = canmore_msg_fd_plan_fragments(len, nominal_bitrate, data_bitrate, frame_lens);
+
+        canmore_msg_encode_load(&encoder, SUBTYPE, msg, len);
+        size_t frames = 0;
+        size_t decoded_len = 0;
+        uint8_t frame[CANMORE_MAX_FD_FRAME_SIZE];
+        uint8_t frame_len;
+        uint32_t can_id;
+        bool is_extended;
+        while (canmore_msg_encode_next(&encoder, frame, &frame_len, &can_id, &is_extended)) {
+            TEST_CHECK(frames < num_frames);
+            if (frames < num_frames) {
+                TEST_CHECK_EQ(frame_len, padded_len(frame_lens[frames]));
+            }
+            frames++;
+
+            size_t ret = canmore_msg_decode_frame(&decoder, can_id, is_extended, frame, frame_len);
+            if (ret) {
+                TEST_CHECK_EQ(decoded_len, 0);
+                decoded_len = ret;
+            }
+        }
+        TEST_CHECK_EQ(frames, num_frames);
+        TEST_CHECK_EQ(decoded_len, len);
+        TEST_CHECK_EQ(canmore_msg_decode_get_subtype(&decoder), SUBTYPE);
+        TEST_CHECK(memcmp(canmore_msg_decode_get_buf(&decoder), msg, len) == 0);
+    }
+}
+
+int main(void) {
+    unsigned int faster_plans = 0;
+    for (size_t i = 0; i < sizeof(bitrates) / sizeof(bitrates[0]); i++) {
+        faster_plans += test_plans(bitrates[i].nominal, bitrates[i].data);
+        test_round_trip(bitrates[i].nominal, bitrates[i].data);
+    }
+    // Some plans must differ from filling every frame, so those are round tripped too
+    TEST_CHECK(faster_plans > 0);
+
+    return TEST_RESULT();
+}
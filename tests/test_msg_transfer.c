@@ -0,0 +1,250 @@
+#include "test_util.h"
+
+#include "canmore/msg_transfer.h"
+
+#include <string.h>
+
+/*
+ * Checks large transfers by passing messages directly between a sender and a receiver. Replies are held until the
+ * sender has nothing more it may send, so the sender has to stay within the window it was last granted. Covers a
+ * transfer of the maximum length, recovery from lost DATA messages and ACKs, windows smaller than a chunk, and
+ * transfers which are aborted by the receiver
+ */
+
+#define SUBTYPE 5
+#define MAX_REPLIES 64
+
+static uint8_t payload[CANMORE_MSG_TRANSFER_MAX_LENGTH];
+static uint8_t rx_buffer[CANMORE_MSG_TRANSFER_MAX_LENGTH];
+
+static canmore_msg_transfer_tx_t tx;
+static canmore_msg_transfer_rx_t rx;
+
+// Faults injected by pump, and what it saw. Reset by start_transfer
+static struct {
+    int drop_data_offset;     // Offset of a DATA message to drop once, or -1 for none
+    int corrupt_data_offset;  // Offset of a DATA message to flip a payload bit of, or -1 for none
+    int drop_burst;           // Index of a burst (counting from 0) to lose the replies to, or -1 for none
+
+    unsigned int data_msgs;
+    size_t max_data_len;
+    unsigned int bursts;
+    unsigned int resend_acks;
+    unsigned int completions;
+    uint32_t granted_end;  // End of the window from the last ACK the sender received
+} link;
+
+static uint32_t read_u16(const uint8_t *buf) {
+    return buf[0] | (buf[1] << 8);
+}
+
+static uint32_t read_u32(const uint8_t *buf) {
+    return buf[0] | (buf[1] << 8) | (buf[2] << 16) | ((uint32_t) buf[3] << 24);
+}
+
+static void fill_payload(size_t len, uint32_t seed) {
+    for (size_t i = 0; i < len; i++) {
+        payload[i] = test_rand(&seed);
+    }
+}
+
+static void start_transfer(size_t len, size_t chunk_size, size_t capacity, uint16_t window) {
+    memset(&link, 0, sizeof(link));
+    link.drop_data_offset = -1;
+    link.corrupt_data_offset = -1;
+    link.drop_burst = -1;
+    canmore_msg_transfer_rx_init(&rx, rx_buffer, capacity, window);
+    TEST_CHECK(canmore_msg_transfer_tx_start(&tx, SUBTYPE, payload, len, chunk_size));
+}
+
+// Sends everything the sender may send to the receiver as a burst, then hands the sender the replies, until the
+// sender stalls (or the transfer ends)
+static void pump(void) {
+    static uint8_t msg[CANMORE_MAX_MSG_LENGTH];
+    static uint8_t replies[MAX_REPLIES][CANMORE_MSG_TRANSFER_ACK_SIZE];
+    static size_t reply_lens[MAX_REPLIES];
+
+    for (;;) {
+        unsigned int num_replies = 0;
+        size_t len;
+        while ((len = canmore_msg_transfer_tx_next(&tx, msg)) > 0) {
+            if (msg[0] == CANMORE_MSG_TRANSFER_OPCODE_DATA) {
+                uint32_t offset = read_u16(&msg[2]);
+                size_t data_len = len - CANMORE_MSG_TRANSFER_DATA_HEADER_SIZE;
+                link.data_msgs++;
+                if (data_len > link.max_data_len) {
+                    link.max_data_len = data_len;
+                }
+                TEST_CHECK(offset + data_len <= link.granted_end);
+
+                if ((int) offset == link.drop_data_offset) {
+                    link.drop_data_offset = -1;
+                    continue;
+                }
+                if ((int) offset == link.corrupt_data_offset) {
+                    msg[CANMORE_MSG_TRANSFER_DATA_HEADER_SIZE] ^= 1;
+                }
+            }
+
+            size_t reply_len;
+            if (canmore_msg_transfer_rx_handle(&rx, msg, len, replies[num_replies], &reply_len)) {
+                link.completions++;
+            }
+            if (reply_len == 0 || (int) link.bursts == link.drop_burst) {
+                continue;
+            }
+            TEST_CHECK(num_replies < MAX_REPLIES);
+            reply_lens[num_replies++] = reply_len;
+        }
+
+        link.bursts++;
+        if (num_replies == 0) {
+            return;
+        }
+        for (unsigned int i = 0; i < num_replies; i++) {
+            const uint8_t *reply = replies[i];
+            if (reply[0] == CANMORE_MSG_TRANSFER_OPCODE_ACK) {
+                link.granted_end = read_u32(&reply[2]) + read_u16(&reply[6]);
+                if (reply[8] & CANMORE_MSG_TRANSFER_ACK_FLAG_RESEND) {
+                    link.resend_acks++;
+                }
+            }
+            canmore_msg_transfer_tx_handle(&tx, reply, reply_lens[i]);
+        }
+    }
+}
+
+static void check_received(size_t len) {
+    TEST_CHECK_EQ(canmore_msg_transfer_tx_get_status(&tx), CANMORE_MSG_TRANSFER_STATUS_COMPLETE);
+    TEST_CHECK_EQ(canmore_msg_transfer_rx_get_status(&rx), CANMORE_MSG_TRANSFER_STATUS_COMPLETE);
+    TEST_CHECK_EQ(canmore_msg_transfer_rx_get_length(&rx), len);
+    TEST_CHECK_EQ(canmore_msg_transfer_rx_get_subtype(&rx), SUBTYPE);
+    TEST_CHECK(memcmp(rx_buffer, payload, len) == 0);
+    TEST_CHECK_EQ(link.completions, 1);
+}
+
+static void test_round_trip(void) {
+    fill_payload(CANMORE_MSG_TRANSFER_MAX_LENGTH, 0x39);
+    start_transfer(CANMORE_MSG_TRANSFER_MAX_LENGTH, CANMORE_MSG_TRANSFER_MAX_CHUNK_SIZE, sizeof(rx_buffer), 4096);
+    pump();
+    check_received(CANMORE_MSG_TRANSFER_MAX_LENGTH);
+
+    // Every chunk is sent once, in full
+    unsigned int chunks = (CANMORE_MSG_TRANSFER_MAX_LENGTH + CANMORE_MSG_TRANSFER_MAX_CHUNK_SIZE - 1) /
+                          CANMORE_MSG_TRANSFER_MAX_CHUNK_SIZE;
+    TEST_CHECK_EQ(link.data_msgs, chunks);
+    TEST_CHECK_EQ(link.max_data_len, CANMORE_MSG_TRANSFER_MAX_CHUNK_SIZE);
+    TEST_CHECK_EQ(link.resend_acks, 0);
+
+    // Transfers the sender can't start are refused
+    TEST_CHECK(!canmore_msg_transfer_tx_start(&tx, SUBTYPE, payload, 0, 100));
+    TEST_CHECK(!canmore_msg_transfer_tx_start(&tx, SUBTYPE, payload, CANMORE_MSG_TRANSFER_MAX_LENGTH + 1, 100));
+    TEST_CHECK(!canmore_msg_transfer_tx_start(&tx, CANMORE_MSG_SUBTYPE_TRANSFER, payload, 100, 100));
+    TEST_CHECK(!canmore_msg_transfer_tx_start(&tx, SUBTYPE, payload, 100, 0));
+}
+
+static void test_dropped_data(void) {
+    const size_t len = 20000;
+    const size_t chunk = 500;
+    fill_payload(len, 0x3901);
+    start_transfer(len, chunk, sizeof(rx_buffer), 4000);
+    link.drop_data_offset = 3 * chunk;
+    pump();
+    check_received(len);
+
+    // The receiver asks for the data to be resent once, and the sender resends from the gap
+    TEST_CHECK_EQ(link.resend_acks, 1);
+    TEST_CHECK(link.data_msgs > len / chunk);
+}
+
+static void test_lost_acks(void) {
+    const size_t len = 6000;
+    const size_t chunk = 250;
+    const uint16_t window = 1000;
+    fill_payload(len, 0x3902);
+
+    // Count the bursts of a transfer with nothing lost (pump ends on one more, with nothing to send)
+    start_transfer(len, chunk, sizeof(rx_buffer), window);
+    pump();
+    check_received(len);
+    unsigned int total_bursts = link.bursts - 1;
+    unsigned int clean_msgs = link.data_msgs;
+
+    // Losing the ACK to START, the ACKs partway through, or the final ACK stalls the sender until it times out
+    unsigned int lost_bursts[] = { 0, total_bursts / 2, total_bursts - 1 };
+    for (unsigned int i = 0; i < sizeof(lost_bursts) / sizeof(lost_bursts[0]); i++) {
+        start_transfer(len, chunk, sizeof(rx_buffer), window);
+        link.drop_burst = lost_bursts[i];
+        pump();
+        TEST_CHECK_EQ(canmore_msg_transfer_tx_get_status(&tx), CANMORE_MSG_TRANSFER_STATUS_ACTIVE);
+
+        canmore_msg_transfer_tx_timeout(&tx);
+        pump();
+        check_received(len);
+        // Only the unacknowledged data is sent again
+        TEST_CHECK(link.data_msgs <= clean_msgs + window / chunk);
+    }
+
+    // Timeouts after the transfer ends are ignored
+    canmore_msg_transfer_tx_timeout(&tx);
+    uint8_t msg[CANMORE_MAX_MSG_LENGTH];
+    TEST_CHECK_EQ(canmore_msg_transfer_tx_next(&tx, msg), 0);
+}
+
+static void test_small_window(void) {
+    // Windows smaller than a chunk are filled with partial chunks
+    const size_t len = 5000;
+    fill_payload(len, 0x3903);
+    start_transfer(len, CANMORE_MSG_TRANSFER_MAX_CHUNK_SIZE, sizeof(rx_buffer), 100);
+    pump();
+    check_received(len);
+    TEST_CHECK_EQ(link.max_data_len, 100);
+    TEST_CHECK_EQ(link.data_msgs, len / 100);
+
+    // Down to a single byte at a time
+    start_transfer(300, CANMORE_MSG_TRANSFER_MAX_CHUNK_SIZE, sizeof(rx_buffer), 1);
+    pump();
+    check_received(300);
+    TEST_CHECK_EQ(link.max_data_len, 1);
+    TEST_CHECK_EQ(link.data_msgs, 300);
+}
+
+static void test_aborts(void) {
+    fill_payload(3000, 0x3904);
+    uint8_t msg[CANMORE_MAX_MSG_LENGTH];
+
+    // Corrupted data fails the CRC check once the whole payload arrives
+    start_transfer(3000, 400, sizeof(rx_buffer), 1000);
+    link.corrupt_data_offset = 800;
+    pump();
+    TEST_CHECK_EQ(canmore_msg_transfer_rx_get_status(&rx), CANMORE_MSG_TRANSFER_STATUS_ABORTED);
+    TEST_CHECK_EQ(canmore_msg_transfer_tx_get_status(&tx), CANMORE_MSG_TRANSFER_STATUS_ABORTED);
+    TEST_CHECK_EQ(canmore_msg_transfer_tx_get_abort_reason(&tx), CANMORE_MSG_TRANSFER_ABORT_CRC_FAIL);
+    TEST_CHECK_EQ(link.completions, 0);
+    TEST_CHECK_EQ(canmore_msg_transfer_tx_next(&tx, msg), 0);
+
+    // Transfers larger than the receiver's buffer are refused before any data is sent
+    start_transfer(3000, 400, 2999, 1000);
+    pump();
+    TEST_CHECK_EQ(canmore_msg_transfer_rx_get_status(&rx), CANMORE_MSG_TRANSFER_STATUS_ABORTED);
+    TEST_CHECK_EQ(canmore_msg_transfer_tx_get_status(&tx), CANMORE_MSG_TRANSFER_STATUS_ABORTED);
+    TEST_CHECK_EQ(canmore_msg_transfer_tx_get_abort_reason(&tx), CANMORE_MSG_TRANSFER_ABORT_TOO_LARGE);
+    TEST_CHECK_EQ(link.data_msgs, 0);
+
+    // But one which just fits is accepted
+    start_transfer(3000, 400, 3000, 1000);
+    pump();
+    check_received(3000);
+}
+
+int main(void) {
+    canmore_msg_transfer_tx_init(&tx);
+
+    test_round_trip();
+    test_dropped_data();
+    test_lost_acks();
+    test_small_window();
+    test_aborts();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,297 @@
+#include "reg_mapped_loopback.h"
+#include "test_util.h"
+
+#include "canmore_cpp/RegMappedClient.hpp"
+
+#include "canmore/reg_mapped/client.h"
+#include "canmore/reg_mapped/server.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <iterator>
+#include <poll.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+/*
+ * Checks batch transactions against a model of the server's memory in every transfer mode, that a failing entry is
+ * reported and stops the batch, and that short error responses and a server with a smaller multiword buffer than the
+ * client are handled. The C client is tested over an in-process loopback, and the Ethernet client against the same
+ * server over UDP on localhost
+ */
+
+using namespace Canmore;
+
+namespace {
+
+constexpr uint16_t testPort = 24049;
+
+constexpr uint8_t pageA = 0;
+constexpr uint8_t pageB = 1;
+constexpr uint8_t pageReadOnly = 2;
+constexpr uint8_t pageUnimplemented = 3;
+
+uint32_t memA[REG_MAPPED_PAGE_NUM_WORDS];
+uint32_t memB[40];
+uint32_t memReadOnly[4] = { 0x11, 0x22, 0x33, 0x44 };
+
+const reg_mapped_server_page_def_t pages[] = {
+    { reg_mapped_server_page_def_t::PAGE_TYPE_MEMORY_MAPPED_WORD,
+      { .mem_mapped_word = { REGISTER_PERM_READ_WRITE, memA, std::size(memA) } } },
+    { reg_mapped_server_page_def_t::PAGE_TYPE_MEMORY_MAPPED_WORD,
+      { .mem_mapped_word = { REGISTER_PERM_READ_WRITE, memB, std::size(memB) } } },
+    { reg_mapped_server_page_def_t::PAGE_TYPE_MEMORY_MAPPED_WORD,
+      { .mem_mapped_word = { REGISTER_PERM_READ_ONLY, memReadOnly, std::size(memReadOnly) } } },
+    { reg_mapped_server_page_def_t::PAGE_TYPE_UNIMPLEMENTED, {} },
+};
+
+// Entries with storage for their data, so they can be passed to reg_mapped_client_transact
+struct Batch {
+    std::vector<reg_mapped_client_batch_entry_t> entries;
+    std::vector<std::vector<uint32_t>> data;
+
+    void add(bool write, uint8_t page, uint8_t offset, std::vector<uint32_t> words) {
+        data.push_back(std::move(words));
+        entries.push_back({ write, page, offset, (unsigned int) data.back().size(), nullptr });
+    }
+
+    int transact(const reg_mapped_client_cfg_t *cfg, size_t *errorEntry) {
+        for (size_t i = 0; i < entries.size(); i++) {
+            entries[i].data = data[i].data();
+        }
+        return reg_mapped_client_transact(cfg, entries.data(), entries.size(), errorEntry);
+    }
+};
+
+void testRandomBatches(enum reg_mapped_client_transfer_mode mode) {
+    reg_mapped_loopback_t *loopback = reg_mapped_loopback_init(pages, std::size(pages), mode, 64, 64);
+    uint32_t seed = 0x1234 + mode;
+
+    std::vector<uint32_t> modelA(std::begin(memA), std::end(memA));
+    std::vector<uint32_t> modelB(std::begin(memB), std::end(memB));
+
+    for (int iter = 0; iter < 500; iter++) {
+        Batch batch;
+        std::vector<std::vector<uint32_t>> expected;
+        int numEntries = 1 + test_rand(&seed) % 8;
+        for (int i = 0; i < numEntries; i++) {
+            bool usePageA = test_rand(&seed) % 2;
+            auto &model = (usePageA ? modelA : modelB);
+            uint8_t offset = test_rand(&seed) % model.size();
+            unsigned int count = 1 + test_rand(&seed) % std::min<size_t>(model.size() - offset, 20);
+
+            if (test_rand(&seed) % 2) {
+                std::vector<uint32_t> words(count);
+                for (auto &word : words) {
+                    word = test_rand(&seed);
+                }
+                std::copy(words.begin(), words.end(), model.begin() + offset);
+                batch.add(true, (usePageA ? pageA : pageB), offset, words);
+                expected.emplace_back();
+            }
+            else {
+                batch.add(false, (usePageA ? pageA : pageB), offset, std::vector<uint32_t>(count));
+                expected.emplace_back(model.begin() + offset, model.begin() + offset + count);
+            }
+        }
+
+        TEST_CHECK_EQ(batch.transact(&loopback->client, nullptr), REG_MAPPED_RESULT_SUCCESSFUL);
+        for (size_t i = 0; i < batch.entries.size(); i++) {
+            TEST_CHECK(batch.entries[i].write || batch.data[i] == expected[i]);
+        }
+    }
+
+    TEST_CHECK(std::equal(modelA.begin(), modelA.end(), memA));
+    TEST_CHECK(std::equal(modelB.begin(), modelB.end(), memB));
+}
+
+void testFailingEntry(enum reg_mapped_client_transfer_mode mode) {
+    reg_mapped_loopback_t *loopback = reg_mapped_loopback_init(pages, std::size(pages), mode, 64, 64);
+    memA[0] = 0;
+    memA[1] = 0;
+
+    // The entries before the failure are performed, and the ones after are not
+    Batch batch;
+    batch.add(true, pageA, 0, { 0xAA });
+    batch.add(false, pageReadOnly, 0, { 0, 0 });
+    batch.add(true, pageReadOnly, 1, { 0xBB });
+    batch.add(true, pageA, 1, { 0xCC });
+    size_t errorEntry = 99;
+    TEST_CHECK_EQ(batch.transact(&loopback->client, &errorEntry), REG_MAPPED_RESULT_INVALID_REGISTER_MODE);
+    TEST_CHECK_EQ(errorEntry, 2);
+    TEST_CHECK_EQ(memA[0], 0xAA);
+    TEST_CHECK_EQ(memA[1], 0);
+    TEST_CHECK_EQ(memReadOnly[1], 0x22);
+
+    Batch unimplemented;
+    unimplemented.add(false, pageA, 0, { 0 });
+    unimplemented.add(false, pageUnimplemented, 0, { 0 });
+    TEST_CHECK_EQ(unimplemented.transact(&loopback->client, &errorEntry), REG_MAPPED_RESULT_INVALID_REGISTER_ADDRESS);
+    TEST_CHECK_EQ(errorEntry, 1);
+
+    // Entries crossing a page boundary are refused before anything is sent
+    unsigned int requests = loopback->requests;
+    Batch crossing;
+    crossing.add(false, pageA, 0, { 0 });
+    crossing.add(false, pageA, REG_MAPPED_PAGE_NUM_WORDS - 1, { 0, 0 });
+    TEST_CHECK_EQ(crossing.transact(&loopback->client, &errorEntry), REG_MAPPED_CLIENT_RESULT_INVALID_ARG);
+    TEST_CHECK_EQ(errorEntry, 1);
+    TEST_CHECK_EQ(loopback->requests, requests);
+}
+
+void testShortErrorResponses() {
+    // Batches rejected before any entry is performed get a response without the read data, which must be reported as
+    // the server's error rather than a receive failure
+    reg_mapped_loopback_t *loopback =
+        reg_mapped_loopback_init(pages, std::size(pages), TRANSFER_MODE_MULTIWORD, 64, 64);
+    Batch batch;
+    batch.add(false, pageA, 0, std::vector<uint32_t>(10));
+    size_t errorEntry = 99;
+
+    loopback->client.control_interface_mode = CANMORE_CONTROL_INTERFACE_MODE_BOOTLOADER;
+    TEST_CHECK_EQ(batch.transact(&loopback->client, &errorEntry), REG_MAPPED_RESULT_INVALID_MODE);
+    TEST_CHECK_EQ(errorEntry, 0);
+    loopback->client.control_interface_mode = CANMORE_CONTROL_INTERFACE_MODE_NORMAL;
+
+    loopback->server.multiword_resp_buffer = nullptr;
+    TEST_CHECK_EQ(batch.transact(&loopback->client, &errorEntry), REG_MAPPED_RESULT_MULTIWORD_UNSUPPORTED);
+
+    // A lost response is still a receive failure
+    loopback = reg_mapped_loopback_init(pages, std::size(pages), TRANSFER_MODE_MULTIWORD, 64, 64);
+    loopback->drop_responses = 1;
+    TEST_CHECK_EQ(batch.transact(&loopback->client, &errorEntry), REG_MAPPED_CLIENT_RESULT_RX_FAIL);
+}
+
+void testSmallServerBuffer() {
+    // The server can return 14 words in a batch response, but the client packs up to 254 words into a request
+    reg_mapped_loopback_t *loopback =
+        reg_mapped_loopback_init(pages, std::size(pages), TRANSFER_MODE_MULTIWORD, 64, REG_MAPPED_LOOPBACK_MAX_LEN);
+    for (unsigned int i = 0; i < std::size(memA); i++) {
+        memA[i] = 0x1000 + i;
+    }
+
+    Batch batch;
+    batch.add(false, pageA, 0, std::vector<uint32_t>(100));
+    batch.add(true, pageB, 0, { 1, 2, 3 });
+    batch.add(false, pageA, 100, std::vector<uint32_t>(50));
+    TEST_CHECK_EQ(batch.transact(&loopback->client, nullptr), REG_MAPPED_RESULT_SUCCESSFUL);
+    for (unsigned int i = 0; i < 100; i++) {
+        TEST_CHECK_EQ(batch.data[0][i], 0x1000 + i);
+    }
+    for (unsigned int i = 0; i < 50; i++) {
+        TEST_CHECK_EQ(batch.data[2][i], 0x1000 + 100 + i);
+    }
+    TEST_CHECK_EQ(memB[2], 3);
+
+    // A few requests are rejected while the limit is found (halving to 9 words), and the rest are sized to fit, rather
+    // than falling back to a request per word
+    unsigned int requests = loopback->requests;
+    TEST_CHECK_EQ(batch.transact(&loopback->client, nullptr), REG_MAPPED_RESULT_SUCCESSFUL);
+    TEST_CHECK(loopback->requests - requests <= 4 + (150 + 8) / 9);
+}
+
+// Serves the loopback's server over UDP, sending responses back to whoever sent the request
+void udpServer(int fd, std::atomic<bool> &stop) {
+    struct Dest {
+        int fd;
+        struct sockaddr_in addr;
+    } dest = { fd, {} };
+
+    reg_mapped_loopback.server.arg = &dest;
+    reg_mapped_loopback.server.tx_func = [](uint8_t *msg, size_t len, void *arg) {
+        auto dest = (Dest *) arg;
+        sendto(dest->fd, msg, len, 0, (sockaddr *) &dest->addr, sizeof(dest->addr));
+    };
+
+    uint8_t buf[CANMORE_ETH_UDP_MAX_LEN];
+    while (!stop) {
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        if (poll(&pfd, 1, 10) <= 0) {
+            continue;
+        }
+        socklen_t addrLen = sizeof(dest.addr);
+        ssize_t len = recvfrom(fd, buf, sizeof(buf), 0, (sockaddr *) &dest.addr, &addrLen);
+        if (len > 0) {
+            reg_mapped_server_handle_request(&reg_mapped_loopback.server, buf, len);
+        }
+    }
+}
+
+void testEthernetClient() {
+    struct in_addr localhost;
+    inet_aton("127.0.0.1", &localhost);
+
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr = localhost;
+    addr.sin_port = htons(testPort);
+    if (fd < 0 || bind(fd, (sockaddr *) &addr, sizeof(addr)) < 0) {
+        fprintf(stderr, "Failed to bind UDP server\n");
+        test_failures++;
+        return;
+    }
+
+    // Smaller than the Ethernet client's scratch buffer, so large batches are split to fit
+    reg_mapped_loopback_init(pages, std::size(pages), TRANSFER_MODE_MULTIWORD, 128, 0);
+    std::atomic<bool> stop { false };
+    std::thread server([&]() { udpServer(fd, stop); });
+
+    auto client = RegMappedEthernetClient::create(localhost, testPort);
+    for (unsigned int i = 0; i < std::size(memA); i++) {
+        memA[i] = 0x2000 + i;
+    }
+
+    std::vector<RegMappedClient::BatchEntry> batch = {
+        RegMappedClient::BatchEntry::read(pageA, 10, 80),
+        RegMappedClient::BatchEntry::write(pageB, 5, { 7, 8 }),
+        RegMappedClient::BatchEntry::read(pageReadOnly, 0, 4),
+    };
+    client->transact(CANMORE_CONTROL_INTERFACE_MODE_NORMAL, batch);
+    for (unsigned int i = 0; i < 80; i++) {
+        TEST_CHECK_EQ(batch[0].data[i], 0x2000 + 10 + i);
+    }
+    TEST_CHECK_EQ(memB[6], 8);
+    TEST_CHECK(batch[2].data == std::vector<uint32_t>(std::begin(memReadOnly), std::end(memReadOnly)));
+
+    // A batch the server rejects in the wrong mode is reported with the server's error
+    int errorCode = REG_MAPPED_RESULT_SUCCESSFUL;
+    try {
+        client->transact(CANMORE_CONTROL_INTERFACE_MODE_BOOTLOADER, batch);
+    } catch (const RegMappedClientError &e) {
+        errorCode = e.errorCode;
+    }
+    TEST_CHECK_EQ(errorCode, REG_MAPPED_RESULT_INVALID_MODE);
+
+    // As is a failing entry, with the response at full length
+    batch.push_back(RegMappedClient::BatchEntry::write(pageReadOnly, 0, { 0 }));
+    errorCode = REG_MAPPED_RESULT_SUCCESSFUL;
+    try {
+        client->transact(CANMORE_CONTROL_INTERFACE_MODE_NORMAL, batch);
+    } catch (const RegMappedClientError &e) {
+        errorCode = e.errorCode;
+    }
+    TEST_CHECK_EQ(errorCode, REG_MAPPED_RESULT_INVALID_REGISTER_MODE);
+
+    stop = true;
+    server.join();
+    close(fd);
+}
+
+}  // namespace
+
+int main() {
+    const enum reg_mapped_client_transfer_mode modes[] = { TRANSFER_MODE_SINGLE, TRANSFER_MODE_BULK,
+                                                           TRANSFER_MODE_MULTIWORD };
+    for (auto mode : modes) {
+        testRandomBatches(mode);
+        testFailingEntry(mode);
+    }
+    testShortErrorResponses();
+    testSmallServerBuffer();
+    testEthernetClient();
+    return TEST_RESULT();
+}
@@ -0,0 +1,150 @@
+#include "reg_mapped_loopback.h"
+#include "test_util.h"
+
+#include "canmore/reg_mapped/client.h"
+#include "canmore/reg_mapped/server.h"
+
+/*
+ * Checks pipelined bulk array reads against the server over an in-process loopback: every offset and length with
+ * several window sizes, reads which run off the end of the page, a lost response, and that the server leaves bulk mode
+ * after every failure so later requests (including bulk writes) still work
+ */
+
+#define PAGE_FULL 0
+#define PAGE_SHORT 1
+#define SHORT_WORDS 40
+
+static uint32_t mem_full[REG_MAPPED_PAGE_NUM_WORDS];
+static uint32_t mem_short[SHORT_WORDS];
+
+static const reg_mapped_server_page_def_t pages[] = {
+    [PAGE_FULL] = { .page_type = PAGE_TYPE_MEMORY_MAPPED_WORD,
+                    .type = { .mem_mapped_word = { .perm = REGISTER_PERM_READ_WRITE,
+                                                   .base_addr = mem_full,
+                                                   .num_words = REG_MAPPED_PAGE_NUM_WORDS } } },
+    [PAGE_SHORT] = { .page_type = PAGE_TYPE_MEMORY_MAPPED_WORD,
+                     .type = { .mem_mapped_word = { .perm = REGISTER_PERM_READ_WRITE,
+                                                    .base_addr = mem_short,
+                                                    .num_words = SHORT_WORDS } } },
+};
+
+// Checks the server isn't stuck in bulk mode, with a plain read followed by a bulk write and read back
+static void check_server_usable(reg_mapped_loopback_t *loopback) {
+    uint32_t value = 0;
+    TEST_CHECK_EQ(reg_mapped_client_read_register(&loopback->client, PAGE_FULL, 3, &value),
+                  REG_MAPPED_RESULT_SUCCESSFUL);
+    TEST_CHECK_EQ(value, mem_full[3]);
+
+    const uint32_t words[3] = { 0xB0, 0xB1, 0xB2 };
+    TEST_CHECK_EQ(reg_mapped_client_write_array(&loopback->client, PAGE_SHORT, 5, words, 3),
+                  REG_MAPPED_RESULT_SUCCESSFUL);
+    uint32_t read_back[3] = { 0 };
+    TEST_CHECK_EQ(reg_mapped_client_read_array(&loopback->client, PAGE_SHORT, 5, read_back, 3),
+                  REG_MAPPED_RESULT_SUCCESSFUL);
+    TEST_CHECK(read_back[0] == 0xB0 && read_back[1] == 0xB1 && read_back[2] == 0xB2);
+}
+
+static void test_every_range(void) {
+    static const unsigned int windows[] = { 1, 3, 8, 64 };
+    reg_mapped_loopback_t *loopback = reg_mapped_loopback_init(pages, 2, TRANSFER_MODE_BULK, 0, 0);
+    unsigned int iter = 0;
+
+    for (unsigned int offset = 0; offset < REG_MAPPED_PAGE_NUM_WORDS; offset += 5) {
+        for (unsigned int len = 1; offset + len <= REG_MAPPED_PAGE_NUM_WORDS; len++, iter++) {
+            uint32_t data[REG_MAPPED_PAGE_NUM_WORDS];
+            memset(data, 0xEE, sizeof(data));
+            loopback->client.max_in_flight = windows[iter % 4];
+            loopback->requests = 0;
+
+            TEST_CHECK_EQ(reg_mapped_client_read_array(&loopback->client, PAGE_FULL, offset, data, len),
+                          REG_MAPPED_RESULT_SUCCESSFUL);
+            TEST_CHECK(memcmp(data, &mem_full[offset], len * sizeof(*data)) == 0);
+            // A single bulk request, one word per request
+            TEST_CHECK_EQ(loopback->requests, len);
+        }
+    }
+}
+
+static void test_out_of_range(void) {
+    reg_mapped_loopback_t *loopback = reg_mapped_loopback_init(pages, 2, TRANSFER_MODE_BULK, 0, 0);
+
+    // The words before the end of the page are read, and the error is reported at the first missing word
+    uint32_t data[20] = { 0 };
+    uint8_t error_offset = 0;
+    TEST_CHECK_EQ(reg_mapped_client_read_array_ex(&loopback->client, PAGE_SHORT, 30, data, 20, &error_offset),
+                  REG_MAPPED_RESULT_INVALID_REGISTER_ADDRESS);
+    TEST_CHECK_EQ(error_offset, SHORT_WORDS);
+    TEST_CHECK(memcmp(data, &mem_short[30], (SHORT_WORDS - 30) * sizeof(*data)) == 0);
+    check_server_usable(loopback);
+
+    // Failing on the very first word, with a small window so the end of the bulk request is sent after the failure
+    loopback->client.max_in_flight = 2;
+    TEST_CHECK_EQ(reg_mapped_client_read_array_ex(&loopback->client, PAGE_SHORT, SHORT_WORDS, data, 10, &error_offset),
+                  REG_MAPPED_RESULT_INVALID_REGISTER_ADDRESS);
+    TEST_CHECK_EQ(error_offset, SHORT_WORDS);
+    check_server_usable(loopback);
+}
+
+static void test_lost_response(void) {
+    reg_mapped_loopback_t *loopback = reg_mapped_loopback_init(pages, 2, TRANSFER_MODE_BULK, 0, 0);
+
+    // Losing a response means the next one arrives out of sequence
+    uint32_t data[16];
+    uint8_t error_offset = 0;
+    loopback->drop_responses = 1;
+    TEST_CHECK_EQ(reg_mapped_client_read_array_ex(&loopback->client, PAGE_FULL, 100, data, 16, &error_offset),
+                  REG_MAPPED_CLIENT_RESULT_INVALID_BULK_COUNT);
+    TEST_CHECK_EQ(error_offset, 100);
+    check_server_usable(loopback);
+
+    // Losing every response is a receive failure
+    loopback->drop_responses = 16;
+    TEST_CHECK_EQ(reg_mapped_client_read_array_ex(&loopback->client, PAGE_FULL, 100, data, 16, &error_offset),
+                  REG_MAPPED_CLIENT_RESULT_RX_FAIL);
+    TEST_CHECK_EQ(error_offset, 100);
+    loopback->drop_responses = 0;
+    check_server_usable(loopback);
+}
+
+static void test_mixed_bulk(void) {
+    reg_mapped_loopback_t *loopback = reg_mapped_loopback_init(pages, 2, TRANSFER_MODE_BULK, 0, 0);
+
+    // A bulk write in the middle of a bulk read is a sequence error, reported by the response ending the bulk request
+    reg_mapped_request_t req = { .read_pkt = { .flags = { .f = { .write = false,
+                                                                 .bulk_req = true,
+                                                                 .mode = CANMORE_CONTROL_INTERFACE_MODE_NORMAL } },
+                                               .count = 0,
+                                               .page = PAGE_FULL,
+                                               .offset = 0 } };
+    reg_mapped_server_handle_request(&loopback->server, req.data, sizeof(req.read_pkt));
+    TEST_CHECK_EQ(loopback->queue_count, 1);
+    TEST_CHECK_EQ(loopback->queue[0].data[0], REG_MAPPED_RESULT_SUCCESSFUL);
+
+    req.write_pkt.flags.f.write = true;
+    req.write_pkt.flags.f.bulk_end = true;
+    req.write_pkt.count = 1;
+    req.write_pkt.data = 0;
+    reg_mapped_server_handle_request(&loopback->server, req.data, sizeof(req.write_pkt));
+    TEST_CHECK_EQ(loopback->queue_count, 2);
+    TEST_CHECK_EQ(loopback->queue[1].data[0], REG_MAPPED_RESULT_BULK_REQUEST_SEQ_ERROR);
+
+    reg_mapped_loopback_client_clear_rx(loopback);
+    check_server_usable(loopback);
+}
+
+int main(void) {
+    uint32_t seed = 0x41;
+    for (unsigned int i = 0; i < REG_MAPPED_PAGE_NUM_WORDS; i++) {
+        mem_full[i] = test_rand(&seed);
+    }
+    for (unsigned int i = 0; i < SHORT_WORDS; i++) {
+        mem_short[i] = test_rand(&seed);
+    }
+
+    test_every_range();
+    test_out_of_range();
+    test_lost_response();
+    test_mixed_bulk();
+
+    return TEST_RESULT();
+}
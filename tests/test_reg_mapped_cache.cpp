@@ -0,0 +1,212 @@
+#include "reg_mapped_loopback.h"
+#include "test_util.h"
+
+#include "canmore_cpp/RegMappedCache.hpp"
+
+#include <iterator>
+#include <memory>
+#include <thread>
+
+/*
+ * Checks RegMappedCache against a server over an in-process loopback, counting the requests it makes: each policy
+ * caches (or doesn't) as documented, writes to adjacent registers are combined into a single request, pending writes
+ * are sent before any other access and once the flush delay passes, and a failed flush isn't left in the cache
+ */
+
+using namespace Canmore;
+
+namespace {
+
+constexpr uint8_t mode = CANMORE_CONTROL_INTERFACE_MODE_NORMAL;
+constexpr uint8_t pageVolatile = 0;
+constexpr uint8_t pageImmutable = 1;
+constexpr uint8_t pageCacheable = 2;
+constexpr uint8_t pageReadOnly = 3;
+
+uint32_t memVolatile[16];
+uint32_t memImmutable[16];
+uint32_t memCacheable[64];
+uint32_t memReadOnly[16];
+
+const reg_mapped_server_page_def_t pages[] = {
+    { reg_mapped_server_page_def_t::PAGE_TYPE_MEMORY_MAPPED_WORD,
+      { .mem_mapped_word = { REGISTER_PERM_READ_WRITE, memVolatile, std::size(memVolatile) } } },
+    { reg_mapped_server_page_def_t::PAGE_TYPE_MEMORY_MAPPED_WORD,
+      { .mem_mapped_word = { REGISTER_PERM_READ_WRITE, memImmutable, std::size(memImmutable) } } },
+    { reg_mapped_server_page_def_t::PAGE_TYPE_MEMORY_MAPPED_WORD,
+      { .mem_mapped_word = { REGISTER_PERM_READ_WRITE, memCacheable, std::size(memCacheable) } } },
+    { reg_mapped_server_page_def_t::PAGE_TYPE_MEMORY_MAPPED_WORD,
+      { .mem_mapped_word = { REGISTER_PERM_READ_ONLY, memReadOnly, std::size(memReadOnly) } } },
+};
+
+// A register mapped client connected to the loopback server
+class LoopbackClient : public RegMappedClient {
+public:
+    LoopbackClient() {
+        clientCfg = reg_mapped_loopback_init(pages, std::size(pages), TRANSFER_MODE_MULTIWORD,
+                                             REG_MAPPED_LOOPBACK_MAX_LEN, REG_MAPPED_LOOPBACK_MAX_LEN)
+                        ->client;
+    }
+};
+
+// Returns the number of requests since it was last called
+unsigned int takeRequests() {
+    unsigned int requests = reg_mapped_loopback.requests;
+    reg_mapped_loopback.requests = 0;
+    return requests;
+}
+
+void testPolicies() {
+    auto client = std::make_shared<LoopbackClient>();
+    RegMappedCache cache(client, mode);
+    cache.setPagePolicy(pageImmutable, RegMappedCache::Policy::Immutable);
+    cache.setPagePolicy(pageCacheable, RegMappedCache::Policy::Cacheable, std::chrono::milliseconds(20));
+    memVolatile[1] = 0x10;
+    memImmutable[1] = 0x20;
+    memCacheable[1] = 0x30;
+    takeRequests();
+
+    // Volatile registers are always read
+    TEST_CHECK_EQ(cache.readRegister(pageVolatile, 1), 0x10);
+    memVolatile[1] = 0x11;
+    TEST_CHECK_EQ(cache.readRegister(pageVolatile, 1), 0x11);
+    TEST_CHECK_EQ(takeRequests(), 2);
+
+    // Immutable registers are read once, until invalidated
+    TEST_CHECK_EQ(cache.readRegister(pageImmutable, 1), 0x20);
+    memImmutable[1] = 0x21;
+    TEST_CHECK_EQ(cache.readRegister(pageImmutable, 1), 0x20);
+    TEST_CHECK_EQ(takeRequests(), 1);
+    cache.invalidate(pageImmutable);
+    TEST_CHECK_EQ(cache.readRegister(pageImmutable, 1), 0x21);
+    TEST_CHECK_EQ(takeRequests(), 1);
+
+    // Cacheable registers are read again once their TTL expires
+    TEST_CHECK_EQ(cache.readRegister(pageCacheable, 1), 0x30);
+    memCacheable[1] = 0x31;
+    TEST_CHECK_EQ(cache.readRegister(pageCacheable, 1), 0x30);
+    TEST_CHECK_EQ(takeRequests(), 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    TEST_CHECK_EQ(cache.readRegister(pageCacheable, 1), 0x31);
+    TEST_CHECK_EQ(takeRequests(), 1);
+
+    // Only the words not already cached are read
+    std::vector<uint32_t> data;
+    cache.readArray(pageImmutable, 0, data, 4);
+    TEST_CHECK_EQ(takeRequests(), 1);
+    memImmutable[0] = 0x99;
+    memImmutable[6] = 0x66;
+    cache.readArray(pageImmutable, 0, data, 8);
+    TEST_CHECK_EQ(takeRequests(), 1);
+    TEST_CHECK(data.size() == 8 && data[0] == 0 && data[1] == 0x21 && data[6] == 0x66);
+    cache.readArray(pageImmutable, 0, data, 8);
+    TEST_CHECK_EQ(takeRequests(), 0);
+}
+
+void testWriteCombining() {
+    auto client = std::make_shared<LoopbackClient>();
+    RegMappedCache cache(client, mode, std::chrono::seconds(10));
+    cache.setPagePolicy(pageCacheable, RegMappedCache::Policy::Cacheable, std::chrono::seconds(10));
+    std::fill(std::begin(memCacheable), std::end(memCacheable), 0);
+    takeRequests();
+
+    // Adjacent writes in any order are held, and read back from the cache
+    cache.writeRegister(pageCacheable, 5, 0x55);
+    cache.writeRegister(pageCacheable, 4, 0x44);
+    cache.writeArray(pageCacheable, 6, { 0x66, 0x77 });
+    TEST_CHECK_EQ(cache.readRegister(pageCacheable, 7), 0x77);
+    TEST_CHECK_EQ(takeRequests(), 0);
+    TEST_CHECK_EQ(memCacheable[4], 0);
+
+    // And sent as a single write
+    cache.flush();
+    TEST_CHECK_EQ(takeRequests(), 1);
+    TEST_CHECK(memCacheable[4] == 0x44 && memCacheable[5] == 0x55 && memCacheable[6] == 0x66 &&
+               memCacheable[7] == 0x77);
+
+    // Writing the cached value again is skipped
+    cache.writeRegister(pageCacheable, 5, 0x55);
+    cache.flush();
+    TEST_CHECK_EQ(takeRequests(), 0);
+
+    // A gap of registers with known values is rewritten unchanged, so the range is still combined
+    cache.writeRegister(pageCacheable, 4, 0x400);
+    cache.writeRegister(pageCacheable, 7, 0x700);
+    cache.flush();
+    TEST_CHECK_EQ(takeRequests(), 1);
+    TEST_CHECK(memCacheable[4] == 0x400 && memCacheable[5] == 0x55 && memCacheable[7] == 0x700);
+
+    // But a gap of unknown registers sends the first range separately
+    cache.writeRegister(pageCacheable, 4, 0x401);
+    cache.writeRegister(pageCacheable, 20, 0x2000);
+    TEST_CHECK_EQ(takeRequests(), 1);
+    TEST_CHECK_EQ(memCacheable[4], 0x401);
+    cache.flush();
+    TEST_CHECK_EQ(takeRequests(), 1);
+    TEST_CHECK_EQ(memCacheable[20], 0x2000);
+}
+
+void testOrdering() {
+    auto client = std::make_shared<LoopbackClient>();
+    RegMappedCache cache(client, mode, std::chrono::milliseconds(20));
+    cache.setPagePolicy(pageCacheable, RegMappedCache::Policy::Cacheable, std::chrono::seconds(10));
+    memCacheable[10] = 0;
+    takeRequests();
+
+    // Pending writes are sent before accesses to other pages
+    cache.writeRegister(pageCacheable, 10, 0xA0);
+    TEST_CHECK_EQ(memCacheable[10], 0);
+    cache.writeRegister(pageVolatile, 0, 1);
+    TEST_CHECK_EQ(memCacheable[10], 0xA0);
+    TEST_CHECK_EQ(takeRequests(), 2);
+
+    // And once the flush delay has passed
+    cache.writeRegister(pageCacheable, 10, 0xA1);
+    cache.flushIfDue();
+    TEST_CHECK_EQ(memCacheable[10], 0xA0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    cache.flushIfDue();
+    TEST_CHECK_EQ(memCacheable[10], 0xA1);
+    TEST_CHECK_EQ(takeRequests(), 1);
+
+    // And when the cache is destroyed
+    {
+        RegMappedCache other(client, mode, std::chrono::seconds(10));
+        other.setPagePolicy(pageCacheable, RegMappedCache::Policy::Cacheable);
+        other.writeRegister(pageCacheable, 10, 0xA2);
+        TEST_CHECK_EQ(memCacheable[10], 0xA1);
+    }
+    TEST_CHECK_EQ(memCacheable[10], 0xA2);
+}
+
+void testFailedFlush() {
+    auto client = std::make_shared<LoopbackClient>();
+    RegMappedCache cache(client, mode, std::chrono::seconds(10));
+    cache.setPagePolicy(pageReadOnly, RegMappedCache::Policy::Cacheable, std::chrono::seconds(10));
+    memReadOnly[2] = 0x22;
+
+    cache.writeRegister(pageReadOnly, 2, 0xBAD);
+    int errorCode = 0;
+    try {
+        cache.flush();
+    } catch (const RegMappedClientError &e) {
+        errorCode = e.errorCode;
+    }
+    TEST_CHECK_EQ(errorCode, REG_MAPPED_RESULT_INVALID_REGISTER_MODE);
+
+    // The failed write isn't retried, and the register is read from the device again
+    takeRequests();
+    TEST_CHECK_EQ(cache.readRegister(pageReadOnly, 2), 0x22);
+    TEST_CHECK_EQ(takeRequests(), 1);
+}
+
+}  // namespace
+
+int main() {
+    testPolicies();
+    testWriteCombining();
+    testOrdering();
+    testFailedFlush();
+
+    return TEST_RESULT();
+}
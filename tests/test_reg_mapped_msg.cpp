@@ -0,0 +1,122 @@
+#include "reg_mapped_msg_loopback.hpp"
+#include "test_util.h"
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+/*
+ * Runs the register mapped protocol over CANmore messages end to end, with a RegMappedMsgClient on a UDP agent talking
+ * to a RegMappedMsgServer on localhost. Checks every kind of access, that requests and responses of up to a kilobyte
+ * (too long for a single frame) get through, and that errors in multiword responses are reported with the server's
+ * result code
+ */
+
+using namespace Canmore;
+
+namespace {
+
+constexpr uint16_t testPort = 24048;
+constexpr uint8_t mode = CANMORE_CONTROL_INTERFACE_MODE_NORMAL;
+constexpr uint8_t pageWords = 0;  // Pages 0 to 2 are word mapped, for regions across them
+constexpr uint8_t pageString = 3;
+constexpr uint8_t pageRegisters = 4;
+constexpr uint8_t pageMissing = 5;
+
+}  // namespace
+
+int main() {
+    std::vector<uint32_t> memory[3];
+    for (auto &page : memory) {
+        page.resize(REG_MAPPED_PAGE_NUM_WORDS);
+    }
+    uint8_t str[64] = "Register mapped over CANmore messages";
+    uint32_t reg = 0;
+
+    RegMappedMsgLoopback loopback(testPort);
+    for (unsigned int i = 0; i < std::size(memory); i++) {
+        loopback.getServer().addWordMappedPage(pageWords + i, REGISTER_PERM_READ_WRITE, memory[i]);
+    }
+    loopback.getServer().addByteMappedPage(pageString, REGISTER_PERM_READ_ONLY, str);
+    auto registers = RegMappedRegisterPage::create();
+    registers->addMemoryRegister(0, REGISTER_PERM_READ_WRITE, &reg);
+    registers->addConstRegister(1, 0x48);
+    loopback.getServer().addRegisterPage(pageRegisters, std::move(registers));
+    loopback.start();
+    auto client = loopback.getClient();
+
+    // Single registers
+    client->writeRegister(mode, pageRegisters, 0, 0x1234);
+    TEST_CHECK_EQ(reg, 0x1234);
+    TEST_CHECK_EQ(client->readRegister(mode, pageRegisters, 0), 0x1234);
+    TEST_CHECK_EQ(client->readRegister(mode, pageRegisters, 1), 0x48);
+
+    // A whole page with the default chunk size, which takes requests and responses longer than a CAN frame
+    uint32_t seed = 0x48;
+    std::vector<uint32_t> page(REG_MAPPED_PAGE_NUM_WORDS);
+    for (auto &word : page) {
+        word = test_rand(&seed);
+    }
+    client->writeArray(mode, pageWords, 0, page);
+    TEST_CHECK(page == memory[0]);
+    std::vector<uint32_t> readBack;
+    client->readArray(mode, pageWords, 0, readBack, page.size());
+    TEST_CHECK(readBack == page);
+
+    // Regions across all the word mapped pages
+    std::vector<uint32_t> region(700);
+    for (auto &word : region) {
+        word = test_rand(&seed);
+    }
+    uint32_t addrStart = REG_MAPPED_CLIENT_REGION_ADDR(pageWords, 30);
+    client->writeRegion(mode, addrStart, region);
+    client->readRegion(mode, addrStart, readBack, region.size());
+    TEST_CHECK(readBack == region);
+    TEST_CHECK_EQ(memory[2][30 + 700 - 2 * REG_MAPPED_PAGE_NUM_WORDS - 1], region.back());
+
+    // Batches, strings and posted writes
+    std::vector<RegMappedClient::BatchEntry> batch = {
+        RegMappedClient::BatchEntry::write(pageWords + 1, 5, { 0xAA, 0xBB }),
+        RegMappedClient::BatchEntry::read(pageRegisters, 1),
+        RegMappedClient::BatchEntry::read(pageWords + 1, 4, 3),
+    };
+    client->transact(mode, batch);
+    TEST_CHECK(batch[1].data == std::vector<uint32_t>({ 0x48 }));
+    TEST_CHECK(batch[2].data.size() == 3 && batch[2].data[1] == 0xAA && batch[2].data[2] == 0xBB);
+
+    TEST_CHECK(client->readStringPage(mode, pageString) == (const char *) str);
+
+    client->postWriteRegister(mode, pageRegisters, 0, 0x5678);
+    client->sync();
+    TEST_CHECK_EQ(reg, 0x5678);
+
+    // Errors in multiword responses are reported with the server's result code, rather than a receive failure
+    int errorCode = 0;
+    try {
+        client->readArray(mode, pageMissing, 0, readBack, 100);
+    } catch (const RegMappedClientError &e) {
+        errorCode = e.errorCode;
+    }
+    TEST_CHECK_EQ(errorCode, REG_MAPPED_RESULT_INVALID_REGISTER_ADDRESS);
+
+    errorCode = 0;
+    try {
+        client->readArray(mode, pageRegisters, 0, readBack, 2);
+    } catch (const RegMappedClientError &e) {
+        errorCode = e.errorCode;
+    }
+    TEST_CHECK_EQ(errorCode, REG_MAPPED_RESULT_INVALID_REGISTER_ADDRESS);
+
+    errorCode = 0;
+    try {
+        client->writeRegister(mode, pageRegisters, 1, 0);
+    } catch (const RegMappedClientError &e) {
+        errorCode = e.errorCode;
+    }
+    TEST_CHECK_EQ(errorCode, REG_MAPPED_RESULT_INVALID_REGISTER_MODE);
+
+    // And the client still works afterwards
+    TEST_CHECK_EQ(client->readRegister(mode, pageWords, 1), page[1]);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,155 @@
+#include "reg_mapped_loopback.h"
+#include "test_util.h"
+
+#include "canmore/reg_mapped/client.h"
+#include "canmore/reg_mapped/server.h"
+
+/*
+ * Checks windowed multiword array transfers against the server over an in-process loopback: random offsets, lengths,
+ * chunk sizes and windows, that the window is actually kept full, and that a failure partway through a window reports
+ * the offset of the request which failed
+ */
+
+#define PAGE_FULL 0
+#define PAGE_SHORT 1
+#define SHORT_WORDS 40
+
+static uint32_t mem_full[REG_MAPPED_PAGE_NUM_WORDS];
+static uint32_t mem_short[SHORT_WORDS];
+
+static const reg_mapped_server_page_def_t pages[] = {
+    [PAGE_FULL] = { .page_type = PAGE_TYPE_MEMORY_MAPPED_WORD,
+                    .type = { .mem_mapped_word = { .perm = REGISTER_PERM_READ_WRITE,
+                                                   .base_addr = mem_full,
+                                                   .num_words = REG_MAPPED_PAGE_NUM_WORDS } } },
+    [PAGE_SHORT] = { .page_type = PAGE_TYPE_MEMORY_MAPPED_WORD,
+                     .type = { .mem_mapped_word = { .perm = REGISTER_PERM_READ_WRITE,
+                                                    .base_addr = mem_short,
+                                                    .num_words = SHORT_WORDS } } },
+};
+
+// Tracks the most requests awaiting a response when the client waits for one
+static unsigned int responses_received;
+static unsigned int max_outstanding;
+
+static bool counting_rx(uint8_t *buf, size_t len, unsigned int timeout_ms, void *arg) {
+    reg_mapped_loopback_t *loopback = (reg_mapped_loopback_t *) arg;
+    unsigned int outstanding = loopback->requests - responses_received;
+    if (outstanding > max_outstanding) {
+        max_outstanding = outstanding;
+    }
+    responses_received++;
+    return reg_mapped_loopback_client_rx(buf, len, timeout_ms, arg);
+}
+
+static reg_mapped_loopback_t *init_counting(size_t scratch_len, unsigned int window) {
+    reg_mapped_loopback_t *loopback =
+        reg_mapped_loopback_init(pages, 2, TRANSFER_MODE_MULTIWORD, REG_MAPPED_LOOPBACK_MAX_LEN, scratch_len);
+    loopback->client.rx_func = &counting_rx;
+    loopback->client.max_in_flight = window;
+    return loopback;
+}
+
+static void reset_counts(reg_mapped_loopback_t *loopback) {
+    loopback->requests = 0;
+    responses_received = 0;
+    max_outstanding = 0;
+}
+
+static void test_random_transfers(void) {
+    uint32_t seed = 0x42;
+
+    for (int iter = 0; iter < 2000; iter++) {
+        // Scratch buffers from a single word per request up to 80 words
+        size_t scratch_len = REG_MAPPED_COMPUTE_MULTIWORD_REQ_LEN(1 + test_rand(&seed) % 80);
+        unsigned int window = 1 + test_rand(&seed) % 10;
+        reg_mapped_loopback_t *loopback = init_counting(scratch_len, window);
+
+        unsigned int offset = test_rand(&seed) % REG_MAPPED_PAGE_NUM_WORDS;
+        // Array writes are limited to 255 words
+        unsigned int len = 1 + test_rand(&seed) % (REG_MAPPED_PAGE_NUM_WORDS - offset);
+        if (len > UINT8_MAX) {
+            len = UINT8_MAX;
+        }
+        unsigned int write_chunk = REG_MAPPED_COMPUTE_MAX_REQ_WORD_COUNT(scratch_len);
+        unsigned int read_chunk = REG_MAPPED_COMPUTE_MAX_RESP_WORD_COUNT(scratch_len);
+
+        uint32_t words[REG_MAPPED_PAGE_NUM_WORDS];
+        for (unsigned int i = 0; i < len; i++) {
+            words[i] = test_rand(&seed);
+        }
+        uint32_t before = (offset > 0 ? mem_full[offset - 1] : 0);
+        uint32_t after = (offset + len < REG_MAPPED_PAGE_NUM_WORDS ? mem_full[offset + len] : 0);
+
+        reset_counts(loopback);
+        TEST_CHECK_EQ(reg_mapped_client_write_array(&loopback->client, PAGE_FULL, offset, words, len),
+                      REG_MAPPED_RESULT_SUCCESSFUL);
+        TEST_CHECK(memcmp(&mem_full[offset], words, len * sizeof(*words)) == 0);
+        TEST_CHECK(offset == 0 || mem_full[offset - 1] == before);
+        TEST_CHECK(offset + len == REG_MAPPED_PAGE_NUM_WORDS || mem_full[offset + len] == after);
+        unsigned int num_requests = (len + write_chunk - 1) / write_chunk;
+        TEST_CHECK_EQ(loopback->requests, num_requests);
+        TEST_CHECK_EQ(max_outstanding, (num_requests < window ? num_requests : window));
+
+        uint32_t read_back[REG_MAPPED_PAGE_NUM_WORDS];
+        memset(read_back, 0xEE, sizeof(read_back));
+        reset_counts(loopback);
+        TEST_CHECK_EQ(reg_mapped_client_read_array(&loopback->client, PAGE_FULL, offset, read_back, len),
+                      REG_MAPPED_RESULT_SUCCESSFUL);
+        TEST_CHECK(memcmp(read_back, words, len * sizeof(*words)) == 0);
+        num_requests = (len + read_chunk - 1) / read_chunk;
+        TEST_CHECK_EQ(loopback->requests, num_requests);
+        TEST_CHECK_EQ(max_outstanding, (num_requests < window ? num_requests : window));
+    }
+}
+
+static void test_failing_window(void) {
+    // Chunks of 4 words from offset 2, so the request for offsets 38 to 41 runs off the end of the page
+    size_t scratch_len = REG_MAPPED_COMPUTE_MULTIWORD_REQ_LEN(4);
+    reg_mapped_loopback_t *loopback = init_counting(scratch_len, 16);
+    TEST_CHECK_EQ(REG_MAPPED_COMPUTE_MAX_REQ_WORD_COUNT(scratch_len), 4);
+
+    uint32_t words[60];
+    for (unsigned int i = 0; i < 60; i++) {
+        words[i] = 0x4200 + i;
+    }
+    uint8_t error_offset = 0;
+    TEST_CHECK_EQ(reg_mapped_client_write_array_ex(&loopback->client, PAGE_SHORT, 2, words, 60, &error_offset),
+                  REG_MAPPED_RESULT_INVALID_REGISTER_ADDRESS);
+    TEST_CHECK_EQ(error_offset, 38);
+    TEST_CHECK(memcmp(&mem_short[2], words, 36 * sizeof(*words)) == 0);
+
+    // Reads use the response length to size their chunks
+    scratch_len = REG_MAPPED_COMPUTE_MULTIWORD_RESP_LEN(4);
+    loopback = init_counting(scratch_len, 16);
+    TEST_CHECK_EQ(REG_MAPPED_COMPUTE_MAX_RESP_WORD_COUNT(scratch_len), 4);
+    uint32_t read_back[60];
+    TEST_CHECK_EQ(reg_mapped_client_read_array_ex(&loopback->client, PAGE_SHORT, 2, read_back, 60, &error_offset),
+                  REG_MAPPED_RESULT_INVALID_REGISTER_ADDRESS);
+    TEST_CHECK_EQ(error_offset, 38);
+    TEST_CHECK(memcmp(read_back, words, 36 * sizeof(*words)) == 0);
+
+    // With one request in flight, a lost response is reported at the request it belonged to
+    loopback->client.max_in_flight = 1;
+    loopback->drop_responses = 1;
+    TEST_CHECK_EQ(reg_mapped_client_read_array_ex(&loopback->client, PAGE_FULL, 10, read_back, 20, &error_offset),
+                  REG_MAPPED_CLIENT_RESULT_RX_FAIL);
+    TEST_CHECK_EQ(error_offset, 10);
+
+    // The next transfer is unaffected
+    TEST_CHECK_EQ(reg_mapped_client_read_array(&loopback->client, PAGE_FULL, 10, read_back, 20),
+                  REG_MAPPED_RESULT_SUCCESSFUL);
+    TEST_CHECK(memcmp(read_back, &mem_full[10], 20 * sizeof(*read_back)) == 0);
+}
+
+int main(void) {
+    uint32_t seed = 0x4242;
+    for (unsigned int i = 0; i < REG_MAPPED_PAGE_NUM_WORDS; i++) {
+        mem_full[i] = test_rand(&seed);
+    }
+
+    test_random_transfers();
+    test_failing_window();
+
+    return TEST_RESULT();
+}
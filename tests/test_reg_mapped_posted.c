@@ -0,0 +1,176 @@
+#include "reg_mapped_loopback.h"
+#include "test_util.h"
+
+#include "canmore/reg_mapped/client.h"
+#include "canmore/reg_mapped/server.h"
+
+/*
+ * Checks posted writes against the server over an in-process loopback: writes are only waited on once max_in_flight
+ * are outstanding, each failure reaches the callback once and the first is reported by the next sync, and lost
+ * responses are reported without stopping later writes
+ */
+
+#define PAGE_RW 0
+#define PAGE_RO 1
+#define WINDOW 5
+
+static uint32_t mem_rw[64];
+static uint32_t mem_ro[4];
+
+static const reg_mapped_server_page_def_t pages[] = {
+    [PAGE_RW] = { .page_type = PAGE_TYPE_MEMORY_MAPPED_WORD,
+                  .type = { .mem_mapped_word = { .perm = REGISTER_PERM_READ_WRITE,
+                                                 .base_addr = mem_rw,
+                                                 .num_words = 64 } } },
+    [PAGE_RO] = { .page_type = PAGE_TYPE_MEMORY_MAPPED_WORD,
+                  .type = { .mem_mapped_word = { .perm = REGISTER_PERM_READ_ONLY,
+                                                 .base_addr = mem_ro,
+                                                 .num_words = 4 } } },
+};
+
+// Errors reported to the callback
+static struct {
+    uint8_t page;
+    uint8_t offset;
+    int result;
+} errors[16];
+static unsigned int num_errors;
+
+static void error_cb(uint8_t page, uint8_t offset, int result, void *arg) {
+    TEST_CHECK(arg == &num_errors);
+    if (num_errors < 16) {
+        errors[num_errors].page = page;
+        errors[num_errors].offset = offset;
+        errors[num_errors].result = result;
+    }
+    num_errors++;
+}
+
+// Responses only become available once the client waits for them, so polling never consumes a response and the
+// number of writes outstanding when the client first waits shows how many it keeps in flight
+static unsigned int responses_received;
+static unsigned int max_outstanding;
+
+static bool delayed_rx(uint8_t *buf, size_t len, unsigned int timeout_ms, void *arg) {
+    reg_mapped_loopback_t *loopback = (reg_mapped_loopback_t *) arg;
+    if (timeout_ms == 0) {
+        return false;
+    }
+    unsigned int outstanding = loopback->requests - responses_received;
+    if (outstanding > max_outstanding) {
+        max_outstanding = outstanding;
+    }
+    responses_received++;
+    return reg_mapped_loopback_client_rx(buf, len, timeout_ms, arg);
+}
+
+static reg_mapped_loopback_t *init(reg_mapped_client_posted_writes_t *state) {
+    reg_mapped_loopback_t *loopback = reg_mapped_loopback_init(pages, 2, TRANSFER_MODE_SINGLE, 0, 0);
+    loopback->client.rx_func = &delayed_rx;
+    loopback->client.max_in_flight = WINDOW;
+    // A timeout of 0 polls, so use any other timeout (the loopback never waits)
+    loopback->client.timeout_ms = 1;
+    responses_received = 0;
+    max_outstanding = 0;
+    num_errors = 0;
+    reg_mapped_client_posted_init(state, &error_cb, &num_errors);
+    return loopback;
+}
+
+static void test_window(void) {
+    reg_mapped_client_posted_writes_t state;
+    reg_mapped_loopback_t *loopback = init(&state);
+
+    for (unsigned int i = 0; i < 50; i++) {
+        TEST_CHECK_EQ(reg_mapped_client_post_write(&loopback->client, &state, PAGE_RW, i, 0x4500 + i),
+                      REG_MAPPED_RESULT_SUCCESSFUL);
+        // Nothing is waited on until the window is full
+        TEST_CHECK_EQ(responses_received, (i < WINDOW ? 0 : i + 1 - WINDOW));
+    }
+    TEST_CHECK_EQ(max_outstanding, WINDOW);
+    TEST_CHECK_EQ(reg_mapped_client_posted_sync(&loopback->client, &state, NULL, NULL), REG_MAPPED_RESULT_SUCCESSFUL);
+    TEST_CHECK_EQ(responses_received, 50);
+    for (unsigned int i = 0; i < 50; i++) {
+        TEST_CHECK_EQ(mem_rw[i], 0x4500 + i);
+    }
+    TEST_CHECK_EQ(num_errors, 0);
+}
+
+static void test_errors(void) {
+    reg_mapped_client_posted_writes_t state;
+    reg_mapped_loopback_t *loopback = init(&state);
+
+    // Each failure is reported to the callback, and the first one to sync
+    TEST_CHECK_EQ(reg_mapped_client_post_write(&loopback->client, &state, PAGE_RW, 0, 1), REG_MAPPED_RESULT_SUCCESSFUL);
+    TEST_CHECK_EQ(reg_mapped_client_post_write(&loopback->client, &state, PAGE_RO, 2, 1), REG_MAPPED_RESULT_SUCCESSFUL);
+    TEST_CHECK_EQ(reg_mapped_client_post_write(&loopback->client, &state, PAGE_RW, 1, 2), REG_MAPPED_RESULT_SUCCESSFUL);
+    TEST_CHECK_EQ(reg_mapped_client_post_write(&loopback->client, &state, PAGE_RW, 200, 3),
+                  REG_MAPPED_RESULT_SUCCESSFUL);
+    uint8_t error_page = 0xFF;
+    uint8_t error_offset = 0xFF;
+    TEST_CHECK_EQ(reg_mapped_client_posted_sync(&loopback->client, &state, &error_page, &error_offset),
+                  REG_MAPPED_RESULT_INVALID_REGISTER_MODE);
+    TEST_CHECK_EQ(error_page, PAGE_RO);
+    TEST_CHECK_EQ(error_offset, 2);
+    TEST_CHECK_EQ(num_errors, 2);
+    TEST_CHECK(errors[0].page == PAGE_RO && errors[0].offset == 2 &&
+               errors[0].result == REG_MAPPED_RESULT_INVALID_REGISTER_MODE);
+    TEST_CHECK(errors[1].page == PAGE_RW && errors[1].offset == 200 &&
+               errors[1].result == REG_MAPPED_RESULT_INVALID_REGISTER_ADDRESS);
+    // The writes around the failures still happened
+    TEST_CHECK(mem_rw[0] == 1 && mem_rw[1] == 2);
+
+    // Errors are only reported by one sync
+    TEST_CHECK_EQ(reg_mapped_client_posted_sync(&loopback->client, &state, NULL, NULL), REG_MAPPED_RESULT_SUCCESSFUL);
+    TEST_CHECK_EQ(num_errors, 2);
+}
+
+static void test_lost_responses(void) {
+    reg_mapped_client_posted_writes_t state;
+    reg_mapped_loopback_t *loopback = init(&state);
+
+    // Dropping the first response shifts the others onto the wrong writes, so the loss is reported against the last
+    // write, whose response never arrives
+    uint8_t error_offset = 0;
+    loopback->drop_responses = 1;
+    for (unsigned int i = 0; i < 3; i++) {
+        TEST_CHECK_EQ(reg_mapped_client_post_write(&loopback->client, &state, PAGE_RW, 10 + i, i + 1),
+                      REG_MAPPED_RESULT_SUCCESSFUL);
+    }
+    TEST_CHECK_EQ(reg_mapped_client_posted_sync(&loopback->client, &state, NULL, &error_offset),
+                  REG_MAPPED_CLIENT_RESULT_RX_FAIL);
+    TEST_CHECK_EQ(error_offset, 12);
+    TEST_CHECK_EQ(num_errors, 1);
+
+    // Losing the responses while waiting for room in the window is reported, and the next write is still sent
+    num_errors = 0;
+    for (unsigned int i = 0; i < WINDOW; i++) {
+        TEST_CHECK_EQ(reg_mapped_client_post_write(&loopback->client, &state, PAGE_RW, 20 + i, i),
+                      REG_MAPPED_RESULT_SUCCESSFUL);
+    }
+    reg_mapped_loopback_client_clear_rx(loopback);
+    TEST_CHECK_EQ(reg_mapped_client_post_write(&loopback->client, &state, PAGE_RW, 30, 0x30),
+                  REG_MAPPED_RESULT_SUCCESSFUL);
+    TEST_CHECK_EQ(num_errors, 1);
+    TEST_CHECK_EQ(errors[0].offset, 20);
+    TEST_CHECK_EQ(errors[0].result, REG_MAPPED_CLIENT_RESULT_RX_FAIL);
+    TEST_CHECK_EQ(reg_mapped_client_posted_sync(&loopback->client, &state, NULL, &error_offset),
+                  REG_MAPPED_CLIENT_RESULT_RX_FAIL);
+    TEST_CHECK_EQ(error_offset, 20);
+    TEST_CHECK_EQ(mem_rw[30], 0x30);
+
+    // Later writes work normally
+    TEST_CHECK_EQ(reg_mapped_client_post_write(&loopback->client, &state, PAGE_RW, 31, 0x31),
+                  REG_MAPPED_RESULT_SUCCESSFUL);
+    TEST_CHECK_EQ(reg_mapped_client_posted_sync(&loopback->client, &state, NULL, NULL), REG_MAPPED_RESULT_SUCCESSFUL);
+    TEST_CHECK_EQ(mem_rw[31], 0x31);
+    TEST_CHECK_EQ(num_errors, 1);
+}
+
+int main(void) {
+    test_window();
+    test_errors();
+    test_lost_responses();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,221 @@
+#include "reg_mapped_loopback.h"
+#include "test_util.h"
+
+#include "canmore_cpp/RegMappedClient.hpp"
+
+#include "canmore/reg_mapped/client.h"
+#include "canmore/reg_mapped/server.h"
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+/*
+ * Checks region transfers spanning several pages against a model of the server's memory in every transfer mode, that
+ * multiword requests never cross a page boundary, and that a region running off the end of the served memory reports
+ * where it failed. The C client and RegMappedClient (which splits regions into chunks) are both tested over an
+ * in-process loopback
+ */
+
+using namespace Canmore;
+
+namespace {
+
+constexpr uint8_t mode = CANMORE_CONTROL_INTERFACE_MODE_NORMAL;
+constexpr unsigned int numFullPages = 4;
+constexpr uint8_t pageShort = numFullPages;
+constexpr unsigned int shortWords = 100;
+constexpr unsigned int chunkWords = 16;
+
+uint32_t memFull[numFullPages][REG_MAPPED_PAGE_NUM_WORDS];
+uint32_t memShort[shortWords];
+
+const reg_mapped_server_page_def_t pages[] = {
+    { reg_mapped_server_page_def_t::PAGE_TYPE_MEMORY_MAPPED_WORD,
+      { .mem_mapped_word = { REGISTER_PERM_READ_WRITE, memFull[0], REG_MAPPED_PAGE_NUM_WORDS } } },
+    { reg_mapped_server_page_def_t::PAGE_TYPE_MEMORY_MAPPED_WORD,
+      { .mem_mapped_word = { REGISTER_PERM_READ_WRITE, memFull[1], REG_MAPPED_PAGE_NUM_WORDS } } },
+    { reg_mapped_server_page_def_t::PAGE_TYPE_MEMORY_MAPPED_WORD,
+      { .mem_mapped_word = { REGISTER_PERM_READ_WRITE, memFull[2], REG_MAPPED_PAGE_NUM_WORDS } } },
+    { reg_mapped_server_page_def_t::PAGE_TYPE_MEMORY_MAPPED_WORD,
+      { .mem_mapped_word = { REGISTER_PERM_READ_WRITE, memFull[3], REG_MAPPED_PAGE_NUM_WORDS } } },
+    { reg_mapped_server_page_def_t::PAGE_TYPE_MEMORY_MAPPED_WORD,
+      { .mem_mapped_word = { REGISTER_PERM_READ_WRITE, memShort, shortWords } } },
+};
+
+const enum reg_mapped_client_transfer_mode modes[] = { TRANSFER_MODE_SINGLE, TRANSFER_MODE_BULK,
+                                                       TRANSFER_MODE_MULTIWORD };
+
+reg_mapped_loopback_t *initLoopback(enum reg_mapped_client_transfer_mode transferMode) {
+    // The client's scratch buffer limits multiword requests to chunkWords words
+    return reg_mapped_loopback_init(pages, std::size(pages), transferMode, REG_MAPPED_LOOPBACK_MAX_LEN,
+                                    REG_MAPPED_COMPUTE_MULTIWORD_REQ_LEN(chunkWords));
+}
+
+// Returns the number of multiword requests for a region, which are split at page boundaries
+unsigned int countRequests(uint32_t addrStart, size_t numWords, unsigned int maxCount) {
+    unsigned int requests = 0;
+    uint32_t addr = addrStart;
+    while (addr < addrStart + numWords) {
+        uint32_t pageEnd = addr - REG_MAPPED_CLIENT_REGION_OFFSET(addr) + REG_MAPPED_PAGE_NUM_WORDS;
+        addr = std::min<uint32_t>({ pageEnd, (uint32_t) (addrStart + numWords), addr + maxCount });
+        requests++;
+    }
+    return requests;
+}
+
+void testRandomRegions(enum reg_mapped_client_transfer_mode transferMode) {
+    reg_mapped_loopback_t *loopback = initLoopback(transferMode);
+    const unsigned int regionWords = numFullPages * REG_MAPPED_PAGE_NUM_WORDS;
+    uint32_t seed = 0x4700 + transferMode;
+
+    std::vector<uint32_t> model(regionWords);
+    for (unsigned int i = 0; i < regionWords; i++) {
+        model[i] = memFull[i / REG_MAPPED_PAGE_NUM_WORDS][i % REG_MAPPED_PAGE_NUM_WORDS];
+    }
+
+    for (int iter = 0; iter < 200; iter++) {
+        uint32_t addrStart = test_rand(&seed) % regionWords;
+        size_t numWords = 1 + test_rand(&seed) % std::min<size_t>(regionWords - addrStart, 700);
+
+        std::vector<uint32_t> words(numWords);
+        for (auto &word : words) {
+            word = test_rand(&seed);
+        }
+        std::copy(words.begin(), words.end(), model.begin() + addrStart);
+
+        loopback->requests = 0;
+        TEST_CHECK_EQ(reg_mapped_client_write_region(&loopback->client, addrStart, words.data(), numWords, nullptr),
+                      REG_MAPPED_RESULT_SUCCESSFUL);
+        if (transferMode == TRANSFER_MODE_MULTIWORD) {
+            TEST_CHECK_EQ(loopback->requests, countRequests(addrStart, numWords, chunkWords));
+        }
+
+        // Read back a different region overlapping the write
+        uint32_t readStart = (addrStart > 10 ? addrStart - 10 : 0);
+        size_t readWords = std::min<size_t>(numWords + 20, regionWords - readStart);
+        std::vector<uint32_t> readBack(readWords);
+        loopback->requests = 0;
+        TEST_CHECK_EQ(reg_mapped_client_read_region(&loopback->client, readStart, readBack.data(), readWords, nullptr),
+                      REG_MAPPED_RESULT_SUCCESSFUL);
+        TEST_CHECK(std::equal(readBack.begin(), readBack.end(), model.begin() + readStart));
+        if (transferMode == TRANSFER_MODE_MULTIWORD) {
+            unsigned int maxCount = REG_MAPPED_COMPUTE_MAX_RESP_WORD_COUNT(loopback->client.multiword_scratch_len);
+            TEST_CHECK_EQ(loopback->requests, countRequests(readStart, readWords, maxCount));
+        }
+    }
+
+    for (unsigned int i = 0; i < regionWords; i++) {
+        TEST_CHECK_EQ(memFull[i / REG_MAPPED_PAGE_NUM_WORDS][i % REG_MAPPED_PAGE_NUM_WORDS], model[i]);
+    }
+}
+
+void testErrors(enum reg_mapped_client_transfer_mode transferMode) {
+    reg_mapped_loopback_t *loopback = initLoopback(transferMode);
+
+    // A region running past the end of the short page. Multiword transfers fail at the start of the request holding
+    // the first missing word
+    uint32_t addrStart = REG_MAPPED_CLIENT_REGION_ADDR(pageShort - 1, 200);
+    std::vector<uint32_t> words(200, 0x47);
+    uint32_t expectedError = REG_MAPPED_CLIENT_REGION_ADDR(pageShort, shortWords);
+    if (transferMode == TRANSFER_MODE_MULTIWORD) {
+        expectedError -= shortWords % chunkWords;
+    }
+
+    uint32_t errorAddr = 0;
+    TEST_CHECK_EQ(reg_mapped_client_write_region(&loopback->client, addrStart, words.data(), words.size(), &errorAddr),
+                  REG_MAPPED_RESULT_INVALID_REGISTER_ADDRESS);
+    TEST_CHECK_EQ(errorAddr, expectedError);
+    TEST_CHECK(std::all_of(std::begin(memShort), std::begin(memShort) + shortWords - shortWords % chunkWords,
+                           [](uint32_t word) { return word == 0x47; }));
+
+    // Reads carry a different number of words per multiword request
+    expectedError = REG_MAPPED_CLIENT_REGION_ADDR(pageShort, shortWords);
+    if (transferMode == TRANSFER_MODE_MULTIWORD) {
+        expectedError -= shortWords % REG_MAPPED_COMPUTE_MAX_RESP_WORD_COUNT(loopback->client.multiword_scratch_len);
+    }
+    errorAddr = 0;
+    TEST_CHECK_EQ(reg_mapped_client_read_region(&loopback->client, addrStart, words.data(), words.size(), &errorAddr),
+                  REG_MAPPED_RESULT_INVALID_REGISTER_ADDRESS);
+    TEST_CHECK_EQ(errorAddr, expectedError);
+
+    // Regions past the last page are refused before anything is sent
+    loopback->requests = 0;
+    TEST_CHECK_EQ(reg_mapped_client_read_region(&loopback->client, REG_MAPPED_CLIENT_REGION_NUM_WORDS - 10,
+                                                words.data(), 11, nullptr),
+                  REG_MAPPED_CLIENT_RESULT_INVALID_ARG);
+    TEST_CHECK_EQ(reg_mapped_client_write_region(&loopback->client, REG_MAPPED_CLIENT_REGION_NUM_WORDS + 1,
+                                                 words.data(), 0, nullptr),
+                  REG_MAPPED_CLIENT_RESULT_INVALID_ARG);
+    TEST_CHECK_EQ(loopback->requests, 0);
+}
+
+// A register mapped client connected to the loopback server
+class LoopbackClient : public RegMappedClient {
+public:
+    LoopbackClient() { clientCfg = initLoopback(TRANSFER_MODE_MULTIWORD)->client; }
+};
+
+void testClient() {
+    LoopbackClient client;
+    client.setTransactionChunkWords(50);
+
+    // Split into chunks which don't line up with the pages
+    std::vector<uint32_t> words(600);
+    for (unsigned int i = 0; i < words.size(); i++) {
+        words[i] = 0x47000 + i;
+    }
+    uint32_t addrStart = REG_MAPPED_CLIENT_REGION_ADDR(0, 130);
+    client.writeRegion(mode, addrStart, words);
+    std::vector<uint32_t> readBack;
+    client.readRegion(mode, addrStart, readBack, words.size());
+    TEST_CHECK(readBack == words);
+    TEST_CHECK_EQ(memFull[1][REG_MAPPED_PAGE_NUM_WORDS - 1], 0x47000 + 2 * REG_MAPPED_PAGE_NUM_WORDS - 130 - 1);
+
+    // A whole page as a single chunk, more words than an array request can count
+    client.setTransactionChunkWords(REG_MAPPED_PAGE_NUM_WORDS);
+    words.resize(REG_MAPPED_PAGE_NUM_WORDS);
+    for (unsigned int i = 0; i < words.size(); i++) {
+        words[i] = 0x47100 + i;
+    }
+    client.writeArray(mode, 2, 0, words);
+    TEST_CHECK(std::equal(words.begin(), words.end(), std::begin(memFull[2])));
+    client.readArray(mode, 2, 0, readBack, words.size());
+    TEST_CHECK(readBack == words);
+
+    // Failures are thrown with the error code
+    int errorCode = 0;
+    try {
+        client.readRegion(mode, REG_MAPPED_CLIENT_REGION_ADDR(pageShort, 0), readBack, shortWords + 1);
+    } catch (const RegMappedClientError &e) {
+        errorCode = e.errorCode;
+    }
+    TEST_CHECK_EQ(errorCode, REG_MAPPED_RESULT_INVALID_REGISTER_ADDRESS);
+
+    errorCode = 0;
+    try {
+        client.writeRegion(mode, REG_MAPPED_CLIENT_REGION_NUM_WORDS - 1, { 1, 2 });
+    } catch (const RegMappedClientError &e) {
+        errorCode = e.errorCode;
+    }
+    TEST_CHECK_EQ(errorCode, REG_MAPPED_CLIENT_RESULT_INVALID_ARG);
+}
+
+}  // namespace
+
+int main() {
+    uint32_t seed = 0x47;
+    for (auto &page : memFull) {
+        for (auto &word : page) {
+            word = test_rand(&seed);
+        }
+    }
+
+    for (auto transferMode : modes) {
+        testRandomRegions(transferMode);
+        testErrors(transferMode);
+    }
+    testClient();
+
+    return TEST_RESULT();
+}
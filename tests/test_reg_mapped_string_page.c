@@ -0,0 +1,137 @@
+#include "reg_mapped_loopback.h"
+#include "test_util.h"
+
+#include "canmore/reg_mapped/client.h"
+#include "canmore/reg_mapped/server.h"
+
+/*
+ * Checks string page reads against the server over an in-process loopback. Every transfer mode must return the same
+ * result as reading word by word, for strings of every length on byte mapped pages cut short just after the string,
+ * register mapped pages (which can't be read with multiword requests) and output buffers too small for the string,
+ * while taking fewer round trips when reading ahead
+ */
+
+#define PAGE_BYTES 0
+#define PAGE_REGS 1
+#define PAGE_UNIMPLEMENTED 2
+
+#define REG_STRING "register mapped"
+#define REG_STRING_WORDS 4
+
+static uint8_t mem_bytes[REG_MAPPED_PAGE_NUM_WORDS * 4];
+static uint32_t mem_regs[REG_STRING_WORDS];
+
+static const reg_mapped_server_register_def_t regs[] = {
+    DEFINE_REG_MEMORY_PTR(0, &mem_regs[0], REGISTER_PERM_READ_ONLY),
+    DEFINE_REG_MEMORY_PTR(1, &mem_regs[1], REGISTER_PERM_READ_ONLY),
+    DEFINE_REG_MEMORY_PTR(2, &mem_regs[2], REGISTER_PERM_READ_ONLY),
+    DEFINE_REG_MEMORY_PTR(3, &mem_regs[3], REGISTER_PERM_READ_ONLY),
+};
+
+// The byte page is resized by the tests, so it is kept writable
+static reg_mapped_server_page_def_t pages[] = {
+    DEFINE_PAGE_MEMMAPPED_BYTE_ARRAY(PAGE_BYTES, mem_bytes, REGISTER_PERM_READ_ONLY),
+    DEFINE_PAGE_REG_MAPPED(PAGE_REGS, regs),
+    DEFINE_PAGE_UNIMPLEMENTED(PAGE_UNIMPLEMENTED),
+};
+
+static const enum reg_mapped_client_transfer_mode modes[] = { TRANSFER_MODE_SINGLE, TRANSFER_MODE_BULK,
+                                                              TRANSFER_MODE_MULTIWORD };
+
+// Reads a string page in the given transfer mode, returning the result and the number of requests it took
+static int read_string(enum reg_mapped_client_transfer_mode mode, uint8_t page, char *str_out, size_t max_len,
+                       unsigned int *requests) {
+    reg_mapped_loopback_t *loopback =
+        reg_mapped_loopback_init(pages, 3, mode, REG_MAPPED_LOOPBACK_MAX_LEN, REG_MAPPED_LOOPBACK_MAX_LEN);
+    int ret = reg_mapped_client_read_string_page(&loopback->client, page, str_out, max_len);
+    if (requests) {
+        *requests = loopback->requests;
+    }
+    return ret;
+}
+
+// Reads the page in every mode, checking they all match the word by word read
+static void check_all_modes(uint8_t page, size_t max_len, int expected_ret, const char *expected_str) {
+    for (unsigned int i = 0; i < 3; i++) {
+        char str[sizeof(mem_bytes) + 2];
+        memset(str, 0x7F, sizeof(str));
+        int ret = read_string(modes[i], page, str, max_len, NULL);
+        TEST_CHECK_EQ(ret, expected_ret);
+        if (ret >= 0) {
+            TEST_CHECK(strcmp(str, expected_str) == 0);
+        }
+        // Nothing is written past max_len
+        TEST_CHECK_EQ(str[max_len], 0x7F);
+    }
+}
+
+static void test_every_length(void) {
+    for (size_t len = 0; len < sizeof(mem_bytes); len++) {
+        // A string of len characters, on a page ending just after its terminator
+        memset(mem_bytes, 0, sizeof(mem_bytes));
+        for (size_t i = 0; i < len; i++) {
+            mem_bytes[i] = 'a' + (i % 26);
+        }
+        pages[PAGE_BYTES].type.mem_mapped_byte.size = len + 1;
+
+        check_all_modes(PAGE_BYTES, sizeof(mem_bytes) + 1, len, (const char *) mem_bytes);
+
+        // Truncated to the output buffer
+        size_t max_len = 1 + len / 2;
+        char expected[sizeof(mem_bytes)];
+        memcpy(expected, mem_bytes, max_len - 1);
+        expected[max_len - 1] = 0;
+        check_all_modes(PAGE_BYTES, max_len, max_len - 1, expected);
+    }
+
+    // A page filled without a terminator is read up to the end of the page
+    memset(mem_bytes, 'z', sizeof(mem_bytes));
+    pages[PAGE_BYTES].type.mem_mapped_byte.size = sizeof(mem_bytes);
+    char expected[sizeof(mem_bytes) + 1];
+    memset(expected, 'z', sizeof(mem_bytes));
+    expected[sizeof(mem_bytes)] = 0;
+    check_all_modes(PAGE_BYTES, sizeof(mem_bytes) + 1, sizeof(mem_bytes), expected);
+
+    // A shorter page without a terminator fails reading the word after its end
+    pages[PAGE_BYTES].type.mem_mapped_byte.size = 64;
+    check_all_modes(PAGE_BYTES, sizeof(mem_bytes) + 1, -REG_MAPPED_RESULT_INVALID_REGISTER_ADDRESS, NULL);
+}
+
+static void test_other_pages(void) {
+    memcpy(mem_regs, REG_STRING, sizeof(REG_STRING));
+    check_all_modes(PAGE_REGS, 100, sizeof(REG_STRING) - 1, REG_STRING);
+    check_all_modes(PAGE_UNIMPLEMENTED, 100, -REG_MAPPED_RESULT_INVALID_REGISTER_ADDRESS, NULL);
+
+    // Buffers too small to read anything
+    for (unsigned int i = 0; i < 3; i++) {
+        char str[2] = { 0x7F, 0x7F };
+        TEST_CHECK_EQ(read_string(modes[i], PAGE_REGS, str, 1, NULL), 0);
+        TEST_CHECK_EQ(str[0], 0);
+        TEST_CHECK_EQ(str[1], 0x7F);
+        TEST_CHECK_EQ(read_string(modes[i], PAGE_REGS, str, 0, NULL), 0);
+    }
+}
+
+static void test_round_trips(void) {
+    // A 1 KiB page holding a 1000 character string
+    memset(mem_bytes, 'r', 1000);
+    memset(&mem_bytes[1000], 0, sizeof(mem_bytes) - 1000);
+    pages[PAGE_BYTES].type.mem_mapped_byte.size = sizeof(mem_bytes);
+
+    char str[sizeof(mem_bytes) + 1];
+    unsigned int single_requests = 0;
+    unsigned int multiword_requests = 0;
+    TEST_CHECK_EQ(read_string(TRANSFER_MODE_SINGLE, PAGE_BYTES, str, sizeof(str), &single_requests), 1000);
+    TEST_CHECK_EQ(read_string(TRANSFER_MODE_MULTIWORD, PAGE_BYTES, str, sizeof(str), &multiword_requests), 1000);
+    TEST_CHECK_EQ(single_requests, 251);
+    // Reading ahead in chunks of 64 words
+    TEST_CHECK_EQ(multiword_requests, 4);
+}
+
+int main(void) {
+    test_every_length();
+    test_other_pages();
+    test_round_trips();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,250 @@
+#include "reg_mapped_loopback.h"
+#include "reg_mapped_msg_loopback.hpp"
+#include "test_util.h"
+
+#include "canmore/reg_mapped/client.h"
+#include "canmore/reg_mapped/server.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <vector>
+
+/*
+ * Checks register subscriptions end to end over CANmore messages, with the server sampling on a fake clock (which
+ * wraps partway through): the first sample is always notified, changes are held back until the interval has passed and
+ * they exceed the threshold, unchanged registers are still notified every keepalive, and registers which can no longer
+ * be read are notified once with the error. The listener's snapshots and callback must follow every notification.
+ * Splitting subscriptions across notifications is checked on a server over the in-process loopback, as a message
+ * always holds a whole subscription
+ */
+
+using namespace Canmore;
+
+namespace {
+
+constexpr uint16_t testPort = 24050;
+constexpr uint8_t mode = CANMORE_CONTROL_INTERFACE_MODE_NORMAL;
+constexpr uint8_t pageWords = 0;
+constexpr uint8_t pageCallback = 1;
+constexpr uint32_t startMs = UINT32_MAX - 150;
+
+struct Notification {
+    uint8_t page;
+    uint8_t offset;
+    int result;
+    std::vector<uint32_t> values;
+};
+
+// Notifications received by the listener's callback
+std::vector<Notification> received;
+
+// Samples subscriptions at the given time, returning the notifications received for the page
+std::vector<Notification> sampleAt(RegMappedMsgLoopback &loopback, uint32_t nowMs, uint8_t page) {
+    loopback.setClock(nowMs);
+    loopback.waitForTicks();
+    PollGroup group;
+    group.addFd(loopback.getAgent());
+    while (group.processEvent(20)) {}
+
+    std::vector<Notification> notifications;
+    for (auto &notification : received) {
+        if (notification.page == page) {
+            notifications.push_back(notification);
+        }
+    }
+    received.clear();
+    return notifications;
+}
+
+bool checkSnapshot(RegMappedNotificationListener &listener, uint8_t page, uint8_t offset, uint32_t value) {
+    RegMappedNotificationListener::RegisterSnapshot snapshot;
+    return listener.getSnapshot(page, offset, snapshot) && snapshot.result == REG_MAPPED_RESULT_SUCCESSFUL &&
+           snapshot.value == value;
+}
+
+void testMsgSubscriptions() {
+    std::vector<uint32_t> memory(16);
+    for (unsigned int i = 0; i < memory.size(); i++) {
+        memory[i] = 0x5000 + i;
+    }
+    std::atomic<bool> failReads { false };
+    std::atomic<uint32_t> callbackValue { 0x50 };
+
+    RegMappedMsgLoopback loopback(testPort);
+    loopback.getServer().addWordMappedPage(pageWords, REGISTER_PERM_READ_WRITE, memory);
+    auto registers = RegMappedRegisterPage::create();
+    registers->addCallbackRegister(0, REGISTER_PERM_READ_ONLY, [&](uint16_t, bool, uint32_t *data) {
+        *data = callbackValue;
+        return !failReads;
+    });
+    loopback.getServer().addRegisterPage(pageCallback, std::move(registers));
+    loopback.setClock(startMs);
+    loopback.start();
+    auto client = loopback.getClient();
+
+    RegMappedMsgNotificationListener listener(loopback.getAgent(), 1);
+    listener.setCallback([](uint8_t page, uint8_t offset, int result, const std::vector<uint32_t> &values) {
+        received.push_back({ page, offset, result, values });
+    });
+
+    // The current values are notified once subscribed
+    client->subscribe(mode, pageWords, 2, 4, 100, 10);
+    auto notifications = sampleAt(loopback, startMs, pageWords);
+    TEST_CHECK_EQ(notifications.size(), 1);
+    TEST_CHECK(notifications.size() == 1 && notifications[0].offset == 2 &&
+               notifications[0].result == REG_MAPPED_RESULT_SUCCESSFUL &&
+               notifications[0].values == std::vector<uint32_t>(memory.begin() + 2, memory.begin() + 6));
+    TEST_CHECK(checkSnapshot(listener, pageWords, 5, 0x5005));
+    RegMappedNotificationListener::RegisterSnapshot snapshot;
+    TEST_CHECK(!listener.getSnapshot(pageWords, 6, snapshot));
+
+    // Changes aren't sampled until the interval has passed
+    client->writeRegister(mode, pageWords, 3, 0x5003 + 50);
+    TEST_CHECK_EQ(sampleAt(loopback, startMs + 99, pageWords).size(), 0);
+    notifications = sampleAt(loopback, startMs + 100, pageWords);
+    TEST_CHECK(notifications.size() == 1 && notifications[0].values.size() == 4 &&
+               notifications[0].values[1] == 0x5003 + 50);
+    TEST_CHECK(checkSnapshot(listener, pageWords, 3, 0x5003 + 50));
+
+    // Changes within the threshold of the notified value are held back until they add up to more than it
+    client->writeRegister(mode, pageWords, 4, 0x5004 + 6);
+    TEST_CHECK_EQ(sampleAt(loopback, startMs + 200, pageWords).size(), 0);
+    client->writeRegister(mode, pageWords, 4, 0x5004 - 10);
+    TEST_CHECK_EQ(sampleAt(loopback, startMs + 300, pageWords).size(), 0);
+    client->writeRegister(mode, pageWords, 4, 0x5004 + 11);
+    notifications = sampleAt(loopback, startMs + 400, pageWords);
+    TEST_CHECK(notifications.size() == 1 && notifications[0].values.size() == 4 &&
+               notifications[0].values[2] == 0x5004 + 11);
+
+    // Unchanged registers are notified every keepalive since the first notification
+    TEST_CHECK(listener.getSnapshot(pageWords, 2, snapshot));
+    auto lastUpdate = snapshot.updated;
+    TEST_CHECK_EQ(sampleAt(loopback, startMs + REG_MAPPED_SUBSCRIPTION_KEEPALIVE_MS - 50, pageWords).size(), 0);
+    notifications = sampleAt(loopback, startMs + REG_MAPPED_SUBSCRIPTION_KEEPALIVE_MS + 50, pageWords);
+    TEST_CHECK(notifications.size() == 1 && notifications[0].values.size() == 4);
+    TEST_CHECK(listener.getSnapshot(pageWords, 2, snapshot) && snapshot.updated > lastUpdate);
+
+    // Nothing is notified once unsubscribed
+    client->unsubscribe(mode, pageWords, 2);
+    client->writeRegister(mode, pageWords, 3, 0);
+    TEST_CHECK_EQ(sampleAt(loopback, startMs + 3 * REG_MAPPED_SUBSCRIPTION_KEEPALIVE_MS, pageWords).size(), 0);
+
+    // Registers which can't be read are refused when subscribing
+    int errorCode = 0;
+    try {
+        client->subscribe(mode, pageCallback, 1, 1, 0);
+    } catch (const RegMappedClientError &e) {
+        errorCode = e.errorCode;
+    }
+    TEST_CHECK_EQ(errorCode, REG_MAPPED_RESULT_INVALID_REGISTER_ADDRESS);
+
+    // And notified once with the error when they stop being readable, and with the value once they can be read again
+    uint32_t nowMs = startMs + 4 * REG_MAPPED_SUBSCRIPTION_KEEPALIVE_MS;
+    loopback.setClock(nowMs);
+    client->subscribe(mode, pageCallback, 0, 1, 0);
+    TEST_CHECK_EQ(sampleAt(loopback, nowMs, pageCallback).size(), 1);
+    failReads = true;
+    notifications = sampleAt(loopback, nowMs + 1, pageCallback);
+    TEST_CHECK(notifications.size() == 1 && notifications[0].result == REG_MAPPED_RESULT_INVALID_DATA &&
+               notifications[0].values.empty());
+    TEST_CHECK(listener.getSnapshot(pageCallback, 0, snapshot) && snapshot.result == REG_MAPPED_RESULT_INVALID_DATA);
+    TEST_CHECK_EQ(sampleAt(loopback, nowMs + 2, pageCallback).size(), 0);
+    callbackValue = 0x51;
+    failReads = false;
+    notifications = sampleAt(loopback, nowMs + 3, pageCallback);
+    TEST_CHECK(notifications.size() == 1 && notifications[0].values == std::vector<uint32_t>({ 0x51 }));
+    TEST_CHECK(checkSnapshot(listener, pageCallback, 0, 0x51));
+    client->unsubscribe(mode, pageCallback, 0);
+}
+
+uint32_t memSplit[REG_MAPPED_SUBSCRIPTION_MAX_WORDS];
+
+const reg_mapped_server_page_def_t splitPages[] = {
+    { reg_mapped_server_page_def_t::PAGE_TYPE_MEMORY_MAPPED_WORD,
+      { .mem_mapped_word = { REGISTER_PERM_READ_WRITE, memSplit, std::size(memSplit) } } },
+};
+
+// Notifications sent by the loopback server
+std::vector<Notification> sent;
+
+void captureNotification(uint8_t *msg, size_t len, void *arg) {
+    (void) arg;
+    struct reg_mapped_notification header;
+    memcpy(&header, msg, sizeof(header));
+    std::vector<uint32_t> values((len - sizeof(header)) / sizeof(uint32_t));
+    memcpy(values.data(), msg + sizeof(header), values.size() * sizeof(uint32_t));
+    sent.push_back({ header.page, header.offset, header.result, values });
+}
+
+void testSplit() {
+    for (unsigned int i = 0; i < std::size(memSplit); i++) {
+        memSplit[i] = 0x5100 + i;
+    }
+    reg_mapped_loopback_t *loopback = reg_mapped_loopback_init(splitPages, std::size(splitPages), TRANSFER_MODE_SINGLE,
+                                                               0, 0);
+    reg_mapped_server_subscription_t subscriptions[2] = {};
+    loopback->server.subscriptions = subscriptions;
+    loopback->server.num_subscriptions = std::size(subscriptions);
+    loopback->server.notify_tx_func = &captureNotification;
+    loopback->server.notify_max_words = 5;
+
+    // Every register is sent when subscribing, split into notifications of at most notify_max_words
+    TEST_CHECK_EQ(reg_mapped_client_subscribe(&loopback->client, 0, 0, REG_MAPPED_SUBSCRIPTION_MAX_WORDS, 0, 0),
+                  REG_MAPPED_RESULT_SUCCESSFUL);
+    reg_mapped_server_tick(&loopback->server, 0);
+    TEST_CHECK_EQ(sent.size(), 4);
+    for (unsigned int i = 0; i < sent.size(); i++) {
+        TEST_CHECK_EQ(sent[i].offset, 5 * i);
+        TEST_CHECK_EQ(sent[i].values.size(), (i < 3 ? 5 : 1));
+        TEST_CHECK(std::equal(sent[i].values.begin(), sent[i].values.end(), &memSplit[5 * i]));
+    }
+
+    // Afterwards only the notifications holding a changed register are sent
+    sent.clear();
+    memSplit[7]++;
+    reg_mapped_server_tick(&loopback->server, 1);
+    TEST_CHECK(sent.size() == 1 && sent[0].offset == 5 && sent[0].values.size() == 5 &&
+               sent[0].values[2] == memSplit[7]);
+    sent.clear();
+    memSplit[0]++;
+    memSplit[15]++;
+    reg_mapped_server_tick(&loopback->server, 2);
+    TEST_CHECK(sent.size() == 2 && sent[0].offset == 0 && sent[1].offset == 15);
+    sent.clear();
+    reg_mapped_server_tick(&loopback->server, 3);
+    TEST_CHECK_EQ(sent.size(), 0);
+
+    // Subscriptions too large or crossing the end of the page are refused by the client, and malformed if sent
+    TEST_CHECK_EQ(reg_mapped_client_subscribe(&loopback->client, 0, 0, REG_MAPPED_SUBSCRIPTION_MAX_WORDS + 1, 0, 0),
+                  REG_MAPPED_CLIENT_RESULT_INVALID_ARG);
+    TEST_CHECK_EQ(reg_mapped_client_subscribe(&loopback->client, 0, REG_MAPPED_PAGE_NUM_WORDS - 2, 3, 0, 0),
+                  REG_MAPPED_CLIENT_RESULT_INVALID_ARG);
+    reg_mapped_request_t req = {};
+    req.subscribe_pkt.flags.f.write = true;
+    req.subscribe_pkt.flags.f.batch = true;
+    req.subscribe_pkt.flags.f.mode = CANMORE_CONTROL_INTERFACE_MODE_NORMAL;
+    req.subscribe_pkt.count = REG_MAPPED_SUBSCRIPTION_MAX_WORDS + 1;
+    reg_mapped_server_handle_request(&loopback->server, req.data, sizeof(req.subscribe_pkt));
+    reg_mapped_response_t resp = {};
+    TEST_CHECK(reg_mapped_loopback_client_rx(resp.data, sizeof(resp.write_pkt), 1, loopback));
+    TEST_CHECK_EQ(resp.write_pkt.result, REG_MAPPED_RESULT_MALFORMED_REQUEST);
+
+    // Only the preallocated number of subscriptions are kept
+    TEST_CHECK_EQ(reg_mapped_client_subscribe(&loopback->client, 0, 1, 1, 0, 0), REG_MAPPED_RESULT_SUCCESSFUL);
+    TEST_CHECK_EQ(reg_mapped_client_subscribe(&loopback->client, 0, 2, 1, 0, 0),
+                  REG_MAPPED_RESULT_SUBSCRIPTION_UNAVAILABLE);
+    // Subscribing at the same register replaces the subscription
+    TEST_CHECK_EQ(reg_mapped_client_subscribe(&loopback->client, 0, 1, 2, 0, 0), REG_MAPPED_RESULT_SUCCESSFUL);
+    TEST_CHECK_EQ(reg_mapped_client_unsubscribe(&loopback->client, 0, 1), REG_MAPPED_RESULT_SUCCESSFUL);
+    TEST_CHECK_EQ(reg_mapped_client_subscribe(&loopback->client, 0, 2, 1, 0, 0), REG_MAPPED_RESULT_SUCCESSFUL);
+}
+
+}  // namespace
+
+int main() {
+    testMsgSubscriptions();
+    testSplit();
+
+    return TEST_RESULT();
+}
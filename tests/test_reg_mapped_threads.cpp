@@ -0,0 +1,124 @@
+#include "reg_mapped_msg_loopback.hpp"
+#include "test_util.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/*
+ * Shares a single register mapped client between several threads, each accessing its own registers through every kind
+ * of access while another thread keeps changing the transaction chunk size and posted error callback. Each thread must
+ * read back exactly what it wrote, and every failed posted write must reach exactly one of the callbacks. Run under the
+ * sanitizers to catch races
+ */
+
+using namespace Canmore;
+
+namespace {
+
+constexpr uint16_t testPort = 24046;
+constexpr uint8_t page = 0;
+constexpr uint8_t pageReadOnly = 1;
+constexpr uint8_t mode = CANMORE_CONTROL_INTERFACE_MODE_NORMAL;
+
+constexpr int numThreads = 4;
+constexpr int iterations = 100;
+constexpr unsigned int wordsPerThread = REG_MAPPED_PAGE_NUM_WORDS / numThreads;
+
+std::atomic<int> postedErrors { 0 };
+
+void worker(RegMappedClient &client, int id) {
+    uint8_t base = id * wordsPerThread;
+    uint32_t seed = 0x4600 + id;
+
+    for (int iter = 0; iter < iterations; iter++) {
+        // Single registers
+        uint32_t value = test_rand(&seed);
+        client.writeRegister(mode, page, base, value);
+        TEST_CHECK_EQ(client.readRegister(mode, page, base), value);
+
+        // Arrays, split into chunks by the current chunk size
+        std::vector<uint32_t> data(wordsPerThread - 1);
+        for (auto &word : data) {
+            word = test_rand(&seed);
+        }
+        client.writeArray(mode, page, base + 1, data);
+        std::vector<uint32_t> readBack;
+        client.readArray(mode, page, base + 1, readBack, data.size());
+        TEST_CHECK(readBack == data);
+
+        // Batches
+        std::vector<RegMappedClient::BatchEntry> batch = {
+            RegMappedClient::BatchEntry::write(page, base, { value + 1 }),
+            RegMappedClient::BatchEntry::read(page, base, 2),
+        };
+        client.transact(mode, batch);
+        TEST_CHECK(batch[1].data.size() == 2 && batch[1].data[0] == value + 1 && batch[1].data[1] == data[0]);
+
+        // Posted writes, with a failing write every iteration on the first thread. The client has a single queue of
+        // posted writes, so the failure is reported by the next sync on any thread
+        client.postWriteRegister(mode, page, base, value + 2);
+        if (id == 0) {
+            client.postWriteRegister(mode, pageReadOnly, 0, 0);
+        }
+        try {
+            client.sync();
+        } catch (const RegMappedClientError &e) {
+            TEST_CHECK_EQ(e.errorCode, REG_MAPPED_RESULT_INVALID_REGISTER_MODE);
+        }
+        TEST_CHECK_EQ(client.readRegister(mode, page, base), value + 2);
+    }
+}
+
+}  // namespace
+
+int main() {
+    std::vector<uint32_t> memory(REG_MAPPED_PAGE_NUM_WORDS);
+    std::vector<uint32_t> readOnly(1);
+
+    RegMappedMsgLoopback loopback(testPort);
+    loopback.getServer().addWordMappedPage(page, REGISTER_PERM_READ_WRITE, memory);
+    loopback.getServer().addWordMappedPage(pageReadOnly, REGISTER_PERM_READ_ONLY, readOnly);
+    loopback.start();
+    auto client = loopback.getClient();
+    client->setPostedErrorCallback([](uint8_t, uint8_t, int) { postedErrors++; });
+
+    std::atomic<bool> stop { false };
+    std::thread configThread([&]() {
+        uint32_t seed = 0x46;
+        while (!stop) {
+            client->setTransactionChunkWords(test_rand(&seed) % 70);
+            if (test_rand(&seed) % 2) {
+                client->setPostedErrorCallback([](uint8_t, uint8_t, int) { postedErrors++; });
+            }
+            else {
+                client->setPostedErrorCallback([](uint8_t, uint8_t, int errorCode) {
+                    if (errorCode == REG_MAPPED_RESULT_INVALID_REGISTER_MODE) {
+                        postedErrors++;
+                    }
+                });
+            }
+            std::this_thread::yield();
+        }
+    });
+
+    std::vector<std::thread> workers;
+    for (int id = 0; id < numThreads; id++) {
+        workers.emplace_back([&client, id]() {
+            try {
+                worker(*client, id);
+            } catch (const std::exception &e) {
+                fprintf(stderr, "Thread %d failed: %s\n", id, e.what());
+                test_failures++;
+            }
+        });
+    }
+    for (auto &thread : workers) {
+        thread.join();
+    }
+    stop = true;
+    configThread.join();
+
+    TEST_CHECK_EQ(postedErrors, iterations);
+    return TEST_RESULT();
+}
@@ -0,0 +1,62 @@
+#ifndef CANMORE_TESTS__TEST_UTIL_H_
+#define CANMORE_TESTS__TEST_UTIL_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+/**
+ * @file test_util.h
+ * @brief Minimal check macros shared by the C and C++ tests
+ *
+ * Failed checks are reported with their location and counted, without stopping the test, and the test's main returns
+ * TEST_RESULT() so that ctest sees the failure.
+ */
+
+static int test_failures __attribute__((unused)) = 0;
+
+#define TEST_SKIP_RETURN_CODE 77
+
+#define TEST_CHECK(cond)                                                                                               \
+    do {                                                                                                               \
+        if (!(cond)) {                                                                                                 \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);                                  \
+            test_failures++;                                                                                           \
+        }                                                                                                              \
+    } while (0)
+
+#define TEST_CHECK_EQ(actual, expected)                                                                                \
+    do {                                                                                                               \
+        long long test_actual_ = (long long) (actual);                                                                 \
+        long long test_expected_ = (long long) (expected);                                                             \
+        if (test_actual_ != test_expected_) {                                                                          \
+            fprintf(stderr, "%s:%d: check failed: %s == %s (%lld != %lld)\n", __FILE__, __LINE__, #actual, #expected,  \
+                    test_actual_, test_expected_);                                                                     \
+            test_failures++;                                                                                           \
+        }                                                                                                              \
+    } while (0)
+
+#define TEST_RESULT() (test_failures ? (fprintf(stderr, "%d check(s) failed\n", test_failures), 1) : 0)
+
+/**
+ * @brief Returns a monotonic timestamp in nanoseconds, for benchmarks
+ */
+static inline uint64_t test_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec * 1000000000ull) + (uint64_t) ts.tv_nsec;
+}
+
+/**
+ * @brief Small deterministic PRNG (xorshift32), so test failures are reproducible
+ */
+static inline uint32_t test_rand(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+#endif
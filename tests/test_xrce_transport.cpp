@@ -0,0 +1,181 @@
+#include "test_util.h"
+
+#include "canmore_cpp/MsgAgent.hpp"
+#include "canmore_cpp/MsgClient.hpp"
+#include "canmore_cpp/XRCETransport.hpp"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/*
+ * Runs two XRCE client transports against an agent transport which echoes every packet back to the client which sent
+ * it, standing in for an XRCE agent. Carried over the UDP message transport on localhost, so no CAN interface is needed
+ */
+
+using namespace Canmore;
+
+namespace {
+
+constexpr uint16_t testPort = 24028;
+
+// Stand-in for uxrCustomTransport, which is all the templated callbacks need
+struct FakeCustomTransport {
+    void *args;
+};
+
+class NullAgentHandler : public AgentMsgHandler {
+public:
+    void handleMessage(uint8_t clientId, uint8_t subtype, std::span<const uint8_t> data) override {
+        (void) clientId;
+        (void) subtype;
+        (void) data;
+        unexpected++;
+    }
+    void handleDecodeError(uint8_t clientId, unsigned int errorCode) override {
+        (void) clientId;
+        (void) errorCode;
+        unexpected++;
+    }
+    std::atomic<int> unexpected { 0 };
+};
+
+class NullClientHandler : public ClientMsgHandler {
+public:
+    void handleMessage(uint8_t subtype, std::span<const uint8_t> data) override {
+        (void) subtype;
+        (void) data;
+        unexpected++;
+    }
+    void handleDecodeError(unsigned int errorCode) override {
+        (void) errorCode;
+        unexpected++;
+    }
+    int unexpected = 0;
+};
+
+std::vector<uint8_t> makePacket(uint8_t clientId, size_t len, uint32_t seq) {
+    std::vector<uint8_t> packet(len);
+    for (size_t i = 0; i < len; i++) {
+        packet[i] = (uint8_t) (clientId * 31 + seq * 7 + i);
+    }
+    return packet;
+}
+
+}  // namespace
+
+int main() {
+    struct in_addr localhost;
+    inet_aton("127.0.0.1", &localhost);
+
+    NullAgentHandler agentHandler;
+    NullClientHandler clientHandler;
+    MsgEthernetAgent agent(agentHandler, testPort, localhost);
+    MsgEthernetClient client1(localhost, 1, clientHandler, testPort);
+    MsgEthernetClient client2(localhost, 2, clientHandler, testPort);
+
+    // Echo agent, returning each packet to whichever client sent it (the agent learns each client's address from the
+    // first packet it sends)
+    XRCEAgentTransport agentTransport(agent);
+    TEST_CHECK(agentTransport.init());
+    std::atomic<bool> stop { false };
+    std::atomic<int> echoed { 0 };
+    std::thread echoThread([&]() {
+        std::vector<uint8_t> buf(XRCEAgentTransport::mtu);
+        while (!stop) {
+            uint8_t clientId;
+            XRCETransportRc rc;
+            ssize_t len = agentTransport.recv(clientId, buf.data(), buf.size(), 10, rc);
+            if (len >= 0 && rc == XRCETransportRc::ok) {
+                agentTransport.send(clientId, buf.data(), len, rc);
+                echoed++;
+            }
+        }
+    });
+
+    XRCEClientTransport adapter1(client1);
+    XRCEClientTransport adapter2(client2);
+    FakeCustomTransport transport1 { &adapter1 };
+    FakeCustomTransport transport2 { &adapter2 };
+
+    // Operations on a closed transport fail
+    uint8_t err = 0;
+    uint8_t byte = 0;
+    TEST_CHECK_EQ(XRCEClientTransport::write(&transport1, &byte, 1, &err), 0);
+    TEST_CHECK(err != 0);
+
+    TEST_CHECK(XRCEClientTransport::open(&transport1));
+    TEST_CHECK(XRCEClientTransport::open(&transport2));
+
+    // Packets of every size come back intact to the client which sent them, with their boundaries preserved
+    std::vector<uint8_t> rxBuf(XRCEClientTransport::mtu);
+    const size_t sizes[] = { 1, 2, 7, 8, 60, 61, 200, 511, 1000, XRCEClientTransport::mtu };
+    uint32_t seq = 0;
+    for (size_t len : sizes) {
+        for (uint8_t clientId = 1; clientId <= 2; clientId++) {
+            auto transport = (clientId == 1 ? &transport1 : &transport2);
+            auto packet = makePacket(clientId, len, seq++);
+
+            err = 0;
+            TEST_CHECK_EQ(XRCEClientTransport::write(transport, packet.data(), packet.size(), &err), len);
+            TEST_CHECK_EQ(err, 0);
+
+            size_t rxLen = XRCEClientTransport::read(transport, rxBuf.data(), rxBuf.size(), 1000, &err);
+            TEST_CHECK_EQ(err, 0);
+            TEST_CHECK_EQ(rxLen, len);
+            TEST_CHECK(std::equal(packet.begin(), packet.end(), rxBuf.begin()));
+        }
+    }
+
+    // Both clients in flight at once, each only receives its own packets
+    auto packet1 = makePacket(1, 100, seq++);
+    auto packet2 = makePacket(2, 300, seq++);
+    XRCEClientTransport::write(&transport1, packet1.data(), packet1.size(), &err);
+    XRCEClientTransport::write(&transport2, packet2.data(), packet2.size(), &err);
+    TEST_CHECK_EQ(XRCEClientTransport::read(&transport2, rxBuf.data(), rxBuf.size(), 1000, &err), packet2.size());
+    TEST_CHECK(std::equal(packet2.begin(), packet2.end(), rxBuf.begin()));
+    TEST_CHECK_EQ(XRCEClientTransport::read(&transport1, rxBuf.data(), rxBuf.size(), 1000, &err), packet1.size());
+    TEST_CHECK(std::equal(packet1.begin(), packet1.end(), rxBuf.begin()));
+
+    // Several packets arriving before a read are returned one per read, in order
+    for (int i = 0; i < 3; i++) {
+        auto packet = makePacket(1, 10 + i, i);
+        XRCEClientTransport::write(&transport1, packet.data(), packet.size(), &err);
+    }
+    for (int i = 0; i < 3; i++) {
+        auto packet = makePacket(1, 10 + i, i);
+        TEST_CHECK_EQ(XRCEClientTransport::read(&transport1, rxBuf.data(), rxBuf.size(), 1000, &err), packet.size());
+        TEST_CHECK(std::equal(packet.begin(), packet.end(), rxBuf.begin()));
+    }
+    TEST_CHECK_EQ(err, 0);
+
+    // A read with nothing to receive times out without an error
+    err = 0;
+    TEST_CHECK_EQ(XRCEClientTransport::read(&transport1, rxBuf.data(), rxBuf.size(), 20, &err), 0);
+    TEST_CHECK_EQ(err, 0);
+
+    // A packet larger than the read buffer is an error, as are packets larger than the MTU
+    auto bigPacket = makePacket(1, 50, seq++);
+    XRCEClientTransport::write(&transport1, bigPacket.data(), bigPacket.size(), &err);
+    TEST_CHECK_EQ(XRCEClientTransport::read(&transport1, rxBuf.data(), 20, 1000, &err), 0);
+    TEST_CHECK(err != 0);
+    err = 0;
+    std::vector<uint8_t> tooLarge(XRCEClientTransport::mtu + 1);
+    TEST_CHECK_EQ(XRCEClientTransport::write(&transport1, tooLarge.data(), tooLarge.size(), &err), 0);
+    TEST_CHECK(err != 0);
+
+    TEST_CHECK(XRCEClientTransport::close(&transport1));
+    TEST_CHECK(XRCEClientTransport::close(&transport2));
+
+    stop = true;
+    echoThread.join();
+    TEST_CHECK(agentTransport.fini());
+
+    // XRCE traffic must never leak through to the default handlers
+    TEST_CHECK_EQ(agentHandler.unexpected, 0);
+    TEST_CHECK_EQ(clientHandler.unexpected, 0);
+    TEST_CHECK(echoed > 0);
+    return TEST_RESULT();
+}